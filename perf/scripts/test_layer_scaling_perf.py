@@ -0,0 +1,113 @@
+#!/usr/bin/python3
+#
+# This is a script that will render single layers with synfig using different
+# numbers of rendering threads (SYNFIG_RENDERING_THREADS).  It records the
+# render time of each pass and stores those readings into a .csv file, so it
+# shows how well each layer scales with the number of threads.  To properly
+# run this:
+#
+# 1. This script needs to be placed in the root of the build directory, and run
+#    from that directory
+# 2. Don't have any applications running at the same time.  It can mess with the
+#    performance measurements.
+#
+# The test files are generated into TEST_DIR.  Each of them contains only one
+# layer with default parameters over the whole canvas, rendered into the null
+# target, so the time is spent mostly in the layer itself.  Layers which
+# are not marked as thread safe (Layer::is_render_thread_safe()) are rendered
+# by one thread, whatever the number of threads is.
+
+
+
+import os
+import time, datetime
+import csv
+import subprocess
+from collections import OrderedDict
+
+TEST_DIR = 'synfig-tests/layer-scaling/'
+SIF_EXE = 'output/bin/synfig'
+NUM_PASSES = 5
+NUM_FRAMES = 10
+WIDTH, HEIGHT = 1920, 1080
+THREADS = sorted(set([1, 2, 4, os.cpu_count() or 1]))
+LAYERS = [
+    'linear_gradient',
+    'radial_gradient',
+    'conical_gradient',
+    'spiral_gradient',
+    'noise',
+    'metaballs',
+]
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%i" height="%i" xres="2834.645669" yres="2834.645669" view-box="-4.000000 2.250000 4.000000 -2.250000" antialias="1" fps="24.000" begin-time="0f" end-time="%if" bgcolor="0.500000 0.500000 0.500000 1.000000">
+  <layer type="%s" active="true" exclude_from_rendering="false" version="0.0" desc="%s"/>
+</canvas>
+'''
+
+
+
+def make_test_file(layer):
+    os.makedirs(TEST_DIR, exist_ok=True)
+    sif_path = os.path.join(TEST_DIR, layer + '.sif')
+    with open(sif_path, 'w') as f:
+        f.write(SIF_TEMPLATE % (WIDTH, HEIGHT, NUM_FRAMES - 1, layer, layer))
+    return sif_path
+
+
+def run_pass(sif_path, threads):
+    env = dict(os.environ, SYNFIG_RENDERING_THREADS=str(threads))
+    st = time.time()
+    status = subprocess.call(
+        [SIF_EXE, sif_path, '-t', 'null', '--quiet'],
+        cwd=os.getcwd(), env=env,
+        stdout=subprocess.DEVNULL
+    )
+    et = time.time()
+    if status != 0:
+        print('%s: synfig failed with status %i' % (sif_path, status))
+    return et - st
+
+
+def main():
+    # Result of all the renders, key=(<layer>, <threads>), value=list[float]
+    all_renders = OrderedDict()
+
+    print('Doing (%i x %i x %i) render tests' % (len(LAYERS), len(THREADS), NUM_PASSES))
+
+    for layer in LAYERS:
+        sif_path = make_test_file(layer)
+        for threads in THREADS:
+            results = []
+            for i in range(0, NUM_PASSES):
+                rt = run_pass(sif_path, threads)
+                results.append(rt)
+                print('%s [%i threads %02i]  ::  %.4f sec' % (layer, threads, i + 1, rt))
+            all_renders[(layer, threads)] = results
+
+    # Write the results
+    time_str = datetime.datetime.now().strftime('%Y_%m_%d-%H_%M_%S')
+    result_filename = 'layer_scaling_n%s_%s.csv' % (NUM_PASSES, time_str)
+    with open(result_filename, 'w') as csv_file:
+        fieldnames = ['Layer', 'Threads'] \
+                   + ['Pass %i' % (x + 1) for x in range(0, NUM_PASSES)] \
+                   + ['Speedup']
+
+        wr = csv.writer(csv_file)
+        wr.writerow(fieldnames)
+
+        for (layer, threads), results in all_renders.items():
+            speedup = min(all_renders[(layer, THREADS[0])]) / max(min(results), 1e-6)
+            wr.writerow([layer, threads] + results + [speedup])
+
+    print('Wrote results to %s' % result_filename)
+    for layer in LAYERS:
+        base = min(all_renders[(layer, THREADS[0])])
+        print('%s: %s' % (layer, '  '.join(
+            '%i threads: x%.2f' % (threads, base / max(min(all_renders[(layer, threads)]), 1e-6))
+            for threads in THREADS )))
+
+
+if __name__ == '__main__':
+    main()
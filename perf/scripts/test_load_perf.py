@@ -0,0 +1,95 @@
+#!/usr/bin/python3
+#
+# This is a script that will load a set of .sif/.sifz files with synfig multiple
+# times, once with the streaming canvas loader and once with the old DOM loader
+# (SYNFIG_CANVAS_LOADER=dom).  It records load time and peak memory of each pass
+# and stores those readings into a .csv file.  To properly run this:
+#
+# 1. This script needs to be placed in the root of the build directory, and run
+#    from that directory
+# 2. Put the files to test into SIF_DIR.  The gain is visible on big files
+#    (e.g. with tens of thousands of waypoints), small files are loaded in
+#    a few milliseconds by both loaders.
+# 3. Don't have any applications running at the same time.  It can mess with the
+#    performance measurements.
+#
+# Only loading is measured: `--canvas-info` makes synfig exit right after the
+# file is opened.  Peak memory is the maximum resident set size of the process,
+# so it also includes memory used by synfig startup (modules, etc.)
+
+
+
+import os
+import time, datetime
+import csv
+import subprocess
+from collections import OrderedDict
+
+SIF_DIR = 'synfig-tests/load/'
+SIF_EXE = 'output/bin/synfig'
+NUM_PASSES = 5
+LOADERS = ['stream', 'dom']
+
+
+
+def run_pass(sif_path, loader):
+    env = dict(os.environ, SYNFIG_CANVAS_LOADER=loader)
+    st = time.time()
+    process = subprocess.Popen(
+        [SIF_EXE, sif_path, '--canvas-info=w', '--quiet'],
+        cwd=os.getcwd(), env=env,
+        stdout=subprocess.DEVNULL
+    )
+    _, status, usage = os.wait4(process.pid, 0)
+    et = time.time()
+    if status != 0:
+        print('%s: synfig failed with status %i' % (sif_path, status))
+    # ru_maxrss is in kilobytes on Linux
+    return et - st, usage.ru_maxrss / 1024.0
+
+
+def main():
+    # Get all of the .sif and .sifz files
+    all_sif = os.listdir(SIF_DIR)
+    all_sif = list(filter(lambda x: x.endswith('.sif') or x.endswith('.sifz'), all_sif))
+    all_sif.sort()
+
+    # Result of all the loads, key=(<filename>, <loader>), value=list[(time, memory)]
+    all_loads = OrderedDict()
+
+    print('Doing (%i x %i x %i) load tests' % (len(all_sif), len(LOADERS), NUM_PASSES))
+
+    total_load_time = dict((loader, 0.0) for loader in LOADERS)
+    for sif in all_sif:
+        sif_path = os.path.join(SIF_DIR, sif)
+
+        for loader in LOADERS:
+            results = []
+            for i in range(0, NUM_PASSES):
+                lt, mem = run_pass(sif_path, loader)
+                results.append((lt, mem))
+                total_load_time[loader] += lt
+                print('%s [%s %02i]  ::  %.4f sec  %.1f MB' % (sif, loader, i + 1, lt, mem))
+            all_loads[(sif, loader)] = results
+
+    # Write the results
+    time_str = datetime.datetime.now().strftime('%Y_%m_%d-%H_%M_%S')
+    result_filename = 'load_n%s_%s.csv' % (NUM_PASSES, time_str)
+    with open(result_filename, 'w') as csv_file:
+        fieldnames = ['.sif file', 'Loader'] \
+                   + ['Pass %i time' % (x + 1) for x in range(0, NUM_PASSES)] \
+                   + ['Pass %i peak MB' % (x + 1) for x in range(0, NUM_PASSES)]
+
+        wr = csv.writer(csv_file)
+        wr.writerow(fieldnames)
+
+        for (sif, loader), results in all_loads.items():
+            wr.writerow([sif, loader] + [r[0] for r in results] + [r[1] for r in results])
+
+    print('Wrote results to %s' % result_filename)
+    for loader in LOADERS:
+        print('Total Load Time (%s): %.4f sec' % (loader, total_load_time[loader]))
+
+
+if __name__ == '__main__':
+    main()
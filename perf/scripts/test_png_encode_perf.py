@@ -0,0 +1,144 @@
+#!/usr/bin/python3
+#
+# This is a script that will render an image sequence into the png target with
+# different numbers of encoder threads (SYNFIG_TARGET_PNG_ENCODE_THREADS).  It
+# records the time of each pass and stores those readings into a .csv file.
+# Every frame is decoded and compared with the frame written without encoder
+# threads, so the script also fails when the threads change the output.  To
+# properly run this:
+#
+# 1. This script needs to be placed in the root of the build directory, and run
+#    from that directory
+# 2. Don't have any applications running at the same time.  It can mess with the
+#    performance measurements.
+#
+# The test file is generated into TEST_DIR.  It has a noise layer animated by
+# its speed, so frames are different and not trivial to compress.  The seed is
+# fixed, otherwise the layer takes the current time as the seed.  Encoder
+# threads 0 means that frames are encoded by the rendering thread.
+
+
+
+import os
+import time, datetime
+import csv
+import shutil
+import subprocess
+from collections import OrderedDict
+
+from PIL import Image
+
+TEST_DIR = 'synfig-tests/png-encode/'
+SIF_EXE = 'output/bin/synfig'
+NUM_PASSES = 5
+NUM_FRAMES = 48
+WIDTH, HEIGHT = 1920, 1080
+ENCODE_THREADS = sorted(set([0, 1, 2, 4]))
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%i" height="%i" xres="2834.645669" yres="2834.645669" view-box="-4.000000 2.250000 4.000000 -2.250000" antialias="1" fps="24.000" begin-time="0f" end-time="%if" bgcolor="0.500000 0.500000 0.500000 1.000000">
+  <layer type="noise" active="true" exclude_from_rendering="false" version="0.0" desc="noise">
+    <param name="seed">
+      <integer value="1234"/>
+    </param>
+    <param name="speed">
+      <real value="1.0000000000"/>
+    </param>
+  </layer>
+</canvas>
+'''
+
+
+
+def make_test_file():
+    os.makedirs(TEST_DIR, exist_ok=True)
+    sif_path = os.path.join(TEST_DIR, 'noise.sif')
+    with open(sif_path, 'w') as f:
+        f.write(SIF_TEMPLATE % (WIDTH, HEIGHT, NUM_FRAMES - 1))
+    return sif_path
+
+
+def output_dir(threads):
+    return os.path.join(TEST_DIR, 'threads-%i' % threads)
+
+
+def run_pass(sif_path, threads):
+    out_dir = output_dir(threads)
+    shutil.rmtree(out_dir, ignore_errors=True)
+    os.makedirs(out_dir)
+    env = dict(os.environ, SYNFIG_TARGET_PNG_ENCODE_THREADS=str(threads))
+    st = time.time()
+    status = subprocess.call(
+        [SIF_EXE, sif_path, '-t', 'png', '-o', os.path.join(out_dir, 'frame.png'), '--quiet'],
+        cwd=os.getcwd(), env=env,
+        stdout=subprocess.DEVNULL
+    )
+    et = time.time()
+    if status != 0:
+        print('%s: synfig failed with status %i' % (sif_path, status))
+    return et - st
+
+
+def compare_frames(threads):
+    """Returns the list of frames that differ from the frames encoded without threads."""
+    base_dir = output_dir(ENCODE_THREADS[0])
+    out_dir = output_dir(threads)
+    base_files = sorted(os.listdir(base_dir))
+    if base_files != sorted(os.listdir(out_dir)) or len(base_files) != NUM_FRAMES:
+        return ['frame list']
+    errors = []
+    for name in base_files:
+        with Image.open(os.path.join(base_dir, name)) as a, Image.open(os.path.join(out_dir, name)) as b:
+            if a.size != b.size or a.mode != b.mode or a.tobytes() != b.tobytes():
+                errors.append(name)
+    return errors
+
+
+def main():
+    # Result of all the renders, key=<threads>, value=list[float]
+    all_renders = OrderedDict()
+
+    print('Doing (%i x %i) render tests' % (len(ENCODE_THREADS), NUM_PASSES))
+
+    sif_path = make_test_file()
+    failed = False
+    for threads in ENCODE_THREADS:
+        results = []
+        for i in range(0, NUM_PASSES):
+            rt = run_pass(sif_path, threads)
+            results.append(rt)
+            print('[%i encode threads %02i]  ::  %.4f sec' % (threads, i + 1, rt))
+        all_renders[threads] = results
+
+        errors = compare_frames(threads)
+        if errors:
+            failed = True
+            print('%i encode threads: output differs: %s' % (threads, ', '.join(errors)))
+
+    # Write the results
+    time_str = datetime.datetime.now().strftime('%Y_%m_%d-%H_%M_%S')
+    result_filename = 'png_encode_n%s_%s.csv' % (NUM_PASSES, time_str)
+    with open(result_filename, 'w') as csv_file:
+        fieldnames = ['Encode threads'] \
+                   + ['Pass %i' % (x + 1) for x in range(0, NUM_PASSES)] \
+                   + ['Frames per second', 'Speedup']
+
+        wr = csv.writer(csv_file)
+        wr.writerow(fieldnames)
+
+        base = min(all_renders[ENCODE_THREADS[0]])
+        for threads, results in all_renders.items():
+            best = max(min(results), 1e-6)
+            wr.writerow([threads] + results + [NUM_FRAMES / best, base / best])
+
+    print('Wrote results to %s' % result_filename)
+    print('  '.join(
+        '%i threads: %.2f fps x%.2f' % (threads, NUM_FRAMES / max(min(results), 1e-6), base / max(min(results), 1e-6))
+        for threads, results in all_renders.items() ))
+
+    if failed:
+        exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -42,6 +42,10 @@
 #include "lyr_freetype.h"
 
 #include <algorithm>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <memory>
 #include <glibmm.h>
 
 #if HAVE_HARFBUZZ
@@ -117,9 +121,167 @@ static const std::vector<uint32_t> line_endings{'\n', '\v', '\f', '\r', 0x0085,
 
 /* === C L A S S E S ======================================================= */
 
+/// Least recently used cache limited by memory usage.
+/// Values are shared, so evicted entries stay valid while someone uses them.
+/// Value type should provide `size` field with estimated memory usage in bytes.
+template<typename K, typename V>
+class TextCache {
+public:
+	typedef std::shared_ptr<const V> Handle;
+
+private:
+	typedef std::list<std::pair<K, Handle>> List;
+
+	std::mutex mutex;
+	List list; // recently used entries first
+	std::map<K, typename List::iterator> map;
+	size_t size = 0;
+	size_t max_size;
+	long long hits = 0;
+	long long misses = 0;
+
+	void erase(typename List::iterator i) {
+		size -= i->second->size;
+		map.erase(i->first);
+		list.erase(i);
+	}
+
+public:
+	explicit TextCache(size_t max_size): max_size(max_size) { }
+
+	Handle get(const K &key) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto iter = map.find(key);
+		if (iter == map.end()) {
+			++misses;
+			return Handle();
+		}
+		++hits;
+		list.splice(list.begin(), list, iter->second);
+		return iter->second->second;
+	}
+
+	void put(const K &key, const Handle &value) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto iter = map.find(key);
+		if (iter != map.end())
+			erase(iter->second);
+		list.emplace_front(key, value);
+		map[key] = list.begin();
+		size += value->size;
+		while (size > max_size && list.size() > 1)
+			erase(std::prev(list.end()));
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		map.clear();
+		list.clear();
+		size = 0;
+	}
+
+	std::string get_statistics() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return strprintf("%lld hits, %lld misses, %d entries, %d of %d KiB",
+			hits, misses, (int)list.size(), (int)(size/1024), (int)(max_size/1024));
+	}
+};
+
+/// Glyph loaded for a face scaled to specific size,
+/// keeps both the outline and the rasterized bitmap
+struct GlyphEntry {
+	FT_Glyph outline = nullptr;
+	FT_Glyph bitmap = nullptr;
+	FT_Vector advance = FT_Vector();
+	size_t size = 0;
+
+	GlyphEntry() = default;
+	GlyphEntry(const GlyphEntry&) = delete;
+	GlyphEntry& operator=(const GlyphEntry&) = delete;
+
+	~GlyphEntry() {
+		if (bitmap)
+			FT_Done_Glyph(bitmap);
+		if (outline)
+			FT_Done_Glyph(outline);
+	}
+};
+
+struct GlyphKey {
+	FT_Face face;
+	int x_res; //!< device resolution passed to FT_Set_Char_Size
+	int y_res;
+	FT_UInt index;
+	bool grid_fit;
+
+	bool operator<(const GlyphKey &other) const {
+		if (face != other.face) return face < other.face;
+		if (x_res != other.x_res) return x_res < other.x_res;
+		if (y_res != other.y_res) return y_res < other.y_res;
+		if (index != other.index) return index < other.index;
+		return grid_fit < other.grid_fit;
+	}
+};
+
+#if HAVE_HARFBUZZ
+/// Glyph indices produced by HarfBuzz for a span of text
+struct ShapeEntry {
+	std::vector<FT_UInt> glyphs;
+	size_t size = 0;
+};
+
+/// Each font meta has its own hb_font_t in FaceCache,
+/// and faces are never unloaded, so font pointer identifies the font.
+/// Shaping is used only to get glyph indices, so it doesn't depend on font size.
+struct ShapeKey {
+	hb_font_t *font;
+	hb_script_t script;
+	hb_direction_t direction;
+	std::vector<uint32_t> codepoints;
+
+	bool operator<(const ShapeKey &other) const {
+		if (font != other.font) return font < other.font;
+		if (script != other.script) return script < other.script;
+		if (direction != other.direction) return direction < other.direction;
+		return codepoints < other.codepoints;
+	}
+};
+#endif
+
+/// Process-wide caches of glyphs and shaped text spans
+struct GlyphCache {
+	TextCache<GlyphKey, GlyphEntry> glyphs;
+#if HAVE_HARFBUZZ
+	TextCache<ShapeKey, ShapeEntry> shapes;
+#endif
+
+	static GlyphCache& instance() {
+		static GlyphCache obj;
+		return obj;
+	}
+
+	GlyphCache(const GlyphCache&) = delete;
+	void operator=(const GlyphCache&) = delete;
+
+private:
+	static size_t get_max_size() {
+		// size in megabytes may be set by environment variable
+		const char *s = getenv("SYNFIG_TEXT_CACHE_SIZE");
+		int megabytes = s ? atoi(s) : 0;
+		return (megabytes > 0 ? megabytes : 32)*size_t(1024*1024);
+	}
+
+	GlyphCache():
+		glyphs(get_max_size())
+#if HAVE_HARFBUZZ
+		, shapes(get_max_size()/8)
+#endif
+	{ }
+};
+
 struct Glyph
 {
-	FT_Glyph glyph;
+	std::shared_ptr<const GlyphEntry> entry;
 	FT_Vector pos;
 };
 
@@ -137,7 +299,7 @@ struct VisualTextLine
 			FT_BBox   glyph_bbox;
 
 			//FT_Glyph_Get_CBox( glyphs[n], ft_glyph_bbox_pixels, &glyph_bbox );
-			FT_Glyph_Get_CBox( glyph.glyph, ft_glyph_bbox_subpixels, &glyph_bbox );
+			FT_Glyph_Get_CBox( glyph.entry->outline, ft_glyph_bbox_subpixels, &glyph_bbox );
 
 			if(glyph_bbox.yMax>height)
 				height=glyph_bbox.yMax;
@@ -1021,12 +1183,14 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
 	std::lock_guard<std::recursive_mutex> lock(freetype_mutex);
 
 #define CHAR_RESOLUTION		(64)
+	const int x_res = round_to_int(std::fabs(size[0]*pw*CHAR_RESOLUTION));
+	const int y_res = round_to_int(std::fabs(size[1]*ph*CHAR_RESOLUTION));
 	error = FT_Set_Char_Size(
 		face,						// handle to face object
 		CHAR_RESOLUTION,	// char_width in 1/64th of points
 		CHAR_RESOLUTION,	// char_height in 1/64th of points
-		round_to_int(std::fabs(size[0]*pw*CHAR_RESOLUTION)),   // horizontal device resolution
-		round_to_int(std::fabs(size[1]*ph*CHAR_RESOLUTION)) ); // vertical device resolution
+		x_res,   // horizontal device resolution
+		y_res ); // vertical device resolution
 
 	// Here is where we can compensate for the
 	// error in freetype's rendering engine.
@@ -1040,7 +1204,7 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
 		if(cb)cb->warning(std::string("Layer_Freetype:")+_("Unable to set face size.")+strprintf(" (err=%d)",error));
 	}
 
-	FT_GlyphSlot  slot = face->glyph;  // a small shortcut
+	GlyphCache &glyph_cache = GlyphCache::instance();
 	FT_UInt       glyph_index(0);
 	FT_UInt       previous(0);
 
@@ -1067,26 +1231,42 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
 
 		for (const TextSpan& span : line) {
 #if HAVE_HARFBUZZ
-			hb_buffer_clear_contents(span_buffer);
-
 			hb_direction_t direction = HB_DIRECTION_LTR; // character order already fixed by FriBiDi
-			hb_buffer_set_direction(span_buffer, direction);
-			hb_buffer_set_script(span_buffer, span.script);
-//			hb_buffer_set_language(span_buffer, hb_language_from_string(language.c_str(), -1));
-
-			hb_buffer_add_utf32(span_buffer, span.codepoints.data(), span.codepoints.size(), 0, -1);
-
-			hb_shape(font, span_buffer, nullptr, 0);
+			ShapeKey shape_key = { font, span.script, direction, span.codepoints };
+			std::shared_ptr<const ShapeEntry> shape = glyph_cache.shapes.get(shape_key);
+			if (!shape) {
+				hb_buffer_clear_contents(span_buffer);
+
+				hb_buffer_set_direction(span_buffer, direction);
+				hb_buffer_set_script(span_buffer, span.script);
+//				hb_buffer_set_language(span_buffer, hb_language_from_string(language.c_str(), -1));
+
+				hb_buffer_add_utf32(span_buffer, span.codepoints.data(), span.codepoints.size(), 0, -1);
+
+				hb_shape(font, span_buffer, nullptr, 0);
+
+				unsigned int glyph_count;
+				hb_glyph_info_t *glyph_info = hb_buffer_get_glyph_infos(span_buffer, &glyph_count);
+
+				std::shared_ptr<ShapeEntry> new_shape = std::make_shared<ShapeEntry>();
+				new_shape->glyphs.reserve(glyph_count);
+				for (unsigned int i = 0; i < glyph_count; ++i)
+					new_shape->glyphs.push_back(glyph_info[i].codepoint);
+				new_shape->size = sizeof(ShapeKey) + sizeof(ShapeEntry)
+				                + span.codepoints.size()*sizeof(uint32_t)
+				                + glyph_count*sizeof(FT_UInt);
+				glyph_cache.shapes.put(shape_key, new_shape);
+				shape = new_shape;
+			}
 
-			unsigned int glyph_count;
-			hb_glyph_info_t *glyph_info = hb_buffer_get_glyph_infos(span_buffer, &glyph_count);
+			size_t glyph_count = shape->glyphs.size();
 #else
 			size_t glyph_count = span.codepoints.size();
 #endif
 
 			for (size_t i = 0; i < glyph_count; i++) {
 #if HAVE_HARFBUZZ
-				glyph_index = glyph_info[i].codepoint;
+				glyph_index = shape->glyphs[i];
 #else
 				glyph_index = FT_Get_Char_Index(face, span.codepoints[i]);
 #endif
@@ -1118,27 +1298,54 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
         curr_glyph.pos.x = bx;
         curr_glyph.pos.y = by;
 
-        // load glyph image into the slot. DO NOT RENDER IT !!
-		if(grid_fit)
-			error = FT_Load_Glyph( face, glyph_index, FT_LOAD_DEFAULT);
-		else
-			error = FT_Load_Glyph( face, glyph_index, FT_LOAD_DEFAULT|FT_LOAD_NO_HINTING );
-        if (error) continue;  // ignore errors, jump to next glyph
+		GlyphKey glyph_key = { face, x_res, y_res, glyph_index, grid_fit };
+		curr_glyph.entry = glyph_cache.glyphs.get(glyph_key);
+		if (!curr_glyph.entry) {
+			// load glyph image into the slot
+			if(grid_fit)
+				error = FT_Load_Glyph( face, glyph_index, FT_LOAD_DEFAULT);
+			else
+				error = FT_Load_Glyph( face, glyph_index, FT_LOAD_DEFAULT|FT_LOAD_NO_HINTING );
+			if (error) continue;  // ignore errors, jump to next glyph
+
+			std::shared_ptr<GlyphEntry> entry = std::make_shared<GlyphEntry>();
+			entry->advance = face->glyph->advance;
+
+			// extract glyph image and rasterize a copy of it,
+			// bitmap doesn't depend on pen position, so it can be reused
+			error = FT_Get_Glyph( face->glyph, &entry->outline );
+			if (error) continue;  // ignore errors, jump to next glyph
+			entry->bitmap = entry->outline;
+			if (FT_Glyph_To_Bitmap( &entry->bitmap, FT_RENDER_MODE_NORMAL, nullptr, 0 ))
+				entry->bitmap = nullptr;
+
+			entry->size = sizeof(GlyphKey) + sizeof(GlyphEntry);
+			if (entry->outline->format == FT_GLYPH_FORMAT_OUTLINE) {
+				const FT_Outline &outline = ((FT_OutlineGlyph)entry->outline)->outline;
+				entry->size += sizeof(FT_OutlineGlyphRec)
+				             + outline.n_points*(sizeof(FT_Vector) + sizeof(char))
+				             + outline.n_contours*sizeof(short);
+			}
+			if (entry->bitmap) {
+				const FT_Bitmap &bitmap = ((FT_BitmapGlyph)entry->bitmap)->bitmap;
+				entry->size += sizeof(FT_BitmapGlyphRec) + bitmap.rows*std::abs(bitmap.pitch);
+			}
 
-        // extract glyph image and store it in our table
-        error = FT_Get_Glyph( face->glyph, &curr_glyph.glyph );
-        if (error) continue;  // ignore errors, jump to next glyph
+			glyph_cache.glyphs.put(glyph_key, entry);
+			curr_glyph.entry = entry;
+		}
+		const FT_Vector &advance = curr_glyph.entry->advance;
 
         // record current glyph index
         previous = glyph_index;
 
 		// Update the line width
-		visual_lines.front().width=bx+slot->advance.x;
+		visual_lines.front().width=bx+advance.x;
 
 		// increment pen position
-		bx += round_to_int(slot->advance.x*compress);
+		bx += round_to_int(advance.x*compress);
 
-		by += slot->advance.y;
+		by += advance.y;
 
 		visual_lines.front().glyph_table.push_back(curr_glyph);
 
@@ -1203,17 +1410,14 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
 			std::vector<Glyph>::iterator iter2;
 			for(iter2=iter->glyph_table.begin();iter2!=iter->glyph_table.end();++iter2)
 			{
-				FT_Glyph  image(iter2->glyph);
 				FT_Vector pen;
 				FT_BitmapGlyph  bit;
 
 				pen.x = bx + iter2->pos.x;
 				pen.y = by + iter2->pos.y;
 
-				error = FT_Glyph_To_Bitmap( &image, FT_RENDER_MODE_NORMAL, nullptr/*&pen*/, 1 );
-				if(error) { FT_Done_Glyph( image ); continue; }
-
-				bit = (FT_BitmapGlyph)image;
+				if (!iter2->entry->bitmap) continue;
+				bit = (FT_BitmapGlyph)iter2->entry->bitmap;
 
 				for(size_t v=0; v<bit->bitmap.rows; v++)
 					for(size_t u=0; u<bit->bitmap.width; u++)
@@ -1231,8 +1435,6 @@ Layer_Freetype::accelerated_render(Context context,Surface *surface,int quality,
 							(*surface)[y][x]=Color::blend(color,(*src_surface)[y][x],myamount*get_amount(),get_blend_method());
 						}
 					}
-
-				FT_Done_Glyph( image );
 			}
 		}
 	}
@@ -1252,6 +1454,18 @@ Layer_Freetype::get_bounding_rect()const
 	return synfig::Rect::full_plane();
 }
 
+void
+Layer_Freetype::clear_cache()
+{
+	GlyphCache &glyph_cache = GlyphCache::instance();
+	synfig::info("Layer_Freetype: glyph cache: %s", glyph_cache.glyphs.get_statistics().c_str());
+	glyph_cache.glyphs.clear();
+#if HAVE_HARFBUZZ
+	synfig::info("Layer_Freetype: shaping cache: %s", glyph_cache.shapes.get_statistics().c_str());
+	glyph_cache.shapes.clear();
+#endif
+}
+
 void
 Layer_Freetype::on_param_text_changed()
 {
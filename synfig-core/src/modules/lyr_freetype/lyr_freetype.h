@@ -127,6 +127,9 @@ public:
 
 	synfig::Rect get_bounding_rect() const override;
 
+	//! Releases cached glyphs and shaped text, should be called before FreeType is done
+	static void clear_cache();
+
 private:
 	void new_font(const synfig::String &family, int style=0, int weight=400);
 	bool new_font_(const synfig::String &family, int style=0, int weight=400);
@@ -67,6 +67,7 @@ bool freetype_constructor(synfig::ProgressCallback *cb)
 
 void freetype_destructor()
 {
+	Layer_Freetype::clear_cache();
 	FT_Done_FreeType(ft_library);
 	std::cerr<<"freetype_destructor()"<<std::endl;
 }
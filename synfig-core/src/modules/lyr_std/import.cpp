@@ -227,3 +227,10 @@ Import::load_resources_vfunc(IndependentContext context, Time time)const
 			importer->get_frame(get_canvas()->rend_desc(), time+time_offset) );
 	context.load_resources(time);
 }
+
+bool
+Import::get_time_dependency_vfunc(const Time &a, const Time &b)const
+{
+	return (importer && importer->is_animated())
+	    || Layer_Bitmap::get_time_dependency_vfunc(a, b);
+}
@@ -75,6 +75,9 @@ public:
 
 	virtual void set_time_vfunc(IndependentContext context, Time time)const;
 	virtual void load_resources_vfunc(IndependentContext context, Time time)const;
+
+protected:
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b)const;
 };
 
 }; // END of namespace lyr_std
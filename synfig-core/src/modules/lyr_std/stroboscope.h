@@ -69,6 +69,10 @@ public:
 	virtual Vocab get_param_vocab()const;
 
 	virtual void set_time_vfunc(IndependentContext context, Time time)const;
+
+protected:
+	//! Layers below are shown at other time, so result always depends on time
+	virtual bool get_time_dependency_vfunc(const Time &/*a*/, const Time &/*b*/)const { return true; }
 };
 
 }; // END of namespace lyr_std
@@ -57,6 +57,7 @@ MODULE_INVENTORY_BEGIN(mod_ffmpeg)
 		TARGET_EXT(ffmpeg_trgt,"avi")
 		TARGET_EXT(ffmpeg_trgt,"flv")
 		TARGET_EXT(ffmpeg_trgt,"mkv")
+		TARGET_EXT(ffmpeg_trgt,"mov")
 		TARGET_EXT(ffmpeg_trgt,"mpg")
 		TARGET_EXT(ffmpeg_trgt,"mpeg")
 		TARGET_EXT(ffmpeg_trgt,"mp4")
@@ -37,7 +37,13 @@
 #include <synfig/general.h>
 #include <synfig/soundprocessor.h>
 
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <glib/gstdio.h>
 
 #include "trgt_ffmpeg.h"
@@ -71,6 +77,150 @@ SYNFIG_TARGET_SET_NAME(ffmpeg_trgt,"ffmpeg");
 SYNFIG_TARGET_SET_EXT(ffmpeg_trgt,"mpg");
 SYNFIG_TARGET_SET_VERSION(ffmpeg_trgt,"0.1");
 
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+bool
+is_little_endian()
+{
+	const uint16_t x = 1;
+	return *(const unsigned char*)&x == 1;
+}
+
+//! codecs which can store alpha channel of rawvideo frames
+bool
+is_alpha_codec(const std::string &codec)
+{
+	return codec == "prores-4444"
+	    || codec == "qtrle"
+	    || codec == "png"
+	    || codec == "ffv1";
+}
+
+inline void
+put_uint16le(unsigned char *dst, ColorReal x)
+{
+	int i = (int)(clamp(x, ColorReal(0), ColorReal(1))*ColorReal(65535) + ColorReal(0.5));
+	dst[0] = (unsigned char)(i & 0xff);
+	dst[1] = (unsigned char)(i >> 8);
+}
+
+void
+pack_rgba64le(unsigned char *dst, const Surface &surface)
+{
+	for(int y = 0; y < surface.get_h(); ++y) {
+		const Color *src = surface[y];
+		for(const Color *end = src + surface.get_w(); src < end; ++src, dst += 8) {
+			put_uint16le(dst + 0, src->get_r());
+			put_uint16le(dst + 2, src->get_g());
+			put_uint16le(dst + 4, src->get_b());
+			put_uint16le(dst + 6, src->get_a());
+		}
+	}
+}
+
+//! host byte order, planes are G, B, R, A
+void
+pack_gbrapf32(unsigned char *dst, const Surface &surface)
+{
+	const int w = surface.get_w(), h = surface.get_h();
+	float *g = (float*)dst;
+	float *b = g + w*h;
+	float *r = b + w*h;
+	float *a = r + w*h;
+	for(int y = 0; y < h; ++y) {
+		const Color *src = surface[y];
+		for(const Color *end = src + w; src < end; ++src) {
+			*g++ = src->get_g();
+			*b++ = src->get_b();
+			*r++ = src->get_r();
+			*a++ = clamp(src->get_a(), ColorReal(0), ColorReal(1));
+		}
+	}
+}
+
+}
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+//! Sends frames to ffmpeg in separate thread, so encoding overlaps rendering
+class ffmpeg_trgt::Writer
+{
+private:
+	//! count of frames waiting for writing, limits memory usage
+	static const size_t max_queue = 2;
+
+	FILE *file;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque< std::vector<unsigned char> > queue;
+	std::vector< std::vector<unsigned char> > spare;
+	bool stopped;
+	bool failed;
+	std::thread thread;
+
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true) {
+			cond.wait(lock, [this] { return stopped || !queue.empty(); });
+			if (queue.empty()) break;
+
+			std::vector<unsigned char> buffer;
+			std::swap(buffer, queue.front());
+			queue.pop_front();
+			cond.notify_all();
+
+			lock.unlock();
+			bool success = failed || fwrite(&buffer.front(), 1, buffer.size(), file) == buffer.size();
+			lock.lock();
+
+			if (!success) failed = true;
+			spare.push_back(std::vector<unsigned char>());
+			std::swap(spare.back(), buffer);
+		}
+	}
+
+public:
+	explicit Writer(FILE *file):
+		file(file), stopped(), failed(),
+		thread(&Writer::run, this)
+	{ }
+
+	~Writer() { finish(); }
+
+	//! takes buffer of already written frame to avoid reallocation
+	void reuse_buffer(std::vector<unsigned char> &buffer) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!spare.empty()) {
+			std::swap(buffer, spare.back());
+			spare.pop_back();
+		}
+	}
+
+	//! moves content of buffer into queue, waits while queue is full
+	bool push(std::vector<unsigned char> &buffer) {
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait(lock, [this] { return failed || queue.size() < max_queue; });
+		if (failed) return false;
+		queue.push_back(std::vector<unsigned char>());
+		std::swap(queue.back(), buffer);
+		cond.notify_all();
+		return true;
+	}
+
+	//! writes all queued frames and stops thread
+	bool finish() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopped = true;
+			cond.notify_all();
+		}
+		if (thread.joinable()) thread.join();
+		return !failed;
+	}
+};
+
 /* === M E T H O D S ======================================================= */
 
 ffmpeg_trgt::ffmpeg_trgt(const char *Filename, const synfig::TargetParam &params):
@@ -81,10 +231,11 @@ ffmpeg_trgt::ffmpeg_trgt(const char *Filename, const synfig::TargetParam &params
 	sound_filename(""),
 	buffer(NULL),
 	color_buffer(NULL),
-	bitrate()
+	bitrate(),
+	frame_format(FORMAT_PPM),
+	writer(NULL),
+	write_failed(false)
 {
-	set_alpha_mode(TARGET_ALPHA_MODE_FILL);
-
 	// Set default video codec and bitrate if they weren't given.
 	if (params.video_codec == "none")
 		video_codec = "mpeg1video";
@@ -95,10 +246,38 @@ ffmpeg_trgt::ffmpeg_trgt(const char *Filename, const synfig::TargetParam &params
 		bitrate = 200;
 	else
 		bitrate = params.bitrate;
+
+	// PPM frames have no alpha and only 8 bits per channel
+	if (is_alpha_codec(video_codec))
+		frame_format = FORMAT_RGBA64;
+	if (const char *s = getenv("SYNFIG_TARGET_FFMPEG_FRAME_FORMAT")) {
+		String format(s);
+		if (format == "ppm")
+			frame_format = FORMAT_PPM;
+		else
+		if (format == "rgba64le")
+			frame_format = FORMAT_RGBA64;
+		else
+		if (format == "gbrapf32")
+			frame_format = FORMAT_GBRAPF32;
+		else
+			synfig::warning("SYNFIG_TARGET_FFMPEG_FRAME_FORMAT: unknown format '%s'", s);
+	}
+
+	set_alpha_mode(frame_format != FORMAT_PPM && is_alpha_codec(video_codec)
+		? TARGET_ALPHA_MODE_KEEP : TARGET_ALPHA_MODE_FILL);
 }
 
 ffmpeg_trgt::~ffmpeg_trgt()
 {
+	if (writer)
+	{
+		if (!writer->finish())
+			synfig::error(_("Unable to write frames to ffmpeg"));
+		delete writer;
+		writer = NULL;
+	}
+
 	if(file)
 	{
 #if defined(WIN32_PIPE_TO_PROCESSES)
@@ -228,7 +407,10 @@ ffmpeg_trgt::init(ProgressCallback *cb=NULL)
 	// this should avoid conflicts with locale settings
 	synfig::ChangeLocale change_locale(LC_NUMERIC, "C");
 	
-	std::string video_codec_real = (video_codec == "libx264-lossless" ? "libx264" : video_codec);
+	std::string video_codec_real =
+		video_codec == "libx264-lossless" ? "libx264"
+	  : video_codec == "prores-4444"      ? "prores_ks"
+	  : video_codec;
 
 	std::vector<std::string> vargs;
 	vargs.emplace_back(ffmpeg_binary_path);
@@ -240,10 +422,22 @@ ffmpeg_trgt::init(ProgressCallback *cb=NULL)
 		vargs.emplace_back(sound_filename);
 #endif
 	}
-	vargs.emplace_back("-f");
-	vargs.emplace_back("image2pipe");
-	vargs.emplace_back("-vcodec");
-	vargs.emplace_back("ppm");
+	if (frame_format == FORMAT_PPM) {
+		vargs.emplace_back("-f");
+		vargs.emplace_back("image2pipe");
+		vargs.emplace_back("-vcodec");
+		vargs.emplace_back("ppm");
+	} else {
+		vargs.emplace_back("-f");
+		vargs.emplace_back("rawvideo");
+		vargs.emplace_back("-pix_fmt");
+		vargs.emplace_back(
+			frame_format == FORMAT_RGBA64 ? "rgba64le"
+		  : is_little_endian()           ? "gbrapf32le"
+		  :                                "gbrapf32be" );
+		vargs.emplace_back("-s");
+		vargs.emplace_back(etl::strprintf("%dx%d", desc.get_w(), desc.get_h()));
+	}
 	vargs.emplace_back("-r");
 	vargs.emplace_back(etl::strprintf("%f", desc.get_frame_rate()));
 	vargs.emplace_back("-i");
@@ -252,8 +446,16 @@ ffmpeg_trgt::init(ProgressCallback *cb=NULL)
 	vargs.emplace_back(etl::strprintf("title=\"%s\"", get_canvas()->get_name().c_str()));
 	vargs.emplace_back("-vcodec");
 	vargs.emplace_back(video_codec_real);
-	vargs.emplace_back("-b:v");
-	vargs.emplace_back(etl::strprintf("%ik", bitrate));
+	if (video_codec == "prores-4444") {
+		// quality is controlled by profile, bitrate is ignored
+		vargs.emplace_back("-profile:v");
+		vargs.emplace_back("4444");
+		vargs.emplace_back("-pix_fmt");
+		vargs.emplace_back("yuva444p10le");
+	} else {
+		vargs.emplace_back("-b:v");
+		vargs.emplace_back(etl::strprintf("%ik", bitrate));
+	}
 	if (video_codec == "libx264-lossless") {
 		vargs.emplace_back("-tune");
 		vargs.emplace_back("fastdecode");
@@ -361,14 +563,48 @@ ffmpeg_trgt::init(ProgressCallback *cb=NULL)
 		return false;
 	}
 
+	if (frame_format != FORMAT_PPM)
+	{
+		const char *s = getenv("SYNFIG_TARGET_FFMPEG_WRITER_THREAD");
+		if (!s || atoi(s) != 0)
+			writer = new Writer(file);
+	}
+
 	return true;
 }
 
+bool
+ffmpeg_trgt::write_frame()
+{
+	const size_t pixel_size = frame_format == FORMAT_RGBA64 ? 4*sizeof(uint16_t) : 4*sizeof(float);
+	const size_t size = pixel_size*frame.get_w()*frame.get_h();
+
+	if (writer)
+		writer->reuse_buffer(frame_buffer);
+	frame_buffer.resize(size);
+
+	if (frame_format == FORMAT_RGBA64)
+		pack_rgba64le(&frame_buffer.front(), frame);
+	else
+		pack_gbrapf32(&frame_buffer.front(), frame);
+
+	if (writer)
+		return writer->push(frame_buffer);
+	return fwrite(&frame_buffer.front(), 1, size, file) == size;
+}
+
 void
 ffmpeg_trgt::end_frame()
 {
+	if (frame_format != FORMAT_PPM && file && !write_frame())
+	{
+		synfig::error(_("Unable to write frame to ffmpeg"));
+		write_failed = true;
+	}
+
 	//fprintf(file, " ");
-	fflush(file);
+	if (!writer)
+		fflush(file);
 	imagecount++;
 }
 
@@ -377,9 +613,16 @@ ffmpeg_trgt::start_frame(synfig::ProgressCallback */*callback*/)
 {
 	int w=desc.get_w(),h=desc.get_h();
 
-	if(!file)
+	if(!file || write_failed)
 		return false;
 
+	if (frame_format != FORMAT_PPM)
+	{
+		if (frame.get_w() != w || frame.get_h() != h)
+			frame.set_wh(w, h);
+		return true;
+	}
+
 	fprintf(file, "P6\n");
 	fprintf(file, "%d %d\n", w, h);
 	fprintf(file, "%d\n", 255);
@@ -393,9 +636,18 @@ ffmpeg_trgt::start_frame(synfig::ProgressCallback */*callback*/)
 }
 
 Color *
-ffmpeg_trgt::start_scanline(int /*scanline*/)
+ffmpeg_trgt::start_scanline(int scanline)
+{
+	return frame_format == FORMAT_PPM ? color_buffer : frame[scanline];
+}
+
+Color *
+ffmpeg_trgt::start_scanlines(int scanline, int /*count*/, int &pitch)
 {
-	return color_buffer;
+	if (frame_format == FORMAT_PPM)
+		return NULL;
+	pitch = frame.get_pitch();
+	return frame[scanline];
 }
 
 bool
@@ -403,6 +655,8 @@ ffmpeg_trgt::end_scanline()
 {
 	if(!file)
 		return false;
+	if (frame_format != FORMAT_PPM)
+		return true;
 
 	color_to_pixelformat(buffer, color_buffer, PF_RGB, 0, desc.get_w());
 
@@ -33,8 +33,10 @@
 #include <synfig/target_scanline.h>
 #include <synfig/string.h>
 #include <synfig/targetparam.h>
+#include <synfig/surface.h>
 #include <sys/types.h>
 #include <cstdio>
+#include <vector>
 
 /* === M A C R O S ========================================================= */
 
@@ -47,6 +49,16 @@ class TargetParam;
 class ffmpeg_trgt : public synfig::Target_Scanline
 {
 	SYNFIG_TARGET_MODULE_EXT
+public:
+	//! Format of frames sent to ffmpeg
+	enum FrameFormat {
+		FORMAT_PPM,        //!< 8-bit RGB, no alpha, written by scanlines
+		FORMAT_RGBA64,     //!< rawvideo, 16-bit RGBA, little-endian
+		FORMAT_GBRAPF32    //!< rawvideo, planar float GBRA, unclamped colors
+	};
+
+	class Writer;
+
 private:
 #ifdef HAVE_FORK
 	pid_t pid = -1;
@@ -60,6 +72,17 @@ private:
 	synfig::Color *color_buffer;
 	std::string video_codec;
 	int bitrate;
+
+	FrameFormat frame_format;
+	//! whole frame, used by rawvideo formats
+	synfig::Surface frame;
+	std::vector<unsigned char> frame_buffer;
+	//! writes frames in separate thread, NULL when disabled
+	Writer *writer;
+	bool write_failed;
+
+	bool write_frame();
+
 public:
 	ffmpeg_trgt(const char *filename,
 				const synfig::TargetParam& params);
@@ -72,6 +95,8 @@ public:
 
 	virtual synfig::Color * start_scanline(int scanline);
 	virtual bool end_scanline();
+
+	virtual synfig::Color * start_scanlines(int scanline, int count, int &pitch);
 	
 	//! Initialization tasks of ffmpeg target.
 	//! @returns true if the initialization has no errors
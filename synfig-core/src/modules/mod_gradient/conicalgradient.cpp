@@ -38,6 +38,8 @@
 #include <synfig/renddesc.h>
 #include <synfig/surface.h>
 #include <synfig/value.h>
+
+#include "taskgradient.h"
 #include <synfig/angle.h>
 
 #include "conicalgradient.h"
@@ -252,3 +254,15 @@ ConicalGradient::accelerated_render(Context context,Surface *surface,int quality
 
 	return true;
 }
+
+rendering::Task::Handle
+ConicalGradient::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	TaskGradient::Handle task(new TaskGradient());
+	task->gradient = compiled_gradient;
+	task->shape = rendering::software::GradientFill::SHAPE_CONICAL;
+	task->angle = Angle::rot(param_angle.get(Angle())).get();
+	task->transformation->matrix = Matrix().set_translate(param_center.get(Point()));
+
+	return task;
+}
@@ -75,6 +75,8 @@ public:
 	virtual Color get_color(Context context, const Point &pos)const;
 
 	virtual bool accelerated_render(Context context,Surface *surface,int quality, const RendDesc &renddesc, ProgressCallback *cb)const;
+	virtual bool is_render_thread_safe()const { return true; }
+	virtual rendering::Task::Handle build_composite_task_vfunc(ContextParams context_params)const;
 	Layer::Handle hit_check(Context context, const Point &point)const;
 
 	virtual Vocab get_param_vocab()const;
@@ -46,6 +46,10 @@
 #include <synfig/surface.h>
 #include <synfig/value.h>
 #include <synfig/valuenode.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/task/tasksw.h>
+#include <synfig/rendering/software/function/blend.h>
 #include <ETL/bezier>
 #include <ETL/hermite>
 #include <ETL/calculus>
@@ -66,6 +70,84 @@ SYNFIG_LAYER_SET_VERSION(CurveGradient,"0.0");
 
 /* === P R O C E D U R E S ================================================= */
 
+//! Parameters of layer and segments of bline prepared for rendering
+struct CurveGradient::Params
+{
+	//! Segment of bline between two neighbour vertices
+	struct Segment {
+		enum { samples_count = 7 };
+
+		etl::hermite<Vector> curve;
+		int vertex;                    //!< index of the first vertex in bline
+		Real offset;                   //!< length of bline before this segment
+		Point samples[samples_count];  //!< points checked in fast mode
+		Rect bounds;                   //!< contains the samples in fast mode, or the whole curve
+
+		Segment(): vertex(), offset() { }
+	};
+
+	Point origin;
+	Real width;
+	std::vector<synfig::BLinePoint> bline;
+	bool bline_loop;
+	bool loop;
+	bool perpendicular;
+	bool fast;
+	Real curve_length;
+	CompiledGradient gradient;
+	std::vector<Segment> segments;
+
+	Params(): width(), bline_loop(), loop(), perpendicular(), fast(), curve_length() { }
+
+	void init_segments();
+};
+
+void
+CurveGradient::Params::init_segments()
+{
+	segments.clear();
+	if (bline.size() < 2)
+		return;
+
+	int count = (int)bline.size();
+	segments.reserve(count);
+	Real offset(0);
+	for(int i = bline_loop ? count - 1 : 0, j = bline_loop ? 0 : 1; j < count; i = j++)
+	{
+		segments.push_back(Segment());
+		Segment &s = segments.back();
+		s.curve = etl::hermite<Vector>(
+			bline[i].get_vertex(),
+			bline[j].get_vertex(),
+			bline[i].get_tangent2(),
+			bline[j].get_tangent1() );
+		s.vertex = i;
+		s.offset = offset;
+		offset += s.curve.length();
+
+		// the same points as in the search over all segments
+		s.samples[0] = s.curve(0.0001);
+		s.samples[1] = s.curve((1.0/6.0));
+		s.samples[2] = s.curve((2.0/6.0));
+		s.samples[3] = s.curve((3.0/6.0));
+		s.samples[4] = s.curve((4.0/6.0));
+		s.samples[5] = s.curve((5.0/6.0));
+		s.samples[6] = s.curve(0.9999);
+
+		if (fast) {
+			s.bounds = Rect(s.samples[0]);
+			for(int k = 1; k < Segment::samples_count; ++k)
+				s.bounds.expand(s.samples[k]);
+		} else {
+			// curve is inside of convex hull of its bezier control points
+			s.bounds = Rect(s.curve[0]);
+			for(int k = 1; k < 4; ++k)
+				s.bounds.expand(s.curve[k]);
+			s.bounds.expand(real_low_precision<Real>());
+		}
+	}
+}
+
 inline Real calculate_distance(const synfig::BLinePoint& a,const synfig::BLinePoint& b)
 {
 	const Point& c1(a.get_vertex());
@@ -107,155 +189,82 @@ inline Real calculate_distance(const std::vector<synfig::BLinePoint>& bline, boo
 	return dist;
 }
 
-std::vector<synfig::BLinePoint>::const_iterator
-find_closest(bool fast, const std::vector<synfig::BLinePoint>& bline,const Point& p, Real& t, bool loop=false, Real *bline_dist_ret=0)
+namespace {
+
+//! Squared distance from p to the nearest point of rect
+inline Real
+bounds_distance(const Rect &r, const Point &p)
 {
-	std::vector<synfig::BLinePoint>::const_iterator iter,next,ret;
-	std::vector<synfig::BLinePoint>::const_iterator end(bline.end());
+	Real dx = p[0] < r.minx ? r.minx - p[0] : p[0] > r.maxx ? p[0] - r.maxx : 0.0;
+	Real dy = p[1] < r.miny ? r.miny - p[1] : p[1] > r.maxy ? p[1] - r.maxy : 0.0;
+	return dx*dx + dy*dy;
+}
 
-	ret=bline.end();
-	Real dist(100000000000.0);
+//! Squared distance from p to the segment, and position of the closest point when not in fast mode
+inline Real
+segment_distance(bool fast, const CurveGradient::Params::Segment &segment, const Point &p, Real &pos)
+{
+	if (fast) {
+		Real dist = (segment.samples[0] - p).mag_squared();
+		for(int i = 1; i < CurveGradient::Params::Segment::samples_count; ++i)
+			dist = std::min(dist, (segment.samples[i] - p).mag_squared());
+		return dist;
+	}
+	pos = segment.curve.find_closest(fast, p);
+	return (segment.curve(pos) - p).mag_squared();
+}
 
-	next=bline.begin();
+//! Finds the segment of bline closest to p. Result is the same as of the search over
+//! all segments, but segments which bounds are farther than the closest point found so far
+//! are skipped. Search starts from the segment found for the previous pixel (hint).
+const CurveGradient::Params::Segment&
+find_closest(const CurveGradient::Params &params, const Point &p, Real &t, int &hint, Real *bline_dist_ret=0)
+{
+	const std::vector<CurveGradient::Params::Segment> &segments = params.segments;
+	const int count = (int)segments.size();
 
-	Real best_bline_dist(0);
-	//Real best_bline_len(0);
-	Real total_bline_dist(0);
+	const int first = hint >= 0 && hint < count ? hint : 0;
+	int best = first;
 	Real best_pos(0);
-	etl::hermite<Vector> best_curve;
+	Real dist = segment_distance(params.fast, segments[best], p, best_pos);
 
-	if(loop)
-		iter=--bline.end();
-	else
-		iter=next++;
-
-	Point bp;
-
-	for(;next!=end;iter=next++)
+	for(int i = 0; i < count; ++i)
 	{
-		// Setup the curve
-		etl::hermite<Vector> curve(
-			iter->get_vertex(),
-			next->get_vertex(),
-			iter->get_tangent2(),
-			next->get_tangent1());
-
-		/*
-		const float t(curve.find_closest(p,6,0.01,0.99));
-		bp=curve(t);if((bp-p).mag_squared()<dist) { ret=iter; dist=(bp-p).mag_squared(); ret_t=t; }
-		*/
-
-		Real thisdist(0);
-		Real len(0);
-		if(bline_dist_ret)
-		{
-			//len=calculate_distance(*iter,*next);
-			len=curve.length();
-		}
-
-		if (fast)
-		{
-#define POINT_CHECK(x) bp=curve(x);	thisdist=(bp-p).mag_squared(); if(thisdist<dist) { ret=iter; dist=thisdist; best_bline_dist=total_bline_dist; /* best_bline_len=len; */ best_curve=curve; }
-			POINT_CHECK(0.0001);
-			POINT_CHECK((1.0/6.0));
-			POINT_CHECK((2.0/6.0));
-			POINT_CHECK((3.0/6.0));
-			POINT_CHECK((4.0/6.0));
-			POINT_CHECK((5.0/6.0));
-			POINT_CHECK(0.9999);
-		}
-		else
-		{
-			Real pos = curve.find_closest(fast, p);
-			thisdist=(curve(pos)-p).mag_squared();
-			if(thisdist<dist)
-			{
-				ret=iter;
-				dist=thisdist;
-				best_bline_dist=total_bline_dist;
-				//best_bline_len=len;
-				best_curve=curve;
-				best_pos = pos;
-			}
-		}
-
-		total_bline_dist+=len;
+		if (i == first)
+			continue;
+		// segments are checked in order of bline, so first of equally distant ones wins
+		Real bounds_dist = bounds_distance(segments[i].bounds, p);
+		if (bounds_dist > dist || (bounds_dist == dist && i > best))
+			continue;
+		Real pos(0);
+		Real thisdist = segment_distance(params.fast, segments[i], p, pos);
+		if (thisdist < dist || (thisdist == dist && i < best))
+			{ best = i; dist = thisdist; best_pos = pos; }
 	}
 
-	t = best_pos;
+	hint = best;
+	const CurveGradient::Params::Segment &segment = segments[best];
+	t = params.fast ? 0 : best_pos;
 
 	if(bline_dist_ret)
 	{
 		//! \todo is this a redundant call to find_closest()?
 		// note bline_dist_ret is null except when 'perpendicular' is true
-		*bline_dist_ret=best_bline_dist+best_curve.find_distance(0,best_curve.find_closest(fast, p));
-//		*bline_dist_ret=best_bline_dist+best_curve.find_closest(fast, p)*best_bline_len;
+		*bline_dist_ret=segment.offset+segment.curve.find_distance(0,segment.curve.find_closest(params.fast, p));
 	}
 
-	return ret;
-}
-
-/* === M E T H O D S ======================================================= */
-
-inline void
-CurveGradient::sync()
-{
-	std::vector<synfig::BLinePoint> bline(param_bline.get_list_of(BLinePoint()));
-	curve_length_=calculate_distance(bline, bline_loop);
-}
-
-void
-CurveGradient::compile()
-{
-	compiled_gradient.set(
-		param_gradient.get(Gradient()),
-		param_loop.get(bool()),
-		param_zigzag.get(bool()) );
+	return segment;
 }
 
-
-CurveGradient::CurveGradient():
-	Layer_Composite(1.0,Color::BLEND_COMPOSITE),
-	param_origin(ValueBase(Point(0,0))),
-	param_width(ValueBase(Real(0.25))),
-	param_bline(ValueBase(std::vector<synfig::BLinePoint>())),
-	param_gradient(Gradient(Color::black(), Color::white())),
-	param_loop(ValueBase(false)),
-	param_zigzag(ValueBase(false)),
-	param_perpendicular(ValueBase(false)),
-	param_fast(ValueBase(true))
-{
-	std::vector<synfig::BLinePoint> bline;
-	bline.push_back(BLinePoint());
-	bline.push_back(BLinePoint());
-	bline.push_back(BLinePoint());
-	bline[0].set_vertex(Point(0,1));
-	bline[1].set_vertex(Point(0,-1));
-	bline[2].set_vertex(Point(1,0));
-	bline[0].set_tangent(bline[1].get_vertex()-bline[2].get_vertex()*0.5f);
-	bline[1].set_tangent(bline[2].get_vertex()-bline[0].get_vertex()*0.5f);
-	bline[2].set_tangent(bline[0].get_vertex()-bline[1].get_vertex()*0.5f);
-	bline[0].set_width(1.0f);
-	bline[1].set_width(1.0f);
-	bline[2].set_width(1.0f);
-	bline_loop=true;
-	param_bline.set_list_of(bline);
-
-	sync();
-
-	SET_INTERPOLATION_DEFAULTS();
-	SET_STATIC_DEFAULTS();
-}
-
-inline Color
-CurveGradient::color_func(const Point &point_, int quality, Real supersample)const
+Color
+color_func(const CurveGradient::Params &params, const Point &point_, int &hint, int quality=10, Real supersample=0)
 {
-	Point origin=param_origin.get(Point());
-	Real width=param_width.get(Real());
-	std::vector<synfig::BLinePoint> bline(param_bline.get_list_of(BLinePoint()));
-	bool loop=param_loop.get(bool());
-	bool perpendicular=param_perpendicular.get(bool());
-	bool fast=param_fast.get(bool());
+	const Point &origin=params.origin;
+	const Real &width=params.width;
+	const std::vector<synfig::BLinePoint> &bline=params.bline;
+	const bool &loop=params.loop;
+	const bool &perpendicular=params.perpendicular;
+	const bool &fast=params.fast;
 
 	Vector tangent;
 	Vector diff;
@@ -283,26 +292,23 @@ CurveGradient::color_func(const Point &point_, int quality, Real supersample)con
 
 		// Figure out the BLinePoints we will be using,
 		// Taking into account looping.
+		const CurveGradient::Params::Segment *segment;
 		if(perpendicular)
 		{
-			next=find_closest(fast,bline,point,t,bline_loop,&perp_dist);
-			perp_dist/=curve_length_;
+			segment=&find_closest(params,point,t,hint,&perp_dist);
+			perp_dist/=params.curve_length;
 		}
 		else					// not perpendicular
 		{
-			next=find_closest(fast,bline,point,t,bline_loop);
+			segment=&find_closest(params,point,t,hint);
 		}
 
+		next=bline.begin()+segment->vertex;
 		iter=next++;
 		if(next==bline.end()) next=bline.begin();
 
 		// Setup the curve
-		etl::hermite<Vector> curve(
-			iter->get_vertex(),
-			next->get_vertex(),
-			iter->get_tangent2(),
-			next->get_tangent1()
-			);
+		const etl::hermite<Vector> &curve(segment->curve);
 
 		// Setup the derivative function
 		etl::derivative<etl::hermite<Vector> > deriv(curve);
@@ -402,7 +408,7 @@ CurveGradient::color_func(const Point &point_, int quality, Real supersample)con
 
 		if(perpendicular)
 		{
-			tangent*=curve_length_;
+			tangent*=params.curve_length;
 			p1-=tangent*perp_dist;
 			tangent=-tangent.perp();
 		}
@@ -451,7 +457,163 @@ CurveGradient::color_func(const Point &point_, int quality, Real supersample)con
 	}
 
 	supersample *= 0.5;
-	return compiled_gradient.average(dist - supersample, dist + supersample);
+	return params.gradient.average(dist - supersample, dist + supersample);
+}
+
+class TaskCurveGradient: public rendering::Task, public rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskCurveGradient> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	CurveGradient::Params params;
+	rendering::Holder<rendering::TransformationAffine> transformation;
+
+	virtual rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+};
+
+
+class TaskCurveGradientSW: public TaskCurveGradient, public rendering::TaskSW,
+	public rendering::TaskInterfaceBlendToTarget,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskCurveGradientSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual void on_target_set_as_source() {
+		Task::Handle &subtask = sub_task(0);
+		if ( subtask
+		  && subtask->target_surface == target_surface
+		  && !Color::is_straight(blend_method) )
+		{
+			trunc_by_bounds();
+			subtask->source_rect = source_rect;
+			subtask->target_rect = target_rect;
+		}
+	}
+
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid())
+			return true;
+
+		Vector ppu = get_pixels_per_unit();
+
+		Matrix bounds_transfromation;
+		bounds_transfromation.m00 = ppu[0];
+		bounds_transfromation.m11 = ppu[1];
+		bounds_transfromation.m20 = target_rect.minx - ppu[0]*source_rect.minx;
+		bounds_transfromation.m21 = target_rect.miny - ppu[1]*source_rect.miny;
+
+		Matrix matrix = bounds_transfromation * transformation->matrix;
+		if (!matrix.is_invertible())
+			return true;
+		Matrix inv_matrix = matrix.get_inverted();
+
+		LockWrite la(this);
+		if (!la)
+			return false;
+
+		synfig::Surface &surface = la->get_surface();
+		Color::BlendMethod method = blend ? blend_method : Color::BLEND_COMPOSITE;
+		ColorReal amount = blend ? this->amount : ColorReal(1.0);
+
+		// the same quality which TaskLayerSW passes into accelerated_render()
+		const int quality = 4;
+		const Real supersample = inv_matrix.axis_x().mag();
+
+		int tw = target_rect.get_width();
+		Vector dx = inv_matrix.axis_x();
+		std::vector<Color> row(tw);
+		int hint = 0;
+		for(int iy = target_rect.miny; iy < target_rect.maxy; ++iy) {
+			Vector p = inv_matrix.get_transformed( Vector((Real)target_rect.minx, (Real)iy) );
+			for(int i = 0; i < tw; ++i, p += dx)
+				row[i] = color_func(params, p, hint, quality, supersample);
+			rendering::software::Blend::blend(&surface[iy][target_rect.minx], &row.front(), tw, method, amount);
+		}
+
+		return true;
+	}
+};
+
+rendering::Task::Token TaskCurveGradient::token(
+	DescAbstract<TaskCurveGradient>("CurveGradient") );
+rendering::Task::Token TaskCurveGradientSW::token(
+	DescReal<TaskCurveGradientSW, TaskCurveGradient>("CurveGradientSW") );
+
+} // namespace
+
+/* === M E T H O D S ======================================================= */
+
+inline void
+CurveGradient::sync()
+{
+	std::vector<synfig::BLinePoint> bline(param_bline.get_list_of(BLinePoint()));
+	curve_length_=calculate_distance(bline, bline_loop);
+
+	// segments are prepared once here, not for every pixel in get_color() and hit_check()
+	std::shared_ptr<Params> params(new Params());
+	params->origin=param_origin.get(Point());
+	params->width=param_width.get(Real());
+	params->bline.swap(bline);
+	params->bline_loop=bline_loop;
+	params->loop=param_loop.get(bool());
+	params->perpendicular=param_perpendicular.get(bool());
+	params->fast=param_fast.get(bool());
+	params->curve_length=curve_length_;
+	params->gradient=compiled_gradient;
+	params->init_segments();
+	params_=params;
+}
+
+void
+CurveGradient::compile()
+{
+	compiled_gradient.set(
+		param_gradient.get(Gradient()),
+		param_loop.get(bool()),
+		param_zigzag.get(bool()) );
+}
+
+CurveGradient::CurveGradient():
+	Layer_Composite(1.0,Color::BLEND_COMPOSITE),
+	param_origin(ValueBase(Point(0,0))),
+	param_width(ValueBase(Real(0.25))),
+	param_bline(ValueBase(std::vector<synfig::BLinePoint>())),
+	param_gradient(Gradient(Color::black(), Color::white())),
+	param_loop(ValueBase(false)),
+	param_zigzag(ValueBase(false)),
+	param_perpendicular(ValueBase(false)),
+	param_fast(ValueBase(true))
+{
+	std::vector<synfig::BLinePoint> bline;
+	bline.push_back(BLinePoint());
+	bline.push_back(BLinePoint());
+	bline.push_back(BLinePoint());
+	bline[0].set_vertex(Point(0,1));
+	bline[1].set_vertex(Point(0,-1));
+	bline[2].set_vertex(Point(1,0));
+	bline[0].set_tangent(bline[1].get_vertex()-bline[2].get_vertex()*0.5f);
+	bline[1].set_tangent(bline[2].get_vertex()-bline[0].get_vertex()*0.5f);
+	bline[2].set_tangent(bline[0].get_vertex()-bline[1].get_vertex()*0.5f);
+	bline[0].set_width(1.0f);
+	bline[1].set_width(1.0f);
+	bline[2].set_width(1.0f);
+	bline_loop=true;
+	param_bline.set_list_of(bline);
+
+	compile();
+	sync();
+
+	SET_INTERPOLATION_DEFAULTS();
+	SET_STATIC_DEFAULTS();
 }
 
 Real
@@ -467,7 +629,11 @@ CurveGradient::hit_check(synfig::Context context, const synfig::Point &point)con
 		return const_cast<CurveGradient*>(this);
 	if(get_amount()==0.0)
 		return context.hit_check(point);
-	if((get_blend_method()==Color::BLEND_STRAIGHT || get_blend_method()==Color::BLEND_COMPOSITE|| get_blend_method()==Color::BLEND_ONTO) && color_func(point).get_a()>0.5)
+
+	std::shared_ptr<const Params> params = params_;
+	int hint = 0;
+
+	if((get_blend_method()==Color::BLEND_STRAIGHT || get_blend_method()==Color::BLEND_COMPOSITE|| get_blend_method()==Color::BLEND_ONTO) && color_func(*params,point,hint).get_a()>0.5)
 		return const_cast<CurveGradient*>(this);
 	return context.hit_check(point);
 }
@@ -477,8 +643,8 @@ CurveGradient::set_param(const String & param, const ValueBase &value)
 {
 
 
-	IMPORT_VALUE(param_origin);
-	IMPORT_VALUE(param_width);
+	IMPORT_VALUE_PLUS(param_origin, sync());
+	IMPORT_VALUE_PLUS(param_width, sync());
 	if(param=="bline" && value.get_type()==type_list)
 	{
 		param_bline=value;
@@ -486,11 +652,11 @@ CurveGradient::set_param(const String & param, const ValueBase &value)
 		sync();
 		return true;
 	}
-	IMPORT_VALUE_PLUS(param_gradient, compile());
-	IMPORT_VALUE_PLUS(param_loop, compile());
-	IMPORT_VALUE_PLUS(param_zigzag, compile());
-	IMPORT_VALUE(param_perpendicular);
-	IMPORT_VALUE(param_fast);
+	IMPORT_VALUE_PLUS(param_gradient, compile(); sync());
+	IMPORT_VALUE_PLUS(param_loop, compile(); sync());
+	IMPORT_VALUE_PLUS(param_zigzag, compile(); sync());
+	IMPORT_VALUE_PLUS(param_perpendicular, sync());
+	IMPORT_VALUE_PLUS(param_fast, sync());
 
 	if(param=="offset")
 		return set_param("origin", value);
@@ -563,7 +729,10 @@ CurveGradient::get_param_vocab()const
 Color
 CurveGradient::get_color(Context context, const Point &point)const
 {
-	const Color color(color_func(point,0));
+	std::shared_ptr<const Params> params = params_;
+	int hint = 0;
+
+	const Color color(color_func(*params,point,hint,0));
 
 	if(get_amount()==1.0 && get_blend_method()==Color::BLEND_STRAIGHT)
 		return color;
@@ -576,6 +745,8 @@ CurveGradient::accelerated_render(Context context,Surface *surface,int quality,
 {
 	RENDER_TRANSFORMED_IF_NEED(__FILE__, __LINE__)
 
+	std::shared_ptr<const Params> params = params_;
+
 	SuperCallback supercb(cb,0,9500,10000);
 
 	if(get_amount()==1.0 && get_blend_method()==Color::BLEND_STRAIGHT)
@@ -599,18 +770,19 @@ CurveGradient::accelerated_render(Context context,Surface *surface,int quality,
 	Point tl(renddesc.get_tl());
 	const int w(surface->get_w());
 	const int h(surface->get_h());
+	int hint = 0;
 
 	if(get_amount()==1.0 && get_blend_method()==Color::BLEND_STRAIGHT)
 	{
 		for(y=0,pos[1]=tl[1];y<h;y++,pen.inc_y(),pen.dec_x(x),pos[1]+=ph)
 			for(x=0,pos[0]=tl[0];x<w;x++,pen.inc_x(),pos[0]+=pw)
-				pen.put_value(color_func(pos,quality,calc_supersample(pos,pw,ph)));
+				pen.put_value(color_func(*params,pos,hint,quality,calc_supersample(pos,pw,ph)));
 	}
 	else
 	{
 		for(y=0,pos[1]=tl[1];y<h;y++,pen.inc_y(),pen.dec_x(x),pos[1]+=ph)
 			for(x=0,pos[0]=tl[0];x<w;x++,pen.inc_x(),pos[0]+=pw)
-				pen.put_value(Color::blend(color_func(pos,quality,calc_supersample(pos,pw,ph)),pen.get_value(),get_amount(),get_blend_method()));
+				pen.put_value(Color::blend(color_func(*params,pos,hint,quality,calc_supersample(pos,pw,ph)),pen.get_value(),get_amount(),get_blend_method()));
 	}
 
 	// Mark our progress as finished
@@ -620,3 +792,10 @@ CurveGradient::accelerated_render(Context context,Surface *surface,int quality,
 	return true;
 }
 
+rendering::Task::Handle
+CurveGradient::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	TaskCurveGradient::Handle task(new TaskCurveGradient());
+	task->params = *params_;
+	return task;
+}
@@ -30,6 +30,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <memory>
+
 #include <synfig/vector.h>
 #include <synfig/layers/layer_composite.h>
 #include <synfig/gradient.h>
@@ -48,6 +50,10 @@ class CurveGradient : public Layer_Composite, public Layer_NoDeform
 {
 	SYNFIG_LAYER_MODULE_EXT
 
+public:
+	//! Parameters and segments of bline prepared for rendering, see curvegradient.cpp
+	struct Params;
+
 private:
 	//! Parameter: (Point)
 	ValueBase param_origin;
@@ -70,10 +76,11 @@ private:
 	bool bline_loop;
 
 	CompiledGradient compiled_gradient;
+	//! rebuilt by sync() when parameters are changed, shared with rendering tasks
+	std::shared_ptr<const Params> params_;
 
 	void compile();
 	void sync();
-	Color color_func(const Point &x, int quality=10, Real supersample=0)const;
 	Real calc_supersample(const Point &x, Real pw, Real ph)const;
 
 public:
@@ -83,6 +90,8 @@ public:
 	virtual ValueBase get_param(const String &param)const;
 	virtual Color get_color(Context context, const Point &pos)const;
 	virtual bool accelerated_render(Context context,Surface *surface,int quality, const RendDesc &renddesc, ProgressCallback *cb)const;
+	virtual bool is_render_thread_safe()const { return true; }
+	virtual rendering::Task::Handle build_composite_task_vfunc(ContextParams context_params)const;
 	Layer::Handle hit_check(synfig::Context context, const synfig::Point &point)const;
 
 	virtual Vocab get_param_vocab()const;
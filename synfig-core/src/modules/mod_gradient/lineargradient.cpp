@@ -43,6 +43,8 @@
 #include <synfig/surface.h>
 #include <synfig/value.h>
 
+#include "taskgradient.h"
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -267,3 +269,19 @@ LinearGradient::accelerated_render(Context context,Surface *surface,int quality,
 	return true;
 }
 
+rendering::Task::Handle
+LinearGradient::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	Params params;
+	fill_params(params);
+
+	// x axis goes from p1 to p2, gradient doesn't depend on y
+	Vector axis = params.p2 - params.p1;
+
+	TaskGradient::Handle task(new TaskGradient());
+	task->gradient = params.gradient;
+	task->shape = rendering::software::GradientFill::SHAPE_LINEAR;
+	task->transformation->matrix = Matrix(axis, axis.perp(), params.p1);
+
+	return task;
+}
@@ -40,6 +40,8 @@
 #include <synfig/surface.h>
 #include <synfig/value.h>
 
+#include "taskgradient.h"
+
 #include "spiralgradient.h"
 
 #endif
@@ -249,6 +251,23 @@ SpiralGradient::accelerated_render(Context context,Surface *surface,int quality,
 	return true;
 }
 
-
-
-
+rendering::Task::Handle
+SpiralGradient::build_composite_task_vfunc(ContextParams context_params)const
+{
+	Point center = param_center.get(Point());
+	Real radius = param_radius.get(Real());
+
+	// distance is divided by signed radius, task supports only positive one
+	if (radius <= 0.0)
+		return Layer_Composite::build_composite_task_vfunc(context_params);
+
+	TaskGradient::Handle task(new TaskGradient());
+	task->gradient = compiled_gradient;
+	task->shape = rendering::software::GradientFill::SHAPE_SPIRAL;
+	task->angle = Angle::rot(param_angle.get(Angle())).get();
+	task->clockwise = param_clockwise.get(bool());
+	task->transformation->matrix = Matrix().set_translate(center)
+	                             * Matrix().set_scale(radius);
+
+	return task;
+}
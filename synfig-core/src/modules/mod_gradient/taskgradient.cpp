@@ -0,0 +1,142 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file taskgradient.cpp
+**	\brief Rendering tasks of the gradient layers
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/software/task/tasksw.h>
+#include <synfig/rendering/software/function/blend.h>
+
+#include "taskgradient.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+Task::Token TaskGradient::token(
+	DescAbstract<TaskGradient>("Gradient") );
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+class TaskGradientSW: public TaskGradient, public TaskSW,
+	public TaskInterfaceBlendToTarget,
+	public TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskGradientSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual void on_target_set_as_source() {
+		Task::Handle &subtask = sub_task(0);
+		if ( subtask
+		  && subtask->target_surface == target_surface
+		  && !Color::is_straight(blend_method) )
+		{
+			trunc_by_bounds();
+			subtask->source_rect = source_rect;
+			subtask->target_rect = target_rect;
+		}
+	}
+
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid())
+			return true;
+
+		Vector ppu = get_pixels_per_unit();
+
+		Matrix bounds_transfromation;
+		bounds_transfromation.m00 = ppu[0];
+		bounds_transfromation.m11 = ppu[1];
+		bounds_transfromation.m20 = target_rect.minx - ppu[0]*source_rect.minx;
+		bounds_transfromation.m21 = target_rect.miny - ppu[1]*source_rect.miny;
+
+		Matrix matrix = bounds_transfromation * transformation->matrix;
+
+		LockWrite la(this);
+		if (!la)
+			return false;
+
+		Color::BlendMethod method = blend ? blend_method : Color::BLEND_COMPOSITE;
+		ColorReal amount = blend ? this->amount : ColorReal(1.0);
+
+		if (!matrix.is_invertible()) {
+			// gradient is squeezed into a line or a point, so each pixel covers all of its colors
+			software::Blend::fill(la->get_surface(), target_rect, gradient.average(), method, amount);
+			return true;
+		}
+
+		software::GradientFill::Params params;
+		params.shape = shape;
+		params.matrix = matrix.get_inverted();
+		params.angle = angle;
+		params.clockwise = clockwise;
+		software::GradientFill::fill(la->get_surface(), target_rect, gradient, params, method, amount);
+
+		return true;
+	}
+};
+
+Task::Token TaskGradientSW::token(
+	DescReal<TaskGradientSW, TaskGradient>("GradientSW") );
+
+} // namespace
+
+/* === M E T H O D S ======================================================= */
+
+bool
+TaskGradient::hash_params(TaskHash &hash) const
+{
+	hash.add((int)shape);
+	hash.add(angle);
+	hash.add(clockwise);
+	hash.add(&transformation->matrix.m, sizeof(transformation->matrix.m));
+	hash.add(gradient.get_repeat());
+	const CompiledGradient::List &list = gradient.get_list();
+	hash.add((int)list.size());
+	for(CompiledGradient::List::const_iterator i = list.begin(); i != list.end(); ++i) {
+		hash.add(i->prev_pos);
+		hash.add(i->next_pos);
+		hash.add(&i->prev_color, sizeof(i->prev_color));
+		hash.add(&i->next_color, sizeof(i->next_color));
+	}
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
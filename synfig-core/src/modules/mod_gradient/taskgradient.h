@@ -0,0 +1,68 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file taskgradient.h
+**	\brief Header file for rendering tasks of the gradient layers
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_MOD_GRADIENT_TASKGRADIENT_H
+#define __SYNFIG_MOD_GRADIENT_TASKGRADIENT_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/gradient.h>
+#include <synfig/rendering/task.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/function/gradientfill.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+//! Fills the whole plane by linear, radial, conical or spiral gradient.
+//! Transformation maps the shape space (see GradientFill::Shape) into units,
+//! so the gradient position is the x coordinate for linear gradient,
+//! or distance from the origin for radial one.
+class TaskGradient: public synfig::rendering::Task, public synfig::rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskGradient> Handle;
+	typedef synfig::rendering::software::GradientFill::Shape Shape;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	synfig::CompiledGradient gradient;
+	Shape shape;
+	synfig::Real angle; //!< in turns
+	bool clockwise;
+	synfig::rendering::Holder<synfig::rendering::TransformationAffine> transformation;
+
+	TaskGradient(): shape(synfig::rendering::software::GradientFill::SHAPE_LINEAR), angle(), clockwise() { }
+	virtual synfig::rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+
+	virtual bool hash_params(synfig::rendering::TaskHash &hash) const;
+};
+
+/* === E N D =============================================================== */
+
+#endif
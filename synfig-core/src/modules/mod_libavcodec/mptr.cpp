@@ -1,11 +1,12 @@
 /* === S Y N F I G ========================================================= */
 /*!	\file mptr.cpp
-**	\brief writeme
+**	\brief Video importer, decodes files through libavformat/libavcodec
 **
 **	$Id$
 **
 **	\legal
 **	Copyright (c) 2002-2005 Robert B. Quattlebaum Jr., Adrian Bentley
+**	Copyright (c) 2020 Synfig contributors
 **
 **	This package is free software; you can redistribute it and/or
 **	modify it under the terms of the GNU General Public License as
@@ -29,13 +30,47 @@
 #	include <config.h>
 #endif
 
+extern "C"
+{
+#ifdef HAVE_LIBAVFORMAT_AVFORMAT_H
+#	include <libavformat/avformat.h>
+#elif defined(HAVE_AVFORMAT_H)
+#	include <avformat.h>
+#elif defined(HAVE_FFMPEG_AVFORMAT_H)
+#	include <ffmpeg/avformat.h>
+#else
+#   ifndef DISABLE_MODULE
+#   define DISABLE_MODULE
+#   endif
+#endif
+
+#ifdef HAVE_LIBSWSCALE_SWSCALE_H
+#	include <libswscale/swscale.h>
+#elif defined(HAVE_SWSCALE_H)
+#	include <swscale.h>
+#elif defined(HAVE_FFMPEG_SWSCALE_H)
+#	include <ffmpeg/swscale.h>
+#else
+#   ifndef DISABLE_MODULE
+#   define DISABLE_MODULE
+#   endif
+#endif
+} // extern "C"
+
 #include "mptr.h"
 #include <synfig/general.h>
 #include <synfig/localization.h>
 #include <synfig/surface.h>
+#include <synfig/color/pixelformat.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
 #endif
 
 /* === U S I N G =========================================================== */
@@ -48,9 +83,298 @@ using namespace etl;
 SYNFIG_IMPORTER_INIT(Importer_LibAVCodec);
 SYNFIG_IMPORTER_SET_NAME(Importer_LibAVCodec,"libav");
 SYNFIG_IMPORTER_SET_EXT(Importer_LibAVCodec,"avi");
-SYNFIG_IMPORTER_SET_VERSION(Importer_LibAVCodec,"0.1");
+SYNFIG_IMPORTER_SET_VERSION(Importer_LibAVCodec,"0.2");
 SYNFIG_IMPORTER_SET_SUPPORTS_FILE_SYSTEM_WRAPPER(Importer_LibAVCodec, false);
 
+#ifndef DISABLE_MODULE
+
+//! count of decoded frames kept for backward and random access
+#define DEFAULT_RING_SIZE 8
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+static bool av_registered = false;
+#endif
+
+class Importer_LibAVCodec::Session
+{
+private:
+	//! decoded frame converted to RGBA
+	struct Frame {
+		long long index;
+		int width;
+		int height;
+		std::vector<unsigned char> data;
+		Frame(): index(), width(), height() { }
+	};
+
+	typedef std::map<String, std::weak_ptr<Session> > Map;
+
+	static std::mutex sessions_mutex;
+	static Map sessions;
+
+	std::mutex mutex;
+	String filename;
+
+	AVFormatContext *format_context;
+	AVCodecContext *codec_context;
+	AVFrame *frame;
+	AVPacket *packet;
+	SwsContext *swscale_context;
+	int stream_index;
+	bool end_of_file;
+
+	AVRational time_base;
+	long long start_time;
+	double fps;
+
+	//! index of last decoded frame, -1 when unknown (after open or seek)
+	long long position;
+	//! recently used frames, most recent at back
+	std::deque<Frame> ring;
+	size_t ring_size;
+
+	explicit Session(const String &filename):
+		filename(filename),
+		format_context(),
+		codec_context(),
+		frame(),
+		packet(),
+		swscale_context(),
+		stream_index(-1),
+		end_of_file(),
+		time_base(),
+		start_time(),
+		fps(),
+		position(-1),
+		ring_size(DEFAULT_RING_SIZE)
+	{
+		if (const char *s = getenv("SYNFIG_IMPORT_VIDEO_RING_SIZE"))
+			ring_size = std::max(1, atoi(s));
+	}
+
+	bool open() {
+		close();
+
+		#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+		if (!av_registered) {
+			av_register_all();
+			av_registered = true;
+		}
+		#endif
+
+		if (avformat_open_input(&format_context, filename.c_str(), NULL, NULL) < 0) {
+			synfig::error("Importer_LibAVCodec: unable to open file '%s'", filename.c_str());
+			return false;
+		}
+		if (avformat_find_stream_info(format_context, NULL) < 0) {
+			synfig::error("Importer_LibAVCodec: unable to find stream info in '%s'", filename.c_str());
+			return false;
+		}
+
+		stream_index = av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+		if (stream_index < 0) {
+			synfig::error("Importer_LibAVCodec: no video stream in '%s'", filename.c_str());
+			return false;
+		}
+		AVStream *stream = format_context->streams[stream_index];
+
+		const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+		if (!codec) {
+			synfig::error("Importer_LibAVCodec: no decoder for video stream in '%s'", filename.c_str());
+			return false;
+		}
+
+		codec_context = avcodec_alloc_context3(codec);
+		if (!codec_context || avcodec_parameters_to_context(codec_context, stream->codecpar) < 0) {
+			synfig::error("Importer_LibAVCodec: could not allocate decoder context");
+			return false;
+		}
+		codec_context->thread_count = 0; // auto
+		if (avcodec_open2(codec_context, codec, NULL) < 0) {
+			synfig::error("Importer_LibAVCodec: could not open decoder");
+			return false;
+		}
+
+		frame = av_frame_alloc();
+		packet = av_packet_alloc();
+		if (!frame || !packet) {
+			synfig::error("Importer_LibAVCodec: could not allocate frame");
+			return false;
+		}
+
+		time_base = stream->time_base;
+		start_time = stream->start_time == AV_NOPTS_VALUE ? 0 : stream->start_time;
+		AVRational rate = av_guess_frame_rate(format_context, stream, NULL);
+		fps = rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 24.0;
+		return true;
+	}
+
+	void close() {
+		if (swscale_context) {
+			sws_freeContext(swscale_context);
+			swscale_context = NULL;
+		}
+		if (packet) av_packet_free(&packet);
+		if (frame) av_frame_free(&frame);
+		if (codec_context) avcodec_free_context(&codec_context);
+		if (format_context) avformat_close_input(&format_context);
+		stream_index = -1;
+	}
+
+	bool seek(long long index) {
+		end_of_file = false;
+		position = -1;
+
+		long long timestamp = start_time + (long long)std::floor(index/(fps*av_q2d(time_base)));
+		if (av_seek_frame(format_context, stream_index, timestamp, AVSEEK_FLAG_BACKWARD) >= 0) {
+			avcodec_flush_buffers(codec_context);
+			return true;
+		}
+
+		// format is not seekable, so decode it again from the beginning
+		std::deque<Frame> frames;
+		std::swap(frames, ring);
+		if (!open()) return false;
+		std::swap(frames, ring);
+		return true;
+	}
+
+	//! decodes next frame into 'frame', returns false at the end of stream or on error
+	bool decode() {
+		while(true) {
+			int res = avcodec_receive_frame(codec_context, frame);
+			if (!res) break;
+			if (res != AVERROR(EAGAIN) || end_of_file)
+				return false;
+
+			if (av_read_frame(format_context, packet) < 0) {
+				// flush decoder
+				end_of_file = true;
+				avcodec_send_packet(codec_context, NULL);
+				continue;
+			}
+			if (packet->stream_index == stream_index)
+				avcodec_send_packet(codec_context, packet);
+			av_packet_unref(packet);
+		}
+
+		long long timestamp = frame->best_effort_timestamp;
+		if (timestamp == AV_NOPTS_VALUE)
+			position = position + 1;
+		else
+			position = (long long)std::floor((timestamp - start_time)*av_q2d(time_base)*fps + 0.5);
+		return true;
+	}
+
+	//! converts decoded frame into back of ring
+	bool store() {
+		int w = frame->width, h = frame->height;
+		swscale_context = sws_getCachedContext(
+			swscale_context,
+			w, h, (AVPixelFormat)frame->format,
+			w, h, AV_PIX_FMT_RGBA,
+			SWS_POINT, NULL, NULL, NULL );
+		if (!swscale_context) {
+			synfig::error("Importer_LibAVCodec: cannot initialize the conversion context");
+			return false;
+		}
+
+		// reuse buffer of the oldest frame
+		Frame f;
+		if (ring.size() >= ring_size) {
+			std::swap(f, ring.front());
+			ring.pop_front();
+		}
+		f.index = position;
+		f.width = w;
+		f.height = h;
+		f.data.resize(4*(size_t)w*h);
+
+		uint8_t *data[4] = { &f.data.front(), NULL, NULL, NULL };
+		int linesize[4] = { 4*w, 0, 0, 0 };
+		sws_scale(swscale_context, (const uint8_t * const *)frame->data, frame->linesize, 0, h, data, linesize);
+
+		ring.push_back(Frame());
+		std::swap(ring.back(), f);
+		return true;
+	}
+
+	const Frame* find(long long index) {
+		for(std::deque<Frame>::iterator i = ring.begin(); i != ring.end(); ++i) {
+			if (i->index == index) {
+				// mark as recently used
+				if (i + 1 != ring.end()) {
+					Frame f;
+					std::swap(f, *i);
+					ring.erase(i);
+					ring.push_back(Frame());
+					std::swap(ring.back(), f);
+				}
+				return &ring.back();
+			}
+		}
+		return NULL;
+	}
+
+	const Frame* decode_to(long long index) {
+		// seek when requested frame is behind of decoder or too far ahead
+		long long max_skip = std::max((long long)ring_size, (long long)std::ceil(2.0*fps));
+		if (position < 0 || index <= position || index > position + max_skip)
+			if (!seek(index))
+				return NULL;
+
+		const Frame *last = NULL;
+		while(decode()) {
+			// keep only frames which will stay in ring
+			if (position > index - (long long)ring_size) {
+				if (!store()) return NULL;
+				last = &ring.back();
+			}
+			if (position >= index)
+				break;
+		}
+		// end of stream or gap in timestamps, use nearest decoded frame
+		return last ? last : (ring.empty() ? NULL : &ring.back());
+	}
+
+public:
+	~Session() { close(); }
+
+	static std::shared_ptr<Session> open_shared(const String &filename) {
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		std::shared_ptr<Session> session = sessions[filename].lock();
+		if (!session) {
+			session.reset(new Session(filename));
+			if (!session->open())
+				return std::shared_ptr<Session>();
+			sessions[filename] = session;
+		}
+		return session;
+	}
+
+	bool get_frame(Surface &surface, Time time) {
+		std::lock_guard<std::mutex> lock(mutex);
+		long long index = std::max(0ll, (long long)std::floor((double)time*fps + 1e-3));
+
+		const Frame *f = find(index);
+		if (!f) f = decode_to(index);
+		if (!f) {
+			synfig::error("Importer_LibAVCodec: cannot decode frame %lld of '%s'", index, filename.c_str());
+			return false;
+		}
+
+		surface.set_wh(f->width, f->height);
+		pixelformat_to_color(&surface[0][0], &f->data.front(), PF_RGB|PF_A, f->width, f->height);
+		return true;
+	}
+};
+
+std::mutex Importer_LibAVCodec::Session::sessions_mutex;
+Importer_LibAVCodec::Session::Map Importer_LibAVCodec::Session::sessions;
+
+#endif
 
 /* === M E T H O D S ======================================================= */
 
@@ -58,6 +382,9 @@ SYNFIG_IMPORTER_SET_SUPPORTS_FILE_SYSTEM_WRAPPER(Importer_LibAVCodec, false);
 Importer_LibAVCodec::Importer_LibAVCodec(const synfig::FileSystem::Identifier &identifier):
 	Importer(identifier)
 {
+#ifndef DISABLE_MODULE
+	session = Session::open_shared(identifier.filename);
+#endif
 }
 
 Importer_LibAVCodec::~Importer_LibAVCodec()
@@ -65,7 +392,17 @@ Importer_LibAVCodec::~Importer_LibAVCodec()
 }
 
 bool
-Importer_LibAVCodec::get_frame(Surface &/*surface*/, const RendDesc &/*renddesc*/, Time /*time*/, ProgressCallback */*callback*/)
+Importer_LibAVCodec::is_animated()
 {
+	return true;
+}
+
+bool
+Importer_LibAVCodec::get_frame(Surface &surface, const RendDesc &/*renddesc*/, Time time, ProgressCallback */*callback*/)
+{
+#ifndef DISABLE_MODULE
+	return session && session->get_frame(surface, time);
+#else
 	return false;
+#endif
 }
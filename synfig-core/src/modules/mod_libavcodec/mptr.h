@@ -1,11 +1,12 @@
 /* === S Y N F I G ========================================================= */
 /*!	\file mptr.h
-**	\brief writeme
+**	\brief Video importer, decodes files through libavformat/libavcodec
 **
 **	$Id$
 **
 **	\legal
 **	Copyright (c) 2002-2005 Robert B. Quattlebaum Jr., Adrian Bentley
+**	Copyright (c) 2020 Synfig contributors
 **
 **	This package is free software; you can redistribute it and/or
 **	modify it under the terms of the GNU General Public License as
@@ -27,6 +28,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <memory>
+
 #include <synfig/importer.h>
 #include <synfig/string.h>
 #include <synfig/time.h>
@@ -42,13 +45,19 @@ class Importer_LibAVCodec : public synfig::Importer
 {
 SYNFIG_IMPORTER_MODULE_EXT
 
+public:
+	//! Opened file and decoder, shared between importers of the same file
+	class Session;
+
 private:
-	synfig::String filename;
+	std::shared_ptr<Session> session;
 
 public:
-	Importer_LibAVCodec(const synfig::FileSystem::Identifier &identifier); 
+	Importer_LibAVCodec(const synfig::FileSystem::Identifier &identifier);
 	~Importer_LibAVCodec();
 
+	virtual bool is_animated();
+
 	virtual bool get_frame(synfig::Surface &surface, const synfig::RendDesc &renddesc, synfig::Time time, synfig::ProgressCallback *callback);
 };
 
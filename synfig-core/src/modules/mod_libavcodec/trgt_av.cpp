@@ -474,6 +474,10 @@ bool
 Target_LibAVCodec::end_scanline()
 	{ return true; }
 
+Color*
+Target_LibAVCodec::start_scanlines(int scanline, int /*count*/, int &pitch)
+	{ pitch = surface.get_pitch(); return surface[scanline]; }
+
 bool Target_LibAVCodec::init(synfig::ProgressCallback */*cb*/)
 {
 	surface.set_wh(desc.get_w(), desc.get_h());
@@ -62,6 +62,7 @@ public:
 	virtual void end_frame();
 	virtual synfig::Color * start_scanline(int scanline);
 	virtual bool end_scanline();
+	virtual synfig::Color * start_scanlines(int scanline, int count, int &pitch);
 };
 
 /* === E N D =============================================================== */
@@ -43,6 +43,8 @@
 #include <synfig/value.h>
 #include <time.h>
 
+#include "tasknoise.h"
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -190,6 +192,14 @@ NoiseDistort::get_param(const String & param)const
 	return Layer_Composite::get_param(param);
 }
 
+bool
+NoiseDistort::get_time_dependency_vfunc(const Time &a, const Time &b)const
+{
+	// noise is animated by speed parameter
+	return param_speed.get(Real()) != 0.0
+	    || Layer_CompositeFork::get_time_dependency_vfunc(a, b);
+}
+
 Layer::Vocab
 NoiseDistort::get_param_vocab()const
 {
@@ -342,5 +352,23 @@ NoiseDistort::accelerated_render(Context context,Surface *surface,int quality, c
 */
 
 rendering::Task::Handle
-NoiseDistort::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+NoiseDistort::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	Real speed=param_speed.get(Real());
+	int smooth=param_smooth.get(int());
+	if (!speed && smooth == (int)RandomNoise::SMOOTH_SPLINE)
+		smooth = (int)RandomNoise::SMOOTH_FAST_SPLINE;
+	Time time=speed*get_time_mark();
+
+	TaskNoiseDistort::Handle task(new TaskNoiseDistort());
+	task->random.set_seed(param_random.get(int()));
+	task->smooth = RandomNoise::SmoothType(smooth);
+	task->size = param_size.get(Vector());
+	task->detail = param_detail.get(int());
+	task->time = time;
+	task->turbulent = param_turbulent.get(bool());
+	task->displacement = param_displacement.get(Vector());
+	task->sub_task() = sub_task ? sub_task->clone_recursive() : rendering::Task::Handle();
+
+	return task;
+}
@@ -44,6 +44,8 @@
 #include <synfig/value.h>
 #include <time.h>
 
+#include "tasknoise.h"
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -194,6 +196,29 @@ Noise::color_func(const Point &point, float pixel_size,Context /*context*/)const
 	return ret;
 }
 
+rendering::Task::Handle
+Noise::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	Real speed=param_speed.get(Real());
+	int smooth=param_smooth.get(int());
+	if (!speed && smooth == (int)RandomNoise::SMOOTH_SPLINE)
+		smooth = (int)RandomNoise::SMOOTH_FAST_SPLINE;
+	Time time=speed*get_time_mark();
+
+	TaskNoise::Handle task(new TaskNoise());
+	task->random.set_seed(param_random.get(int()));
+	task->smooth = RandomNoise::SmoothType(smooth);
+	task->size = param_size.get(Vector());
+	task->detail = param_detail.get(int());
+	task->time = time;
+	task->turbulent = param_turbulent.get(bool());
+	task->do_alpha = param_do_alpha.get(bool());
+	task->super_sample = param_super_sample.get(bool());
+	task->gradient = compiled_gradient;
+
+	return task;
+}
+
 inline float
 Noise::calc_supersample(const synfig::Point &/*x*/, float /*pw*/,float /*ph*/)const
 {
@@ -253,6 +278,14 @@ Noise::get_param(const String & param)const
 	return Layer_Composite::get_param(param);
 }
 
+bool
+Noise::get_time_dependency_vfunc(const Time &a, const Time &b)const
+{
+	// noise is animated by speed parameter
+	return param_speed.get(Real()) != 0.0
+	    || Layer_Composite::get_time_dependency_vfunc(a, b);
+}
+
 Layer::Vocab
 Noise::get_param_vocab()const
 {
@@ -32,6 +32,8 @@
 
 #include "random_noise.h"
 #include <synfig/quick_rng.h>
+#include <synfig/rendering/software/function/blend.h>
+#include <algorithm>
 #include <cmath>
 #endif
 
@@ -40,10 +42,308 @@
 #define PI	(3.1415927)
 #endif
 
+#ifdef __GNUC__
+	// GCC and Clang vector extensions
+	#define NOISE_VECTORS
+	#define NOISE_INLINE inline __attribute__((always_inline))
+	#if defined(__x86_64__) || defined(__i386__)
+		#define NOISE_AVX2
+	#endif
+#endif
+
+#if defined(NOISE_AVX2) && !defined(__clang__)
+	// 8-wide vectors are used only inside of the function with avx2 target
+	#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
 
+#ifdef NOISE_VECTORS
+namespace {
+
+// Vector code below repeats every arithmetic operation of
+// RandomNoise::operator() in the same order and precision,
+// so results are bit-identical with scalar ones.
+
+//! Parameters of RandomNoise::generate() which are the same for all points
+struct Uniform
+{
+	RandomNoise::SmoothType smooth;
+	unsigned int seed;	//!< seed+subseed, multiplied by hash constant
+	int t, t_1, t0, t1, t2;
+	bool animated;		//!< time is not an integer
+	float c, f;			//!< time weights of linear and cosine interpolation
+	float ttf[4];		//!< time weights of cubic interpolation
+	float st[4];		//!< time weights of spline interpolation, see spline_sum()
+};
+
+float
+spline_p(float x)
+	{ return x > 0 ? x*x*x : 0.0f; }
+
+//! R(x) of spline interpolation without the final division by 6,
+//! scalar code multiplies products of these sums by 1/6 after each factor
+float
+spline_sum(float x)
+	{ return spline_p(x+2) - 4.0f*spline_p(x+1) + 6.0f*spline_p(x) - 4.0f*spline_p(x-1); }
+
+void
+init_uniform(Uniform &u, RandomNoise::SmoothType smooth, unsigned int seed, float tf, int loop)
+{
+	u.smooth = smooth;
+	u.seed = seed*31337u;
+
+	const int t((int)floor(tf));
+	u.t = t;
+	if (loop)
+	{
+		u.t0  = t % loop;		if (u.t0  <  0   ) u.t0  += loop;
+		u.t_1 = u.t0 - 1;	if (u.t_1 <  0   ) u.t_1 += loop;
+		u.t1  = u.t0 + 1;	if (u.t1  >= loop) u.t1  -= loop;
+		u.t2  = u.t1 + 1;	if (u.t2  >= loop) u.t2  -= loop;
+	}
+	else
+	{
+		u.t0  = t;
+		u.t_1 = t - 1;
+		u.t1  = t + 1;
+		u.t2  = t + 2;
+	}
+
+	u.animated = (float)t != tf;
+
+	const float dt(tf-t);
+	u.c = dt;
+	u.f = 1.0-dt;
+
+	u.ttf[0] = 0.5f*dt*(dt*(dt*(-1.f) + 2.f) - 1.f);
+	u.ttf[1] = 0.5f*(dt*(dt*(3.f*dt - 5.f)) + 2.f);
+	u.ttf[2] = 0.5f*dt*(dt*(-3.f*dt + 4.f) + 1.f);
+	u.ttf[3] = 0.5f*dt*dt*(dt-1.f);
+
+	for(int k = 0; k < 4; ++k)
+		u.st[k] = spline_sum((k - 1) - dt);
+}
+
+template<int N>
+struct VectorTypes;
+
+template<>
+struct VectorTypes<4>
+{
+	typedef float Real __attribute__((vector_size(4*sizeof(float))));
+	typedef int Int __attribute__((vector_size(4*sizeof(int))));
+	typedef unsigned int UInt __attribute__((vector_size(4*sizeof(int))));
+};
+
+template<>
+struct VectorTypes<8>
+{
+	typedef float Real __attribute__((vector_size(8*sizeof(float))));
+	typedef int Int __attribute__((vector_size(8*sizeof(int))));
+	typedef unsigned int UInt __attribute__((vector_size(8*sizeof(int))));
+};
+
+template<int N>
+class Generator
+{
+public:
+	typedef typename VectorTypes<N>::Real Real;
+	typedef typename VectorTypes<N>::Int Int;
+	typedef typename VectorTypes<N>::UInt UInt;
+
+	static NOISE_INLINE Real splat(float x)
+		{ return Real() + x; }
+	static NOISE_INLINE UInt splat_uint(unsigned int x)
+		{ return UInt() + x; }
+	static NOISE_INLINE Real to_real(const Int &x)
+		{ return __builtin_convertvector(x, Real); }
+	static NOISE_INLINE Real select(const Int &mask, const Real &x, const Real &y)
+		{ return (Real)(((Int)x & mask) | ((Int)y & ~mask)); }
+
+	//! (int)floor(x), too large values give the same result as scalar conversion
+	static NOISE_INLINE Int floor(const Real &x)
+	{
+		const Int i = __builtin_convertvector(x, Int);
+		return i + ((to_real(i) > x) & (x > splat(-2147483648.f)));
+	}
+
+	//! Products of lattice coordinates with hash constants of RandomNoise::operator(),
+	//! hash is linear modulo 2^32, so neighbour points only add constants to them
+	struct Lattice
+	{
+		UInt xy, y, x;
+		Lattice(const Int &x, const Int &y):
+			xy(((UInt)x + (UInt)y)*splat_uint(21870u)),
+			y((UInt)y*splat_uint(11213u)),
+			x((UInt)x*splat_uint(36979u))
+			{ }
+	};
+
+	//! RandomNoise::operator()(subseed,x+i,y+j,t) for each lane
+	static NOISE_INLINE Real value(const Uniform &u, const Lattice &l, int i, int j, int t)
+	{
+		UInt s = ( l.xy + splat_uint((unsigned int)(i + j)*21870u) )
+		       ^ ( l.y  + splat_uint((unsigned int)(j + t)*11213u) )
+		       ^ ( l.x  + splat_uint((unsigned int)(t + i)*36979u) )
+		       ^ splat_uint(u.seed);
+		s = s*splat_uint(1664525u) + splat_uint(1013904223u);
+		return to_real((Int)(s >> 16))/splat(65535.f)*splat(2.0f) - splat(1.0f);
+	}
+
+	static NOISE_INLINE Real spline_p(const Real &x)
+		{ return select(x > Real(), x*x*x, Real()); }
+
+	static NOISE_INLINE Real spline_sum(const Real &x)
+	{
+		return spline_p(x + splat(2.f)) - splat(4.0f)*spline_p(x + splat(1.f))
+		     + splat(6.0f)*spline_p(x) - splat(4.0f)*spline_p(x - splat(1.f));
+	}
+
+	//! RandomNoise::operator()(smooth,subseed,xf,yf,t,loop) for each lane
+	static NOISE_INLINE Real evaluate(const Uniform &u, const Real &xf, const Real &yf)
+	{
+		const Int x = floor(xf), y = floor(yf);
+		const Real a = xf - to_real(x), b = yf - to_real(y);
+		const Lattice l(x, y);
+
+		switch(u.smooth)
+		{
+		case RandomNoise::SMOOTH_CUBIC:
+		{
+			const Real txf[] =
+			{
+				splat(0.5f)*a*(a*(a*splat(-1.f) + splat(2.f)) - splat(1.f)),
+				splat(0.5f)*(a*(a*(splat(3.f)*a - splat(5.f))) + splat(2.f)),
+				splat(0.5f)*a*(a*(splat(-3.f)*a + splat(4.f)) + splat(1.f)),
+				splat(0.5f)*a*a*(a - splat(1.f))
+			};
+			const Real tyf[] =
+			{
+				splat(0.5f)*b*(b*(b*splat(-1.f) + splat(2.f)) - splat(1.f)),
+				splat(0.5f)*(b*(b*(splat(3.f)*b - splat(5.f))) + splat(2.f)),
+				splat(0.5f)*b*(b*(splat(-3.f)*b + splat(4.f)) + splat(1.f)),
+				splat(0.5f)*b*b*(b - splat(1.f))
+			};
+
+			Real xfa[4], tfa[4];
+			for(int i = 0; i < 4; ++i)
+			{
+				for(int j = 0; j < 4; ++j)
+				{
+					tfa[j] = value(u, l, j - 1, i - 1, u.t_1)*splat(u.ttf[0]) + value(u, l, j - 1, i - 1, u.t0)*splat(u.ttf[1])
+					       + value(u, l, j - 1, i - 1, u.t1)*splat(u.ttf[2]) + value(u, l, j - 1, i - 1, u.t2)*splat(u.ttf[3]);
+				}
+				xfa[i] = tfa[0]*txf[0] + tfa[1]*txf[1] + tfa[2]*txf[2] + tfa[3]*txf[3];
+			}
+			return xfa[0]*tyf[0] + xfa[1]*tyf[1] + xfa[2]*tyf[2] + xfa[3]*tyf[3];
+		}
+
+		case RandomNoise::SMOOTH_FAST_SPLINE:
+		case RandomNoise::SMOOTH_SPLINE:
+		{
+			const Real m = splat(1.0f/6.0f);
+			Real ra[4], sb[4];
+			for(int i = 0; i < 4; ++i)
+			{
+				ra[i] = spline_sum(splat((float)(i - 1)) - a)*m;
+				sb[i] = spline_sum(b - splat((float)(i - 1)));
+			}
+
+			Real w[4][4];
+			for(int i = 0; i < 4; ++i)
+				for(int j = 0; j < 4; ++j)
+					w[i][j] = ra[i]*sb[j]*m;
+
+			if (u.smooth == RandomNoise::SMOOTH_FAST_SPLINE)
+			{
+				Real ret = value(u, l, 0, 0, 0)*w[1][1];
+				for(int i = 0; i < 4; ++i)
+					for(int j = 0; j < 4; ++j)
+						if (i != 1 || j != 1)
+							ret += value(u, l, i - 1, j - 1, 0)*w[i][j];
+				return ret;
+			}
+
+			const int ta[] = { u.t_1, u.t0, u.t1, u.t2 };
+			Real ret = value(u, l, 0, 0, u.t0)*(w[1][1]*splat(u.st[1])*m);
+			for(int k = 0; k < 4; ++k)
+				for(int i = 0; i < 4; ++i)
+					for(int j = 0; j < 4; ++j)
+						if (k != 1 || i != 1 || j != 1)
+							ret += value(u, l, i - 1, j - 1, ta[k])*(w[i][j]*splat(u.st[k])*m);
+			return ret;
+		}
+
+		case RandomNoise::SMOOTH_COSINE:
+		case RandomNoise::SMOOTH_LINEAR:
+		{
+			Real wa = a, wb = b;
+			if (u.smooth == RandomNoise::SMOOTH_COSINE)
+			{
+				// double precision cos() of each lane, exactly as in scalar code
+				for(int i = 0; i < N; ++i)
+				{
+					const float ai = wa[i], bi = wb[i];
+					wa[i] = (1.0f-cos(ai*PI))*0.5f;
+					wb[i] = (1.0f-cos(bi*PI))*0.5f;
+				}
+			}
+			const Real wc = splat(1.f) - wa, wd = splat(1.f) - wb;
+
+			if (!u.animated)
+				return value(u, l, 0, 0, u.t0)*(wc*wd)
+				     + value(u, l, 1, 0, u.t0)*(wa*wd)
+				     + value(u, l, 0, 1, u.t0)*(wc*wb)
+				     + value(u, l, 1, 1, u.t0)*(wa*wb);
+
+			const Real c = splat(u.c), f = splat(u.f);
+			return value(u, l, 0, 0, u.t0)*(wc*wd*f)
+			     + value(u, l, 1, 0, u.t0)*(wa*wd*f)
+			     + value(u, l, 0, 1, u.t0)*(wc*wb*f)
+			     + value(u, l, 1, 1, u.t0)*(wa*wb*f)
+			     + value(u, l, 0, 0, u.t1)*(wc*wd*c)
+			     + value(u, l, 1, 0, u.t1)*(wa*wd*c)
+			     + value(u, l, 0, 1, u.t1)*(wc*wb*c)
+			     + value(u, l, 1, 1, u.t1)*(wa*wb*c);
+		}
+
+		default:
+			return value(u, l, 0, 0, u.t0);
+		}
+	}
+
+	static NOISE_INLINE void generate(const Uniform &u, const float *x, const float *y, float *dest, int count)
+	{
+		for(int i = 0; i < count; i += N)
+		{
+			const int n = std::min(N, count - i);
+			Real xf = Real(), yf = Real();
+			for(int j = 0; j < n; ++j)
+				{ xf[j] = x[i + j]; yf[j] = y[i + j]; }
+			const Real r = evaluate(u, xf, yf);
+			for(int j = 0; j < n; ++j)
+				dest[i + j] = r[j];
+		}
+	}
+};
+
+void
+generate_vector4(const Uniform &u, const float *x, const float *y, float *dest, int count)
+	{ Generator<4>::generate(u, x, y, dest, count); }
+
+#ifdef NOISE_AVX2
+__attribute__((target("avx2")))
+void
+generate_vector8(const Uniform &u, const float *x, const float *y, float *dest, int count)
+	{ Generator<8>::generate(u, x, y, dest, count); }
+#endif
+
+} // end of anonimous namespace
+#endif // NOISE_VECTORS
+
 /* === M E T H O D S ======================================================= */
 
 void
@@ -320,3 +620,29 @@ RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf
 		return (*this)(subseed,x,y,t0);
 	}
 }
+
+void
+RandomNoise::generate(SmoothType smooth,int subseed,const float *x,const float *y,float *dest,int count,float t,int loop)const
+{
+#ifdef NOISE_VECTORS
+	Uniform u;
+	init_uniform(u, smooth, static_cast<unsigned int>(seed_+subseed), t, loop);
+
+	switch(synfig::rendering::software::Blend::get_instructions())
+	{
+	#ifdef NOISE_AVX2
+	case synfig::rendering::software::Blend::INSTRUCTIONS_VECTOR8:
+		generate_vector8(u, x, y, dest, count);
+		return;
+	#endif
+	case synfig::rendering::software::Blend::INSTRUCTIONS_VECTOR4:
+		generate_vector4(u, x, y, dest, count);
+		return;
+	default:
+		break;
+	}
+#endif
+
+	for(int i = 0; i < count; ++i)
+		dest[i] = (*this)(smooth, subseed, x[i], y[i], t, loop);
+}
@@ -56,6 +56,10 @@ public:
 
 	float operator()(int subseed,int x,int y=0, int t=0)const;
 	float operator()(SmoothType smooth,int subseed,float x,float y=0,float t=0,int loop=0)const;
+
+	//! Evaluates smoothed noise for count points at once (usually a row of pixels),
+	//! dest[i] is exactly the same as operator()(smooth,subseed,x[i],y[i],t,loop)
+	void generate(SmoothType smooth,int subseed,const float *x,const float *y,float *dest,int count,float t=0,int loop=0)const;
 };
 
 /* === E N D =============================================================== */
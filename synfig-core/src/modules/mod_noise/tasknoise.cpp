@@ -0,0 +1,375 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tasknoise.cpp
+**	\brief Rendering tasks of the noise layers
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/software/task/tasksw.h>
+#include <synfig/rendering/software/function/blend.h>
+
+#include "tasknoise.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+Task::Token TaskNoise::token(
+	DescAbstract<TaskNoise>("Noise") );
+Task::Token TaskNoiseDistort::token(
+	DescAbstract<TaskNoiseDistort>("NoiseDistort") );
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+//! Coordinates of the first octave for a row of points, see Noise::color_func()
+void
+init_octave(const NoiseOctaves &octaves, const Vector *points, const Vector &offset, float *x, float *y, int count)
+{
+	for(int i = 0; i < count; ++i) {
+		x[i] = (points[i][0] + offset[0])/octaves.size[0]*(1<<octaves.detail);
+		y[i] = (points[i][1] + offset[1])/octaves.size[1]*(1<<octaves.detail);
+	}
+}
+
+//! Adds the next octave to the accumulated noise values
+template<typename T>
+void
+add_octave(const NoiseOctaves &octaves, T *values, const float *noise, int count)
+{
+	for(int i = 0; i < count; ++i) {
+		T &v = values[i];
+		v = noise[i] + v*0.5;
+		if (v < -1) v = -1;
+		if (v >  1) v =  1;
+		if (octaves.turbulent)
+			v = std::fabs(v);
+	}
+}
+
+void
+scale_octave(float *x, float *y, int count)
+	{ for(int i = 0; i < count; ++i) { x[i] *= 0.5f; y[i] *= 0.5f; } }
+
+
+class TaskNoiseSW: public TaskNoise, public TaskSW,
+	public TaskInterfaceBlendToTarget,
+	public TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskNoiseSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual void on_target_set_as_source() {
+		Task::Handle &subtask = sub_task(0);
+		if ( subtask
+		  && subtask->target_surface == target_surface
+		  && !Color::is_straight(blend_method) )
+		{
+			trunc_by_bounds();
+			subtask->source_rect = source_rect;
+			subtask->target_rect = target_rect;
+		}
+	}
+
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid())
+			return true;
+
+		Vector ppu = get_pixels_per_unit();
+
+		Matrix bounds_transfromation;
+		bounds_transfromation.m00 = ppu[0];
+		bounds_transfromation.m11 = ppu[1];
+		bounds_transfromation.m20 = target_rect.minx - ppu[0]*source_rect.minx;
+		bounds_transfromation.m21 = target_rect.miny - ppu[1]*source_rect.miny;
+
+		Matrix matrix = bounds_transfromation * transformation->matrix;
+		if (!matrix.is_invertible())
+			return true;
+		Matrix inv_matrix = matrix.get_inverted();
+
+		LockWrite la(this);
+		if (!la)
+			return false;
+
+		Color::BlendMethod method = blend ? blend_method : Color::BLEND_COMPOSITE;
+		ColorReal amount = blend ? this->amount : ColorReal(1.0);
+
+		// the same supersample radius as in Noise::accelerated_render()
+		const float pixel_size = super_sample ? (inv_matrix.axis_x().mag() + inv_matrix.axis_y().mag())*0.5f : 0.f;
+		const bool supersampled = super_sample && pixel_size;
+
+		const int w = target_rect.get_width();
+		std::vector<Vector> points(w);
+		std::vector<float> x(w), y(w), x2(w), y2(w), noise(w);
+		std::vector<float> values(w), values2(w), values3(w), alpha(w);
+		std::vector<Color> colors(w);
+
+		for(int py = target_rect.miny; py < target_rect.maxy; ++py) {
+			// noise is sampled at the corners of pixels, like in Noise::accelerated_render()
+			for(int i = 0; i < w; ++i)
+				points[i] = inv_matrix.get_transformed(Vector(target_rect.minx + i, py));
+
+			init_octave(*this, &points.front(), Vector(), &x.front(), &y.front(), w);
+			std::fill(values.begin(), values.end(), 0.f);
+			std::fill(alpha.begin(), alpha.end(), 0.f);
+			if (supersampled) {
+				init_octave(*this, &points.front(), Vector(pixel_size, pixel_size), &x2.front(), &y2.front(), w);
+				std::fill(values2.begin(), values2.end(), 0.f);
+				std::fill(values3.begin(), values3.end(), 0.f);
+			}
+
+			for(int i = 0; i < detail; ++i) {
+				const int subseed = (detail - i)*5;
+
+				random.generate(smooth, subseed, &x.front(), &y.front(), &noise.front(), w, time);
+				add_octave(*this, &values.front(), &noise.front(), w);
+
+				if (supersampled) {
+					random.generate(smooth, subseed, &x2.front(), &y.front(), &noise.front(), w, time);
+					add_octave(*this, &values2.front(), &noise.front(), w);
+					random.generate(smooth, subseed, &x.front(), &y2.front(), &noise.front(), w, time);
+					add_octave(*this, &values3.front(), &noise.front(), w);
+					scale_octave(&x2.front(), &y2.front(), w);
+				}
+
+				if (do_alpha) {
+					random.generate(smooth, 3 + subseed, &x.front(), &y.front(), &noise.front(), w, time);
+					add_octave(*this, &alpha.front(), &noise.front(), w);
+				}
+
+				scale_octave(&x.front(), &y.front(), w);
+			}
+
+			for(int i = 0; i < w; ++i) {
+				float a = values[i], a2 = values2[i], a3 = values3[i], al = alpha[i];
+				if (!turbulent) {
+					a = a/2.0f + 0.5f;
+					al = al/2.0f + 0.5f;
+					if (supersampled) {
+						a2 = a2/2.0f + 0.5f;
+						a3 = a3/2.0f + 0.5f;
+					}
+				}
+
+				if (supersampled) {
+					Real da = std::max(a3, std::max(a, a2)) - std::min(a3, std::min(a, a2));
+					colors[i] = gradient.average(a - da, a + da);
+				} else {
+					colors[i] = gradient.color(a);
+				}
+
+				if (do_alpha)
+					colors[i].set_a(colors[i].get_a()*al);
+			}
+
+			software::Blend::blend(&la->get_surface()[py][target_rect.minx], &colors.front(), w, method, amount);
+		}
+
+		return true;
+	}
+};
+
+
+class TaskNoiseDistortSW: public TaskNoiseDistort, public TaskSW,
+	public TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskNoiseDistortSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
+			return true;
+
+		LockWrite la(this);
+		LockRead lb(sub_task());
+		if (!la || !lb)
+			return false;
+
+		synfig::Surface &dest = la->get_surface();
+		const synfig::Surface &src = lb->get_surface();
+
+		// see Layer_RenderingTask::get_color(), pixels are sampled at their centers here
+		const RectInt &src_target_rect = sub_task()->target_rect;
+		const Rect &src_source_rect = sub_task()->source_rect;
+		Matrix units_to_src_pixels;
+		units_to_src_pixels.m00 = (src_target_rect.maxx - src_target_rect.minx)/(src_source_rect.maxx - src_source_rect.minx);
+		units_to_src_pixels.m11 = (src_target_rect.maxy - src_target_rect.miny)/(src_source_rect.maxy - src_source_rect.miny);
+		units_to_src_pixels.m20 = src_target_rect.minx - src_source_rect.minx*units_to_src_pixels.m00;
+		units_to_src_pixels.m21 = src_target_rect.miny - src_source_rect.miny*units_to_src_pixels.m11;
+		Rect src_target_rectf(src_target_rect.minx, src_target_rect.miny, src_target_rect.maxx, src_target_rect.maxy);
+
+		const Vector upp = get_units_per_pixel();
+		const int w = target_rect.get_width();
+		std::vector<Vector> points(w);
+		std::vector<float> x(w), y(w), noise(w);
+		std::vector<Real> vx(w), vy(w);
+
+		for(int py = target_rect.miny; py < target_rect.maxy; ++py) {
+			// layers without own renderer are sampled at the centers of pixels, see synfig::render()
+			for(int i = 0; i < w; ++i)
+				points[i] = Vector(
+					source_rect.minx + (i + 0.5)*upp[0],
+					source_rect.miny + (py - target_rect.miny + 0.5)*upp[1] );
+
+			init_octave(*this, &points.front(), Vector(), &x.front(), &y.front(), w);
+			std::fill(vx.begin(), vx.end(), 0.0);
+			std::fill(vy.begin(), vy.end(), 0.0);
+
+			for(int i = 0; i < detail; ++i) {
+				const int subseed = (detail - i)*5;
+				random.generate(smooth, subseed, &x.front(), &y.front(), &noise.front(), w, time);
+				add_octave(*this, &vx.front(), &noise.front(), w);
+				random.generate(smooth, 1 + subseed, &x.front(), &y.front(), &noise.front(), w, time);
+				add_octave(*this, &vy.front(), &noise.front(), w);
+				scale_octave(&x.front(), &y.front(), w);
+			}
+
+			Color *d = &dest[py][target_rect.minx];
+			for(int i = 0; i < w; ++i, ++d) {
+				Vector vect(vx[i], vy[i]);
+				if (!turbulent) {
+					vect[0] = vect[0]/2.0f + 0.5f;
+					vect[1] = vect[1]/2.0f + 0.5f;
+				}
+				vect[0] = (vect[0] - 0.5f)*displacement[0];
+				vect[1] = (vect[1] - 0.5f)*displacement[1];
+
+				// linear_sample() takes values of pixels at their integer coordinates,
+				// but the context pixel covers [x, x+1), so its center is half a pixel off
+				Vector p = units_to_src_pixels.get_transformed(points[i] + vect);
+				*d = src_target_rectf.is_inside(p) ? src.linear_sample(p[0] - 0.5, p[1] - 0.5) : Color(0.0, 0.0, 0.0, 0.0);
+			}
+		}
+
+		return true;
+	}
+};
+
+
+Task::Token TaskNoiseSW::token(
+	DescReal<TaskNoiseSW, TaskNoise>("NoiseSW") );
+Task::Token TaskNoiseDistortSW::token(
+	DescReal<TaskNoiseDistortSW, TaskNoiseDistort>("NoiseDistortSW") );
+
+} // namespace
+
+/* === M E T H O D S ======================================================= */
+
+void
+NoiseOctaves::hash_octaves(TaskHash &hash) const
+{
+	hash.add(random.get_seed());
+	hash.add((int)smooth);
+	hash.add(size);
+	hash.add(detail);
+	hash.add(time);
+	hash.add(turbulent);
+}
+
+bool
+TaskNoise::hash_params(TaskHash &hash) const
+{
+	hash_octaves(hash);
+	hash.add(do_alpha);
+	hash.add(super_sample);
+	hash.add(&transformation->matrix.m, sizeof(transformation->matrix.m));
+	hash.add(gradient.get_repeat());
+	const CompiledGradient::List &list = gradient.get_list();
+	hash.add((int)list.size());
+	for(CompiledGradient::List::const_iterator i = list.begin(); i != list.end(); ++i) {
+		hash.add(i->prev_pos);
+		hash.add(i->next_pos);
+		hash.add(&i->prev_color, sizeof(i->prev_color));
+		hash.add(&i->next_color, sizeof(i->next_color));
+	}
+	return true;
+}
+
+bool
+TaskNoiseDistort::hash_params(TaskHash &hash) const
+{
+	hash_octaves(hash);
+	hash.add(displacement);
+	return true;
+}
+
+Rect
+TaskNoiseDistort::calc_bounds() const
+{
+	if (!sub_task()) return Rect::zero();
+	Rect bounds = sub_task()->get_bounds();
+	bounds.expand_x(std::fabs(displacement[0]));
+	bounds.expand_y(std::fabs(displacement[1]));
+	return bounds;
+}
+
+void
+TaskNoiseDistort::set_coords_sub_tasks()
+{
+	if (!sub_task())
+		{ trunc_to_zero(); return; }
+	if (!is_valid_coords())
+		{ sub_task()->set_coords_zero(); return; }
+
+	Vector ppu = get_pixels_per_unit();
+	Vector upp = get_units_per_pixel();
+
+	// displaced points may reach the context out of own bounds,
+	// one extra pixel is for linear sampling
+	VectorInt target_extra_size(
+		(int)std::ceil(std::fabs(displacement[0]*ppu[0])) + 1,
+		(int)std::ceil(std::fabs(displacement[1]*ppu[1])) + 1 );
+	VectorInt sub_target_size = target_rect.get_size() + target_extra_size*2;
+
+	Rect sub_source_rect = source_rect;
+	sub_source_rect.expand_x(target_extra_size[0]*upp[0]);
+	sub_source_rect.expand_y(target_extra_size[1]*upp[1]);
+
+	sub_task()->set_coords(sub_source_rect, sub_target_size);
+}
+
+/* === E N T R Y P O I N T ================================================= */
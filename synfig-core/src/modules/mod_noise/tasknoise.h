@@ -0,0 +1,104 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tasknoise.h
+**	\brief Header file for rendering tasks of the noise layers
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_MOD_NOISE_TASKNOISE_H
+#define __SYNFIG_MOD_NOISE_TASKNOISE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/gradient.h>
+#include <synfig/vector.h>
+#include <synfig/rendering/task.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+
+#include "random_noise.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+//! Parameters of the noise sampled by octaves, common for both noise layers
+class NoiseOctaves
+{
+public:
+	RandomNoise random;
+	RandomNoise::SmoothType smooth;
+	synfig::Vector size;
+	int detail;
+	float time; //!< speed multiplied by time
+	bool turbulent;
+
+	NoiseOctaves(): smooth(RandomNoise::SMOOTH_DEFAULT), size(1.0, 1.0), detail(), time(), turbulent()
+		{ random.set_seed(0); }
+
+	void hash_octaves(synfig::rendering::TaskHash &hash) const;
+};
+
+//! Fills the whole plane by the noise gradient, see Noise::color_func()
+class TaskNoise: public synfig::rendering::Task, public synfig::rendering::TaskInterfaceTransformation,
+	public NoiseOctaves
+{
+public:
+	typedef etl::handle<TaskNoise> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	bool do_alpha;
+	bool super_sample;
+	synfig::CompiledGradient gradient;
+	synfig::rendering::Holder<synfig::rendering::TransformationAffine> transformation;
+
+	TaskNoise(): do_alpha(), super_sample() { }
+	virtual synfig::rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+
+	virtual bool hash_params(synfig::rendering::TaskHash &hash) const;
+};
+
+//! Samples the sub task at points moved by the noise, see NoiseDistort::point_func()
+class TaskNoiseDistort: public synfig::rendering::Task, public NoiseOctaves
+{
+public:
+	typedef etl::handle<TaskNoiseDistort> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	synfig::Vector displacement;
+
+	virtual int get_pass_subtask_index() const
+		{ return sub_task() ? PASSTO_THIS_TASK : PASSTO_NO_TASK; }
+
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	virtual bool hash_params(synfig::rendering::TaskHash &hash) const;
+	virtual synfig::Rect calc_bounds() const;
+	virtual void set_coords_sub_tasks();
+};
+
+/* === E N D =============================================================== */
+
+#endif
@@ -37,10 +37,17 @@
 #include <glib/gstdio.h>
 #include "trgt_png.h"
 #include <png.h>
+#include <zlib.h>
 #include <cstdio>
 #include <ETL/misc>
 #include <string.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -55,22 +62,138 @@ SYNFIG_TARGET_SET_NAME(png_trgt,"png");
 SYNFIG_TARGET_SET_EXT(png_trgt,"png");
 SYNFIG_TARGET_SET_VERSION(png_trgt,"0.1");
 
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+inline void
+put_uint16be(unsigned char *dst, ColorReal x)
+{
+	int i = (int)(clamp(x, ColorReal(0), ColorReal(1))*ColorReal(65535) + ColorReal(0.5));
+	dst[0] = (unsigned char)(i >> 8);
+	dst[1] = (unsigned char)(i & 0xff);
+}
+
+void
+pack_rgb48be(unsigned char *dst, const Surface &surface, bool alpha)
+{
+	for(int y = 0; y < surface.get_h(); ++y) {
+		const Color *src = surface[y];
+		for(const Color *end = src + surface.get_w(); src < end; ++src) {
+			put_uint16be(dst + 0, src->get_r());
+			put_uint16be(dst + 2, src->get_g());
+			put_uint16be(dst + 4, src->get_b());
+			dst += 6;
+			if (alpha)
+				put_uint16be(dst, src->get_a()), dst += 2;
+		}
+	}
+}
+
+}
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+//! Encodes frames of image sequence in several threads, so compression
+//! of frames overlaps rendering of the next ones
+class png_trgt::Encoder
+{
+private:
+	//! count of frames waiting for encoding, limits memory usage
+	size_t max_queue;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<Image> queue;
+	std::vector< std::vector<unsigned char> > spare;
+	bool stopped;
+	bool failed;
+	std::vector<std::thread> threads;
+
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true) {
+			cond.wait(lock, [this] { return stopped || !queue.empty(); });
+			if (queue.empty()) break;
+
+			Image image(std::move(queue.front()));
+			queue.pop_front();
+			cond.notify_all();
+
+			lock.unlock();
+			bool success = write_image(image);
+			lock.lock();
+
+			if (!success) failed = true;
+			spare.push_back(std::vector<unsigned char>());
+			std::swap(spare.back(), image.pixels);
+		}
+	}
+
+public:
+	explicit Encoder(int count):
+		max_queue(count), stopped(), failed()
+	{
+		for(int i = 0; i < count; ++i)
+			threads.push_back(std::thread(&Encoder::run, this));
+	}
+
+	~Encoder() { finish(); }
+
+	//! takes buffer of already encoded frame to avoid reallocation
+	void reuse_buffer(std::vector<unsigned char> &buffer) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!spare.empty()) {
+			std::swap(buffer, spare.back());
+			spare.pop_back();
+		}
+	}
+
+	//! moves image into queue, waits while queue is full
+	bool push(Image &image) {
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait(lock, [this] { return failed || queue.size() < max_queue; });
+		if (failed) return false;
+		queue.push_back(std::move(image));
+		image.file = NULL;
+		cond.notify_all();
+		return true;
+	}
+
+	//! encodes all queued frames and stops threads
+	bool finish() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopped = true;
+			cond.notify_all();
+		}
+		for(std::vector<std::thread>::iterator i = threads.begin(); i != threads.end(); ++i)
+			if (i->joinable()) i->join();
+		return !failed;
+	}
+};
+
 /* === M E T H O D S ======================================================= */
 
+png_trgt::EncodeParams::EncodeParams():
+	bit_depth(8),
+	compression_level(Z_DEFAULT_COMPRESSION),
+	strategy(Z_DEFAULT_STRATEGY),
+	filters(PNG_FILTER_NONE)
+{ }
+
 void
 png_trgt::png_out_error(png_struct *png_data,const char *msg)
 {
-	png_trgt *me=(png_trgt*)png_get_error_ptr(png_data);
-	synfig::error(strprintf("png_trgt: error: %s",msg));
-	me->ready=false;
+	const char *filename=(const char*)png_get_error_ptr(png_data);
+	synfig::error(strprintf("png_trgt: error: %s: %s",filename,msg));
 }
 
 void
 png_trgt::png_out_warning(png_struct *png_data,const char *msg)
 {
-	png_trgt *me=(png_trgt*)png_get_error_ptr(png_data);
-	synfig::warning(strprintf("png_trgt: warning: %s",msg));
-	me->ready=false;
+	const char *filename=(const char*)png_get_error_ptr(png_data);
+	synfig::warning(strprintf("png_trgt: warning: %s: %s",filename,msg));
 }
 
 
@@ -78,24 +201,58 @@ png_trgt::png_out_warning(png_struct *png_data,const char *msg)
 
 png_trgt::png_trgt(const char *Filename, const synfig::TargetParam &params):
 	file(NULL),
-	png_ptr(NULL),
-	info_ptr(NULL),
 	multi_image(),
-	ready(false),
 	imagecount(),
 	filename(Filename),
-	buffer(NULL),
-	color_buffer(NULL),
-	sequence_separator(params.sequence_separator)
-{ }
+	sequence_separator(params.sequence_separator),
+	encoder(NULL),
+	encode_threads(std::max(1, std::min(4, (int)std::thread::hardware_concurrency()/2))),
+	encode_failed(false)
+{
+	if (const char *s = getenv("SYNFIG_TARGET_PNG_BIT_DEPTH")) {
+		int depth = atoi(s);
+		if (depth == 8 || depth == 16)
+			encode_params.bit_depth = depth;
+		else
+			synfig::warning("SYNFIG_TARGET_PNG_BIT_DEPTH: unsupported bit depth '%s'", s);
+	}
+	if (const char *s = getenv("SYNFIG_TARGET_PNG_COMPRESSION")) {
+		String level(s);
+		if (level == "fast") {
+			// run-length matches only, fast but needs filtered rows
+			// to compress well, so SYNFIG_TARGET_PNG_FILTER is "sub" by default
+			encode_params.compression_level = 1;
+			encode_params.strategy = Z_RLE;
+			encode_params.filters = PNG_FILTER_SUB;
+		} else
+		if (level == "best")
+			encode_params.compression_level = Z_BEST_COMPRESSION;
+		else
+		if (level.size() == 1 && level[0] >= '0' && level[0] <= '9')
+			encode_params.compression_level = level[0] - '0';
+		else
+			synfig::warning("SYNFIG_TARGET_PNG_COMPRESSION: unknown compression '%s'", s);
+	}
+	if (const char *s = getenv("SYNFIG_TARGET_PNG_FILTER")) {
+		String filter(s);
+		if (filter == "none")  encode_params.filters = PNG_FILTER_NONE;  else
+		if (filter == "sub")   encode_params.filters = PNG_FILTER_SUB;   else
+		if (filter == "up")    encode_params.filters = PNG_FILTER_UP;    else
+		if (filter == "avg")   encode_params.filters = PNG_FILTER_AVG;   else
+		if (filter == "paeth") encode_params.filters = PNG_FILTER_PAETH; else
+		if (filter == "all")   encode_params.filters = PNG_ALL_FILTERS;  else
+			synfig::warning("SYNFIG_TARGET_PNG_FILTER: unknown filter '%s'", s);
+	}
+	if (const char *s = getenv("SYNFIG_TARGET_PNG_ENCODE_THREADS"))
+		encode_threads = std::max(0, atoi(s));
+}
 
 png_trgt::~png_trgt()
 {
-	if(file)
+	delete encoder;
+	if(file && file!=stdout)
 		fclose(file);
 	file=NULL;
-	delete [] buffer;
-	delete [] color_buffer;
 }
 
 bool
@@ -111,20 +268,64 @@ png_trgt::set_rend_desc(RendDesc *given_desc)
 	return true;
 }
 
+void
+png_trgt::pack_image()
+{
+	image.w=frame.get_w();
+	image.h=frame.get_h();
+	image.alpha=get_alpha_mode()==TARGET_ALPHA_MODE_KEEP;
+	image.x_res=round_to_int(desc.get_x_res());
+	image.y_res=round_to_int(desc.get_y_res());
+	image.title=get_canvas()->get_name();
+	image.description=get_canvas()->get_description();
+	image.params=encode_params;
+
+	if (encoder)
+		encoder->reuse_buffer(image.pixels);
+	image.pixels.resize(image.row_size()*image.h);
+	if (image.pixels.empty())
+		return;
+
+	if (image.params.bit_depth == 16)
+		pack_rgb48be(&image.pixels.front(), frame, image.alpha);
+	else
+		color_to_pixelformat(
+			&image.pixels.front(), frame[0],
+			image.alpha ? PF_RGB|PF_A : PF_RGB, 0,
+			image.w, image.h, 0, frame.get_pitch() );
+}
+
 void
 png_trgt::end_frame()
 {
-	if(ready && file)
+	if(file)
 	{
-		png_write_end(png_ptr,info_ptr);
-		png_destroy_write_struct(&png_ptr, &info_ptr);
+		pack_image();
+		image.file=file;
+		image.filename=frame_filename;
+		file=NULL;
+
+		// frames written to stdout must keep their order
+		bool success = encoder ? encoder->push(image) : write_image(image);
+		if (!success)
+		{
+			if (image.file && image.file!=stdout)
+				fclose(image.file);
+			image.file=NULL;
+			encode_failed=true;
+		}
 	}
 
-	if(file && file!=stdout)
-		fclose(file);
-	file=NULL;
 	imagecount++;
-	ready=false;
+
+	// last frame, so all files should be complete when rendering ends
+	if (encoder && imagecount>desc.get_frame_end())
+	{
+		if (!encoder->finish())
+			encode_failed=true;
+		delete encoder;
+		encoder=NULL;
+	}
 }
 
 bool
@@ -132,24 +333,29 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 {
 	int w=desc.get_w(),h=desc.get_h();
 
+	if (encode_failed)
+		return false;
+
 	if(file && file!=stdout)
 		fclose(file);
 	if(filename=="-")
 	{
 		if(callback)callback->task(strprintf("(stdout) %d",imagecount).c_str());
 		file=stdout;
+		frame_filename="(stdout)";
 	}
 	else if(multi_image)
 	{
-		String newfilename(filename_sans_extension(filename) +
-						   sequence_separator +
-						   etl::strprintf("%04d",imagecount) +
-						   filename_extension(filename));
-		file=g_fopen(newfilename.c_str(),POPEN_BINARY_WRITE_TYPE);
-		if(callback)callback->task(newfilename);
+		frame_filename=filename_sans_extension(filename) +
+					   sequence_separator +
+					   etl::strprintf("%04d",imagecount) +
+					   filename_extension(filename);
+		file=g_fopen(frame_filename.c_str(),POPEN_BINARY_WRITE_TYPE);
+		if(callback)callback->task(frame_filename);
 	}
 	else
 	{
+		frame_filename=filename;
 		file=g_fopen(filename.c_str(),POPEN_BINARY_WRITE_TYPE);
 		if(callback)callback->task(filename);
 	}
@@ -157,47 +363,78 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 	if(!file)
 		return false;
 
-	delete [] buffer;
-	buffer=new unsigned char[4*w];
+	if (!encoder && multi_image && file!=stdout && encode_threads>0)
+		encoder=new Encoder(encode_threads);
+
+	if (frame.get_w()!=w || frame.get_h()!=h)
+		frame.set_wh(w,h);
+	return true;
+}
+
+Color *
+png_trgt::start_scanline(int scanline)
+{
+	return frame[scanline];
+}
 
-	delete [] color_buffer;
-	color_buffer=new Color[w];
+Color *
+png_trgt::start_scanlines(int scanline, int /*count*/, int &pitch)
+{
+	pitch = frame.get_pitch();
+	return frame[scanline];
+}
 
-	png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING, (png_voidp)this,png_out_error, png_out_warning);
+bool
+png_trgt::end_scanline()
+{
+	return file!=NULL;
+}
+
+bool
+png_trgt::write_image(Image &image)
+{
+	FILE *file=image.file;
+	image.file=NULL;
+
+	png_structp png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING, (png_voidp)image.filename.c_str(), png_out_error, png_out_warning);
 	if (!png_ptr)
 	{
 		synfig::error("Unable to setup PNG struct");
-		fclose(file);
+		if(file!=stdout)
+			fclose(file);
 		return false;
 	}
 
-	info_ptr= png_create_info_struct(png_ptr);
+	png_infop info_ptr= png_create_info_struct(png_ptr);
 	if (!info_ptr)
 	{
 		synfig::error("Unable to setup PNG info struct");
-		fclose(file);
 		png_destroy_write_struct(&png_ptr,(png_infopp)NULL);
+		if(file!=stdout)
+			fclose(file);
 		return false;
 	}
 
+	// png_out_error() returns, then libpng jumps here
 	if (setjmp(png_jmpbuf(png_ptr)))
 	{
-		synfig::error("Unable to setup longjump");
 		png_destroy_write_struct(&png_ptr, &info_ptr);
-		fclose(file);
+		if(file!=stdout)
+			fclose(file);
 		return false;
 	}
+
 	png_init_io(png_ptr,file);
-	png_set_filter(png_ptr,0,PNG_FILTER_NONE);
+	png_set_filter(png_ptr,0,image.params.filters);
+	png_set_compression_level(png_ptr,image.params.compression_level);
+	png_set_compression_strategy(png_ptr,image.params.strategy);
 
-	setjmp(png_jmpbuf(png_ptr));
-	if (get_alpha_mode()==TARGET_ALPHA_MODE_KEEP)
-		png_set_IHDR(png_ptr,info_ptr,w,h,8,PNG_COLOR_TYPE_RGBA,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
-	else
-		png_set_IHDR(png_ptr,info_ptr,w,h,8,PNG_COLOR_TYPE_RGB,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
+	png_set_IHDR(png_ptr,info_ptr,image.w,image.h,image.params.bit_depth,
+		image.alpha ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB,
+		PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
 
 	// Write the physical size
-	png_set_pHYs(png_ptr,info_ptr,round_to_int(desc.get_x_res()),round_to_int(desc.get_y_res()),PNG_RESOLUTION_METER);
+	png_set_pHYs(png_ptr,info_ptr,image.x_res,image.y_res,PNG_RESOLUTION_METER);
 	
 	// Explicit set gamma value to 2.2 (it's a default value)
 	png_set_gAMA(png_ptr,info_ptr,1/2.2);
@@ -213,12 +450,12 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 
 	comments[0].compression = PNG_TEXT_COMPRESSION_NONE;
 	comments[0].key         = title;
-	comments[0].text        = const_cast<char *>(get_canvas()->get_name().c_str());
+	comments[0].text        = const_cast<char *>(image.title.c_str());
 	comments[0].text_length = strlen(comments[0].text);
 
 	comments[1].compression = PNG_TEXT_COMPRESSION_NONE;
 	comments[1].key         = description;
-	comments[1].text        = const_cast<char *>(get_canvas()->get_description().c_str());
+	comments[1].text        = const_cast<char *>(image.description.c_str());
 	comments[1].text_length = strlen(comments[1].text);
 
 	comments[2].compression = PNG_TEXT_COMPRESSION_NONE;
@@ -228,29 +465,16 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 
 	png_set_text(png_ptr, info_ptr, comments, sizeof(comments)/sizeof(png_text));
 
-	png_write_info_before_PLTE(png_ptr, info_ptr);
 	png_write_info(png_ptr, info_ptr);
-	ready=true;
-	return true;
-}
 
-Color *
-png_trgt::start_scanline(int /*scanline*/)
-{
-	return color_buffer;
-}
-
-bool
-png_trgt::end_scanline()
-{
-	if(!file || !ready)
-		return false;
+	const size_t row_size=image.row_size();
+	for(int y=0; y<image.h; ++y)
+		png_write_row(png_ptr,&image.pixels[y*row_size]);
 
-	PixelFormat pf = get_alpha_mode()==TARGET_ALPHA_MODE_KEEP ? PF_RGB|PF_A : PF_RGB;
-	color_to_pixelformat(buffer, color_buffer, pf, 0, desc.get_w());
+	png_write_end(png_ptr,info_ptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
 
-	setjmp(png_jmpbuf(png_ptr));
-	png_write_row(png_ptr,buffer);
-
-	return true;
+	if(file!=stdout)
+		return fclose(file)==0;
+	return fflush(file)==0;
 }
@@ -32,7 +32,9 @@
 #include <png.h>
 #include <synfig/target_scanline.h>
 #include <synfig/targetparam.h>
+#include <synfig/surface.h>
 #include <cstdio>
+#include <vector>
 
 /* === M A C R O S ========================================================= */
 
@@ -43,20 +45,59 @@
 class png_trgt : public synfig::Target_Scanline
 {
 	SYNFIG_TARGET_MODULE_EXT
+public:
+	//! Settings of PNG encoding, see SYNFIG_TARGET_PNG_* environment variables
+	struct EncodeParams
+	{
+		int bit_depth;         //!< 8 or 16
+		int compression_level; //!< zlib level, 0..9 or Z_DEFAULT_COMPRESSION
+		int strategy;          //!< zlib strategy
+		int filters;           //!< set of PNG_FILTER_* flags
+
+		EncodeParams();
+	};
+
+	//! Frame packed to PNG rows and ready for encoding
+	struct Image
+	{
+		FILE *file;
+		synfig::String filename;
+		int w, h;
+		bool alpha;
+		int x_res, y_res;
+		synfig::String title;
+		synfig::String description;
+		EncodeParams params;
+		std::vector<unsigned char> pixels;
+
+		Image(): file(NULL), w(), h(), alpha(), x_res(), y_res() { }
+		size_t row_size() const { return (size_t)w*(alpha ? 4 : 3)*(params.bit_depth/8); }
+	};
+
+	class Encoder;
+
 private:
 	FILE *file;
-	//int w,h;
-	png_structp png_ptr;
-	png_infop info_ptr;
-
-	static void png_out_error(png_struct *png,const char *msg);
-	static void png_out_warning(png_struct *png,const char *msg);
-	bool multi_image,ready;
+	bool multi_image;
 	int imagecount;
 	synfig::String filename;
-	unsigned char *buffer;
-	synfig::Color *color_buffer;
+	synfig::String frame_filename;
 	synfig::String sequence_separator;
+
+	EncodeParams encode_params;
+	//! whole frame, rows are rendered directly into it
+	synfig::Surface frame;
+	Image image;
+	//! encodes frames of sequence in separate threads, NULL when disabled
+	Encoder *encoder;
+	int encode_threads;
+	bool encode_failed;
+
+	static void png_out_error(png_struct *png,const char *msg);
+	static void png_out_warning(png_struct *png,const char *msg);
+
+	void pack_image();
+
 public:
 	png_trgt(const char *filename, const synfig::TargetParam& /* params */);
 	virtual ~png_trgt();
@@ -67,6 +108,10 @@ public:
 
 	virtual synfig::Color * start_scanline(int scanline);
 	virtual bool end_scanline();
+	virtual synfig::Color * start_scanlines(int scanline, int count, int &pitch);
+
+	//! Writes image to its file and closes the file, may be called from any thread
+	static bool write_image(Image &image);
 };
 
 /* === E N D =============================================================== */
@@ -98,6 +98,7 @@ png_trgt_spritesheet::png_trgt_spritesheet(const char *Filename, const synfig::T
 	lastimage(),
 	numimages(),
 	cur_y(0),
+	cur_strip_height(0),
 	cur_row(0),
 	cur_col(0),
 	params(params),
@@ -121,8 +122,7 @@ png_trgt_spritesheet::~png_trgt_spritesheet()
 		write_png_file ();
 	if (color_data)
 	{
-		for (unsigned int i = 0; i < sheet_height; i++)
-			delete []color_data[i];
+		delete []color_data[0];
 		delete []color_data;
 	}
 	if (overflow_buff)
@@ -192,10 +192,12 @@ png_trgt_spritesheet::set_rend_desc(RendDesc *given_desc)
 
 	cout << "Color size: " << sizeof(Color) << endl;
 	
+	// rows are allocated as single block to allow rendering of
+	// several rows at once, see start_scanlines()
 	color_data = new Color*[sheet_height];
-	if (color_data)
-		for (unsigned int i = 0; i < sheet_height; i++)
-			color_data[i] = new Color[sheet_width];
+	color_data[0] = new Color[sheet_width*sheet_height];
+	for (unsigned int i = 1; i < sheet_height; i++)
+		color_data[i] = color_data[0] + i*sheet_width;
 	
 	if (is_loaded)
 		ready = read_png_file();
@@ -271,6 +273,27 @@ png_trgt_spritesheet::end_scanline()
     return true;
 }
 
+Color *
+png_trgt_spritesheet::start_scanlines(int scanline, int count, int &pitch)
+{
+	unsigned int y = scanline + params.offset_y + cur_row * desc.get_h();
+	unsigned int x = cur_col * desc.get_w() + params.offset_x;
+	if ((x + desc.get_w() > sheet_width) || (y + count > sheet_height) || !color_data)
+		return NULL; // start_scanline() will handle the overflow
+	cur_y = scanline;
+	cur_strip_height = count;
+	pitch = sheet_width*sizeof(Color);
+	return &color_data[y][x];
+}
+
+bool
+png_trgt_spritesheet::end_scanlines()
+{
+	cur_y += cur_strip_height;
+	cur_strip_height = 0;
+	return true;
+}
+
 //The func only loads file. Reading into the buffer in read_png_file().
 bool
 png_trgt_spritesheet::load_png_file()
@@ -72,6 +72,7 @@ private:
 	int lastimage;
 	int numimages;
 	unsigned int cur_y;
+	unsigned int cur_strip_height;
 	unsigned int cur_row;
 	unsigned int cur_col;
 	synfig::TargetParam params;
@@ -99,6 +100,8 @@ public:
 
 	virtual synfig::Color * start_scanline(int scanline);
 	virtual bool end_scanline();
+	virtual synfig::Color * start_scanlines(int scanline, int count, int &pitch);
+	virtual bool end_scanlines();
 	bool read_png_file();
 	bool write_png_file();
 	bool load_png_file();
@@ -117,6 +117,19 @@ yuv::end_scanline()
 	return static_cast<bool>(file);
 }
 
+Color *
+yuv::start_scanlines(int x, int /*count*/, int &pitch)
+{
+	pitch = surface.get_pitch();
+	return surface[x];
+}
+
+bool
+yuv::end_scanlines()
+{
+	return static_cast<bool>(file);
+}
+
 void
 yuv::end_frame()
 {
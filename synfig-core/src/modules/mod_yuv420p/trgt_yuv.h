@@ -64,6 +64,8 @@ public:
 
 	virtual synfig::Color* start_scanline(int scanline);
 	virtual bool end_scanline();
+	virtual synfig::Color* start_scanlines(int scanline, int count, int &pitch);
+	virtual bool end_scanlines();
 };
 
 /* === E N D =============================================================== */
@@ -1300,6 +1300,15 @@ Canvas::get_times_vfunc(Node::time_set &set) const
 	}
 }
 
+bool
+Canvas::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	for(const_iterator i = begin(); i != end(); ++i)
+		if ((*i)->active() && (*i)->get_time_dependency(a, b))
+			return true;
+	return false;
+}
+
 std::set<etl::handle<Layer> >
 Canvas::get_layers_in_group(const String&group)
 {
@@ -717,6 +717,9 @@ protected:
 	//! stores it in the passed Time Set \set
 	//! \see Node::get_times()
 	virtual void get_times_vfunc(Node::time_set &set) const;
+	//! Canvas changes in time when any of its active Layers changes
+	//! \see Node::get_time_dependency()
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
 
 public:
 	void fill_sound_processor(SoundProcessor &soundProcessor) const;
@@ -0,0 +1,384 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file canvascache.cpp
+**	\brief CanvasCache
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include <glib/gstdio.h>
+
+#include <ETL/stringf>
+
+#include "canvascache.h"
+
+#include "filesystemnative.h"
+#include "general.h"
+#include "guid.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+#define CACHE_MAGIC "SYNFIGCC"
+#define CACHE_VERSION 3
+
+/* === G L O B A L S ======================================================= */
+
+const unsigned long long CanvasCache::min_source_size = 64*1024;
+
+namespace {
+
+std::mutex directory_mutex;
+
+String&
+directory()
+{
+	static String directory = getenv("SYNFIG_CANVAS_CACHE_DIR") ? getenv("SYNFIG_CANVAS_CACHE_DIR") : "";
+	return directory;
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+void
+write_varint(std::string &data, unsigned long long x)
+{
+	while(x >= 0x80) {
+		data += (char)((x & 0x7f) | 0x80);
+		x >>= 7;
+	}
+	data += (char)x;
+}
+
+void
+write_string(std::string &data, const String &x)
+{
+	write_varint(data, x.size());
+	data += x;
+}
+
+//! Bounds-checked reader of cache data, sets \a ok to false
+//! when data ends unexpectedly
+class Reader {
+public:
+	const char *pos;
+	const char *end;
+	bool ok;
+
+	Reader(const std::string &data): pos(data.data()), end(data.data() + data.size()), ok(true) { }
+
+	char read_char()
+	{
+		if (pos >= end) { ok = false; return 0; }
+		return *pos++;
+	}
+
+	unsigned long long read_varint()
+	{
+		unsigned long long x = 0;
+		for(int shift = 0; shift < 64; shift += 7) {
+			unsigned char c = (unsigned char)read_char();
+			x |= (unsigned long long)(c & 0x7f) << shift;
+			if (!(c & 0x80)) return x;
+		}
+		ok = false;
+		return 0;
+	}
+
+	void read_string(String &x)
+	{
+		unsigned long long size = read_varint();
+		if (!ok || size > (unsigned long long)(end - pos))
+			{ ok = false; x.clear(); return; }
+		x.assign(pos, (size_t)size);
+		pos += size;
+	}
+
+	//! names are stored once, then referenced by index
+	void read_name(std::vector<String> &names, String &x)
+	{
+		unsigned long long index = read_varint();
+		if (!ok) return;
+		if (index == 0) {
+			read_string(x);
+			names.push_back(x);
+		} else
+		if (index <= names.size()) {
+			x = names[index - 1];
+		} else {
+			ok = false;
+		}
+	}
+};
+
+String
+encode_header(const CanvasCache::Source &source)
+{
+	std::string data = CACHE_MAGIC;
+	write_varint(data, CACHE_VERSION);
+	write_varint(data, source.size);
+	write_varint(data, (unsigned long long)source.mtime);
+	write_string(data, source.path);
+	return data;
+}
+
+bool
+read_file(const String &filename, std::string &out_data)
+{
+	FILE *f = g_fopen(filename.c_str(), "rb");
+	if (!f) return false;
+	char buffer[65536];
+	while(size_t size = fread(buffer, 1, sizeof(buffer), f))
+		out_data.append(buffer, size);
+	bool success = !ferror(f);
+	fclose(f);
+	return success;
+}
+
+//! Walks through events without calling handler,
+//! so broken cache file doesn't leave half-loaded canvas
+bool
+check_events(Reader reader)
+{
+	std::vector<String> names;
+	String s;
+	int depth = 0;
+	while(reader.ok) {
+		switch(reader.read_char()) {
+		case 'S':
+			reader.read_name(names, s);
+			reader.read_varint();
+			for(unsigned long long count = reader.read_varint(); reader.ok && count; --count)
+				{ reader.read_name(names, s); reader.read_string(s); }
+			++depth;
+			break;
+		case 'E':
+			if (--depth < 0) return false;
+			break;
+		case 'T':
+			reader.read_string(s);
+			break;
+		case 'Z':
+			return reader.ok && depth == 0 && reader.pos == reader.end;
+		default:
+			return false;
+		}
+	}
+	return false;
+}
+
+void
+replay_events(Reader reader, CanvasCache::Handler &handler)
+{
+	std::vector<String> names;
+	CanvasCache::AttributeList attributes;
+	String name, text;
+	while(true) {
+		switch(reader.read_char()) {
+		case 'S': {
+			reader.read_name(names, name);
+			int line = (int)reader.read_varint();
+			attributes.resize((size_t)reader.read_varint());
+			for(CanvasCache::AttributeList::iterator i = attributes.begin(); i != attributes.end(); ++i)
+				{ reader.read_name(names, i->name); reader.read_string(i->value); }
+			handler.start_element(name, attributes, line);
+			break;
+		}
+		case 'E':
+			handler.end_element();
+			break;
+		case 'T':
+			reader.read_string(text);
+			handler.characters(text);
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+}
+
+/* === M E T H O D S ======================================================= */
+
+void
+CanvasCache::Writer::write_name(const String &name)
+{
+	std::map<String, int>::iterator i = names.find(name);
+	if (i != names.end()) {
+		write_varint(data, i->second);
+	} else {
+		write_varint(data, 0);
+		write_string(data, name);
+		names[name] = (int)names.size() + 1;
+	}
+}
+
+void
+CanvasCache::Writer::start_element(const String &name, int line, int attributes_count)
+{
+	data += 'S';
+	write_name(name);
+	write_varint(data, line > 0 ? line : 0);
+	write_varint(data, attributes_count);
+}
+
+void
+CanvasCache::Writer::attribute(const String &name, const String &value)
+{
+	write_name(name);
+	write_string(data, value);
+}
+
+void
+CanvasCache::Writer::end_element()
+	{ data += 'E'; }
+
+void
+CanvasCache::Writer::characters(const String &text)
+{
+	data += 'T';
+	write_string(data, text);
+}
+
+bool
+CanvasCache::Writer::save(const Source &source) const
+{
+	String dir = get_directory();
+	if (dir.empty() || !FileSystemNative::instance()->directory_create_recursive(dir))
+		return false;
+
+	// write into temporary file, so other processes never see half-written cache
+	String filename = get_cache_filename(source.path);
+	String tmp_filename = filename + "." + GUID().get_string() + ".tmp";
+	FILE *f = g_fopen(tmp_filename.c_str(), "wb");
+	if (!f) {
+		warning("CanvasCache: cannot write '%s'", tmp_filename.c_str());
+		return false;
+	}
+
+	std::string header = encode_header(source);
+	bool success = fwrite(header.data(), 1, header.size(), f) == header.size()
+	            && fwrite(data.data(), 1, data.size(), f) == data.size()
+	            && fputc('Z', f) != EOF;
+	success = fclose(f) == 0 && success;
+
+	if (success && FileSystemNative::instance()->file_rename(tmp_filename, filename))
+		return true;
+	g_remove(tmp_filename.c_str());
+	return false;
+}
+
+String
+CanvasCache::get_cache_filename(const String &path)
+{
+	// 64-bit FNV-1a
+	unsigned long long hash = 14695981039346656037ull;
+	for(String::const_iterator i = path.begin(); i != path.end(); ++i)
+		hash = (hash ^ (unsigned char)*i) * 1099511628211ull;
+	return get_directory() + ETL_DIRECTORY_SEPARATOR + strprintf("%016llx.sifcache", hash);
+}
+
+String
+CanvasCache::get_directory()
+{
+	std::lock_guard<std::mutex> lock(directory_mutex);
+	return directory();
+}
+
+void
+CanvasCache::set_directory(const String &dir)
+{
+	std::lock_guard<std::mutex> lock(directory_mutex);
+	directory() = dir;
+}
+
+bool
+CanvasCache::get_source(const FileSystem::Identifier &identifier, const String &path, Source &out_source)
+{
+	if (!is_enabled() || !identifier.file_system)
+		return false;
+
+	// files inside of containers have no own modification time,
+	// and checksum of the whole file costs almost as much as parsing
+	String filename;
+	try {
+		filename = identifier.file_system->get_real_filename(identifier.filename);
+	} catch(...) {
+		return false;
+	}
+	GStatBuf buffer;
+	if (filename.empty() || g_stat(filename.c_str(), &buffer) != 0)
+		return false;
+
+	out_source = Source();
+	out_source.path = path;
+	out_source.size = (unsigned long long)buffer.st_size;
+	// file may be saved several times per second,
+	// so seconds of st_mtime are not enough to detect changes
+#if defined(_WIN32)
+	out_source.mtime = (long long)buffer.st_mtime*1000000000ll;
+#elif defined(__APPLE__)
+	out_source.mtime = (long long)buffer.st_mtimespec.tv_sec*1000000000ll + buffer.st_mtimespec.tv_nsec;
+#else
+	out_source.mtime = (long long)buffer.st_mtim.tv_sec*1000000000ll + buffer.st_mtim.tv_nsec;
+#endif
+	return out_source.size >= min_source_size;
+}
+
+bool
+CanvasCache::load(const Source &source, Handler &handler)
+{
+	std::string data;
+	if (!read_file(get_cache_filename(source.path), data))
+		return false;
+
+	std::string header = encode_header(source);
+	if (data.compare(0, header.size(), header) != 0)
+		return false;
+
+	Reader reader(data);
+	reader.pos += header.size();
+	if (!check_events(reader)) {
+		warning("CanvasCache: cache file for '%s' is broken", source.path.c_str());
+		return false;
+	}
+
+	replay_events(reader, handler);
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
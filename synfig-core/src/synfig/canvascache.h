@@ -0,0 +1,123 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file canvascache.h
+**	\brief CanvasCache Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_CANVASCACHE_H
+#define __SYNFIG_CANVASCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "string.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+
+/*!	\class CanvasCache
+**	\brief Binary cache of XML events of canvas files.
+**
+**	Cache file stores the sequence of XML events (elements with attributes,
+**	closing tags and text) of the source file in compact binary form.
+**	It is not a serialization of the Canvas object graph: replaying it skips
+**	only decompression and XML tokenizing, canvas objects are still built by
+**	CanvasParser, so cached and parsed files always give the same result,
+**	but building of the canvas is not faster.
+**
+**	Cache is disabled by default, set SYNFIG_CANVAS_CACHE_DIR to enable it.
+**	Only files of native file system are cached, cache file is used
+**	while size and modification time (in nanoseconds, where file system
+**	supports it) of the source file match.
+*/
+class CanvasCache
+{
+public:
+	struct Attribute {
+		String name;
+		String value;
+	};
+	typedef std::vector<Attribute> AttributeList;
+
+	//! Receives events from cache file
+	class Handler {
+	public:
+		virtual ~Handler() { }
+		virtual void start_element(const String &name, const AttributeList &attributes, int line) = 0;
+		virtual void end_element() = 0;
+		virtual void characters(const String &text) = 0;
+	};
+
+	//! Size and modification time of the source file
+	struct Source {
+		String path;
+		unsigned long long size;
+		long long mtime; //!< modification time in nanoseconds
+		Source(): size(), mtime() { }
+	};
+
+	//! Collects events while file is parsed
+	class Writer {
+	private:
+		std::string data;
+		std::map<String, int> names;
+		void write_name(const String &name);
+	public:
+		void start_element(const String &name, int line, int attributes_count);
+		void attribute(const String &name, const String &value);
+		void end_element();
+		void characters(const String &text);
+		bool save(const Source &source) const;
+	};
+
+	//! Files smaller than this are parsed faster than cache is checked
+	static const unsigned long long min_source_size;
+
+	static String get_directory();
+	static void set_directory(const String &directory);
+	static bool is_enabled()
+		{ return !get_directory().empty(); }
+
+	//! Returns name of cache file for the source path, inside of the cache directory
+	static String get_cache_filename(const String &path);
+
+	//! Returns false if cache is disabled, file is too small
+	//! or it is not a file of native file system
+	static bool get_source(const FileSystem::Identifier &identifier, const String &path, Source &out_source);
+
+	//! Returns false and does not call handler when cache file is missing, outdated or broken
+	static bool load(const Source &source, Handler &handler);
+};
+
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
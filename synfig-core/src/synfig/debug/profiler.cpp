@@ -0,0 +1,215 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file profiler.cpp
+**	\brief Per-task render profiler
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+
+#include <ETL/stringf>
+
+#include <synfig/general.h>
+
+#include "profiler.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace debug;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! bytes allocated by current thread since its start
+static thread_local long long allocated_bytes = 0;
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+String
+escape_json(const String &x)
+{
+	String s;
+	s.reserve(x.size());
+	for(String::const_iterator i = x.begin(); i != x.end(); ++i) {
+		unsigned char c = *i;
+		if (c == '"' || c == '\\')
+			{ s += '\\'; s += c; }
+		else
+		if (c < 0x20)
+			s += strprintf("\\u%04x", c);
+		else
+			s += c;
+	}
+	return s;
+}
+
+bool
+greater_time(const Profiler::LayerTotal &a, const Profiler::LayerTotal &b)
+	{ return a.time > b.time; }
+
+}
+
+/* === M E T H O D S ======================================================= */
+
+std::atomic<bool> Profiler::enabled(false);
+std::mutex Profiler::mutex;
+std::vector<Profiler::Event> Profiler::events;
+long long Profiler::origin = 0;
+
+Profiler::Scope::Scope(const String &name, const String &layer, const RectInt &rect, int thread):
+	name(name),
+	layer(layer),
+	rect(rect),
+	thread(thread),
+	active(is_enabled()),
+	begin(active ? now() : 0),
+	bytes(allocated_bytes)
+{ }
+
+Profiler::Scope::~Scope()
+{
+	if (!active) return;
+	Event event;
+	event.name = name;
+	event.layer = layer;
+	event.rect = rect;
+	event.thread = thread;
+	event.begin = begin;
+	event.end = now();
+	event.bytes = allocated_bytes - bytes;
+	add(event);
+}
+
+long long
+Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch() ).count() - origin;
+}
+
+void
+Profiler::set_enabled(bool x)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (x && !enabled && events.empty())
+		origin += now();
+	enabled = x;
+}
+
+void
+Profiler::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	events.clear();
+	origin += now();
+}
+
+void
+Profiler::add(const Event &event)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	events.push_back(event);
+}
+
+std::vector<Profiler::Event>
+Profiler::get_events()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return events;
+}
+
+void
+Profiler::add_allocated(long long bytes)
+	{ if (is_enabled()) allocated_bytes += bytes; }
+
+std::vector<Profiler::LayerTotal>
+Profiler::get_layer_totals()
+{
+	std::map<String, LayerTotal> map;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(std::vector<Event>::const_iterator i = events.begin(); i != events.end(); ++i) {
+			LayerTotal &total = map[i->layer];
+			++total.tasks;
+			total.time += i->end - i->begin;
+			total.bytes += i->bytes;
+		}
+	}
+
+	std::vector<LayerTotal> totals;
+	totals.reserve(map.size());
+	for(std::map<String, LayerTotal>::iterator i = map.begin(); i != map.end(); ++i) {
+		i->second.layer = i->first;
+		totals.push_back(i->second);
+	}
+	std::sort(totals.begin(), totals.end(), greater_time);
+	return totals;
+}
+
+bool
+Profiler::write_trace(const String &filename)
+{
+	std::ofstream f(filename.c_str());
+	if (!f) {
+		error("Profiler: cannot open '%s' for writing", filename.c_str());
+		return false;
+	}
+
+	std::vector<Event> events = get_events();
+	f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for(std::vector<Event>::const_iterator i = events.begin(); i != events.end(); ++i) {
+		if (i != events.begin()) f << ",";
+		f << "\n{\"ph\":\"X\",\"pid\":1"
+		  << ",\"tid\":" << i->thread
+		  << ",\"ts\":" << i->begin
+		  << ",\"dur\":" << (i->end - i->begin)
+		  << ",\"name\":\"" << escape_json(i->name) << "\""
+		  << ",\"cat\":\"task\""
+		  << ",\"args\":{"
+		  << "\"layer\":\"" << escape_json(i->layer) << "\""
+		  << ",\"rect\":[" << i->rect.minx << "," << i->rect.miny << "," << i->rect.maxx << "," << i->rect.maxy << "]"
+		  << ",\"bytes\":" << i->bytes
+		  << "}}";
+	}
+	f << "\n]}\n";
+
+	if (!f) {
+		error("Profiler: cannot write '%s'", filename.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,120 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file profiler.h
+**	\brief Per-task render profiler
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_DEBUG_PROFILER_H
+#define __SYNFIG_DEBUG_PROFILER_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <synfig/rect.h>
+#include <synfig/string.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+namespace debug {
+
+//! Collects timings of rendering tasks.
+//! Disabled by default, when disabled every call costs one atomic load.
+//! Results can be written as Chrome trace (chrome://tracing, Perfetto)
+//! or aggregated by the layers which have produced the tasks.
+class Profiler {
+public:
+	struct Event {
+		String name;        //!< task type
+		String layer;       //!< description of source layer, empty when unknown
+		RectInt rect;       //!< target rect of task
+		int thread;
+		long long begin;    //!< microseconds from enabling of profiler
+		long long end;
+		long long bytes;    //!< memory allocated for surfaces while task was running
+		Event(): thread(), begin(), end(), bytes() { }
+	};
+
+	struct LayerTotal {
+		String layer;
+		int tasks;
+		long long time;     //!< microseconds, sum of all threads
+		long long bytes;
+		LayerTotal(): tasks(), time(), bytes() { }
+	};
+
+	//! Measures one task, event is added in destructor.
+	//! Does nothing when profiler is disabled at construction time.
+	//! Strings are referenced, not copied, they should live longer than scope.
+	class Scope {
+	private:
+		const String &name;
+		const String &layer;
+		const RectInt rect;
+		const int thread;
+		const bool active;
+		long long begin;
+		long long bytes;
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+	public:
+		Scope(const String &name, const String &layer, const RectInt &rect, int thread);
+		~Scope();
+	};
+
+private:
+	static std::atomic<bool> enabled;
+	static std::mutex mutex;
+	static std::vector<Event> events;
+	static long long origin;
+
+	static long long now();
+
+public:
+	static void set_enabled(bool x);
+	static bool is_enabled()
+		{ return enabled.load(std::memory_order_relaxed); }
+
+	static void clear();
+	static void add(const Event &event);
+	static std::vector<Event> get_events();
+
+	//! Call it from surfaces when they are (re)allocated
+	static void add_allocated(long long bytes);
+
+	//! Returns totals ordered by time, tasks without layer are grouped with empty name
+	static std::vector<LayerTotal> get_layer_totals();
+	static bool write_trace(const String &filename);
+};
+
+}; // END of namespace debug
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
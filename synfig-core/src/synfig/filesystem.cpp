@@ -30,7 +30,9 @@
 #endif
 
 #include <glibmm.h>
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 
 #include <ETL/stringf>
 
@@ -82,6 +84,25 @@ int FileSystem::ReadStream::underflow()
 	return std::streambuf::traits_type::to_int_type(*gptr());
 }
 
+std::streamsize FileSystem::ReadStream::xsgetn(char *s, std::streamsize n)
+{
+	if (n <= 0) return 0;
+
+	// consume characters which are already in buffer, including put back ones
+	std::streamsize count = std::min(n, (std::streamsize)(egptr() - gptr()));
+	if (count > 0)
+		{ memcpy(s, gptr(), (size_t)count); gbump((int)count); }
+	if (count < n)
+		count += internal_read(s + count, (size_t)(n - count));
+
+	// keep the last character, so it can be put back again
+	if (count > 0) {
+		buffer_ = s[count - 1];
+		setg(&buffer_, &buffer_ + 1, &buffer_ + 1);
+	}
+	return count;
+}
+
 // WriteStream
 
 FileSystem::WriteStream::WriteStream(FileSystem::Handle file_system):
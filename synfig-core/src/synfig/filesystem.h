@@ -77,6 +77,8 @@ namespace synfig
 
 			ReadStream(FileSystem::Handle file_system);
 			virtual int underflow();
+			//! reads blocks directly, without passing each byte through underflow()
+			virtual std::streamsize xsgetn(char *s, std::streamsize n);
 			virtual size_t internal_read(void *buffer, size_t size) = 0;
 
 		public:
@@ -292,6 +292,7 @@ CompiledGradient::set(const Color &color)
 	list.clear();
 	list.push_back(Entry());
 	list.front().prev_color = list.front().next_color = summary_color;
+	build_index();
 }
 
 void
@@ -345,5 +346,20 @@ CompiledGradient::set(const Gradient &gradient, bool repeat, bool zigzag) {
 	//		i->next_sum.r, i->next_sum.g, i->next_sum.b, i->next_sum.a );
 	//}
 	
+	build_index();
 	summary_color = find(1.0)->summary(1.0);
 }
+
+const int CompiledGradient::index_size;
+
+void
+CompiledGradient::build_index()
+{
+	index.resize(index_size + 1);
+	List::const_iterator it = list.begin(), last = list.end() - 1;
+	for(int i = 0; i <= index_size; ++i) {
+		Real x = (Real)i/index_size;
+		while(it != last && *it < x) ++it;
+		index[i] = (int)(it - list.begin());
+	}
+}
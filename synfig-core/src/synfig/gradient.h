@@ -239,9 +239,14 @@ private:
 	bool is_empty;
 	bool repeat;
 	List list;
+	//! index[i] is the entry of position i/index_size,
+	//! replaces search over the whole list in find()
+	std::vector<int> index;
 
 	Accumulator summary_color;
 
+	void build_index();
+
 public:
 	CompiledGradient();
 	explicit CompiledGradient(const Color &color);
@@ -255,8 +260,20 @@ public:
 	bool get_repeat() const { return repeat; }
 	const List& get_list() const { return list; }
 
-	inline List::const_iterator find(Real x) const
-		{ return std::lower_bound(list.begin(), list.end()-1, x); }
+	//! Cells of lookup table in find()
+	static const int index_size = 128;
+
+	//! Same as std::lower_bound(list.begin(), list.end()-1, x),
+	//! starts from lookup table and usually moves no more than by one entry
+	inline List::const_iterator find(Real x) const {
+		Real cell = x*index_size;
+		int i = cell >= 0.0 ? (cell < (Real)index_size ? (int)cell : index_size) : 0;
+		List::const_iterator begin = list.begin(), last = list.end() - 1;
+		List::const_iterator it = begin + index[i];
+		while(it != begin && !(*(it - 1) < x)) --it;
+		while(it != last && *it < x) ++it;
+		return it;
+	}
 
 	inline Color color(Real x) const {
 		if (repeat) x -= floor(x);
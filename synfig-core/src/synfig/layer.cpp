@@ -47,6 +47,8 @@
 #include "paramdesc.h"
 #include "transform.h"
 
+#include "debug/profiler.h"
+
 #include "layers/layer_composite.h"
 #include "layers/layer_bitmap.h"
 #include "layers/layer_duplicate.h"
@@ -533,6 +535,12 @@ Layer::reads_context() const
 	return false;
 }
 
+bool
+Layer::is_render_thread_safe() const
+{
+	return false;
+}
+
 Rect
 Layer::get_full_bounding_rect(Context context)const
 {
@@ -907,7 +915,10 @@ Layer::build_rendering_task_vfunc(Context context)const
 rendering::Task::Handle
 Layer::build_rendering_task(Context context)const
 {
-	return build_rendering_task_vfunc(context);
+	rendering::Task::Handle task = build_rendering_task_vfunc(context);
+	if (task && debug::Profiler::is_enabled())
+		task->set_source_layer(get_name() + " '" + get_non_empty_description() + "'");
+	return task;
 }
 
 String
@@ -950,6 +961,15 @@ Layer::get_times_vfunc(Node::time_set &set) const
 	}
 }
 
+bool
+Layer::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	for(DynamicParamList::const_iterator i = dynamic_param_list_.begin(); i != dynamic_param_list_.end(); ++i)
+		if (i->second->get_time_dependency(a, b))
+			return true;
+	return false;
+}
+
 
 void
 Layer::add_to_group(const String&x)
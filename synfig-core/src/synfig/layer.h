@@ -640,6 +640,13 @@ public:
 	**  context until the final blend operation. */
 	virtual bool reads_context()const;
 
+	//! Returns true if accelerated_render() may be called from several threads at once.
+	/*! Such layer is rendered by independent horizontal bands in parallel
+	**  (see OptimizerSplit). Layer must not change its own state while rendering
+	**  and every pixel must depend only on its position, not on the size of
+	**  the surface. */
+	virtual bool is_render_thread_safe()const;
+
 	//! Duplicates the Layer without duplicating the value nodes
 	virtual Handle simple_clone()const;
 
@@ -661,6 +668,10 @@ protected:
 	//! Called to figure out the animation time information
 	virtual void get_times_vfunc(Node::time_set &set) const;
 
+	//! Layer changes in time when any of its animated parameters changes.
+	//! Layers which use time directly should override this.
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
+
 	/*
  --	** -- S T A T I C  F U N C T I O N S --------------------------------------
 	*/
@@ -59,6 +59,8 @@ public:
 
 protected:
 	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
+	//! Layers below are evaluated at current time for each copy, be conservative
+	virtual bool get_time_dependency_vfunc(const Time &/*a*/, const Time &/*b*/)const { return true; }
 }; // END of class Layer_Duplicate
 
 }; // END of namespace synfig
@@ -65,6 +65,8 @@ public:
 
 protected:
 	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
+	//! Layers below are shown at previous times, so result always depends on time
+	virtual bool get_time_dependency_vfunc(const Time &/*a*/, const Time &/*b*/)const { return true; }
 }; // END of class Layer_MotionBlur
 
 }; // END of namespace synfig
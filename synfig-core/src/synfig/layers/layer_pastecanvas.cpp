@@ -457,6 +457,24 @@ Layer_PasteCanvas::get_times_vfunc(Node::time_set &set) const
 	Layer::get_times_vfunc(set);
 }
 
+bool
+Layer_PasteCanvas::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	if (Layer::get_time_dependency_vfunc(a, b))
+		return true;
+	if (!sub_canvas)
+		return false;
+	if (depth == MAX_DEPTH)
+		return true;
+	depth_counter counter(depth);
+
+	Real time_dilation = param_time_dilation.get(Real());
+	Time time_offset = param_time_offset.get(Time());
+	return sub_canvas->get_time_dependency(
+		a*time_dilation + time_offset,
+		b*time_dilation + time_offset );
+}
+
 void
 Layer_PasteCanvas::fill_sound_processor(SoundProcessor &soundProcessor) const
 {
@@ -200,6 +200,9 @@ protected:
 	//! are the canvas parameter children layers Time points and the Paste Canvas
 	//! Layer time points. \todo clarify all this comments.
 	virtual void get_times_vfunc(Node::time_set &set) const;
+	//! Checks own parameters and the children layers at the times
+	//! corresponding to \a a and \a b in the canvas parameter
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
 
 	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context)const;
 }; // END of class Layer_PasteCanvas
@@ -36,6 +36,7 @@
 #include <synfig/context.h>
 #include <synfig/paramdesc.h>
 #include <synfig/string.h>
+#include <synfig/threadpool.h>
 #include <synfig/time.h>
 #include <synfig/value.h>
 
@@ -220,13 +221,176 @@ Real Layer_SkeletonDeformation::distance_to_line(const Vector &p0, const Vector
 	return std::min(distance_to_line, std::min(distance_to_p0, distance_to_p1) );
 }
 
+//! Accumulates influence of bones to grid points, grid rows may be processed in parallel.
+//! Everything that does not depend on the grid point is calculated once per bone,
+//! so results are exactly the same as with Bone::distance_to_shape_center_percent()
+//! and distance_to_line() for every pair of grid point and bone.
+struct Layer_SkeletonDeformation::Skinning {
+	struct Influence {
+		Matrix matrix;
+		Real depth;
+
+		// expanded shape of the bone in rest position
+		Vector p0, p1;
+		Real r0, r1;
+
+		// see distance_to_line()
+		Vector line, line_perp;
+		Real line_length;
+
+		// see Bone::distance_to_shape_center_percent()
+		bool has_line;
+		Vector direction, direction_perp, pp0;
+		Real ll, rr0, rr1;
+
+		// grid points which may be affected by the bone
+		int row_begin, row_end, col_begin, col_end;
+	};
+
+	std::vector<GridPoint> &grid;
+	int grid_side_count_x;
+	std::vector<Influence> influences;
+
+	Skinning(std::vector<GridPoint> &grid, int grid_side_count_x):
+		grid(grid), grid_side_count_x(grid_side_count_x) { }
+
+	static void index_range(Real min, Real max, Real origin, Real step, int count, int &begin, int &end)
+	{
+		begin = 0;
+		end = count;
+		Real a = (min - origin)/step;
+		Real b = (max - origin)/step;
+		if (a > b) std::swap(a, b);
+		// keep whole range for degenerate grid or bone, extra rows and columns cover rounding errors
+		if (std::isnan(a) || std::isnan(b)) return;
+		begin = (int)std::max(0.0, std::min((Real)count, std::floor(a) - 1.0));
+		end   = (int)std::max(0.0, std::min((Real)count, std::ceil(b) + 2.0));
+	}
+
+	void add_bone(
+		const Bone::Shape &shape0, const Bone::Shape &shape1, Real depth, Real expand,
+		const Point &grid_p0, Real grid_step_x, Real grid_step_y, int grid_side_count_y )
+	{
+		static const Real epsilon = 1e-10;
+		static const Real precision = 0.000000001;
+
+		Influence b;
+
+		Matrix into_bone(
+			shape0.p1[0] - shape0.p0[0], shape0.p1[1] - shape0.p0[1], 0.0,
+			shape0.p0[1] - shape0.p1[1], shape0.p1[0] - shape0.p0[0], 0.0,
+			shape0.p0[0], shape0.p0[1], 1.0
+		);
+		into_bone.invert();
+		Matrix from_bone(
+			shape1.p1[0] - shape1.p0[0], shape1.p1[1] - shape1.p0[1], 0.0,
+			shape1.p0[1] - shape1.p1[1], shape1.p1[0] - shape1.p0[0], 0.0,
+			shape1.p0[0], shape1.p0[1], 1.0
+		);
+		b.matrix = from_bone * into_bone;
+		b.depth = depth;
+
+		b.p0 = shape0.p0;
+		b.p1 = shape0.p1;
+		b.r0 = fabs(shape0.r0 + expand);
+		b.r1 = fabs(shape0.r1 + expand);
+
+		b.line = b.p1 - b.p0;
+		b.line_length = b.line.mag();
+		if (!(b.line_length > epsilon)) b.line_length = 0.0;
+		b.line_perp = b.line.perp();
+
+		Real length = (b.p1 - b.p0).mag();
+		b.has_line = length + precision > fabs(b.r1 - b.r0);
+		b.ll = b.rr0 = b.rr1 = 0.0;
+		if (b.has_line) {
+			Real cos0 = (b.r0 - b.r1)/length;
+			Real cos1 = -cos0;
+			Real sin0 = sqrt(1 + precision - cos0*cos0);
+			Real sin1 = sin0;
+			b.ll = length - b.r0*cos0 - b.r1*cos1;
+			b.direction = (b.p1 - b.p0)/length;
+			b.direction_perp = b.direction.perp();
+			b.pp0 = b.p0 + b.direction * (b.r0*cos0);
+			b.rr0 = b.r0*sin0;
+			b.rr1 = b.r1*sin1;
+		}
+
+		// the shape is inside of bounding box of its end circles
+		index_range(
+			std::min(b.p0[0] - b.r0, b.p1[0] - b.r1),
+			std::max(b.p0[0] + b.r0, b.p1[0] + b.r1),
+			grid_p0[0], grid_step_x, grid_side_count_x, b.col_begin, b.col_end );
+		index_range(
+			std::min(b.p0[1] - b.r0, b.p1[1] - b.r1),
+			std::max(b.p0[1] + b.r0, b.p1[1] + b.r1),
+			grid_p0[1], grid_step_y, grid_side_count_y, b.row_begin, b.row_end );
+
+		if (b.col_begin < b.col_end && b.row_begin < b.row_end)
+			influences.push_back(b);
+	}
+
+	void process(int row_begin, int row_end)
+	{
+		static const Real precision = 1e-10;
+		static const Real shape_precision = 0.000000001;
+
+		for(std::vector<Influence>::const_iterator b = influences.begin(); b != influences.end(); ++b) {
+			const int rows_end = std::min(row_end, b->row_end);
+			for(int j = std::max(row_begin, b->row_begin); j < rows_end; ++j) {
+				GridPoint *point = &grid[j*grid_side_count_x];
+				for(GridPoint *p = point + b->col_begin, *end = point + b->col_end; p < end; ++p) {
+					const Vector &x = p->initial_position;
+					const Real distance_to_p0 = (x - b->p0).mag();
+					const Real distance_to_p1 = (x - b->p1).mag();
+
+					Real percent = 0.0;
+					Real percent_p0 = b->r0 > shape_precision ? 1.0 - distance_to_p0/b->r0 : 0.0;
+					Real percent_p1 = b->r1 > shape_precision ? 1.0 - distance_to_p1/b->r1 : 0.0;
+					if (percent_p0 > percent) percent = percent_p0;
+					if (percent_p1 > percent) percent = percent_p1;
+					if (b->has_line) {
+						Real pos_at_line = (x - b->pp0)*b->direction/b->ll;
+						if (pos_at_line > 0.0 && pos_at_line < 1.0) {
+							Real distance = fabs((x - b->pp0)*b->direction_perp);
+							Real max_distance = b->rr0*(1.0 - pos_at_line) + b->rr1*pos_at_line;
+							if (max_distance > 0.0) {
+								Real percent_line = 1.0 - distance/max_distance;
+								if (percent_line > percent) percent = percent_line;
+							}
+						}
+					}
+					if (!(percent > precision)) continue;
+
+					Real distance = std::min(distance_to_p0, distance_to_p1);
+					if (b->line_length) {
+						Real pos = (x - b->p0) * b->line / b->line_length;
+						if (pos > 0.0 && pos < b->line_length)
+							distance = std::min(fabs((x - b->p0) * b->line_perp / b->line_length), distance);
+					}
+					if (distance < precision) distance = precision;
+
+					Real weight =
+						percent/(distance*distance);
+						// 1.0/distance;
+						// 1.0/(distance*distance);
+						// 1.0/(distance*distance*distance);
+						// exp(-4.0*distance);
+					p->summary_position += b->matrix.get_transformed(x) * weight;
+					p->summary_depth += b->depth * weight;
+					p->summary_weight += weight;
+					p->used = true;
+				}
+			}
+		}
+	}
+};
+
 void
 Layer_SkeletonDeformation::prepare_mesh()
 {
 	static const Real precision = 1e-10;
 
-	rendering::Mesh::Handle mesh(new rendering::Mesh());
-
 	// TODO: build grid with dynamic size
 
 	const Point grid_p0 = param_point1.get(Point());
@@ -238,16 +402,16 @@ Layer_SkeletonDeformation::prepare_mesh()
 	const Real grid_step_y = (grid_p1[1] - grid_p0[1]) / (Real)(grid_side_count_y - 1);
 	const Real grid_step_diagonal = sqrt(grid_step_x*grid_step_x + grid_step_y*grid_step_y);
 
-	// build grid
-	std::vector<GridPoint> grid;
-	grid.reserve(grid_side_count_x * grid_side_count_y);
-	for(int j = 0; j < grid_side_count_y; ++j)
-		for(int i = 0; i < grid_side_count_x; ++i)
-			grid.push_back(GridPoint(Vector(
-				grid_p0[0] + i*grid_step_x,
-				grid_p0[1] + j*grid_step_y )));
-
-	// apply deformation
+	// collect bones, the mesh stays the same while the bones and the grid are not changed
+	std::vector<Real> state;
+	std::vector<Bone::Shape> shapes;
+	std::vector<Real> depths;
+	state.push_back(grid_p0[0]);
+	state.push_back(grid_p0[1]);
+	state.push_back(grid_p1[0]);
+	state.push_back(grid_p1[1]);
+	state.push_back(grid_side_count_x);
+	state.push_back(grid_side_count_y);
 	if (param_bones.can_get(ValueBase::List()))
 	{
 		const ValueBase::List &bones = param_bones.get_list();
@@ -256,47 +420,59 @@ Layer_SkeletonDeformation::prepare_mesh()
 			if (i->can_get(BonePair()))
 			{
 				const BonePair &bone_pair = i->get(BonePair());
-				Bone::Shape shape0 = bone_pair.first.get_shape();
-				Bone::Shape shape1 = bone_pair.second.get_shape();
-				Bone::Shape expandedShape0 = shape0;
-				expandedShape0.r0 += 2.0*grid_step_diagonal;
-				expandedShape0.r1 += 2.0*grid_step_diagonal;
-				Real depth = bone_pair.second.get_depth();
-
-				Matrix into_bone(
-					shape0.p1[0] - shape0.p0[0], shape0.p1[1] - shape0.p0[1], 0.0,
-					shape0.p0[1] - shape0.p1[1], shape0.p1[0] - shape0.p0[0], 0.0,
-					shape0.p0[0], shape0.p0[1], 1.0
-				);
-				into_bone.invert();
-				Matrix from_bone(
-					shape1.p1[0] - shape1.p0[0], shape1.p1[1] - shape1.p0[1], 0.0,
-					shape1.p0[1] - shape1.p1[1], shape1.p1[0] - shape1.p0[0], 0.0,
-					shape1.p0[0], shape1.p0[1], 1.0
-				);
-				Matrix matrix = from_bone * into_bone;
-
-				for(std::vector<GridPoint>::iterator j = grid.begin(); j != grid.end(); ++j)
-				{
-					Real percent = Bone::distance_to_shape_center_percent(expandedShape0, j->initial_position);
-					if (percent > precision) {
-						Real distance = distance_to_line(shape0.p0, shape0.p1, j->initial_position);
-						if (distance < precision) distance = precision;
-						Real weight =
-							percent/(distance*distance);
-							// 1.0/distance;
-							// 1.0/(distance*distance);
-							// 1.0/(distance*distance*distance);
-							// exp(-4.0*distance);
-						j->summary_position += matrix.get_transformed(j->initial_position) * weight;
-						j->summary_depth += depth * weight;
-						j->summary_weight += weight;
-						j->used = true;
-					}
+				shapes.push_back(bone_pair.first.get_shape());
+				shapes.push_back(bone_pair.second.get_shape());
+				depths.push_back(bone_pair.second.get_depth());
+				for(int j = 2; j > 0; --j) {
+					const Bone::Shape &shape = shapes[shapes.size() - j];
+					state.push_back(shape.p0[0]);
+					state.push_back(shape.p0[1]);
+					state.push_back(shape.r0);
+					state.push_back(shape.p1[0]);
+					state.push_back(shape.p1[1]);
+					state.push_back(shape.r1);
 				}
+				state.push_back(depths.back());
 			}
 		}
 	}
+	if (state == mesh_state)
+		return;
+
+	rendering::Mesh::Handle mesh(new rendering::Mesh());
+
+	// build grid
+	std::vector<GridPoint> grid;
+	grid.reserve(grid_side_count_x * grid_side_count_y);
+	for(int j = 0; j < grid_side_count_y; ++j)
+		for(int i = 0; i < grid_side_count_x; ++i)
+			grid.push_back(GridPoint(Vector(
+				grid_p0[0] + i*grid_step_x,
+				grid_p0[1] + j*grid_step_y )));
+
+	// apply deformation
+	Skinning skinning(grid, grid_side_count_x);
+	for(int i = 0; i < (int)depths.size(); ++i)
+		skinning.add_bone(
+			shapes[2*i], shapes[2*i + 1], depths[i], 2.0*grid_step_diagonal,
+			grid_p0, grid_step_x, grid_step_y, grid_side_count_y );
+
+	long long work = 0;
+	for(std::vector<Skinning::Influence>::const_iterator i = skinning.influences.begin(); i != skinning.influences.end(); ++i)
+		work += (long long)(i->row_end - i->row_begin)*(i->col_end - i->col_begin);
+
+	// rows are independent, every grid point sums influences of bones in the same order
+	const int bands = work < 16384 ? 1 : std::min(grid_side_count_y, 32);
+	if (bands > 1) {
+		ThreadPool::Group group;
+		for(int i = 0; i < bands; ++i)
+			group.enqueue( sigc::bind( sigc::mem_fun(skinning, &Skinning::process),
+				i*grid_side_count_y/bands,
+				(i + 1)*grid_side_count_y/bands ));
+		group.run();
+	} else {
+		skinning.process(0, grid_side_count_y);
+	}
 
 	// build vertices
 	mesh->vertices.reserve(grid.size());
@@ -340,6 +516,7 @@ Layer_SkeletonDeformation::prepare_mesh()
 
 	prepare_mask();
 	this->mesh = mesh;
+	mesh_state.swap(state);
 }
 
 bool
@@ -30,6 +30,7 @@
 #include "layer_meshtransform.h"
 #include <synfig/pair.h>
 #include <synfig/bone.h>
+#include <vector>
 
 /* === M A C R O S ========================================================= */
 
@@ -57,7 +58,14 @@ private:
 	//! Parameter: (Integer)
 	synfig::ValueBase param_y_subdivisions;
 
+	//! Bones and grid from which the current mesh was built, see prepare_mesh()
+	std::vector<Real> mesh_state;
+
 	struct GridPoint;
+	struct Skinning;
+
+protected:
+	//! Distance from point x to segment [p0, p1], weights influence of bones
 	static Real distance_to_line(const Vector &p0, const Vector &p1, const Vector &x);
 
 public:
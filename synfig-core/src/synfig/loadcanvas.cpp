@@ -38,12 +38,16 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
 #include <stdexcept>
 
 #include <libxml++/libxml++.h>
+#include <libxml/SAX2.h>
 #include <sigc++/bind.h>
 
 #include "loadcanvas.h"
@@ -3112,6 +3116,25 @@ CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
 Canvas::Handle
 CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename)
 {
+	bool loaded;
+	Canvas::Handle canvas = parse_canvas_begin(element, parent, inline_, identifier, filename, loaded);
+	if (!canvas || loaded)
+		return canvas;
+
+	list<ValueNode::Handle> bone_list;
+	xmlpp::Element::NodeList list = element->get_children();
+	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+		if(xmlpp::Element *child = dynamic_cast<xmlpp::Element*>(*iter))
+			parse_canvas_child(child, canvas, bone_list);
+
+	parse_canvas_end(element, canvas);
+	return canvas;
+}
+
+Canvas::Handle
+CanvasParser::parse_canvas_begin(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename,bool &loaded)
+{
+	loaded=false;
 
 	if(element->get_name()!="canvas")
 	{
@@ -3158,7 +3181,10 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	{
 		GUID guid(element->get_attribute("guid")->get_value());
 		if(guid_cast<Canvas>(guid))
+		{
+			loaded=true;
 			return guid_cast<Canvas>(guid);
+		}
 		else
 			canvas->set_guid(guid);
 	}
@@ -3278,151 +3304,149 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 
 	canvas->rend_desc().set_flags(RendDesc::PX_ASPECT|RendDesc::IM_SPAN);
 
-	list<ValueNode::Handle> bone_list;
-	xmlpp::Element::NodeList list = element->get_children();
-	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+	return canvas;
+}
+
+void
+CanvasParser::parse_canvas_child(xmlpp::Element *child,Canvas::Handle canvas,std::list<ValueNode::Handle> &bone_list)
+{
+	if(child->get_name()=="defs")
 	{
-		xmlpp::Element *child(dynamic_cast<xmlpp::Element*>(*iter));
-		if(child)
+		if(canvas->is_inline())
+			error(child,_("Group canvases cannot have a <defs> section"));
+		parse_canvas_defs(child, canvas);
+	}
+	else
+	if(child->get_name()=="bones")
+	{
+		if(canvas->is_inline())
+			error(child,_("Inline canvas cannot have a <bones> section"));
+		bone_list = parse_canvas_bones(child, canvas);
+	}
+	else
+	if(child->get_name()=="keyframe")
+	{
+		if(canvas->is_inline())
 		{
-			if(child->get_name()=="defs")
-			{
-				if(canvas->is_inline())
-					error(child,_("Group canvases cannot have a <defs> section"));
-				parse_canvas_defs(child, canvas);
-			}
-			else
-			if(child->get_name()=="bones")
-			{
-				if(canvas->is_inline())
-					error(child,_("Inline canvas cannot have a <bones> section"));
-				bone_list = parse_canvas_bones(child, canvas);
-			}
-			else
-			if(child->get_name()=="keyframe")
-			{
-				if(canvas->is_inline())
-				{
-					warning(child,_("Group canvases cannot have keyframes"));
-					continue;
-				}
+			warning(child,_("Group canvases cannot have keyframes"));
+			return;
+		}
 
-				canvas->keyframe_list().add(parse_keyframe(child,canvas));
-				canvas->keyframe_list().sync();
-			}
-			else
-			if(child->get_name()=="meta")
-			{
-				if(canvas->is_inline())
-				{
-					warning(child,_("Group canvases cannot have metadata"));
-					continue;
-				}
+		canvas->keyframe_list().add(parse_keyframe(child,canvas));
+		canvas->keyframe_list().sync();
+	}
+	else
+	if(child->get_name()=="meta")
+	{
+		if(canvas->is_inline())
+		{
+			warning(child,_("Group canvases cannot have metadata"));
+			return;
+		}
 
-				if(!child->get_attribute("name"))
-				{
-					warning(child,_("<meta> must have a name"));
-					continue;
-				}
+		if(!child->get_attribute("name"))
+		{
+			warning(child,_("<meta> must have a name"));
+			return;
+		}
 
-				if(!child->get_attribute("content"))
-				{
-					warning(child,_("<meta> must have content"));
-					continue;
-				}
-				
-				// In Synfig prior to version 1.0 we have messed decimal separator:
-				// some files use ".", but other ones use ","/
-				// Let's try to put a workaround for that.
-				std::vector<String> replacelist;
-				replacelist.push_back("background_first_color");
-				replacelist.push_back("background_second_color");
-				replacelist.push_back("background_size");
-				replacelist.push_back("grid_color");
-				replacelist.push_back("grid_size");
-				replacelist.push_back("jack_offset");
-				String content;
-				content=child->get_attribute("content")->get_value();
-				if(std::find(replacelist.begin(), replacelist.end(), child->get_attribute("name")->get_value()) != replacelist.end()) 
-				{
-					size_t index = 0;
-					while (true) {
-					     /* Locate the substring to replace. */
-					     index = content.find(",", index);
-					     if (index == string::npos) break;
+		if(!child->get_attribute("content"))
+		{
+			warning(child,_("<meta> must have content"));
+			return;
+		}
+		
+		// In Synfig prior to version 1.0 we have messed decimal separator:
+		// some files use ".", but other ones use ","/
+		// Let's try to put a workaround for that.
+		std::vector<String> replacelist;
+		replacelist.push_back("background_first_color");
+		replacelist.push_back("background_second_color");
+		replacelist.push_back("background_size");
+		replacelist.push_back("grid_color");
+		replacelist.push_back("grid_size");
+		replacelist.push_back("jack_offset");
+		String content;
+		content=child->get_attribute("content")->get_value();
+		if(std::find(replacelist.begin(), replacelist.end(), child->get_attribute("name")->get_value()) != replacelist.end()) 
+		{
+			size_t index = 0;
+			while (true) {
+			     /* Locate the substring to replace. */
+			     index = content.find(",", index);
+			     if (index == string::npos) break;
 
-					     /* Make the replacement. */
-					     content.replace(index, 1, ".");
+			     /* Make the replacement. */
+			     content.replace(index, 1, ".");
 
-					     /* Advance index forward so the next iteration doesn't pick it up as well. */
-					     index += 1;
-					}
-					
-				}
-				canvas->set_meta_data(child->get_attribute("name")->get_value(),content);
+			     /* Advance index forward so the next iteration doesn't pick it up as well. */
+			     index += 1;
 			}
-			else if(child->get_name()=="name")
-			{
-				xmlpp::Element::NodeList list = child->get_children();
+			
+		}
+		canvas->set_meta_data(child->get_attribute("name")->get_value(),content);
+	}
+	else if(child->get_name()=="name")
+	{
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any name, warn
-				if(list.empty())
-					warning(child,_("blank \"name\" entity"));
+		// If we don't have any name, warn
+		if(list.empty())
+			warning(child,_("blank \"name\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_name(tmp);
-			}
-			else
-			if(child->get_name()=="desc")
-			{
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_name(tmp);
+	}
+	else
+	if(child->get_name()=="desc")
+	{
 
-				xmlpp::Element::NodeList list = child->get_children();
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any description, warn
-				if(list.empty())
-					warning(child,_("blank \"desc\" entity"));
+		// If we don't have any description, warn
+		if(list.empty())
+			warning(child,_("blank \"desc\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_description(tmp);
-			}
-			else
-			if(child->get_name()=="author")
-			{
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_description(tmp);
+	}
+	else
+	if(child->get_name()=="author")
+	{
 
-				xmlpp::Element::NodeList list = child->get_children();
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any description, warn
-				if(list.empty())
-					warning(child,_("blank \"author\" entity"));
+		// If we don't have any description, warn
+		if(list.empty())
+			warning(child,_("blank \"author\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_author(tmp);
-			}
-			else
-			if(child->get_name()=="layer")
-			{
-				//if(canvas->is_inline())
-				//	canvas->push_front(parse_layer(child,canvas->parent()));
-				//else
-					canvas->push_front(parse_layer(child,canvas));
-			}
-			else
-			{
-				printf("%s:%d\n", __FILE__, __LINE__);
-				error_unexpected_element(child,child->get_name());
-			}
-		}
-//		else
-//		if((child->get_name()=="text"||child->get_name()=="comment") && child->has_child_text())
-//			continue;
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_author(tmp);
+	}
+	else
+	if(child->get_name()=="layer")
+	{
+		//if(canvas->is_inline())
+		//	canvas->push_front(parse_layer(child,canvas->parent()));
+		//else
+			canvas->push_front(parse_layer(child,canvas));
+	}
+	else
+	{
+		printf("%s:%d\n", __FILE__, __LINE__);
+		error_unexpected_element(child,child->get_name());
 	}
+}
 
+void
+CanvasParser::parse_canvas_end(xmlpp::Element *element,Canvas::Handle canvas)
+{
 	if(canvas->value_node_list().placeholder_count())
 	{
 		String nodes;
@@ -3439,7 +3463,6 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	}
 
 	canvas->set_version(CURRENT_CANVAS_VERSION);
-	return canvas;
 }
 
 void
@@ -3465,6 +3488,215 @@ CanvasParser::show_canvas_map(String file, int line, String text)
 }
 #endif	// _DEBUG
 
+/*!	\class CanvasStreamParser
+**	\brief Builds the root canvas while the file is being read.
+**
+**	Only one child of the root <canvas> (or one entry of its <defs>)
+**	is kept as xmlpp tree at a time and it's passed to CanvasParser
+**	as soon as its closing tag is read, so the whole document tree
+**	is never stored in memory.
+**
+**	Same events may be replayed from CanvasCache instead of libxml.
+*/
+class synfig::CanvasStreamParser: public xmlpp::SaxParser, public CanvasCache::Handler
+{
+private:
+	CanvasParser &parser;
+	const FileSystem::Identifier &identifier;
+	const String &filename;
+	CanvasCache::Writer *writer;
+
+	//! holds root <canvas> element without children
+	std::unique_ptr<xmlpp::Document> root;
+	//! holds currently read child of root canvas
+	std::unique_ptr<xmlpp::Document> part;
+	xmlpp::Element *current;
+	int depth;
+	int part_depth;
+	bool in_defs;
+	std::list<ValueNode::Handle> bone_list;
+	std::exception_ptr exception;
+
+	void stop(const std::exception_ptr &e = std::exception_ptr())
+	{
+		if (!exception) exception = e;
+		stopped = true;
+		if (context_) xmlStopParser(context_);
+	}
+
+	template<typename T>
+	void set_attributes(xmlpp::Element *element, const T &attributes, int line)
+	{
+		for(typename T::const_iterator i = attributes.begin(); i != attributes.end(); ++i)
+			element->set_attribute(i->name, i->value);
+		// keep line numbers for error messages
+		element->cobj()->line = (unsigned short)std::min(line, 65535);
+	}
+
+	template<typename T>
+	void begin_element(const Glib::ustring &name, const T &attributes, int line)
+	{
+		if (stopped) return;
+		if (writer) {
+			writer->start_element(name, line, (int)attributes.size());
+			for(typename T::const_iterator i = attributes.begin(); i != attributes.end(); ++i)
+				writer->attribute(i->name, i->value);
+		}
+
+		try {
+			++depth;
+			if (current) {
+				current = current->add_child(name);
+				set_attributes(current, attributes, line);
+			} else
+			if (depth == 1) {
+				root.reset(new xmlpp::Document());
+				xmlpp::Element *element = root->create_root_node(name);
+				set_attributes(element, attributes, line);
+				bool loaded = false;
+				canvas = parser.parse_canvas_begin(element, 0, false, identifier, filename, loaded);
+				if (!canvas || loaded) stop();
+			} else
+			if (depth == 2 && name == "defs" && !canvas->is_inline()) {
+				// exported values may be huge, so read them one by one
+				in_defs = true;
+			} else {
+				part.reset(new xmlpp::Document());
+				part_depth = depth;
+				current = in_defs
+				        ? part->create_root_node("defs")->add_child(name)
+				        : part->create_root_node(name);
+				set_attributes(current, attributes, line);
+			}
+		} catch(...) {
+			stop(std::current_exception());
+		}
+	}
+
+public:
+	Canvas::Handle canvas;
+	bool stopped;
+
+	CanvasStreamParser(
+		CanvasParser &parser,
+		const FileSystem::Identifier &identifier,
+		const String &filename,
+		CanvasCache::Writer *writer = nullptr
+	):
+		parser(parser),
+		identifier(identifier),
+		filename(filename),
+		writer(writer),
+		current(),
+		depth(),
+		part_depth(),
+		in_defs(),
+		stopped()
+	{ }
+
+	void rethrow()
+		{ if (exception) std::rethrow_exception(exception); }
+
+	void start_element(const String &name, const CanvasCache::AttributeList &attributes, int line) override
+		{ begin_element(name, attributes, line); }
+
+	void end_element() override
+	{
+		if (stopped) return;
+		if (writer) writer->end_element();
+
+		try {
+			if (current) {
+				if (depth == part_depth) {
+					if (in_defs)
+						parser.parse_canvas_defs(part->get_root_node(), canvas);
+					else
+						parser.parse_canvas_child(current, canvas, bone_list);
+					current = nullptr;
+					part.reset();
+				} else {
+					current = current->get_parent();
+				}
+			} else
+			if (depth == 2 && in_defs) {
+				in_defs = false;
+			} else
+			if (depth == 1) {
+				parser.parse_canvas_end(root->get_root_node(), canvas);
+			}
+			--depth;
+		} catch(...) {
+			stop(std::current_exception());
+		}
+	}
+
+	void characters(const String &text) override
+	{
+		if (stopped || !current) return;
+		if (writer) writer->characters(text);
+
+		// libxml may split text into several chunks,
+		// merge them like DomParser does
+		xmlNode *last = current->cobj()->last;
+		if (last && last->type == XML_TEXT_NODE)
+			xmlNodeAddContent(last, (const xmlChar*)text.c_str());
+		else
+			current->add_child_text(text);
+	}
+
+protected:
+	void on_start_element(const Glib::ustring &name, const AttributeList &attributes) override
+		{ begin_element(name, attributes, xmlSAX2GetLineNumber(context_)); }
+
+	void on_end_element(const Glib::ustring & /* name */) override
+		{ end_element(); }
+
+	void on_characters(const Glib::ustring &text) override
+		{ characters(text); }
+
+	void on_cdata_block(const Glib::ustring &text) override
+		{ characters(text); }
+
+	void on_warning(const Glib::ustring &text) override
+		{ synfig::warning("%s: %s", filename.c_str(), text.c_str()); }
+
+	void on_error(const Glib::ustring &text) override
+		{ stop(std::make_exception_ptr(xmlpp::parse_error(text))); }
+
+	void on_fatal_error(const Glib::ustring &text) override
+		{ stop(std::make_exception_ptr(xmlpp::parse_error(text))); }
+};
+
+Canvas::Handle
+CanvasParser::parse_canvas_stream(std::istream &stream,const FileSystem::Identifier &identifier,String filename,const CanvasCache::Source *cache_source)
+{
+	CanvasCache::Writer writer;
+	CanvasStreamParser stream_parser(*this, identifier, filename, cache_source ? &writer : nullptr);
+	try {
+		stream_parser.parse_stream(stream);
+	} catch(const xmlpp::exception&) {
+		// libxml reports stopped parser as malformed document
+		if (!stream_parser.stopped) throw;
+	}
+	stream_parser.rethrow();
+
+	// canvas which was found already opened is not parsed till the end
+	if (cache_source && stream_parser.canvas && !stream_parser.stopped)
+		writer.save(*cache_source);
+	return stream_parser.canvas;
+}
+
+bool
+CanvasParser::parse_canvas_cache(const CanvasCache::Source &cache_source,const FileSystem::Identifier &identifier,String filename,Canvas::Handle &out_canvas)
+{
+	CanvasStreamParser stream_parser(*this, identifier, filename);
+	if (!CanvasCache::load(cache_source, stream_parser))
+		return false;
+	stream_parser.rethrow();
+	out_canvas = stream_parser.canvas;
+	return true;
+}
+
 Canvas::Handle
 CanvasParser::parse_from_file_as(const FileSystem::Identifier &identifier,const String &as,String &errors)
 {
@@ -3483,39 +3715,60 @@ CanvasParser::parse_from_file_as(const FileSystem::Identifier &identifier,const
 		total_warnings_=0;
 		
 		synfig::info(String("Loading file: ") + filename);
-		FileSystem::ReadStream::Handle stream = identifier.get_read_stream();
-		if (stream)
+
+		const char *loader = getenv("SYNFIG_CANVAS_LOADER");
+		const bool use_dom = loader && String(loader) == "dom";
+
+		// size and modification time are taken before the file is opened for parsing,
+		// so cache made from changed file will not match next time
+		CanvasCache::Source cache_source;
+		const bool use_cache = !use_dom
+			&& CanvasCache::get_source(identifier, absolute_path + "#" + identifier.filename, cache_source);
+
+		Canvas::Handle canvas;
+		if (!use_cache || !parse_canvas_cache(cache_source,identifier,as,canvas))
 		{
+			FileSystem::ReadStream::Handle stream = identifier.get_read_stream();
+			if (!stream)
+				throw runtime_error(String("  * ") + _("Can't find linked file") + " \"" + identifier.filename + "\"");
+
 			if (filename_extension(identifier.filename) == ".sifz")
 				stream = FileSystem::ReadStream::Handle(new ZReadStream(stream));
 
-			xmlpp::DomParser parser;
-			parser.parse_stream(*stream);
-			stream.reset();
-			if(parser)
+			if (use_dom)
+			{
+				xmlpp::DomParser parser;
+				parser.parse_stream(*stream);
+				stream.reset();
+				if(parser)
+					canvas = parse_canvas(parser.get_document()->get_root_node(),0,false,identifier,as);
+			}
+			else
 			{
-				Canvas::Handle canvas(parse_canvas(parser.get_document()->get_root_node(),0,false,identifier,as));
-				if (!canvas) return canvas;
-				register_canvas_in_map(canvas, as);
+				canvas = parse_canvas_stream(*stream,identifier,as,use_cache ? &cache_source : nullptr);
+				stream.reset();
+			}
+		}
+
+		if (canvas)
+		{
+			register_canvas_in_map(canvas, as);
 
-				const ValueNodeList& value_node_list(canvas->value_node_list());
+			const ValueNodeList& value_node_list(canvas->value_node_list());
 
-				again:
-				ValueNodeList::const_iterator iter;
-				for(iter=value_node_list.begin();iter!=value_node_list.end();++iter)
+			again:
+			ValueNodeList::const_iterator iter;
+			for(iter=value_node_list.begin();iter!=value_node_list.end();++iter)
+			{
+				ValueNode::Handle value_node(*iter);
+				if(value_node->is_exported() && value_node->get_id().find("Unnamed")==0)
 				{
-					ValueNode::Handle value_node(*iter);
-					if(value_node->is_exported() && value_node->get_id().find("Unnamed")==0)
-					{
-						canvas->remove_value_node(value_node, true);
-						goto again;
-					}
+					canvas->remove_value_node(value_node, true);
+					goto again;
 				}
-
-				return canvas;
 			}
-		} else {
-			throw runtime_error(String("  * ") + _("Can't find linked file") + " \"" + identifier.filename + "\"");
+
+			return canvas;
 		}
 	}
 	catch(Exception::BadLinkName&) { synfig::error("BadLinkName Thrown"); }
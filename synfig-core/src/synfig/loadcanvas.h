@@ -29,8 +29,11 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <istream>
+
 #include "string.h"
 #include "canvas.h"
+#include "canvascache.h"
 #include "valuenode.h"
 #include "vector.h"
 #include "value.h"
@@ -55,12 +58,16 @@ namespace xmlpp { class Node; class Element; };
 
 namespace synfig {
 
+class CanvasStreamParser;
+
 /*!	\class CanvasParser
 **	\brief Class that handles xmlpp elements from a sif file and converts
 * them into Synfig objects
 */
 class CanvasParser
 {
+	friend class CanvasStreamParser;
+
 	/*
  --	** -- D A T A -------------------------------------------------------------
 	*/
@@ -163,6 +170,18 @@ private:
 
 	//! Canvas Parsing Function
 	Canvas::Handle parse_canvas(xmlpp::Element *node,Canvas::Handle parent=0,bool inline_=false,const FileSystem::Identifier &identifier = FileSystemNative::instance()->get_identifier(std::string()),String path=".");
+	//! Creates canvas and reads attributes of <canvas> element, children are not parsed.
+	//! \param loaded is set to true when canvas with the same GUID is already loaded
+	Canvas::Handle parse_canvas_begin(xmlpp::Element *node,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String path,bool &loaded);
+	//! Parses one child element of <canvas>
+	void parse_canvas_child(xmlpp::Element *node,Canvas::Handle canvas,std::list<ValueNode::Handle> &bone_list);
+	//! Finishes canvas when all children are parsed
+	void parse_canvas_end(xmlpp::Element *node,Canvas::Handle canvas);
+	//! Parses root canvas while reading the stream, without building of the whole document tree
+	//! and fills the cache when \a cache_source is set
+	Canvas::Handle parse_canvas_stream(std::istream &stream,const FileSystem::Identifier &identifier,String path,const CanvasCache::Source *cache_source = nullptr);
+	//! Replays the cache file, returns false when cache is outdated
+	bool parse_canvas_cache(const CanvasCache::Source &cache_source,const FileSystem::Identifier &identifier,String path,Canvas::Handle &out_canvas);
 	//! Canvas definitions Parsing Function (exported value nodes and exported canvases)
 	void parse_canvas_defs(xmlpp::Element *node,Canvas::Handle canvas);
 
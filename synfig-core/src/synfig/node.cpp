@@ -299,6 +299,19 @@ Node::get_times() const
 	return times;
 }
 
+bool
+Node::get_time_dependency(const Time &a, const Time &b) const
+{
+	if (a.is_equal(b))
+		return false;
+	return a < b ? get_time_dependency_vfunc(a, b)
+	             : get_time_dependency_vfunc(b, a);
+}
+
+bool
+Node::get_time_dependency_vfunc(const Time & /* a */, const Time & /* b */) const
+	{ return true; }
+
 void
 Node::begin_delete()
 {
@@ -248,6 +248,11 @@ public:
 	//! Returns the cached times values for all the children
 	const time_set &get_times() const;
 
+	//! Returns false when the node is guaranteed to give the same result
+	//! at any time in range [a, b], true when it may change (or nobody knows).
+	//! Used to skip rendering of static parts of animation.
+	bool get_time_dependency(const Time &a, const Time &b) const;
+
 	//! Writeme!
 	Glib::Threads::RWLock& get_rw_lock()const { return rw_lock_; }
 
@@ -279,6 +284,11 @@ protected:
 	//!	Function to be overloaded that fills the Time Point Set with
 	//! all the children Time Points.
 	virtual void get_times_vfunc(time_set &set) const = 0;
+
+	//! Function to be overloaded that checks if the node changes
+	//! in time range [a, b], where a < b. Should be conservative:
+	//! return true when not sure.
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
 }; // End of Node class
 
 //! Finds a node by its GUID.
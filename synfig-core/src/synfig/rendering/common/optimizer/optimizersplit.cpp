@@ -29,6 +29,8 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+
 #include <synfig/general.h>
 #include <synfig/localization.h>
 
@@ -47,40 +49,62 @@ using namespace rendering;
 
 /* === M E T H O D S ======================================================= */
 
-OptimizerSplit::OptimizerSplit()
+OptimizerSplit::OptimizerSplit(int threads):
+	threads(threads)
 {
 	category_id = CATEGORY_ID_LIST;
 	depends_from = CATEGORY_SPECIALIZED;
 	for_list = true;
 }
 
+int
+OptimizerSplit::calc_parts_count(const RectInt &rect) const
+{
+	// don't make parts smaller than this
+	const int min_area = 128*128;
+	const int min_height = 16;
+	// try to keep parts small enough to fit into the cache,
+	// but don't make too much parts, some tasks have constant cost per part
+	const int max_area = 512*512;
+	const int max_parts_per_thread = 4;
+
+	if (threads < 2 || !rect.is_valid())
+		return 1;
+
+	long long area = (long long)rect.get_width()*rect.get_height();
+	long long parts = std::max((long long)threads, (area + max_area - 1)/max_area);
+	parts = std::min(parts, (long long)threads*max_parts_per_thread);
+	parts = std::min(parts, area/min_area);
+	parts = std::min(parts, (long long)(rect.get_height()/min_height));
+	return (int)std::max(parts, 1ll);
+}
+
 void
 OptimizerSplit::run(const RunParams &params) const
 {
 	if (!params.list) return;
-	const int min_area = 256*256;
 	for(Task::List::iterator i = params.list->begin(); i != params.list->end(); ++i)
 	{
 		if (TaskInterfaceSplit *split = i->type_pointer<TaskInterfaceSplit>())
-		if (split->is_splittable())
+		if (split->is_splittable() && !split->is_split_part())
 		{
 			RectInt r = (*i)->target_rect;
-			int w = r.maxx - r.minx;
-			int h = r.maxy - r.miny;
-			int t = std::min(h/10, w*h/min_area);
-			if (t >= 2)
+			int count = calc_parts_count(r);
+			if (count >= 2)
 			{
-				int hh = h/t;
-				int y = r.miny;
-				for(int j = 1; j < t; ++j, y += hh)
+				int h = r.get_height();
+				for(int j = 0; j < count; ++j)
 				{
 					Task::Handle task = (*i)->clone();
-					task->trunc_target_rect( RectInt(r.minx, y, r.maxx, y + hh) );
-					i = params.list->insert(i, task);
-					++i;
+					task.type_pointer<TaskInterfaceSplit>()->remember_whole_coords();
+					task->trunc_target_rect( RectInt(
+						r.minx, r.miny + (int)((long long)h*j/count),
+						r.maxx, r.miny + (int)((long long)h*(j + 1)/count) ));
+					if (j + 1 < count)
+						{ i = params.list->insert(i, task); ++i; }
+					else
+						*i = task;
 				}
-				*i = (*i)->clone();
-				(*i)->trunc_target_rect( RectInt(r.minx, y, r.maxx, r.maxy) );
 				apply(params);
 			}
 		}
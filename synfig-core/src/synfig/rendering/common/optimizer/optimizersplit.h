@@ -40,10 +40,16 @@ namespace synfig
 namespace rendering
 {
 
+//! Splits big tasks into horizontal bands, which may be processed simultaneously.
+//! Count of bands depends on count of rendering threads and size of the task.
 class OptimizerSplit: public Optimizer
 {
+private:
+	int threads;
+
 public:
-	OptimizerSplit();
+	explicit OptimizerSplit(int threads);
+	int calc_parts_count(const RectInt &rect) const;
 	virtual void run(const RunParams &params) const;
 };
 
@@ -0,0 +1,156 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizersurfaceformat.cpp
+**	\brief OptimizerSurfaceFormat
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <map>
+
+#include "optimizersurfaceformat.h"
+
+#include "../task/taskblend.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+struct Usage {
+	int producer; //!< index of the last task which writes to surface
+	int consumer; //!< index of the first task which reads surface
+	bool compact; //!< all readers allow compact format
+	bool skip;
+	Usage(): producer(-1), consumer(-1), compact(true), skip() { }
+};
+
+bool
+is_compact_allowed(const Task::Handle &task)
+{
+	const TaskBlend::Handle blend = TaskBlend::Handle::cast_dynamic(task);
+	return blend
+		&& blend->blend_method == Color::BLEND_COMPOSITE
+		&& blend->amount >= 0.0 && blend->amount <= 1.0;
+}
+
+bool
+less_position(const std::pair<int, Task::Handle> &a, const std::pair<int, Task::Handle> &b)
+	{ return a.first < b.first; }
+
+}
+
+/* === M E T H O D S ======================================================= */
+
+OptimizerSurfaceFormat::OptimizerSurfaceFormat(
+	const Surface::Token::Handle &format,
+	const Surface::Token::Handle &compact_format
+):
+	format(format),
+	compact_format(compact_format)
+{
+	category_id = CATEGORY_ID_LIST;
+	depends_from = CATEGORY_SPECIALIZED;
+	for_list = true;
+}
+
+void
+OptimizerSurfaceFormat::run(const RunParams &params) const
+{
+	// small surfaces don't take much memory, conversion of them is a waste of time
+	const int min_area = 64*64;
+
+	if (!params.list || (!format && !compact_format)) return;
+	Task::List &list = *params.list;
+
+	typedef std::map<SurfaceResource::Handle, Usage> Map;
+	Map usages;
+
+	for(int i = 0; i < (int)list.size(); ++i)
+	{
+		const Task::Handle &task = list[i];
+		if (!task || !task->is_valid()) continue;
+
+		Usage &usage = usages[task->target_surface];
+		if (task.type_is<TaskSurfaceConvert>())
+			{ usage.skip = true; continue; } // already converted
+
+		for(Task::List::const_iterator j = task->sub_tasks.begin(); j != task->sub_tasks.end(); ++j)
+		{
+			if (!*j || !(*j)->is_valid() || (*j)->target_surface == task->target_surface)
+				continue;
+			Map::iterator u = usages.find((*j)->target_surface);
+			if (u == usages.end() || u->second.producer < 0)
+				continue; // surface is not rendered by this list
+			if (u->second.consumer < 0)
+				u->second.consumer = i;
+			if (!is_compact_allowed(task))
+				u->second.compact = false;
+		}
+
+		// surface is changed after it was read
+		if (usage.consumer >= 0) usage.skip = true;
+		usage.producer = i;
+	}
+
+	std::vector< std::pair<int, Task::Handle> > converts;
+	for(Map::const_iterator i = usages.begin(); i != usages.end(); ++i)
+	{
+		const Usage &usage = i->second;
+		if ( usage.skip
+		  || usage.consumer < 0
+		  || usage.consumer - usage.producer < 2
+		  || i->first->get_width()*i->first->get_height() < min_area )
+			continue;
+
+		TaskSurfaceConvert::Handle convert(new TaskSurfaceConvert());
+		convert->format = usage.compact && compact_format ? compact_format : format;
+		if (!convert->format) continue;
+		convert->target_surface = i->first;
+		convert->source_rect = Rect(0.0, 0.0, 1.0, 1.0);
+		convert->target_rect = RectInt(VectorInt::zero(), i->first->get_size());
+		converts.push_back(std::make_pair(usage.producer + 1, convert));
+	}
+
+	if (converts.empty()) return;
+
+	// insert from the end to keep positions valid
+	std::sort(converts.begin(), converts.end(), less_position);
+	for(int i = (int)converts.size() - 1; i >= 0; --i)
+		list.insert(list.begin() + converts[i].first, converts[i].second);
+	apply(params);
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,68 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizersurfaceformat.h
+**	\brief OptimizerSurfaceFormat Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_OPTIMIZERSURFACEFORMAT_H
+#define __SYNFIG_RENDERING_OPTIMIZERSURFACEFORMAT_H
+
+/* === H E A D E R S ======================================================= */
+
+#include "../../optimizer.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Keeps intermediate results in compact formats while they are waiting
+//! for the task which will use them. Adds TaskSurfaceConvert after the last task
+//! which writes to the surface, when other tasks are placed before the first reader.
+//! Format is selected for each surface from its readers:
+//! compact_format is used when all of readers just composite the surface
+//! (rounding errors are not visible at 8-bit output), format is used otherwise.
+class OptimizerSurfaceFormat: public Optimizer
+{
+public:
+	//! format for intermediate surfaces, null to keep them unchanged
+	const Surface::Token::Handle format;
+	//! format for composited surfaces, null to use the format above
+	const Surface::Token::Handle compact_format;
+
+	OptimizerSurfaceFormat(
+		const Surface::Token::Handle &format,
+		const Surface::Token::Handle &compact_format );
+	virtual void run(const RunParams &params) const;
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -49,6 +49,32 @@ SYNFIG_EXPORT Task::Token TaskContour::token(
 	DescAbstract<TaskContour>("Contour") );
 
 
+bool
+TaskContour::hash_params(TaskHash &hash) const
+{
+	hash.add(detail);
+	hash.add(allow_antialias);
+	hash.add((int)rasterizer);
+	hash.add(&transformation->matrix.m, sizeof(transformation->matrix.m));
+	hash.add((bool)contour);
+	if (contour) {
+		hash.add(contour->invert);
+		hash.add(contour->antialias);
+		hash.add((int)contour->winding_style);
+		hash.add(&contour->color, sizeof(contour->color));
+		hash.add(contour->beginning_of_unclosed());
+		const Contour::ChunkList &chunks = contour->get_chunks();
+		hash.add((int)chunks.size());
+		for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+			hash.add((int)i->type);
+			hash.add(i->p1);
+			hash.add(i->pp0);
+			hash.add(i->pp1);
+		}
+	}
+	return true;
+}
+
 Rect
 TaskContour::calc_bounds() const
 {
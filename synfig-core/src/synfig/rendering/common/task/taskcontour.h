@@ -49,14 +49,22 @@ public:
 	SYNFIG_EXPORT static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
 
+	//! Algorithm used to convert contour into pixels
+	enum Rasterizer {
+		RASTERIZER_SORTED,  //!< sort all cover marks of the contour, then draw them
+		RASTERIZER_BUCKETED //!< collect cover marks into rows and accumulate them in row buffer
+	};
+
 public:
 	Contour::Handle contour;
 	Real detail;
 	bool allow_antialias;
+	Rasterizer rasterizer;
 	Holder<TransformationAffine> transformation;
 
-	TaskContour(): detail(1.0), allow_antialias(true) { }
+	TaskContour(): detail(1.0), allow_antialias(true), rasterizer(RASTERIZER_SORTED) { }
 
+	virtual bool hash_params(TaskHash &hash) const;
 	virtual Rect calc_bounds() const;
 
 	virtual Transformation::Handle get_transformation() const
@@ -70,4 +70,22 @@ TaskPixelProcessor::get_offset() const
 	return VectorInt((int)round(offset[0]), (int)round(offset[1])) - sub_task()->target_rect.get_min();
 }
 
+
+bool
+TaskPixelGamma::hash_params(TaskHash &hash) const
+{
+	hash.add(gamma.get_r());
+	hash.add(gamma.get_g());
+	hash.add(gamma.get_b());
+	return true;
+}
+
+
+bool
+TaskPixelColorMatrix::hash_params(TaskHash &hash) const
+{
+	hash.add(&matrix.c, sizeof(matrix.c));
+	return true;
+}
+
 /* === E N T R Y P O I N T ================================================= */
@@ -134,4 +134,13 @@ TaskTransformationAffine::get_pass_subtask_index() const
 	return TaskTransformation::get_pass_subtask_index();
 }
 
+bool
+TaskTransformationAffine::hash_params(TaskHash &hash) const
+{
+	hash.add((int)interpolation);
+	hash.add(supersample);
+	hash.add(&transformation->matrix.m, sizeof(transformation->matrix.m));
+	return true;
+}
+
 /* === E N T R Y P O I N T ================================================= */
@@ -153,11 +153,47 @@ Polyspan::sort_marks()
 		addcurrent();
 		current.setcover(0,0);
 
-		std::sort(covers.begin() + open_index,covers.end());
+		// stable, so marks with the same coordinates are accumulated in order
+		// of creation, and crop_rows() before sorting gives the same rows
+		std::stable_sort(covers.begin() + open_index,covers.end());
 		flags &= ~NotSorted;
 	}
 }
 
+//add the not finished line and the current cell to the marks, but don't sort them
+void
+Polyspan::flush_marks()
+{
+	finish_line();
+	addcurrent();
+	current.setcover(0,0);
+}
+
+//keep only marks of rows [miny, maxy)
+void
+Polyspan::crop_rows(int miny, int maxy)
+{
+	// marks are not sorted here, sort_marks() after cropping is
+	// cheaper than sorting the marks of the whole polyspan
+	flush_marks();
+
+	window.miny = std::max(window.miny, miny);
+	window.maxy = std::max(window.miny, std::min(window.maxy, maxy));
+
+	// keep the order of marks, marks with the same coordinates
+	// should be accumulated in the same order as in the whole polyspan
+	int index = 0, new_open_index = 0;
+	cover_array::iterator j = covers.begin();
+	for(cover_array::const_iterator i = covers.begin(); i != covers.end(); ++i, ++index)
+	{
+		if (i->y < window.miny || i->y >= window.maxy) continue;
+		if (index < open_index) ++new_open_index;
+		*j++ = *i;
+	}
+	covers.erase(j, covers.end());
+	open_index = new_open_index;
+}
+
 //encapsulate the current sublist of marks (used for drawing)
 void
 Polyspan::encapsulate_current()
@@ -161,6 +161,13 @@ public:
 	//will sort the marks if they are not sorted
 	void sort_marks();
 
+	//add the not finished line and the current cell to the marks, but don't sort them
+	void flush_marks();
+
+	//keep only marks of rows [miny, maxy) and reduce window to these rows,
+	//result is the same as the rows of the whole polyspan, marks stay unsorted
+	void crop_rows(int miny, int maxy);
+
 	//encapsulate the current sublist of marks (used for drawing)
 	void encapsulate_current();
 
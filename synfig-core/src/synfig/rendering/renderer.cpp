@@ -46,6 +46,7 @@
 
 #include "renderer.h"
 #include "renderqueue.h"
+#include "common/task/taskblend.h"
 
 #include "software/renderersw.h"
 #include "software/rendererdraftsw.h"
@@ -85,6 +86,7 @@ using namespace rendering;
 Renderer::Handle Renderer::blank;
 std::map<String, Renderer::Handle> *Renderer::renderers;
 RenderQueue *Renderer::queue;
+TaskCache::Handle Renderer::cache;
 Renderer::DebugOptions Renderer::debug_options;
 long long Renderer::last_registered_optimizer_index = 0;
 long long Renderer::last_batch_index = 0;
@@ -248,6 +250,103 @@ Renderer::remove_dummy(Task::List &list) const
 			i = list.erase(i); else ++i;
 }
 
+Task::Handle
+Renderer::apply_cache_recursive(
+	const Task::Handle &task,
+	const Task::Handle &parent,
+	const Task::HashMap &hashes,
+	Task::List &out_list ) const
+{
+	// small sub-trees are cheap to render, don't waste the cache budget
+	const int min_area = 64*64;
+
+	if (!task || task.type_is<TaskSurface>())
+		return task;
+
+	// roots of list are never replaced, they should to draw at given target surfaces,
+	// also sub-tree should to have own target surface, not shared with parent
+	Task::HashMap::const_iterator hi = hashes.find(task.get());
+	if ( hi != hashes.end()
+	  && parent
+	  && task->is_valid()
+	  && task->target_surface != parent->target_surface
+	  && task->target_rect.get_width()*task->target_rect.get_height() >= min_area )
+	{
+		// results of different renderers are not interchangeable
+		TaskHash hash;
+		hash.add(get_name());
+		hash.add(&hi->second, sizeof(hi->second));
+		TaskCache::Key key = hash.get();
+
+		TaskSurface::Handle surface(new TaskSurface());
+		surface->assign_target(*task);
+		if (SurfaceResource::Handle cached = cache->find(key)) {
+			// cached surface is shared between frames and identical sub-trees,
+			// so it should never become a target of any task (see on_target_set_as_source).
+			// Sub-tree is replaced by a copy of cached surface into own target of sub-tree,
+			// OptimizerBlendMerge may fold this copy into the parent blending,
+			// cached surface stays a read-only source in both cases
+			surface->target_surface = cached;
+			TaskBlend::Handle copy(new TaskBlend());
+			copy->assign_target(*task);
+			copy->sub_task_b() = surface;
+			return copy;
+		}
+
+		if (task->target_surface->is_blank() && cache->touch(key)) {
+			// sub-tree will be rendered as separate task
+			// to protect its target surface from optimizations of parent task
+			TaskCacheStore::Handle store(new TaskCacheStore());
+			store->cache = cache;
+			store->key = key;
+			store->assign_target(*task);
+			store->sub_task(0) = new TaskSurface();
+			store->sub_task(0)->assign_target(*task);
+			out_list.push_back(task);
+			out_list.push_back(store);
+			return surface;
+		}
+		return task;
+	}
+
+	Task::Handle result = task;
+	for(int i = 0; i < (int)task->sub_tasks.size(); ++i) {
+		Task::Handle sub_task = apply_cache_recursive(task->sub_tasks[i], task, hashes, out_list);
+		if (sub_task != task->sub_tasks[i]) {
+			if (result == task) result = task->clone();
+			result->sub_tasks[i] = sub_task;
+		}
+	}
+	return result;
+}
+
+void
+Renderer::apply_cache(Task::List &list) const
+{
+	if (!cache || !cache->is_enabled())
+		return;
+
+	#ifdef DEBUG_OPTIMIZATION_MEASURE
+	debug::Measure t("apply cache");
+	#endif
+
+	for(Task::List::iterator i = list.begin(); i != list.end(); ++i)
+	{
+		if (!*i) continue;
+
+		Task::HashMap hashes;
+		TaskHash::Value hash;
+		(*i)->calc_hash(hash, &hashes);
+
+		Task::List stored;
+		*i = apply_cache_recursive(*i, Task::Handle(), hashes, stored);
+
+		// stored sub-trees should be rendered before the task which uses them
+		if (!stored.empty())
+			i = list.insert(i, stored.begin(), stored.end()) + stored.size();
+	}
+}
+
 void
 Renderer::linearize(Task::List &list) const
 {
@@ -509,7 +608,9 @@ Renderer::optimize(Task::List &list) const
 			case Optimizer::CATEGORY_ID_COORDS:
 				calc_coords(list); break;
 			case Optimizer::CATEGORY_ID_SPECIALIZED:
-				specialize(list); break;
+				apply_cache(list);
+				specialize(list);
+				break;
 			case Optimizer::CATEGORY_ID_LIST:
 				linearize(list); break;
 			default:
@@ -935,7 +1036,7 @@ Renderer::log(
 				t->get_bounds().maxx, t->get_bounds().maxy )
 			  : "" )
 			+ ( t->target_surface
-              ? etl::strprintf(" source (%f, %f)-(%f, %f) target (%d, %d)-(%d, %d) surface [%s] (%dx%d) id %d",
+              ? etl::strprintf(" source (%f, %f)-(%f, %f) target (%d, %d)-(%d, %d) surface [%s] (%dx%d) id %llu",
 				t->source_rect.minx, t->source_rect.miny,
 				t->source_rect.maxx, t->source_rect.maxy,
 				t->target_rect.minx, t->target_rect.miny,
@@ -992,6 +1093,10 @@ Renderer::initialize()
 	renderers = new std::map<String, Handle>();
 	queue = new RenderQueue();
 
+	cache = new TaskCache();
+	if (const char *s = getenv("SYNFIG_RENDERING_CACHE_SIZE"))
+		cache->set_max_size((size_t)std::max(0, atoi(s))*1024*1024);
+
 	initialize_renderers();
 }
 
@@ -1008,6 +1113,8 @@ Renderer::deinitialize()
 
 	delete renderers;
 	delete queue;
+
+	cache.reset();
 }
 
 void
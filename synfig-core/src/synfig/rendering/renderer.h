@@ -33,6 +33,7 @@
 #include <atomic>
 
 #include "optimizer.h"
+#include "taskcache.h"
 
 /* === M A C R O S ========================================================= */
 
@@ -63,6 +64,7 @@ private:
 	static Handle blank;
 	static std::map<String, Handle> *renderers;
 	static RenderQueue *queue;
+	static TaskCache::Handle cache;
 	static DebugOptions debug_options;
 	static long long last_registered_optimizer_index;
 	static long long last_batch_index; // TODO: atomic
@@ -96,6 +98,12 @@ private:
 	void specialize_recursive(Task::List &list) const;
 	void specialize(Task::List &list) const;
 	void remove_dummy(Task::List &list) const;
+	Task::Handle apply_cache_recursive(
+		const Task::Handle &task,
+		const Task::Handle &parent,
+		const Task::HashMap &hashes,
+		Task::List &out_list ) const;
+	void apply_cache(Task::List &list) const;
 	void linearize(Task::List &list) const;
 
 	int subtasks_count(const Task::Handle &task, int max_count) const;
@@ -182,6 +190,8 @@ public:
 
 	static const DebugOptions& get_debug_options()
 		{ return debug_options; }
+	static const TaskCache::Handle& get_cache()
+		{ return cache; }
 
 	static bool subsys_init()
 		{ initialize(); return true; }
@@ -37,6 +37,7 @@
 #include <synfig/debug/debugsurface.h>
 #include <synfig/debug/log.h>
 #include <synfig/debug/measure.h>
+#include <synfig/debug/profiler.h>
 
 #include "renderqueue.h"
 #include "renderer.h"
@@ -83,13 +84,15 @@ Task::Token TaskSubQueue::token(
 } // end of anonimous namespace
 
 
-RenderQueue::RenderQueue(): started(false) { start(); }
+RenderQueue::RenderQueue():
+	sleeping(0), ready_count(0), next_worker(0), started(false)
+	{ start(); }
 RenderQueue::~RenderQueue() { stop(); }
 
 void
 RenderQueue::start()
 {
-	std::lock_guard<std::mutex> lock(mutex);
+	std::lock_guard<std::mutex> lock(threads_mutex);
 	if (started) return;
 
 	// one thread reserved for non-multithreading tasks (OpenGL)
@@ -107,25 +110,35 @@ RenderQueue::start()
 	if (count > SYNFIG_RENDERING_MAX_THREADS) count = SYNFIG_RENDERING_MAX_THREADS;
 	if (count < 2) count = 2;
 
+	// worker with index 0 is not used, thread 0 serves single_ready_tasks
+	for(unsigned int i = 0; i < count; ++i)
+		workers.push_back(new Worker());
+
+	started = true;
 	for(unsigned int i = 0; i < count; ++i)
 		threads.push_back(
 			std::thread(
 				sigc::bind(sigc::mem_fun(*this, &RenderQueue::process), i) ));
 	info("rendering threads %d", count);
-	started = true;
 }
 
 void
 RenderQueue::stop()
 {
+	std::lock_guard<std::mutex> lock(threads_mutex);
+	started = false;
 	{
-		std::lock_guard<std::mutex> lock(mutex);
-		started = false;
+		std::lock_guard<std::mutex> lock(sleep_mutex);
 		cond.notify_all();
+	}
+	{
+		std::lock_guard<std::mutex> lock(single_mutex);
 		single_cond.notify_all();
 	}
 	while(!threads.empty())
 		{ threads.front().join(); threads.pop_front(); }
+	while(!workers.empty())
+		{ delete workers.back(); workers.pop_back(); }
 }
 
 void
@@ -149,9 +162,16 @@ RenderQueue::process(int thread_index)
 		}
 
 		bool success = false;
-		try {
-			success = task->run(task->renderer_data.params);
-		} catch(...) { }
+		{
+			debug::Profiler::Scope scope(
+				task->get_token()->name,
+				task->source_layer,
+				task->target_rect,
+				thread_index );
+			try {
+				success = task->run(task->renderer_data.params);
+			} catch(...) { }
+		}
 		if (!success)
 			task->renderer_data.success = false;
 
@@ -159,10 +179,10 @@ RenderQueue::process(int thread_index)
 		debug::DebugSurface::save_to_file(
 			task->target_surface,
 			etl::strprintf(
-				"task-%05d-%04d-%05d",
+				"task-%05d-%04d-%05llu",
 				task->renderer_data.batch_index,
 				task->renderer_data.index,
-				task->target_surface ? task->target_surface->get_id() : 0 ));
+				task->target_surface ? task->target_surface->get_id() : 0ull ));
 		#endif
 
 		#ifdef DEBUG_THREAD_TASK
@@ -193,70 +213,148 @@ void
 RenderQueue::done(int thread_index, const Task::Handle &task)
 {
 	assert(task);
-	int single_signals = 0;
-	int signals = 0;
-	std::lock_guard<std::mutex> lock(mutex);
-	for(Task::Set::iterator i = task->renderer_data.back_deps.begin(); i != task->renderer_data.back_deps.end(); ++i)
+	Task::RendererData &rd = task->renderer_data;
+
+	// task owns its back_deps while it runs, nobody else modifies them
+	for(Task::Set::iterator i = rd.back_deps.begin(); i != rd.back_deps.end(); ++i)
 	{
 		assert(*i);
-		(*i)->renderer_data.deps.erase(task);
-		if ((*i)->renderer_data.deps.empty())
-		{
-			bool mt = (*i)->get_allow_multithreading();
-			TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-			TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-			wait.erase(*i);
-			queue.push_back(*i);
-			++(mt ? signals : single_signals);
-		}
+		if (--(*i)->renderer_data.deps_count == 0)
+			make_ready(thread_index, *i);
+	}
+	rd.back_deps.clear();
+	rd.state = Task::RendererData::STATE_DONE;
+}
+
+void
+RenderQueue::push(int thread_index, const Task::Handle &task)
+{
+	if (!task->get_allow_multithreading())
+	{
+		std::lock_guard<std::mutex> lock(single_mutex);
+		single_ready_tasks.push_back(task);
+		single_cond.notify_one();
+		return;
+	}
+
+	// keep task in the current thread if possible (it probably uses the same surfaces),
+	// tasks enqueued from outside are distributed between all threads
+	int count = (int)workers.size();
+	int index = thread_index > 0 && thread_index < count
+	          ? thread_index
+	          : 1 + (int)(next_worker++ % (unsigned int)(count - 1));
+	{
+		std::lock_guard<std::mutex> lock(workers[index]->mutex);
+		workers[index]->tasks.push_back(task);
+	}
+	++ready_count;
+
+	if (sleeping > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		cond.notify_one();
 	}
-	task->renderer_data.back_deps.clear();
-	assert( tasks_in_process.count(thread_index) == 1 );
-	tasks_in_process.erase(thread_index);
-	//info("rendering threads used %d", tasks_in_process.size());
-
-	// limit signals count
-	int threads = get_threads_count() - 1;
-	if (signals > threads) signals = threads;
-	if (single_signals > 1) single_signals = 1;
-
-	// we don't need to wakeup the current thread
-	--(thread_index ? signals : single_signals);
-
-	// wake up
-	while(signals-- > 0) cond.notify_one();
-	while(single_signals-- > 0) single_cond.notify_one();
+}
+
+void
+RenderQueue::make_ready(int thread_index, const Task::Handle &task)
+{
+	Task::RendererData &rd = task->renderer_data;
+
+	int state = Task::RendererData::STATE_WAITING;
+	if (!rd.state.compare_exchange_strong(state, Task::RendererData::STATE_PREPARING))
+		return; // task was cancelled
+
+	// all dependencies are done, release them
+	rd.deps.clear();
+	rd.state = Task::RendererData::STATE_READY;
+
+	push(thread_index, task);
 }
 
 Task::Handle
-RenderQueue::get(int thread_index)
+RenderQueue::pop(int thread_index)
 {
-	std::unique_lock<std::mutex> lock(mutex);
+	Worker &worker = *workers[thread_index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (worker.tasks.empty())
+		return Task::Handle();
+	Task::Handle task = worker.tasks.back();
+	worker.tasks.pop_back();
+	return task;
+}
 
-	TaskQueue &queue  = thread_index == 0 ? single_ready_tasks     : ready_tasks;
-	TaskQueue &queue2 = thread_index != 0 ? single_ready_tasks     : ready_tasks;
-	TaskSet   &wait   = thread_index == 0 ? single_not_ready_tasks : not_ready_tasks;
-	while(started)
+Task::Handle
+RenderQueue::steal(int thread_index)
+{
+	int count = (int)workers.size() - 1;
+	for(int i = 1; i < count; ++i)
 	{
-		if (!queue.empty())
+		Worker &worker = *workers[1 + (thread_index - 1 + i) % count];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.tasks.empty())
 		{
-			Task::Handle task = queue.front();
-			queue.pop_front();
-			if (!task) continue;
-			assert( tasks_in_process.count(thread_index) == 0 );
-			tasks_in_process[thread_index] = task;
-			//info("rendering threads used %d", tasks_in_process.size());
+			Task::Handle task = worker.tasks.front();
+			worker.tasks.pop_front();
 			return task;
 		}
+	}
+	return Task::Handle();
+}
 
-		#ifdef DEBUG_THREAD_WAIT
-		if (!wait.empty())
-			info("thread %d: rendering wait for task", thread_index);
-		#endif
+void
+RenderQueue::wait(int thread_index)
+{
+	std::unique_lock<std::mutex> lock(sleep_mutex);
+	++sleeping;
 
-		assert( wait.empty() || !tasks_in_process.empty() || !queue2.empty() );
+	#ifdef DEBUG_THREAD_WAIT
+	info("thread %d: rendering wait for task", thread_index);
+	#else
+	(void)thread_index;
+	#endif
 
-		(thread_index ? cond : single_cond).wait(lock);
+	while(started && ready_count <= 0)
+		cond.wait(lock);
+	--sleeping;
+}
+
+Task::Handle
+RenderQueue::get(int thread_index)
+{
+	if (thread_index == 0)
+	{
+		std::unique_lock<std::mutex> lock(single_mutex);
+		while(started)
+		{
+			if (!single_ready_tasks.empty())
+			{
+				Task::Handle task = single_ready_tasks.front();
+				single_ready_tasks.pop_front();
+				int state = Task::RendererData::STATE_READY;
+				if (task->renderer_data.state.compare_exchange_strong(state, Task::RendererData::STATE_RUNNING))
+					return task;
+				continue; // task was cancelled
+			}
+			single_cond.wait(lock);
+		}
+		return Task::Handle();
+	}
+
+	while(started)
+	{
+		Task::Handle task = pop(thread_index);
+		if (!task)
+			task = steal(thread_index);
+		if (task)
+		{
+			--ready_count;
+			int state = Task::RendererData::STATE_READY;
+			if (task->renderer_data.state.compare_exchange_strong(state, Task::RendererData::STATE_RUNNING))
+				return task;
+			continue; // task was cancelled
+		}
+		wait(thread_index);
 	}
 	return Task::Handle();
 }
@@ -264,11 +362,13 @@ RenderQueue::get(int thread_index)
 void
 RenderQueue::fix_task(const Task &task, const Task::RunParams &params)
 {
-	//for(Task::List::iterator i = task.back_deps.begin(); i != task.back_deps.end();)
-	//	if (*i) ++i; else i = (*i)->back_deps.erase(i);
-	task.renderer_data.params = params;
-	task.renderer_data.params.sub_queue.clear();
-	task.renderer_data.success = true;
+	Task::RendererData &rd = task.renderer_data;
+	rd.params = params;
+	rd.params.sub_queue.clear();
+	rd.success = true;
+	rd.deps_count = (int)rd.deps.size();
+	rd.back_deps_count = (int)rd.back_deps.size();
+	rd.state = Task::RendererData::STATE_WAITING;
 }
 
 int
@@ -278,80 +378,65 @@ RenderQueue::get_threads_count() const
 }
 
 bool
-RenderQueue::remove_if_orphan(const Task::Handle &task, bool in_queue)
+RenderQueue::is_orphan_allowed(const Task::Handle &task)
 {
-	// mutex must be already locked
-
-	if (!task)
-		return true;
-
-	TaskSet *tasks = NULL;
-	TaskSet::iterator ii;
-	if (!in_queue) {
-		bool mt = task->get_allow_multithreading();
-		tasks = mt ? &not_ready_tasks : &single_not_ready_tasks;
-		ii = tasks->find(task);
-		if (ii == tasks->end())
-			return true;
-	}
-
 	if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(task))
 		if (!task_event->is_finished())
 			return false;
+	return true;
+}
 
-	if (!task->renderer_data.back_deps.empty())
+bool
+RenderQueue::cancel_task(const Task::Handle &task, bool dependent, TaskEvent::List &events)
+{
+	if (!task)
 		return false;
-		
-	for(TaskSet::iterator i = task->renderer_data.deps.begin(); i != task->renderer_data.deps.end(); ++i)
-		if (*i) {
-			(*i)->renderer_data.back_deps.erase(task);
-			if ((*i)->renderer_data.back_deps.empty())
-				remove_if_orphan(*i, false);
-		}
-	task->renderer_data.deps.clear();
 
-	// don't remove task if 'in_queue' is set (it will removed by caller)
-	if (tasks) tasks->erase(ii);
-	return true;
+	// only waiting or ready tasks may be cancelled,
+	// the thread which changes the state becomes the owner of the task
+	Task::RendererData &rd = task->renderer_data;
+	int state = rd.state;
+	while( state == Task::RendererData::STATE_WAITING
+		|| state == Task::RendererData::STATE_READY )
+	{
+		if (rd.state.compare_exchange_weak(state, Task::RendererData::STATE_CANCELLED))
+		{
+			release_task(task, dependent, events);
+			return true;
+		}
+	}
+	return false;
 }
 
 void
-RenderQueue::remove_orphans()
+RenderQueue::release_task(const Task::Handle &task, bool dependent, TaskEvent::List &events)
 {
-	// mutex must be already locked
+	Task::RendererData &rd = task->renderer_data;
 
-	for(TaskQueue::iterator i = ready_tasks.begin(); i != ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) ready_tasks.erase(i++); else ++i;
-	for(TaskQueue::iterator i = single_ready_tasks.begin(); i != single_ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) single_ready_tasks.erase(i++); else ++i;
+	if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(task))
+		events.push_back(task_event);
 
-	for(TaskSet::iterator i = not_ready_tasks.begin(); i != not_ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) not_ready_tasks.erase(i++); else ++i;
-	for(TaskSet::iterator i = single_not_ready_tasks.begin(); i != single_not_ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) single_not_ready_tasks.erase(i++); else ++i;
-}
+	// remove dependencies which are not required by any other task
+	for(Task::Set::iterator i = rd.deps.begin(); i != rd.deps.end(); ++i)
+		if (*i && --(*i)->renderer_data.back_deps_count <= 0 && is_orphan_allowed(*i))
+			cancel_task(*i, false, events);
 
+	// dependent tasks will never be ready
+	if (dependent)
+		for(Task::Set::iterator i = rd.back_deps.begin(); i != rd.back_deps.end(); ++i)
+			cancel_task(*i, true, events);
+
+	rd.deps.clear();
+	rd.back_deps.clear();
+}
 
 void
 RenderQueue::enqueue(const Task::Handle &task, const Task::RunParams &params)
 {
 	if (!task) return;
 	fix_task(*task, params);
-	std::lock_guard<std::mutex> lock(mutex);
-
-	bool mt = task->get_allow_multithreading();
-	TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-	TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-	if (task->renderer_data.deps.empty()) {
-		queue.push_back(task);
-		(mt ? cond : single_cond).notify_one();
-	}
-	else
-	{
-		wait.insert(task);
-	}
-
-	remove_orphans();
+	if (task->renderer_data.deps.empty())
+		make_ready(-1, task);
 }
 
 void
@@ -359,62 +444,19 @@ RenderQueue::enqueue(const Task::List &tasks, const Task::RunParams &params)
 {
 	Task::RunParams p(params);
 	p.sub_queue.clear();
-	int count = 0;
-	for(Task::List::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
-		if (*i) { fix_task(**i, p); ++count; }
-	if (!count) return;
 
-	std::lock_guard<std::mutex> lock(mutex);
-	int single_signals = 0;
-	int signals = 0;
+	// all counters should be initialized before the first task will pushed,
+	// because pushed task may finish immediately
+	Task::List ready;
 	for(Task::List::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
-	{
-		if (*i)
-		{
-			bool mt = (*i)->get_allow_multithreading();
-			TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-			TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-			if ((*i)->renderer_data.deps.empty()) {
-				queue.push_back(*i);
-				++(mt ? signals : single_signals);
-			} else {
-				wait.insert(*i);
-			}
+		if (*i) {
+			fix_task(**i, p);
+			if ((*i)->renderer_data.deps.empty())
+				ready.push_back(*i);
 		}
-	}
-
-	// limit signals count
-	int threads = get_threads_count() - 1;
-	if (signals > threads) signals = threads;
-	if (single_signals > 1) single_signals = 1;
-
-	// wake up
-	while(signals-- > 0) cond.notify_one();
-	while(single_signals-- > 0) single_cond.notify_one();
 
-	remove_orphans();
-}
-
-bool
-RenderQueue::remove_task(const Task::Handle &task)
-{
-	bool found = false;
-	if (task) {
-		bool mt = task->get_allow_multithreading();
-		TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-		TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-
-		for(TaskQueue::iterator i = queue.begin(); i != queue.end(); ) {
-			if (*i == task) {
-				found = true;
-				i = queue.erase(i);
-			} else {
-				++i;
-			}
-		}
-		if (wait.erase(task)) found = true;
-	}
-	return found;
+	for(Task::List::const_iterator i = ready.begin(); i != ready.end(); ++i)
+		make_ready(-1, *i);
 }
 
 void
@@ -422,14 +464,13 @@ RenderQueue::cancel(const Task::Handle &task)
 {
 	if (!task) return;
 
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		if (remove_task(task))
-			remove_orphans();
-	}
-
+	TaskEvent::List events;
+	cancel_task(task, false, events);
 	if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(task))
-		task_event->finish(false);
+		events.push_back(task_event);
+
+	for(TaskEvent::List::const_iterator i = events.begin(); i != events.end(); ++i)
+		(*i)->finish(false);
 }
 
 void
@@ -438,17 +479,10 @@ RenderQueue::cancel(const Task::List &list)
 	if (list.empty()) return;
 
 	TaskEvent::List events;
-
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		bool found = false;
-		for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i) {
-			if (remove_task(*i))
-				found = true;
-			if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(*i))
-				events.push_back(task_event);
-		}
-		if (found) remove_orphans();
+	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i) {
+		cancel_task(*i, false, events);
+		if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(*i))
+			events.push_back(task_event);
 	}
 
 	for(TaskEvent::List::const_iterator i = events.begin(); i != events.end(); ++i)
@@ -458,11 +492,26 @@ RenderQueue::cancel(const Task::List &list)
 void
 RenderQueue::clear()
 {
-	std::lock_guard<std::mutex> lock(mutex);
-	ready_tasks.clear();
-	single_ready_tasks.clear();
-	not_ready_tasks.clear();
-	single_not_ready_tasks.clear();
+	TaskQueue tasks;
+	for(std::vector<Worker*>::const_iterator i = workers.begin(); i != workers.end(); ++i) {
+		std::lock_guard<std::mutex> lock((*i)->mutex);
+		ready_count -= (int)(*i)->tasks.size();
+		tasks.insert(tasks.end(), (*i)->tasks.begin(), (*i)->tasks.end());
+		(*i)->tasks.clear();
+	}
+	{
+		std::lock_guard<std::mutex> lock(single_mutex);
+		tasks.insert(tasks.end(), single_ready_tasks.begin(), single_ready_tasks.end());
+		single_ready_tasks.clear();
+	}
+
+	// cancel ready tasks and all tasks which are waiting for them
+	TaskEvent::List events;
+	for(TaskQueue::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
+		cancel_task(*i, true, events);
+
+	for(TaskEvent::List::const_iterator i = events.begin(); i != events.end(); ++i)
+		(*i)->finish(false);
 }
 
 /* === E N T R Y P O I N T ================================================= */
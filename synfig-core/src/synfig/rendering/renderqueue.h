@@ -27,7 +27,10 @@
 
 /* === H E A D E R S ======================================================= */
 
-#include <map>
+#include <atomic>
+#include <deque>
+#include <list>
+#include <vector>
 
 #include <mutex>
 #include <condition_variable>
@@ -46,31 +49,40 @@ namespace synfig
 namespace rendering
 {
 
+//! Queue of the rendering tasks.
+//! Each worker thread has own deque of ready tasks, it takes tasks from the back
+//! of own deque and steals tasks from the front of deques of other threads when own deque is empty.
+//! Dependencies are tracked by atomic counters in Task::RendererData,
+//! so finished task makes dependent tasks ready without any global lock.
+//! Thread with index 0 is reserved for tasks which cannot run multithreaded (single_ready_tasks).
 class RenderQueue
 {
 public:
 	typedef std::list<std::thread> ThreadList;
-	typedef std::map<int, Task::Handle> ThreadTaskMap;
-	typedef std::set<Task::Handle> TaskSet;
-	typedef std::list<Task::Handle> TaskQueue;
+	typedef std::deque<Task::Handle> TaskQueue;
 
 private:
-	static int last_batch_index;
+	struct Worker {
+		std::mutex mutex;
+		TaskQueue tasks;
+	};
 
-	std::mutex mutex;
 	std::mutex threads_mutex;
+
+	std::mutex sleep_mutex;
 	std::condition_variable cond;
-	std::condition_variable single_cond;
+	std::atomic<int> sleeping;
+	std::atomic<int> ready_count;
+	std::atomic<unsigned int> next_worker;
 
-	TaskQueue ready_tasks;
+	std::mutex single_mutex;
+	std::condition_variable single_cond;
 	TaskQueue single_ready_tasks;
-	TaskSet not_ready_tasks;
-	TaskSet single_not_ready_tasks;
 
-	bool started;
+	std::atomic<bool> started;
 
 	ThreadList threads;
-	ThreadTaskMap tasks_in_process;
+	std::vector<Worker*> workers;
 
 	void start();
 	void stop();
@@ -79,10 +91,17 @@ private:
 	void done(int thread_index, const Task::Handle &task);
 	Task::Handle get(int thread_index);
 
+	Task::Handle pop(int thread_index);
+	Task::Handle steal(int thread_index);
+	void wait(int thread_index);
+
+	void push(int thread_index, const Task::Handle &task);
+	void make_ready(int thread_index, const Task::Handle &task);
+
 	static void fix_task(const Task &task, const Task::RunParams &params);
-	bool remove_if_orphan(const Task::Handle &task, bool in_queue);
-	void remove_orphans();
-	bool remove_task(const Task::Handle &task);
+	static bool is_orphan_allowed(const Task::Handle &task);
+	bool cancel_task(const Task::Handle &task, bool dependent, TaskEvent::List &events);
+	void release_task(const Task::Handle &task, bool dependent, TaskEvent::List &events);
 
 public:
 	RenderQueue();
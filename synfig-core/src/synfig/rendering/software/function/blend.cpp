@@ -0,0 +1,689 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/blend.cpp
+**	\brief Blend
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+
+#include "blend.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+// the same as COLOR_EPSILON in color.cpp
+#define EPSILON (0.000001f)
+
+// Surface::blit_to() copies pixels for straight blending with this tolerance
+#define STRAIGHT_COPY_EPSILON (0.00001f)
+
+#ifdef __GNUC__
+	// GCC and Clang vector extensions
+	#define BLEND_VECTORS
+	#define BLEND_INLINE inline __attribute__((always_inline))
+	#if defined(__x86_64__) || defined(__i386__)
+		#define BLEND_AVX2
+	#endif
+#endif
+
+#if defined(BLEND_AVX2) && !defined(__clang__)
+	// 8-wide vectors are used only inside of the function with avx2 target,
+	// all functions with vector arguments are inlined into it
+	#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+	std::atomic<int> instructions(-1);
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+void
+blend_row_scalar(
+	Color *dest,
+	const Color *src,
+	int src_step,
+	int count,
+	Color::BlendMethod method,
+	ColorReal amount )
+{
+	for(Color *end = dest + count; dest < end; ++dest, src += src_step)
+		*dest = Color::blend(*src, *dest, amount, method);
+}
+
+#ifdef BLEND_VECTORS
+
+template<int N>
+struct VectorTypes;
+
+template<>
+struct VectorTypes<4>
+{
+	typedef float Real __attribute__((vector_size(4*sizeof(float))));
+	typedef int Int __attribute__((vector_size(4*sizeof(int))));
+};
+
+template<>
+struct VectorTypes<8>
+{
+	typedef float Real __attribute__((vector_size(8*sizeof(float))));
+	typedef int Int __attribute__((vector_size(8*sizeof(int))));
+};
+
+//! Pack of N pixels, each channel is stored in separate vector
+template<int N>
+class Pack
+{
+public:
+	typedef typename VectorTypes<N>::Real Real;
+	typedef typename VectorTypes<N>::Int Int;
+
+	Real r, g, b, a;
+
+	static BLEND_INLINE Real splat(float x)
+		{ return Real() + x; }
+	static BLEND_INLINE Real select(const Int &mask, const Real &x, const Real &y)
+		{ return (Real)(((Int)x & mask) | ((Int)y & ~mask)); }
+	static BLEND_INLINE Real abs(const Real &x)
+		{ return (Real)((Int)x & (Int() + 0x7fffffff)); }
+	static BLEND_INLINE Real sqrt(const Real &x)
+		{ Real y; for(int i = 0; i < N; ++i) y[i] = std::sqrt(x[i]); return y; }
+	static BLEND_INLINE bool all(const Int &mask)
+		{ for(int i = 0; i < N; ++i) if (!mask[i]) return false; return true; }
+
+	static BLEND_INLINE Pack select(const Int &mask, const Pack &x, const Pack &y)
+	{
+		Pack p;
+		p.r = select(mask, x.r, y.r);
+		p.g = select(mask, x.g, y.g);
+		p.b = select(mask, x.b, y.b);
+		p.a = select(mask, x.a, y.a);
+		return p;
+	}
+
+	BLEND_INLINE void load(const Color *src, int step, int count)
+	{
+		const ColorReal *s = reinterpret_cast<const ColorReal*>(src);
+		for(int i = 0; i < N; ++i, s += 4*step)
+		{
+			if (i < count)
+				{ r[i] = s[0]; g[i] = s[1]; b[i] = s[2]; a[i] = s[3]; }
+			else
+				{ r[i] = g[i] = b[i] = a[i] = 0.f; }
+		}
+	}
+
+	BLEND_INLINE void store(Color *dest, int count) const
+	{
+		ColorReal *d = reinterpret_cast<ColorReal*>(dest);
+		for(int i = 0; i < N && i < count; ++i, d += 4)
+			{ d[0] = r[i]; d[1] = g[i]; d[2] = b[i]; d[3] = a[i]; }
+	}
+
+	//! Color::operator~()
+	BLEND_INLINE void invert()
+	{
+		const Real one = splat(1.f);
+		r = one - r;
+		g = one - g;
+		b = one - b;
+	}
+
+	BLEND_INLINE Real get_y() const
+		{ return r*splat(EncodeYUV[0][0]) + g*splat(EncodeYUV[0][1]) + b*splat(EncodeYUV[0][2]); }
+	BLEND_INLINE Real get_u() const
+		{ return r*splat(EncodeYUV[1][0]) + g*splat(EncodeYUV[1][1]) + b*splat(EncodeYUV[1][2]); }
+	BLEND_INLINE Real get_v() const
+		{ return r*splat(EncodeYUV[2][0]) + g*splat(EncodeYUV[2][1]) + b*splat(EncodeYUV[2][2]); }
+
+	BLEND_INLINE void set_yuv(const Real &y, const Real &u, const Real &v)
+	{
+		r = y*splat(DecodeYUV[0][0]) + u*splat(DecodeYUV[0][1]) + v*splat(DecodeYUV[0][2]);
+		g = y*splat(DecodeYUV[1][0]) + u*splat(DecodeYUV[1][1]) + v*splat(DecodeYUV[1][2]);
+		b = y*splat(DecodeYUV[2][0]) + u*splat(DecodeYUV[2][1]) + v*splat(DecodeYUV[2][2]);
+	}
+};
+
+//! Vectorized versions of blendfunc_* from color/colorblendingfunctions.h.
+//! Every function keeps order of operations of the original one
+//! to give the same result, b is the destination pixel.
+template<int N>
+class Blender
+{
+public:
+	typedef Pack<N> P;
+	typedef typename P::Real Real;
+	typedef typename P::Int Int;
+
+	static BLEND_INLINE void composite(P a, P &b, float amount)
+	{
+		const Real zero = Real();
+		const Real one = P::splat(1.f);
+		const Real a_src = a.a*P::splat(amount);
+		const Real k = one - a_src;
+		Real a_dest = b.a;
+
+		const Real r = a.r*a_src + b.r*a_dest*k;
+		const Real g = a.g*a_src + b.g*a_dest*k;
+		const Real bb = a.b*a_src + b.b*a_dest*k;
+		a_dest = a_src + a_dest*k;
+
+		const Int mask = P::abs(a_dest) > P::splat(EPSILON);
+		const Real inv = one/a_dest;
+		b.r = P::select(mask, r*inv, zero);
+		b.g = P::select(mask, g*inv, zero);
+		b.b = P::select(mask, bb*inv, zero);
+		b.a = P::select(mask, a_dest, zero);
+	}
+
+	static BLEND_INLINE void straight(const P &a, P &b, float amount)
+	{
+		const Real zero = Real();
+		const Real am = P::splat(amount);
+		const Real a_out = (a.a - b.a)*am + b.a;
+
+		const Int mask = P::abs(a_out) > P::splat(EPSILON);
+		const Real inv = P::splat(1.f)/a_out;
+		b.r = P::select(mask, ((a.r*a.a - b.r*b.a)*am + b.r*b.a)*inv, zero);
+		b.g = P::select(mask, ((a.g*a.a - b.g*b.a)*am + b.g*b.a)*inv, zero);
+		b.b = P::select(mask, ((a.b*a.a - b.b*b.a)*am + b.b*b.a)*inv, zero);
+		b.a = P::select(mask, a_out, zero);
+	}
+
+	static BLEND_INLINE void onto(const P &a, P &b, float amount)
+	{
+		const Real alpha = b.a;
+		b.a = P::splat(1.f);
+		composite(a, b, amount);
+		b.a = alpha;
+	}
+
+	static BLEND_INLINE void straight_onto(P a, P &b, float amount)
+	{
+		a.a = a.a*b.a;
+		straight(a, b, amount);
+	}
+
+	static BLEND_INLINE void brighten(const P &a, P &b, float amount)
+	{
+		const Real alpha = a.a*P::splat(amount);
+		const Real r = a.r*alpha, g = a.g*alpha, bb = a.b*alpha;
+		b.r = P::select(b.r < r, r, b.r);
+		b.g = P::select(b.g < g, g, b.g);
+		b.b = P::select(b.b < bb, bb, b.b);
+	}
+
+	static BLEND_INLINE void darken(const P &a, P &b, float amount)
+	{
+		const Real one = P::splat(1.f);
+		const Real alpha = a.a*P::splat(amount);
+		const Real r = (a.r - one)*alpha + one;
+		const Real g = (a.g - one)*alpha + one;
+		const Real bb = (a.b - one)*alpha + one;
+		b.r = P::select(b.r > r, r, b.r);
+		b.g = P::select(b.g > g, g, b.g);
+		b.b = P::select(b.b > bb, bb, b.b);
+	}
+
+	static BLEND_INLINE void add(const P &a, P &b, float amount)
+	{
+		const Real ba = b.a, aa = a.a*P::splat(amount);
+		b.r = b.r*ba + a.r*aa;
+		b.g = b.g*ba + a.g*aa;
+		b.b = b.b*ba + a.b*aa;
+	}
+
+	static BLEND_INLINE void add_composite(const P &a, P &b, float amount)
+	{
+		const Real zero = Real();
+		const Real one = P::splat(1.f);
+		Real ba = b.a, aa = a.a*P::splat(amount);
+		Real alpha = ba + aa;
+		alpha = P::select(alpha < one, alpha, one);
+		alpha = P::select(zero < alpha, alpha, zero);
+		const Real k = P::select(P::abs(alpha) > P::splat(1e-8f), one/alpha, zero);
+		aa *= k; ba *= k;
+		b.r = b.r*ba + a.r*aa;
+		b.g = b.g*ba + a.g*aa;
+		b.b = b.b*ba + a.b*aa;
+		b.a = alpha;
+	}
+
+	static BLEND_INLINE void subtract(const P &a, P &b, float amount)
+	{
+		const Real ba = b.a, aa = a.a*P::splat(amount);
+		b.r = b.r*ba - a.r*aa;
+		b.g = b.g*ba - a.g*aa;
+		b.b = b.b*ba - a.b*aa;
+	}
+
+	static BLEND_INLINE void difference(const P &a, P &b, float amount)
+	{
+		const Real ba = b.a, aa = a.a*P::splat(amount);
+		b.r = P::abs(b.r*ba - a.r*aa);
+		b.g = P::abs(b.g*ba - a.g*aa);
+		b.b = P::abs(b.b*ba - a.b*aa);
+	}
+
+	static BLEND_INLINE void multiply(P a, P &b, float amount)
+	{
+		if (amount < 0) a.invert(), amount = -amount;
+		const Real am = P::splat(amount)*a.a;
+		b.r = ((b.r*a.r) - b.r)*am + b.r;
+		b.g = ((b.g*a.g) - b.g)*am + b.g;
+		b.b = ((b.b*a.b) - b.b)*am + b.b;
+	}
+
+	static BLEND_INLINE void divide(const P &a, P &b, float amount)
+	{
+		const Real eps = P::splat(EPSILON);
+		const Real am = P::splat(amount)*a.a;
+		b.r = ((b.r/(a.r + eps)) - b.r)*am + b.r;
+		b.g = ((b.g/(a.g + eps)) - b.g)*am + b.g;
+		b.b = ((b.b/(a.b + eps)) - b.b)*am + b.b;
+	}
+
+	//! (temp - b)*amount*a.a + b
+	static BLEND_INLINE void mix(const P &a, P &b, const P &temp, float amount)
+	{
+		const Real am = P::splat(amount);
+		b.r = (temp.r - b.r)*am*a.a + b.r;
+		b.g = (temp.g - b.g)*am*a.a + b.g;
+		b.b = (temp.b - b.b)*am*a.a + b.b;
+		b.a = (temp.a - b.a)*am*a.a + b.a;
+	}
+
+	static BLEND_INLINE void color(const P &a, P &b, float amount)
+	{
+		P temp(b);
+		temp.set_yuv(b.get_y(), a.get_u(), a.get_v());
+		mix(a, b, temp, amount);
+	}
+
+	static BLEND_INLINE void saturation(const P &a, P &b, float amount)
+	{
+		const Real au = a.get_u(), av = a.get_v();
+		const Real x = P::sqrt(au*au + av*av);
+		Real u = b.get_u(), v = b.get_v();
+		const Real s = P::sqrt(u*u + v*v);
+		u = (u/s)*x;
+		v = (v/s)*x;
+
+		P temp(b);
+		temp.set_yuv(b.get_y(), u, v);
+		mix(a, b, P::select(s != Real(), temp, b), amount);
+	}
+
+	static BLEND_INLINE void luminance(const P &a, P &b, float amount)
+	{
+		P temp(b);
+		temp.set_yuv(a.get_y(), b.get_u(), b.get_v());
+		mix(a, b, temp, amount);
+	}
+
+	static BLEND_INLINE void behind(P a, P &b, float amount)
+	{
+		a.a = P::select(a.a == Real(), P::splat(EPSILON*amount), a.a*P::splat(amount));
+		composite(b, a, 1.f);
+		b = a;
+	}
+
+	static BLEND_INLINE void alpha_brighten(P a, P &b, float amount)
+	{
+		const Int mask = a.a < b.a*P::splat(amount);
+		a.a = a.a*P::splat(amount);
+		b = P::select(mask, a, b);
+	}
+
+	static BLEND_INLINE void alpha_darken(P a, P &b, float amount)
+	{
+		a.a = a.a*P::splat(amount);
+		b = P::select(a.a > b.a, a, b);
+	}
+
+	static BLEND_INLINE void screen(P a, P &b, float amount)
+	{
+		const Real one = P::splat(1.f);
+		if (amount < 0) a.invert(), amount = -amount;
+		a.r = one - (one - a.r)*(one - b.r);
+		a.g = one - (one - a.g)*(one - b.g);
+		a.b = one - (one - a.b)*(one - b.b);
+		onto(a, b, amount);
+	}
+
+	static BLEND_INLINE void overlay(P a, P &b, float amount)
+	{
+		const Real one = P::splat(1.f);
+		if (amount < 0) a.invert(), amount = -amount;
+		a.r = a.r*(one - (one - a.r)*(one - b.r)) + (one - a.r)*(b.r*a.r);
+		a.g = a.g*(one - (one - a.g)*(one - b.g)) + (one - a.g)*(b.g*a.g);
+		a.b = a.b*(one - (one - a.b)*(one - b.b)) + (one - a.b)*(b.b*a.b);
+		onto(a, b, amount);
+	}
+
+	static BLEND_INLINE Real hard_light_channel(const Real &a, const Real &b)
+	{
+		const Real one = P::splat(1.f);
+		const Real a2 = a*P::splat(2.f);
+		return P::select(a > P::splat(0.5f), one - (one - (a2 - one))*(one - b), b*a2);
+	}
+
+	static BLEND_INLINE void hard_light(P a, P &b, float amount)
+	{
+		if (amount < 0) a.invert(), amount = -amount;
+		a.r = hard_light_channel(a.r, b.r);
+		a.g = hard_light_channel(a.g, b.g);
+		a.b = hard_light_channel(a.b, b.b);
+		onto(a, b, amount);
+	}
+
+	static BLEND_INLINE void alpha(const P &a, P &b, float amount)
+	{
+		P rm(b);
+		rm.a = a.a*b.a;
+		straight(rm, b, amount);
+	}
+
+	static BLEND_INLINE void alpha_over(const P &a, P &b, float amount)
+	{
+		P rm(b);
+		rm.a = (P::splat(1.f) - a.a)*b.a;
+		straight(rm, b, amount);
+	}
+
+	static BLEND_INLINE void blend(int method, const P &a, P &b, float amount)
+	{
+		switch(method)
+		{
+		case Color::BLEND_COMPOSITE:      composite(a, b, amount); break;
+		case Color::BLEND_STRAIGHT:       straight(a, b, amount); break;
+		case Color::BLEND_ONTO:           onto(a, b, amount); break;
+		case Color::BLEND_STRAIGHT_ONTO:  straight_onto(a, b, amount); break;
+		case Color::BLEND_BEHIND:         behind(a, b, amount); break;
+		case Color::BLEND_SCREEN:         screen(a, b, amount); break;
+		case Color::BLEND_OVERLAY:        overlay(a, b, amount); break;
+		case Color::BLEND_HARD_LIGHT:     hard_light(a, b, amount); break;
+		case Color::BLEND_MULTIPLY:       multiply(a, b, amount); break;
+		case Color::BLEND_DIVIDE:         divide(a, b, amount); break;
+		case Color::BLEND_ADD:            add(a, b, amount); break;
+		case Color::BLEND_ADD_COMPOSITE:  add_composite(a, b, amount); break;
+		case Color::BLEND_SUBTRACT:       subtract(a, b, amount); break;
+		case Color::BLEND_DIFFERENCE:     difference(a, b, amount); break;
+		case Color::BLEND_BRIGHTEN:       brighten(a, b, amount); break;
+		case Color::BLEND_DARKEN:         darken(a, b, amount); break;
+		case Color::BLEND_COLOR:          color(a, b, amount); break;
+		case Color::BLEND_SATURATION:     saturation(a, b, amount); break;
+		case Color::BLEND_LUMINANCE:      luminance(a, b, amount); break;
+		case Color::BLEND_ALPHA_BRIGHTEN: alpha_brighten(a, b, amount); break;
+		case Color::BLEND_ALPHA_DARKEN:   alpha_darken(a, b, amount); break;
+		case Color::BLEND_ALPHA_OVER:     alpha_over(a, b, amount); break;
+		case Color::BLEND_ALPHA:          alpha(a, b, amount); break;
+		default: break;
+		}
+	}
+
+	//! Method is a template parameter to build the separate loop for each blend method
+	template<int Method>
+	static BLEND_INLINE void blend_row(
+		Color *dest, const Color *src, int src_step, int count, float amount )
+	{
+		// opaque source replaces rgb of destination when amount is 1,
+		// it's exactly what composite() gives in that case
+		const bool copy_opaque = amount == 1.f
+		                      && (Method == Color::BLEND_COMPOSITE || Method == Color::BLEND_ONTO);
+		const Real one = P::splat(1.f);
+
+		P a, b;
+		if (!src_step) a.load(src, 0, N);
+		for(int i = 0; i < count; i += N, dest += N, src += N*src_step)
+		{
+			const int n = std::min(N, count - i);
+			if (src_step) a.load(src, 1, n);
+			b.load(dest, 1, n);
+			if (copy_opaque && P::all(a.a == one))
+			{
+				b.r = a.r;
+				b.g = a.g;
+				b.b = a.b;
+				if (Method == Color::BLEND_COMPOSITE) b.a = one;
+			}
+			else
+			{
+				blend(Method, a, b, amount);
+			}
+			b.store(dest, n);
+		}
+	}
+
+	static BLEND_INLINE void blend_row(
+		Color *dest, const Color *src, int src_step, int count, Color::BlendMethod method, float amount )
+	{
+		#define BLEND_CASE(m) \
+			case Color::m: blend_row<Color::m>(dest, src, src_step, count, amount); break;
+		switch(method)
+		{
+		BLEND_CASE(BLEND_COMPOSITE)
+		BLEND_CASE(BLEND_STRAIGHT)
+		BLEND_CASE(BLEND_ONTO)
+		BLEND_CASE(BLEND_STRAIGHT_ONTO)
+		BLEND_CASE(BLEND_BEHIND)
+		BLEND_CASE(BLEND_SCREEN)
+		BLEND_CASE(BLEND_OVERLAY)
+		BLEND_CASE(BLEND_HARD_LIGHT)
+		BLEND_CASE(BLEND_MULTIPLY)
+		BLEND_CASE(BLEND_DIVIDE)
+		BLEND_CASE(BLEND_ADD)
+		BLEND_CASE(BLEND_ADD_COMPOSITE)
+		BLEND_CASE(BLEND_SUBTRACT)
+		BLEND_CASE(BLEND_DIFFERENCE)
+		BLEND_CASE(BLEND_BRIGHTEN)
+		BLEND_CASE(BLEND_DARKEN)
+		BLEND_CASE(BLEND_COLOR)
+		BLEND_CASE(BLEND_SATURATION)
+		BLEND_CASE(BLEND_LUMINANCE)
+		BLEND_CASE(BLEND_ALPHA_BRIGHTEN)
+		BLEND_CASE(BLEND_ALPHA_DARKEN)
+		BLEND_CASE(BLEND_ALPHA_OVER)
+		BLEND_CASE(BLEND_ALPHA)
+		default:
+			// BLEND_HUE needs trigonometry for each pixel
+			blend_row_scalar(dest, src, src_step, count, method, amount);
+			break;
+		}
+		#undef BLEND_CASE
+	}
+};
+
+void
+blend_row_vector4(
+	Color *dest, const Color *src, int src_step, int count, Color::BlendMethod method, ColorReal amount )
+{
+	Blender<4>::blend_row(dest, src, src_step, count, method, amount);
+}
+
+#ifdef BLEND_AVX2
+__attribute__((target("avx2")))
+void
+blend_row_vector8(
+	Color *dest, const Color *src, int src_step, int count, Color::BlendMethod method, ColorReal amount )
+{
+	Blender<8>::blend_row(dest, src, src_step, count, method, amount);
+}
+#endif
+
+#endif // BLEND_VECTORS
+
+void
+blend_row(
+	Color *dest,
+	const Color *src,
+	int src_step,
+	int count,
+	Color::BlendMethod method,
+	ColorReal amount )
+{
+	// see Color::blend()
+	if (count <= 0 || std::fabs(amount) <= EPSILON)
+		return;
+
+	switch(software::Blend::get_instructions())
+	{
+	#ifdef BLEND_AVX2
+	case software::Blend::INSTRUCTIONS_VECTOR8:
+		blend_row_vector8(dest, src, src_step, count, method, amount);
+		break;
+	#endif
+	#ifdef BLEND_VECTORS
+	case software::Blend::INSTRUCTIONS_VECTOR4:
+		blend_row_vector4(dest, src, src_step, count, method, amount);
+		break;
+	#endif
+	default:
+		blend_row_scalar(dest, src, src_step, count, method, amount);
+		break;
+	}
+}
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+software::Blend::Instructions
+software::Blend::get_supported_instructions()
+{
+	#ifdef BLEND_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return INSTRUCTIONS_VECTOR8;
+	#endif
+	#ifdef BLEND_VECTORS
+	return INSTRUCTIONS_VECTOR4;
+	#else
+	return INSTRUCTIONS_SCALAR;
+	#endif
+}
+
+software::Blend::Instructions
+software::Blend::get_instructions()
+{
+	int i = instructions;
+	if (i < 0)
+		instructions = i = get_supported_instructions();
+	return (Instructions)i;
+}
+
+void
+software::Blend::set_instructions(Instructions x)
+	{ instructions = std::min(x, get_supported_instructions()); }
+
+void
+software::Blend::blend(
+	Color *dest,
+	const Color *src,
+	int count,
+	Color::BlendMethod method,
+	ColorReal amount )
+{
+	blend_row(dest, src, 1, count, method, amount);
+}
+
+void
+software::Blend::fill(
+	Color *dest,
+	const Color &color,
+	int count,
+	Color::BlendMethod method,
+	ColorReal amount )
+{
+	blend_row(dest, &color, 0, count, method, amount);
+}
+
+void
+software::Blend::blend(
+	synfig::Surface &dest,
+	const RectInt &dest_rect,
+	const synfig::Surface &src,
+	const VectorInt &src_offset,
+	Color::BlendMethod method,
+	ColorReal amount )
+{
+	if (!dest_rect.is_valid())
+		return;
+
+	assert( 0 <= dest_rect.minx && dest_rect.maxx <= dest.get_w()
+		 && 0 <= dest_rect.miny && dest_rect.maxy <= dest.get_h() );
+	assert( 0 <= src_offset[0] && src_offset[0] + dest_rect.get_width() <= src.get_w()
+		 && 0 <= src_offset[1] && src_offset[1] + dest_rect.get_height() <= src.get_h() );
+
+	const int w = dest_rect.get_width();
+	const bool copy = method == Color::BLEND_STRAIGHT
+	               && std::fabs(amount - 1.f) < STRAIGHT_COPY_EPSILON;
+	for(int y = dest_rect.miny; y < dest_rect.maxy; ++y)
+	{
+		Color *d = &dest[y][dest_rect.minx];
+		const Color *s = &src[y - dest_rect.miny + src_offset[1]][src_offset[0]];
+		if (copy)
+			memcpy(d, s, w*sizeof(Color));
+		else
+			blend_row(d, s, 1, w, method, amount);
+	}
+}
+
+void
+software::Blend::fill(
+	synfig::Surface &dest,
+	const RectInt &dest_rect,
+	const Color &color,
+	Color::BlendMethod method,
+	ColorReal amount )
+{
+	if (!dest_rect.is_valid())
+		return;
+
+	assert( 0 <= dest_rect.minx && dest_rect.maxx <= dest.get_w()
+		 && 0 <= dest_rect.miny && dest_rect.maxy <= dest.get_h() );
+
+	const int w = dest_rect.get_width();
+	for(int y = dest_rect.miny; y < dest_rect.maxy; ++y)
+		blend_row(&dest[y][dest_rect.minx], &color, 0, w, method, amount);
+}
+
+/* === E N T R Y P O I N T ================================================= */
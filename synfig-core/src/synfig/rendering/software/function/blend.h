@@ -0,0 +1,107 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/blend.h
+**	\brief Blend Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_BLEND_H
+#define __SYNFIG_RENDERING_SOFTWARE_BLEND_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/color.h>
+#include <synfig/rect.h>
+#include <synfig/surface.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+//! Blends rows of pixels, gives the same result as Color::blend() for each pixel.
+//! Pixels are processed by packs of 4 or 8 (SSE2 or AVX2 on x86)
+//! when compiler supports vector extensions, instructions are selected at runtime.
+class Blend
+{
+public:
+	enum Instructions {
+		INSTRUCTIONS_SCALAR = 0, //!< Color::blend() for each pixel
+		INSTRUCTIONS_VECTOR4,    //!< 4 pixels per iteration (SSE2 on x86)
+		INSTRUCTIONS_VECTOR8     //!< 8 pixels per iteration (AVX2 on x86)
+	};
+
+	//! Returns the best instructions supported by both of build and CPU
+	static Instructions get_supported_instructions();
+	//! Returns instructions used by blend functions
+	static Instructions get_instructions();
+	//! Selects instructions (used by tests and benchmarks),
+	//! unsupported instructions are replaced by the best supported ones
+	static void set_instructions(Instructions instructions);
+
+	//! dest[i] = Color::blend(src[i], dest[i], amount, method)
+	static void blend(
+		Color *dest,
+		const Color *src,
+		int count,
+		Color::BlendMethod method,
+		ColorReal amount );
+
+	//! dest[i] = Color::blend(color, dest[i], amount, method)
+	static void fill(
+		Color *dest,
+		const Color &color,
+		int count,
+		Color::BlendMethod method,
+		ColorReal amount );
+
+	//! Blends pixels of src starting from src_offset into dest_rect of dest
+	static void blend(
+		synfig::Surface &dest,
+		const RectInt &dest_rect,
+		const synfig::Surface &src,
+		const VectorInt &src_offset,
+		Color::BlendMethod method,
+		ColorReal amount );
+
+	//! Blends color into dest_rect of dest
+	static void fill(
+		synfig::Surface &dest,
+		const RectInt &dest_rect,
+		const Color &color,
+		Color::BlendMethod method,
+		ColorReal amount );
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
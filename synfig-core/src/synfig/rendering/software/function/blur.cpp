@@ -154,6 +154,28 @@ software::Blur::get_extra_size(
 	return VectorInt( (int)ceil(fabs(s[0]) + 1.0 - precision), (int)ceil(fabs(s[1]) + 1.0 - precision) );
 }
 
+bool
+software::Blur::is_pattern_used(
+	rendering::Blur::Type type,
+	const VectorInt &extra_size )
+{
+	if ( type == rendering::Blur::DISC
+      && fabs(extra_size[0]) < 8
+      && fabs(extra_size[1]) < 8 )
+		return true;
+
+	if ( type == rendering::Blur::DISC
+      && (extra_size[0] + 1)*(extra_size[1] + 1) < 64.0 )
+		return true;
+
+	if ( type == rendering::Blur::GAUSSIAN
+	  && extra_size[0] < 32
+	  && extra_size[1] < 32 )
+		return true;
+
+	return false;
+}
+
 void
 software::Blur::blur_pattern(const Params &params)
 {
@@ -283,7 +305,7 @@ software::Blur::blur_pattern(const Params &params)
 
 		for(Array<ColorReal, 3>::Iterator src_channel(arr_src_surface_cols), dst_channel(arr_dst_surface_cols); dst_channel; ++src_channel, ++dst_channel)
 			for(Array<ColorReal, 2>::Iterator sr(*src_channel), dr(*dst_channel); dr; ++sr, ++dr)
-				BlurTemplates::blur_pattern(*dr, *sr, arr_row_pattern);
+				BlurTemplates::blur_pattern(*dr, *sr, arr_col_pattern);
 	}
 
 	// copy result surface and restore alpha
@@ -715,18 +737,7 @@ software::Blur::blur(Params params)
 	  || params.type == rendering::Blur::CROSS )
 		{ blur_box(params); return; }
 
-	if ( params.type == rendering::Blur::DISC
-      && fabs(params.extra_size[0]) < 8
-      && fabs(params.extra_size[1]) < 8 )
-		{ blur_pattern(params); return; }
-
-	if ( params.type == rendering::Blur::DISC
-      && (params.extra_size[0] + 1)*(params.extra_size[1] + 1) < 64.0 )
-		{ blur_pattern(params); return; }
-
-	if ( params.type == rendering::Blur::GAUSSIAN
-	  && params.extra_size[0] < 32
-	  && params.extra_size[1] < 32 )
+	if (is_pattern_used(params.type, params.extra_size))
 		{ blur_pattern(params); return; }
 
 	if ( params.type == rendering::Blur::FASTGAUSSIAN )
@@ -106,6 +106,10 @@ public:
 	static Real get_extra_size(rendering::Blur::Type type);
 	static VectorInt get_extra_size(rendering::Blur::Type type, const Vector &size);
 
+	//! Blur by pattern calculates each pixel independently,
+	//! so result does not depend on the size of destination rect
+	static bool is_pattern_used(rendering::Blur::Type type, const VectorInt &extra_size);
+
 private:
 	static constexpr Real iir_min_radius = 1.0;
 	static constexpr Real iir_max_radius = 2048.0;
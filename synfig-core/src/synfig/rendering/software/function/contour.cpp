@@ -29,7 +29,13 @@
 #	include <config.h>
 #endif
 
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
 #include "contour.h"
+#include "blend.h"
 
 #include <synfig/debug/debugsurface.h>
 
@@ -40,10 +46,163 @@ using namespace rendering;
 
 /* === M A C R O S ========================================================= */
 
+#ifdef __GNUC__
+	// GCC and Clang vector extensions
+	#define CONTOUR_VECTORS
+#endif
+
+// size of block of pixels in row buffer of bucketed rasterizer
+#define BLOCK_SIZE 32
+
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+#ifdef CONTOUR_VECTORS
+typedef Real RealVector __attribute__((vector_size(2*sizeof(Real))));
+typedef long long IntVector __attribute__((vector_size(2*sizeof(long long))));
+const int vector_size = sizeof(RealVector)/sizeof(Real);
+
+inline RealVector
+select(const IntVector &mask, const RealVector &x, const RealVector &y)
+	{ return (RealVector)(((IntVector)x & mask) | ((IntVector)y & ~mask)); }
+
+inline RealVector
+abs(const RealVector &x)
+	{ return (RealVector)((IntVector)x & (IntVector() + 0x7fffffffffffffffll)); }
+#endif
+
+// the same as Polyspan::extract_alpha(), but without loops
+template<bool even_odd>
+inline Real
+extract_alpha(Real area)
+{
+	area = std::fabs(area);
+	return even_odd
+		 ? std::fabs(area - 2*Real((long long)(0.5*area + 0.5)))
+		 : std::min(area, Real(1));
+}
+
+// alpha of pixels with the same meaning as in software::Contour::render_polyspan():
+// pixels with area are antialiased, other pixels are fully filled or skipped.
+// Cover and area are cleared for the next row.
+template<bool even_odd>
+void
+calc_alpha(ColorReal *alpha, Real *cover, Real *area, int count, bool invert, bool antialias)
+{
+	const Real k0 = invert ? 1 : 0;
+	const Real k1 = invert ? -1 : 1;
+	int i = 0;
+
+#ifdef CONTOUR_VECTORS
+	const RealVector zero = RealVector();
+	const RealVector half = zero + 0.5;
+	const RealVector one = zero + 1.0;
+	const IntVector smooth_mask = IntVector() + (antialias ? -1ll : 0ll);
+	for(; i + vector_size <= count; i += vector_size)
+	{
+		RealVector c, s;
+		memcpy(&c, cover + i, sizeof(c));
+		memcpy(&s, area + i, sizeof(s));
+
+		RealVector a = abs(c - s);
+		if (even_odd)
+		{
+			RealVector r;
+			for(int j = 0; j < vector_size; ++j)
+				r[j] = Real((long long)(0.5*a[j] + 0.5));
+			a = abs(a - 2*r);
+		}
+		else
+		{
+			a = select(a < one, a, one);
+		}
+		a = k0 + k1*a;
+
+		const RealVector filled = select(a >= half, one, zero);
+		a = select(smooth_mask & (s != zero), a, filled);
+		for(int j = 0; j < vector_size; ++j)
+			alpha[i + j] = ColorReal(a[j]);
+
+		memset(cover + i, 0, sizeof(c));
+		memset(area + i, 0, sizeof(s));
+	}
+#endif
+
+	for(; i < count; ++i)
+	{
+		const Real a = k0 + k1*extract_alpha<even_odd>(cover[i] - area[i]);
+		const Real filled = a >= 0.5 ? 1 : 0;
+		const bool smooth = antialias & (area[i] != 0);
+		alpha[i] = ColorReal(smooth ? a : filled);
+		cover[i] = 0;
+		area[i] = 0;
+	}
+}
+
+inline ColorReal
+calc_alpha(Real cover, bool even_odd, bool invert, bool antialias)
+{
+	Real area = 0;
+	ColorReal alpha;
+	if (even_odd)
+		calc_alpha<true>(&alpha, &cover, &area, 1, invert, antialias);
+	else
+		calc_alpha<false>(&alpha, &cover, &area, 1, invert, antialias);
+	return alpha;
+}
+
+// draws spans of pixels, merges adjacent spans with the same alpha
+class SpanWriter
+{
+private:
+	Color *row;
+	int begin, end;
+	ColorReal alpha;
+	const bool simple_fill;
+	const Color &color;
+	const Color::value_type opacity;
+	const Color::BlendMethod blend_method;
+
+public:
+	SpanWriter(bool simple_fill, const Color &color, Color::value_type opacity, Color::BlendMethod blend_method):
+		row(), begin(), end(), alpha(),
+		simple_fill(simple_fill), color(color), opacity(opacity), blend_method(blend_method) { }
+
+	void flush()
+	{
+		if (alpha == 1)
+		{
+			if (simple_fill)
+				std::fill(row + begin, row + end, color);
+			else
+				software::Blend::fill(row + begin, color, end - begin, blend_method, opacity);
+		}
+		else
+		if (alpha)
+		{
+			for(Color *c = row + begin; c < row + end; ++c)
+				*c = Color::blend(color, *c, opacity*alpha, blend_method);
+		}
+		begin = end;
+	}
+
+	void set_row(Color *row)
+		{ flush(); this->row = row; begin = end = 0; }
+
+	void put(int x0, int x1, ColorReal alpha)
+	{
+		if (x0 >= x1) return;
+		if (alpha != this->alpha || x0 != end)
+			{ flush(); begin = x0; this->alpha = alpha; }
+		end = x1;
+	}
+};
+
+} // end of anonymous namespace
+
 /* === M E T H O D S ======================================================= */
 
 void
@@ -260,6 +419,118 @@ software::Contour::render_polyspan(
 	}
 }
 
+void
+software::Contour::render_polyspan_bucketed(
+	synfig::Surface &target_surface,
+	const Polyspan &polyspan,
+	int miny,
+	int maxy,
+	bool invert,
+	bool antialias,
+	rendering::Contour::WindingStyle winding_style,
+	const Color &color,
+	Color::value_type opacity,
+	Color::BlendMethod blend_method )
+{
+	RectInt rect = polyspan.get_window();
+	rect.miny = std::max(rect.miny, miny);
+	rect.maxy = std::min(rect.maxy, maxy);
+	rect_set_intersect(rect, rect, RectInt(0, 0, target_surface.get_w(), target_surface.get_h()));
+	if (!rect.is_valid())
+		return;
+
+	const bool simple_fill = (Color::BLEND_METHODS_OVERWRITE_ON_ALPHA_ONE & (1 << blend_method))
+			              && fabsf(1.f - opacity*color.get_a()) <= 1e-6;
+	const bool even_odd = winding_style == rendering::Contour::WINDING_EVEN_ODD;
+	const int width = rect.maxx - rect.minx;
+	const int height = rect.maxy - rect.miny;
+
+	// collect marks into rows,
+	// marks of row y will be in range [rows[y], rows[y+1]) in the same order as in polyspan
+	const Polyspan::cover_array &covers = polyspan.get_covers();
+	std::vector<int> rows(height + 2, 0);
+	for(Polyspan::cover_array::const_iterator i = covers.begin(); i != covers.end(); ++i)
+		if (i->y >= rect.miny && i->y < rect.maxy)
+			++rows[i->y - rect.miny + 2];
+	for(int y = 2; y < height + 2; ++y)
+		rows[y] += rows[y - 1];
+	std::vector<const Polyspan::PenMark*> marks(rows[height + 1]);
+	for(Polyspan::cover_array::const_iterator i = covers.begin(); i != covers.end(); ++i)
+		if (i->y >= rect.miny && i->y < rect.maxy)
+			marks[ rows[i->y - rect.miny + 1]++ ] = &*i;
+
+	// marks are accumulated in dense buffers,
+	// blocks of buffers without marks are skipped
+	std::vector<Real> cover(width, 0.0), area(width, 0.0);
+	std::vector<ColorReal> alpha(BLOCK_SIZE);
+	std::vector<bool> blocks((width + BLOCK_SIZE - 1)/BLOCK_SIZE, false);
+	SpanWriter writer(simple_fill, color, opacity, blend_method);
+
+	for(int y = 0; y < height; ++y)
+	{
+		const int begin = rows[y], end = rows[y + 1];
+		if (begin == end && !invert)
+			continue;
+
+		// accumulate marks of row in buffer
+		Real sum = 0;
+		int x0 = width, x1 = 0;
+		for(int j = begin; j < end; ++j)
+		{
+			const Polyspan::PenMark &mark = *marks[j];
+			const int x = mark.x - rect.minx;
+			if (x < 0)
+				{ sum += mark.cover; continue; }
+			if (x >= width)
+				continue;
+			cover[x] += mark.cover;
+			area[x] += mark.area;
+			blocks[x/BLOCK_SIZE] = true;
+			x0 = std::min(x0, x);
+			x1 = std::max(x1, x + 1);
+		}
+		if (x0 > x1)
+			x0 = x1 = 0;
+
+		writer.set_row(&target_surface[rect.miny + y][rect.minx]);
+		writer.put(0, x0, calc_alpha(sum, even_odd, invert, antialias));
+
+		for(int x = x0; x < x1; )
+		{
+			const int block = x/BLOCK_SIZE;
+			const int block_end = std::min((block + 1)*BLOCK_SIZE, x1);
+
+			if (!blocks[block])
+			{
+				// no marks, so all pixels of block have the same alpha
+				writer.put(x, block_end, calc_alpha(sum, even_odd, invert, antialias));
+				x = block_end;
+				continue;
+			}
+			blocks[block] = false;
+
+			// sum of covers from the beginning of row,
+			// this loop cannot be parallelized, so keep it as simple as possible
+			for(int i = x; i < block_end; ++i)
+				cover[i] = (sum += cover[i]);
+
+			// calculate alpha and clear buffer for the next row
+			const int count = block_end - x;
+			if (even_odd)
+				calc_alpha<true>(&alpha[0], &cover[x], &area[x], count, invert, antialias);
+			else
+				calc_alpha<false>(&alpha[0], &cover[x], &area[x], count, invert, antialias);
+
+			for(int i = 0; i < count; ++i)
+				writer.put(x + i, x + i + 1, alpha[i]);
+			x = block_end;
+		}
+
+		writer.put(x1, width, calc_alpha(sum, even_odd, invert, antialias));
+	}
+	writer.flush();
+}
+
 void
 software::Contour::build_polyspan(
 	const rendering::Contour::ChunkList &chunks,
@@ -58,6 +58,22 @@ public:
 		Color::value_type opacity,
 		Color::BlendMethod blend_method );
 
+	//! Renders rows [miny, maxy) of polyspan without sorting of marks.
+	//! Marks are collected into rows and accumulated in row buffer,
+	//! so each row may be rendered independently, marks should be flushed
+	//! by Polyspan::flush_marks() or sorted before call.
+	static void render_polyspan_bucketed(
+		synfig::Surface &target_surface,
+		const Polyspan &polyspan,
+		int miny,
+		int maxy,
+		bool invert,
+		bool antialias,
+		rendering::Contour::WindingStyle winding_style,
+		const Color &color,
+		Color::value_type opacity,
+		Color::BlendMethod blend_method );
+
 	static void build_polyspan(
 		const rendering::Contour::ChunkList &chunks,
 		const Matrix &transform_matrix,
@@ -0,0 +1,553 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/gradientfill.cpp
+**	\brief GradientFill
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cassert>
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <synfig/angle.h>
+
+#include "gradientfill.h"
+#include "blend.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#ifdef __GNUC__
+	// GCC and Clang vector extensions
+	#define GRADIENT_VECTORS
+	#define GRADIENT_INLINE inline __attribute__((always_inline))
+	#if defined(__x86_64__) || defined(__i386__)
+		#define GRADIENT_AVX2
+	#endif
+#endif
+
+#if defined(GRADIENT_AVX2) && !defined(__clang__)
+	// 8-wide vectors are used only inside of the function with avx2 target,
+	// all functions with vector arguments are inlined into it
+	#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+	const Real turn = Real(2*PI);
+
+	// see CompiledGradient::average()
+	const float min_width = 1e-5f;
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+//! Pixel coordinates of the row start in shape space and steps along x and y
+class Row
+{
+public:
+	Vector origin;
+	Vector dx;
+	Real px, py; //!< pixel size in shape space
+
+	Row(const software::GradientFill::Params &params, int x, int y):
+		origin(params.matrix.get_transformed(Vector(x, y))),
+		dx(params.matrix.axis_x()),
+		px(params.matrix.axis_x().mag()),
+		py(params.matrix.axis_y().mag())
+		{ }
+};
+
+//! Gradient position and pixel size in gradient units,
+//! repeats color_func() and calc_supersample() of the gradient layers
+void
+calc_position(const software::GradientFill::Params &params, const Row &row, const Vector &p, Real &t, Real &size)
+{
+	switch(params.shape) {
+	case software::GradientFill::SHAPE_LINEAR:
+		t = p[0];
+		size = row.px;
+		break;
+	case software::GradientFill::SHAPE_RADIAL:
+		t = p.mag();
+		size = 1.2*row.px;
+		break;
+	case software::GradientFill::SHAPE_CONICAL: {
+		Real a = std::atan2(-p[1], p[0])/turn + params.angle;
+		t = a - std::floor(a);
+		size = std::fabs(p[0]) < 0.5*row.px && std::fabs(p[1]) < 0.5*row.py
+		     ? 0.5 : row.px/(p.mag()*turn);
+		break;
+	}
+	case software::GradientFill::SHAPE_SPIRAL: {
+		Real a = std::atan2(-p[1], p[0])/turn + params.angle;
+		a -= std::floor(a);
+		Real r = p.mag();
+		t = params.clockwise ? r + a : r - a;
+		size = std::max(Real(0.00001), (1.41421*row.px + 1.41421*row.px/(r*turn))*0.5);
+		break;
+	}
+	}
+}
+
+void
+fill_row_scalar(
+	Color *dest,
+	int count,
+	const CompiledGradient &gradient,
+	const software::GradientFill::Params &params,
+	const Row &row )
+{
+	Real t, size;
+	for(int i = 0; i < count; ++i) {
+		calc_position(params, row, row.origin + row.dx*(Real)i, t, size);
+		size *= 0.5;
+		dest[i] = gradient.average(t - size, t + size);
+	}
+}
+
+#ifdef GRADIENT_VECTORS
+
+//! Entries of CompiledGradient in float precision for vector paths
+class Table
+{
+public:
+	struct Entry {
+		float prev_pos;
+		float next_pos;
+		float prev_sum[4];
+		float prev_color[4];
+		float prev_k1[4];
+		float prev_k2[4];
+		float next_sum[4];
+		float next_color[4];
+	};
+
+	std::vector<Entry> entries;
+	std::vector<int> index;
+	bool repeat;
+	float summary[4];
+	Color average;
+
+	static void copy(float *dest, const CompiledGradient::Accumulator &src)
+		{ for(int i = 0; i < 4; ++i) dest[i] = (float)src.values[i]; }
+
+	explicit Table(const CompiledGradient &gradient):
+		repeat(gradient.get_repeat()),
+		average(gradient.average())
+	{
+		const CompiledGradient::List &list = gradient.get_list();
+		entries.resize(list.size());
+		for(int i = 0; i < (int)list.size(); ++i) {
+			const CompiledGradient::Entry &src = list[i];
+			Entry &e = entries[i];
+			e.prev_pos = (float)src.prev_pos;
+			e.next_pos = (float)src.next_pos;
+			copy(e.prev_sum, src.prev_sum);
+			copy(e.prev_color, src.prev_color);
+			copy(e.prev_k1, src.prev_k1);
+			copy(e.prev_k2, src.prev_k2);
+			copy(e.next_sum, src.next_sum);
+			copy(e.next_color, src.next_color);
+		}
+		copy(summary, gradient.summary());
+
+		index.resize(CompiledGradient::index_size + 1);
+		for(int i = 0; i <= CompiledGradient::index_size; ++i)
+			index[i] = (int)(gradient.find((Real)i/CompiledGradient::index_size) - list.begin());
+	}
+
+	//! Small tables are searched by comparison with each entry
+	bool is_small() const
+		{ return entries.size() <= 8; }
+
+	//! see CompiledGradient::find()
+	GRADIENT_INLINE int find(float x) const {
+		float cell = x*(float)CompiledGradient::index_size;
+		int i = index[ cell >= 0.f ? (cell < (float)CompiledGradient::index_size ? (int)cell : CompiledGradient::index_size) : 0 ];
+		int last = (int)entries.size() - 1;
+		while(i > 0 && !(entries[i - 1].next_pos < x)) --i;
+		while(i < last && entries[i].next_pos < x) ++i;
+		return i;
+	}
+};
+
+template<int N>
+struct VectorTypes;
+
+template<>
+struct VectorTypes<4>
+{
+	typedef float Real __attribute__((vector_size(4*sizeof(float))));
+	typedef int Int __attribute__((vector_size(4*sizeof(int))));
+};
+
+template<>
+struct VectorTypes<8>
+{
+	typedef float Real __attribute__((vector_size(8*sizeof(float))));
+	typedef int Int __attribute__((vector_size(8*sizeof(int))));
+};
+
+template<int N>
+class Filler
+{
+public:
+	typedef typename VectorTypes<N>::Real Real;
+	typedef typename VectorTypes<N>::Int Int;
+
+	//! Fields of table entries, gathered for each lane
+	struct Fields {
+		Real prev_pos, next_pos;
+		Real prev_sum[4], prev_color[4], prev_k1[4], prev_k2[4], next_sum[4], next_color[4];
+	};
+
+	static GRADIENT_INLINE Real splat(float x)
+		{ return Real() + x; }
+	static GRADIENT_INLINE Real select(const Int &mask, const Real &x, const Real &y)
+		{ return (Real)(((Int)x & mask) | ((Int)y & ~mask)); }
+	static GRADIENT_INLINE Real abs(const Real &x)
+		{ return (Real)((Int)x & (Int() + 0x7fffffff)); }
+	static GRADIENT_INLINE Real sqrt(const Real &x)
+		{ Real y; for(int i = 0; i < N; ++i) y[i] = std::sqrt(x[i]); return y; }
+	static GRADIENT_INLINE Real floor(const Real &x)
+	{
+		// valid while |x| < 2^31, larger floats have no fractional part
+		const Real big = splat(2147483648.f);
+		Real y = __builtin_convertvector(__builtin_convertvector(x, Int), Real);
+		y -= select(y > x, splat(1.f), Real());
+		return select(abs(x) < big, y, x);
+	}
+
+	//! Abramowitz and Stegun 4.4.49, error is less than 2e-8 for |x| <= 1
+	static GRADIENT_INLINE Real atan_unit(const Real &x)
+	{
+		const Real x2 = x*x;
+		Real s = splat(0.0028662257f);
+		s = s*x2 + splat(-0.0161657367f);
+		s = s*x2 + splat(0.0429096138f);
+		s = s*x2 + splat(-0.0752896400f);
+		s = s*x2 + splat(0.1065626393f);
+		s = s*x2 + splat(-0.1420889944f);
+		s = s*x2 + splat(0.1999355085f);
+		s = s*x2 + splat(-0.3333314528f);
+		s = s*x2 + splat(1.f);
+		return s*x;
+	}
+
+	static GRADIENT_INLINE Real atan2(const Real &y, const Real &x)
+	{
+		const Real ax = abs(x), ay = abs(y);
+		const Int swap = ay > ax;
+		const Real num = select(swap, ax, ay);
+		const Real den = select(swap, ay, ax);
+		Real a = atan_unit(select(den > Real(), num/den, Real()));
+		a = select(swap, splat((float)(PI/2)) - a, a);
+		a = select(x < Real(), splat((float)PI) - a, a);
+		return select(y < Real(), -a, a);
+	}
+
+	//! Entry index for each lane, see CompiledGradient::find()
+	static GRADIENT_INLINE Int find(const Table &table, const Real &x)
+	{
+		Int e;
+		if (table.is_small()) {
+			// count entries before x, it's the same as std::lower_bound()
+			e = Int();
+			for(int k = 0, last = (int)table.entries.size() - 1; k < last; ++k)
+				e -= splat(table.entries[k].next_pos) < x;
+		} else {
+			for(int i = 0; i < N; ++i)
+				e[i] = table.find(x[i]);
+		}
+		return e;
+	}
+
+	static GRADIENT_INLINE void set(Fields &f, const Table::Entry &entry)
+	{
+		f.prev_pos = splat(entry.prev_pos);
+		f.next_pos = splat(entry.next_pos);
+		for(int j = 0; j < 4; ++j) {
+			f.prev_sum[j]   = splat(entry.prev_sum[j]);
+			f.prev_color[j] = splat(entry.prev_color[j]);
+			f.prev_k1[j]    = splat(entry.prev_k1[j]);
+			f.prev_k2[j]    = splat(entry.prev_k2[j]);
+			f.next_sum[j]   = splat(entry.next_sum[j]);
+			f.next_color[j] = splat(entry.next_color[j]);
+		}
+	}
+
+	static GRADIENT_INLINE void select(Fields &f, const Int &mask, const Table::Entry &entry)
+	{
+		f.prev_pos = select(mask, splat(entry.prev_pos), f.prev_pos);
+		f.next_pos = select(mask, splat(entry.next_pos), f.next_pos);
+		for(int j = 0; j < 4; ++j) {
+			f.prev_sum[j]   = select(mask, splat(entry.prev_sum[j]),   f.prev_sum[j]);
+			f.prev_color[j] = select(mask, splat(entry.prev_color[j]), f.prev_color[j]);
+			f.prev_k1[j]    = select(mask, splat(entry.prev_k1[j]),    f.prev_k1[j]);
+			f.prev_k2[j]    = select(mask, splat(entry.prev_k2[j]),    f.prev_k2[j]);
+			f.next_sum[j]   = select(mask, splat(entry.next_sum[j]),   f.next_sum[j]);
+			f.next_color[j] = select(mask, splat(entry.next_color[j]), f.next_color[j]);
+		}
+	}
+
+	static GRADIENT_INLINE void gather(const Table &table, const Int &e, Fields &f)
+	{
+		if (table.is_small()) {
+			set(f, table.entries.front());
+			for(int k = 1; k < (int)table.entries.size(); ++k)
+				select(f, e == k, table.entries[k]);
+			return;
+		}
+
+		for(int i = 0; i < N; ++i) {
+			const Table::Entry &entry = table.entries[e[i]];
+			f.prev_pos[i] = entry.prev_pos;
+			f.next_pos[i] = entry.next_pos;
+			for(int j = 0; j < 4; ++j) {
+				f.prev_sum[j][i]   = entry.prev_sum[j];
+				f.prev_color[j][i] = entry.prev_color[j];
+				f.prev_k1[j][i]    = entry.prev_k1[j];
+				f.prev_k2[j][i]    = entry.prev_k2[j];
+				f.next_sum[j][i]   = entry.next_sum[j];
+				f.next_color[j][i] = entry.next_color[j];
+			}
+		}
+	}
+
+	//! CompiledGradient::Entry::summary() for channel j
+	static GRADIENT_INLINE Real summary(const Fields &f, const Real &x, const Int &below, const Int &above, int j)
+	{
+		const Real u = x - f.prev_pos;
+		const Real inside = f.prev_sum[j] + f.prev_color[j]*u + f.prev_k2[j]*(u*u);
+		const Real before = f.prev_sum[j] + f.prev_color[j]*u;
+		const Real after = f.next_sum[j] + f.next_color[j]*(x - f.next_pos);
+		return select(above, after, select(below, before, inside));
+	}
+
+	//! CompiledGradient::Entry::color() for channel j, not demultiplied
+	static GRADIENT_INLINE Real color(const Fields &f, const Real &x, const Int &below, const Int &above, int j)
+	{
+		const Real inside = f.prev_color[j] + f.prev_k1[j]*(x - f.prev_pos);
+		return select(above, f.next_color[j], select(below, f.prev_color[j], inside));
+	}
+
+	//! CompiledGradient::average(x0, x1) for each lane
+	static GRADIENT_INLINE void average(const Table &table, const Real &x0, const Real &x1, Real *out)
+	{
+		const Real w = x1 - x0;
+		Real n0 = Real(), n1 = Real();
+		if (table.repeat)
+			{ n0 = floor(x0); n1 = floor(x1); }
+		const Real f0 = x0 - n0;
+		const Real f1 = x1 - n1;
+
+		const Int e0 = find(table, f0);
+		const Int e1 = find(table, f1);
+
+		Fields a, b;
+		gather(table, e0, a);
+		gather(table, e1, b);
+
+		const Int below0 = f0 <= a.prev_pos, above0 = f0 >= a.next_pos;
+		const Int below1 = f1 <= b.prev_pos, above1 = f1 >= b.next_pos;
+
+		// inside of one entry color is linear, so the average is the color at middle
+		const Int same = (e0 == e1) & (n0 == n1) & (below0 == below1) & (above0 == above1);
+		const Int small = ~(w >= splat(min_width));
+		const Int point = same | small;
+		const Real middle = (f0 + f1)*splat(0.5f);
+		const Int below_m = middle <= a.prev_pos, above_m = middle >= a.next_pos;
+
+		const Real k = splat(1.f)/w;
+		const Real count = n1 - n0;
+		for(int j = 0; j < 4; ++j) {
+			const Real s = ( summary(b, f1, below1, above1, j)
+			               - summary(a, f0, below0, above0, j)
+			               + count*splat(table.summary[j]) )*k;
+			out[j] = select(point, color(a, middle, below_m, above_m, j), s);
+		}
+
+		// infinite and NaN sizes give average color of whole gradient
+		const Int finite = abs(w) < splat(INFINITY);
+		if (!all(finite)) {
+			for(int i = 0; i < N; ++i)
+				if (!finite[i]) {
+					out[0][i] = table.average.get_r()*table.average.get_a();
+					out[1][i] = table.average.get_g()*table.average.get_a();
+					out[2][i] = table.average.get_b()*table.average.get_a();
+					out[3][i] = table.average.get_a();
+				}
+		}
+	}
+
+	static GRADIENT_INLINE bool all(const Int &mask)
+		{ for(int i = 0; i < N; ++i) if (!mask[i]) return false; return true; }
+
+	//! calc_position() for N pixels
+	static GRADIENT_INLINE void position(
+		const software::GradientFill::Params &params, const Row &row, const Real &x, const Real &y, Real &t, Real &size )
+	{
+		const float px = (float)row.px;
+		switch(params.shape) {
+		case software::GradientFill::SHAPE_LINEAR:
+			t = x;
+			size = splat(px);
+			break;
+		case software::GradientFill::SHAPE_RADIAL:
+			t = sqrt(x*x + y*y);
+			size = splat(1.2f*px);
+			break;
+		case software::GradientFill::SHAPE_CONICAL: {
+			Real a = atan2(-y, x)*splat((float)(1/turn)) + splat((float)params.angle);
+			t = a - floor(a);
+			const Int center = (abs(x) < splat(0.5f*px)) & (abs(y) < splat(0.5f*(float)row.py));
+			size = select(center, splat(0.5f), splat(px)/(sqrt(x*x + y*y)*splat((float)turn)));
+			break;
+		}
+		case software::GradientFill::SHAPE_SPIRAL: {
+			Real a = atan2(-y, x)*splat((float)(1/turn)) + splat((float)params.angle);
+			a -= floor(a);
+			const Real r = sqrt(x*x + y*y);
+			t = params.clockwise ? r + a : r - a;
+			size = (splat(1.41421f*px) + splat(1.41421f*px)/(r*splat((float)turn)))*splat(0.5f);
+			size = select(size < splat(0.00001f), splat(0.00001f), size);
+			break;
+		}
+		}
+	}
+
+	static GRADIENT_INLINE void fill_row(
+		Color *dest,
+		int count,
+		const Table &table,
+		const software::GradientFill::Params &params,
+		const Row &row )
+	{
+		Real lane;
+		for(int i = 0; i < N; ++i) lane[i] = (float)i;
+		const Real dxx = splat((float)row.dx[0]), dxy = splat((float)row.dx[1]);
+		const Real ox = splat((float)row.origin[0]), oy = splat((float)row.origin[1]);
+
+		Real t, size, c[4];
+		for(int i = 0; i < count; i += N) {
+			const Real k = lane + splat((float)i);
+			position(params, row, ox + k*dxx, oy + k*dxy, t, size);
+			size *= splat(0.5f);
+			average(table, t - size, t + size, c);
+
+			// demultiply alpha, see CompiledGradient::Accumulator::color()
+			const Int visible = abs(c[3]) >= splat(real_low_precision<float>());
+			const Real m = select(visible, splat(1.f)/c[3], Real());
+			c[0] *= m; c[1] *= m; c[2] *= m;
+			c[3] = select(visible, c[3], Real());
+
+			ColorReal *d = reinterpret_cast<ColorReal*>(dest + i);
+			for(int j = 0; j < N && i + j < count; ++j, d += 4)
+				{ d[0] = c[0][j]; d[1] = c[1][j]; d[2] = c[2][j]; d[3] = c[3][j]; }
+		}
+	}
+};
+
+void
+fill_row_vector4(Color *dest, int count, const Table &table, const software::GradientFill::Params &params, const Row &row)
+	{ Filler<4>::fill_row(dest, count, table, params, row); }
+
+#ifdef GRADIENT_AVX2
+__attribute__((target("avx2")))
+void
+fill_row_vector8(Color *dest, int count, const Table &table, const software::GradientFill::Params &params, const Row &row)
+	{ Filler<8>::fill_row(dest, count, table, params, row); }
+#endif
+
+#endif // GRADIENT_VECTORS
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+void
+software::GradientFill::fill(
+	synfig::Surface &dest,
+	const RectInt &dest_rect,
+	const CompiledGradient &gradient,
+	const Params &params,
+	Color::BlendMethod method,
+	ColorReal amount )
+{
+	if (!dest_rect.is_valid())
+		return;
+
+	assert( 0 <= dest_rect.minx && dest_rect.maxx <= dest.get_w()
+		 && 0 <= dest_rect.miny && dest_rect.maxy <= dest.get_h() );
+
+	const int w = dest_rect.get_width();
+
+	Blend::Instructions instructions = Blend::get_instructions();
+	// without atan2() scalar path is faster than vector one of 4 pixels
+	if ( instructions == Blend::INSTRUCTIONS_VECTOR4
+	  && (params.shape == SHAPE_LINEAR || params.shape == SHAPE_RADIAL) )
+		instructions = Blend::INSTRUCTIONS_SCALAR;
+	#ifdef GRADIENT_VECTORS
+	const Table table(gradient);
+	#endif
+
+	const bool copy = method == Color::BLEND_STRAIGHT && amount == 1.f;
+	std::vector<Color> buffer(copy ? 0 : w);
+	for(int y = dest_rect.miny; y < dest_rect.maxy; ++y) {
+		Color *row = copy ? &dest[y][dest_rect.minx] : &buffer.front();
+		Row r(params, dest_rect.minx, y);
+		switch(instructions) {
+		#ifdef GRADIENT_AVX2
+		case Blend::INSTRUCTIONS_VECTOR8:
+			fill_row_vector8(row, w, table, params, r);
+			break;
+		#endif
+		#ifdef GRADIENT_VECTORS
+		case Blend::INSTRUCTIONS_VECTOR4:
+			fill_row_vector4(row, w, table, params, r);
+			break;
+		#endif
+		default:
+			fill_row_scalar(row, w, gradient, params, r);
+			break;
+		}
+		if (!copy)
+			Blend::blend(&dest[y][dest_rect.minx], row, w, method, amount);
+	}
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,92 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/gradientfill.h
+**	\brief GradientFill Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_GRADIENTFILL_H
+#define __SYNFIG_RENDERING_SOFTWARE_GRADIENTFILL_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/color.h>
+#include <synfig/gradient.h>
+#include <synfig/matrix.h>
+#include <synfig/rect.h>
+#include <synfig/surface.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+//! Fills surfaces by linear, radial, conical and spiral gradients.
+//! Each pixel gets average color of gradient over the pixel size,
+//! like CompiledGradient::average() in the gradient layers.
+//! Vector paths process packs of 4 or 8 pixels in float precision
+//! and use the instructions selected by Blend::set_instructions(),
+//! scalar path gives exactly the colors of CompiledGradient::average().
+class GradientFill
+{
+public:
+	enum Shape {
+		SHAPE_LINEAR,  //!< gradient position is x
+		SHAPE_RADIAL,  //!< distance from (0, 0)
+		SHAPE_CONICAL, //!< angle around (0, 0) in turns, counted clockwise from x axis
+		SHAPE_SPIRAL   //!< distance minus angle (or plus angle when clockwise)
+	};
+
+	struct Params {
+		Shape shape;
+		//! Affine transformation from pixel coordinates into shape coordinates
+		Matrix matrix;
+		//! Added to angle of conical and spiral shapes, in turns
+		Real angle;
+		bool clockwise;
+
+		Params(): shape(SHAPE_LINEAR), angle(), clockwise() { }
+	};
+
+	//! Fills dest_rect of dest
+	static void fill(
+		synfig::Surface &dest,
+		const RectInt &dest_rect,
+		const CompiledGradient &gradient,
+		const Params &params,
+		Color::BlendMethod method,
+		ColorReal amount );
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
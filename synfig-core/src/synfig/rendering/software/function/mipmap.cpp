@@ -0,0 +1,224 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/mipmap.cpp
+**	\brief Mipmap
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdlib>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "mipmap.h"
+#include "resample.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+
+struct Pyramid {
+	SurfaceSWPacked::Handle source;
+	std::vector<Mipmap::Level> levels; //!< levels[0] is level 1, it's twice smaller than source
+	std::size_t size;
+	Pyramid(): size() { }
+};
+
+typedef std::list<Pyramid> PyramidList;
+
+class Cache {
+public:
+	std::mutex mutex;
+	PyramidList list; //!< recently used sources first
+	std::map<const rendering::Surface*, PyramidList::iterator> map;
+	Mipmap::Statistics statistics;
+
+	Cache() {
+		const char *s = getenv("SYNFIG_MIPMAP_CACHE_SIZE");
+		int megabytes = s ? atoi(s) : 0;
+		statistics.max_size = (megabytes > 0 ? megabytes : 256)*std::size_t(1024*1024);
+	}
+
+	//! mutex must be locked, removed entries are moved to \a removed,
+	//! so sources will be released when mutex is unlocked
+	void erase(PyramidList::iterator i, PyramidList &removed) {
+		statistics.size -= i->size;
+		--statistics.sources;
+		map.erase(i->source.get());
+		removed.splice(removed.end(), list, i);
+	}
+
+	//! mutex must be locked, first source in list is kept
+	void trim(PyramidList &removed) {
+		if (list.empty()) return;
+
+		// sources which are referenced only by this cache will never be asked again
+		for(PyramidList::iterator i = std::next(list.begin()); i != list.end(); )
+			if (i->source.count() == 1)
+				{ erase(i++, removed); ++statistics.evictions; }
+			else
+				++i;
+
+		while(statistics.size > statistics.max_size && list.size() > 1)
+			{ erase(std::prev(list.end()), removed); ++statistics.evictions; }
+	}
+
+	static Cache& instance() {
+		static Cache cache;
+		return cache;
+	}
+};
+
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+Mipmap::Level
+Mipmap::get_level(const SurfaceSWPacked::Handle &source, int width, int height)
+{
+	if (!source || width <= 0 || height <= 0)
+		return Level();
+
+	const PackedSurface &packed = source->get_surface();
+	int sw = packed.get_width();
+	int sh = packed.get_height();
+	if (sw <= 0 || sh <= 0)
+		return Level();
+
+	// choose the smallest level which is not less than requested size
+	int index = 0, w = sw, h = sh;
+	while((w > 1 || h > 1) && (w + 1)/2 >= width && (h + 1)/2 >= height)
+		{ w = (w + 1)/2; h = (h + 1)/2; ++index; }
+	if (!index)
+		return Level();
+
+	Cache &cache = Cache::instance();
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		std::map<const rendering::Surface*, PyramidList::iterator>::iterator i = cache.map.find(source.get());
+		if (i != cache.map.end()) {
+			cache.list.splice(cache.list.begin(), cache.list, i->second);
+			const Pyramid &pyramid = *i->second;
+			if ((int)pyramid.levels.size() >= index && pyramid.levels[index - 1]) {
+				++cache.statistics.hits;
+				return pyramid.levels[index - 1];
+			}
+		}
+		++cache.statistics.misses;
+	}
+
+	// build level without lock, concurrent threads may build the same level,
+	// the first one will be stored
+	std::shared_ptr<synfig::Surface> surface = std::make_shared<synfig::Surface>(w, h);
+	Resample::downscale(*surface, RectInt(0, 0, w, h), packed, RectInt(0, 0, sw, sh), true);
+	Level level = surface;
+
+	PyramidList removed;
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		std::map<const rendering::Surface*, PyramidList::iterator>::iterator i = cache.map.find(source.get());
+		if (i == cache.map.end()) {
+			cache.list.push_front(Pyramid());
+			cache.list.front().source = source;
+			cache.map[source.get()] = cache.list.begin();
+			++cache.statistics.sources;
+		} else {
+			cache.list.splice(cache.list.begin(), cache.list, i->second);
+		}
+
+		Pyramid &pyramid = cache.list.front();
+		if ((int)pyramid.levels.size() < index)
+			pyramid.levels.resize(index);
+		if (pyramid.levels[index - 1]) {
+			level = pyramid.levels[index - 1];
+		} else {
+			std::size_t size = (std::size_t)w*h*sizeof(Color);
+			pyramid.levels[index - 1] = level;
+			pyramid.size += size;
+			cache.statistics.size += size;
+		}
+
+		cache.trim(removed);
+	}
+
+	return level;
+}
+
+void
+Mipmap::forget(const rendering::Surface *source)
+{
+	Cache &cache = Cache::instance();
+	PyramidList removed;
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	std::map<const rendering::Surface*, PyramidList::iterator>::iterator i = cache.map.find(source);
+	if (i != cache.map.end())
+		cache.erase(i->second, removed);
+}
+
+void
+Mipmap::clear()
+{
+	Cache &cache = Cache::instance();
+	PyramidList removed;
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	removed.swap(cache.list);
+	cache.map.clear();
+	cache.statistics.size = 0;
+	cache.statistics.sources = 0;
+}
+
+void
+Mipmap::set_max_size(std::size_t size)
+{
+	Cache &cache = Cache::instance();
+	PyramidList removed;
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.statistics.max_size = size;
+	cache.trim(removed);
+}
+
+Mipmap::Statistics
+Mipmap::get_statistics()
+{
+	Cache &cache = Cache::instance();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	return cache.statistics;
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,90 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/mipmap.h
+**	\brief Mipmap Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_MIPMAP_H
+#define __SYNFIG_RENDERING_SOFTWARE_MIPMAP_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstddef>
+#include <memory>
+
+#include <synfig/surface.h>
+
+#include "../surfaceswpacked.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+//! Process-wide cache of downscaled copies (mip levels) of imported images.
+//! Level N has size of source divided by 2^N (rounded up),
+//! levels are built lazily when somebody asks for them.
+//! Cache is limited by memory usage, least recently used sources are dropped first,
+//! sources which are not used by anybody else are dropped immediately.
+class Mipmap
+{
+public:
+	//! Downscaled copy of the source, pixels are cooked (see ColorPrep)
+	typedef std::shared_ptr<const synfig::Surface> Level;
+
+	struct Statistics {
+		long long hits;
+		long long misses;
+		long long evictions;
+		int sources;
+		std::size_t size;      //!< bytes used by all levels
+		std::size_t max_size;
+		Statistics(): hits(), misses(), evictions(), sources(), size(), max_size() { }
+	};
+
+	//! Returns the smallest level which is not less than width x height,
+	//! returns empty handle when the source itself should be used
+	static Level get_level(const SurfaceSWPacked::Handle &source, int width, int height);
+
+	//! Drops all levels of the source, called when source is changed
+	static void forget(const rendering::Surface *source);
+	static void clear();
+
+	//! Default is 256 MB, or SYNFIG_MIPMAP_CACHE_SIZE megabytes
+	static void set_max_size(std::size_t size);
+	static Statistics get_statistics();
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
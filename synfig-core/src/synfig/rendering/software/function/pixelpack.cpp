@@ -0,0 +1,387 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/pixelpack.cpp
+**	\brief PixelPack
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "pixelpack.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#ifdef __GNUC__
+	// GCC and Clang vector extensions
+	#define PIXELPACK_VECTORS
+	#define PIXELPACK_INLINE inline __attribute__((always_inline))
+	#if defined(__x86_64__) || defined(__i386__)
+		#define PIXELPACK_F16C
+	#endif
+#else
+	#define PIXELPACK_INLINE inline
+#endif
+
+#ifdef PIXELPACK_F16C
+#include <immintrin.h>
+#endif
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+	std::atomic<int> instructions(-1);
+
+	// constants of half-float conversion, see float_to_half() and half_to_float()
+	const uint32_t float_infinity = 255u << 23;
+	const uint32_t half_overflow  = (127u + 16u) << 23;
+	const uint32_t half_min_normal = 113u << 23;
+	const uint32_t denormal_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+	const uint32_t exponent_adjust = (uint32_t)(15 - 127) << 23;
+	const uint32_t half_exponent  = 0x7c00u << 13;
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+PIXELPACK_INLINE uint32_t
+float_bits(float x)
+	{ uint32_t i; memcpy(&i, &x, sizeof(i)); return i; }
+
+PIXELPACK_INLINE float
+bits_float(uint32_t i)
+	{ float x; memcpy(&x, &i, sizeof(x)); return x; }
+
+// rounds to nearest even, NaN becomes quiet NaN without payload
+PIXELPACK_INLINE uint16_t
+float_to_half(float x)
+{
+	uint32_t f = float_bits(x);
+	uint32_t sign = f & 0x80000000u;
+	f ^= sign;
+
+	uint32_t h;
+	if (f >= half_overflow) {
+		h = f > float_infinity ? 0x7e00u : 0x7c00u;
+	} else
+	if (f < half_min_normal) {
+		// let FPU align mantissa of denormal and round it
+		h = float_bits(bits_float(f) + bits_float(denormal_magic)) - denormal_magic;
+	} else {
+		uint32_t odd = (f >> 13) & 1u;
+		h = (f + exponent_adjust + 0xfffu + odd) >> 13;
+	}
+	return (uint16_t)(h | (sign >> 16));
+}
+
+PIXELPACK_INLINE float
+half_to_float(uint16_t h)
+{
+	uint32_t f = ((uint32_t)h & 0x7fffu) << 13;
+	uint32_t exponent = f & half_exponent;
+	f += (127u - 15u) << 23;
+	if (exponent == half_exponent)
+		f += (128u - 16u) << 23; // Inf or NaN
+	else
+	if (exponent == 0)
+		f = float_bits(bits_float(f + (1u << 23)) - bits_float(half_min_normal)); // zero or denormal
+	return bits_float(f | (((uint32_t)h & 0x8000u) << 16));
+}
+
+PIXELPACK_INLINE ColorReal
+clamp_real(ColorReal x)
+	{ return !(x > 0) ? 0 : x > 1 ? 1 : x; } // NaN becomes zero
+
+PIXELPACK_INLINE uint8_t
+real_to_byte(ColorReal x)
+	{ return (uint8_t)(int)(clamp_real(x)*255.f + 0.5f); }
+
+
+void
+pack_half_scalar(uint16_t *dest, const Color *src, int count)
+{
+	for(const Color *end = src + count; src < end; ++src, dest += 4) {
+		dest[0] = float_to_half(src->get_r());
+		dest[1] = float_to_half(src->get_g());
+		dest[2] = float_to_half(src->get_b());
+		dest[3] = float_to_half(src->get_a());
+	}
+}
+
+void
+unpack_half_scalar(Color *dest, const uint16_t *src, int count)
+{
+	for(Color *end = dest + count; dest < end; ++dest, src += 4)
+		*dest = Color(
+			half_to_float(src[0]),
+			half_to_float(src[1]),
+			half_to_float(src[2]),
+			half_to_float(src[3]) );
+}
+
+void
+pack_premulted8_scalar(uint8_t *dest, const Color *src, int count)
+{
+	for(const Color *end = src + count; src < end; ++src, dest += 4) {
+		ColorReal a = clamp_real(src->get_a());
+		dest[0] = real_to_byte(src->get_r()*a);
+		dest[1] = real_to_byte(src->get_g()*a);
+		dest[2] = real_to_byte(src->get_b()*a);
+		dest[3] = real_to_byte(a);
+	}
+}
+
+void
+unpack_premulted8_scalar(Color *dest, const uint8_t *src, int count)
+{
+	for(Color *end = dest + count; dest < end; ++dest, src += 4) {
+		if (!src[3])
+			{ *dest = Color(0, 0, 0, 0); continue; }
+		ColorReal a = (ColorReal)src[3];
+		*dest = Color(
+			(ColorReal)src[0]/a,
+			(ColorReal)src[1]/a,
+			(ColorReal)src[2]/a,
+			a/255.f );
+	}
+}
+
+#ifdef PIXELPACK_VECTORS
+
+//! channels r, g, b, a of one pixel
+typedef float Real4 __attribute__((vector_size(4*sizeof(float))));
+typedef int Int4 __attribute__((vector_size(4*sizeof(int))));
+typedef uint32_t UInt4 __attribute__((vector_size(4*sizeof(uint32_t))));
+
+PIXELPACK_INLINE UInt4
+select(const Int4 &mask, const UInt4 &x, const UInt4 &y)
+	{ return (x & (UInt4)mask) | (y & ~(UInt4)mask); }
+
+PIXELPACK_INLINE Real4
+select(const Int4 &mask, const Real4 &x, const Real4 &y)
+	{ return (Real4)select(mask, (UInt4)x, (UInt4)y); }
+
+PIXELPACK_INLINE Real4
+load(const Color &color)
+	{ return Real4{ color.get_r(), color.get_g(), color.get_b(), color.get_a() }; }
+
+PIXELPACK_INLINE void
+store(Color &color, const Real4 &x)
+	{ color = Color(x[0], x[1], x[2], x[3]); }
+
+void
+pack_half_vector(uint16_t *dest, const Color *src, int count)
+{
+	const UInt4 zero = UInt4();
+	for(const Color *end = src + count; src < end; ++src, dest += 4) {
+		UInt4 f = (UInt4)load(*src);
+		UInt4 sign = f & 0x80000000u;
+		f ^= sign;
+
+		UInt4 infinity = select(f > float_infinity, zero + 0x7e00u, zero + 0x7c00u);
+		UInt4 denormal = (UInt4)((Real4)f + bits_float(denormal_magic)) - denormal_magic;
+		UInt4 normal = (f + exponent_adjust + 0xfffu + ((f >> 13) & 1u)) >> 13;
+
+		UInt4 h = select(f >= half_overflow, infinity, select(f < half_min_normal, denormal, normal));
+		h |= sign >> 16;
+		for(int i = 0; i < 4; ++i)
+			dest[i] = (uint16_t)h[i];
+	}
+}
+
+void
+unpack_half_vector(Color *dest, const uint16_t *src, int count)
+{
+	for(Color *end = dest + count; dest < end; ++dest, src += 4) {
+		UInt4 h = { src[0], src[1], src[2], src[3] };
+		UInt4 f = (h & 0x7fffu) << 13;
+		UInt4 exponent = f & half_exponent;
+		f += (127u - 15u) << 23;
+		f += (UInt4)(exponent == half_exponent) & ((128u - 16u) << 23);
+		UInt4 denormal = (UInt4)((Real4)(f + (1u << 23)) - bits_float(half_min_normal));
+		f = select(exponent == 0, denormal, f);
+		store(*dest, (Real4)(f | ((h & 0x8000u) << 16)));
+	}
+}
+
+void
+pack_premulted8_vector(uint8_t *dest, const Color *src, int count)
+{
+	const Real4 zero = Real4(), one = zero + 1.f;
+	for(const Color *end = src + count; src < end; ++src, dest += 4) {
+		Real4 x = load(*src);
+		Real4 a = zero + x[3];
+		a = select(a > zero, select(a > one, one, a), zero);
+		x *= Real4{ a[0], a[0], a[0], 1.f };
+		x[3] = a[0];
+		x = select(x > zero, select(x > one, one, x), zero);
+		Int4 b = __builtin_convertvector(x*255.f + 0.5f, Int4);
+		for(int i = 0; i < 4; ++i)
+			dest[i] = (uint8_t)b[i];
+	}
+}
+
+void
+unpack_premulted8_vector(Color *dest, const uint8_t *src, int count)
+{
+	for(Color *end = dest + count; dest < end; ++dest, src += 4) {
+		if (!src[3])
+			{ *dest = Color(0, 0, 0, 0); continue; }
+		Real4 x = { (float)src[0], (float)src[1], (float)src[2], (float)src[3] };
+		Real4 d = { x[3], x[3], x[3], 255.f };
+		store(*dest, x/d);
+	}
+}
+
+#endif // PIXELPACK_VECTORS
+
+#ifdef PIXELPACK_F16C
+
+// Color is 4 floats, so 2 pixels fit into one 256-bit register
+
+__attribute__((target("avx,f16c")))
+void
+pack_half_f16c(uint16_t *dest, const Color *src, int count)
+{
+	const float *s = reinterpret_cast<const float*>(src);
+	const float *end = s + 4*count;
+	for(; s + 8 <= end; s += 8, dest += 8)
+		_mm_storeu_si128((__m128i*)dest, _mm256_cvtps_ph(_mm256_loadu_ps(s), _MM_FROUND_TO_NEAREST_INT));
+	if (s < end)
+		_mm_storel_epi64((__m128i*)dest, _mm_cvtps_ph(_mm_loadu_ps(s), _MM_FROUND_TO_NEAREST_INT));
+}
+
+__attribute__((target("avx,f16c")))
+void
+unpack_half_f16c(Color *dest, const uint16_t *src, int count)
+{
+	float *d = reinterpret_cast<float*>(dest);
+	float *end = d + 4*count;
+	for(; d + 8 <= end; d += 8, src += 8)
+		_mm256_storeu_ps(d, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)src)));
+	if (d < end)
+		_mm_storeu_ps(d, _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)src)));
+}
+
+#endif // PIXELPACK_F16C
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+software::PixelPack::Instructions
+software::PixelPack::get_supported_instructions()
+{
+	#ifdef PIXELPACK_F16C
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c"))
+		return INSTRUCTIONS_F16C;
+	#endif
+	#ifdef PIXELPACK_VECTORS
+	return INSTRUCTIONS_VECTOR;
+	#else
+	return INSTRUCTIONS_SCALAR;
+	#endif
+}
+
+software::PixelPack::Instructions
+software::PixelPack::get_instructions()
+{
+	int i = instructions;
+	if (i < 0)
+		instructions = i = get_supported_instructions();
+	return (Instructions)i;
+}
+
+void
+software::PixelPack::set_instructions(Instructions x)
+	{ instructions = std::min(x, get_supported_instructions()); }
+
+void
+software::PixelPack::pack_half(uint16_t *dest, const Color *src, int count)
+{
+	switch(get_instructions())
+	{
+	#ifdef PIXELPACK_F16C
+	case INSTRUCTIONS_F16C:
+		pack_half_f16c(dest, src, count); break;
+	#endif
+	#ifdef PIXELPACK_VECTORS
+	case INSTRUCTIONS_VECTOR:
+		pack_half_vector(dest, src, count); break;
+	#endif
+	default:
+		pack_half_scalar(dest, src, count); break;
+	}
+}
+
+void
+software::PixelPack::unpack_half(Color *dest, const uint16_t *src, int count)
+{
+	switch(get_instructions())
+	{
+	#ifdef PIXELPACK_F16C
+	case INSTRUCTIONS_F16C:
+		unpack_half_f16c(dest, src, count); break;
+	#endif
+	#ifdef PIXELPACK_VECTORS
+	case INSTRUCTIONS_VECTOR:
+		unpack_half_vector(dest, src, count); break;
+	#endif
+	default:
+		unpack_half_scalar(dest, src, count); break;
+	}
+}
+
+void
+software::PixelPack::pack_premulted8(uint8_t *dest, const Color *src, int count)
+{
+	#ifdef PIXELPACK_VECTORS
+	if (get_instructions() >= INSTRUCTIONS_VECTOR)
+		{ pack_premulted8_vector(dest, src, count); return; }
+	#endif
+	pack_premulted8_scalar(dest, src, count);
+}
+
+void
+software::PixelPack::unpack_premulted8(Color *dest, const uint8_t *src, int count)
+{
+	#ifdef PIXELPACK_VECTORS
+	if (get_instructions() >= INSTRUCTIONS_VECTOR)
+		{ unpack_premulted8_vector(dest, src, count); return; }
+	#endif
+	unpack_premulted8_scalar(dest, src, count);
+}
+
+/* === E N T R Y P O I N T ================================================= */
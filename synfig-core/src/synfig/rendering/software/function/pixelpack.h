@@ -0,0 +1,83 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/pixelpack.h
+**	\brief PixelPack Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_PIXELPACK_H
+#define __SYNFIG_RENDERING_SOFTWARE_PIXELPACK_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <stdint.h>
+
+#include <synfig/color.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+//! Converts rows of pixels between Color and compact formats
+//! used to store intermediate surfaces (see SurfaceSWHalf and SurfaceSWPremulted8).
+//! Each pixel is packed into 4 channels in order r, g, b, a.
+class PixelPack
+{
+public:
+	enum Instructions {
+		INSTRUCTIONS_SCALAR = 0, //!< one channel per iteration
+		INSTRUCTIONS_VECTOR,     //!< one pixel per iteration (SSE2 on x86)
+		INSTRUCTIONS_F16C        //!< two pixels per iteration, hardware half-float conversion (x86)
+	};
+
+	//! Returns the best instructions supported by both of build and CPU
+	static Instructions get_supported_instructions();
+	//! Returns instructions used by conversion functions
+	static Instructions get_instructions();
+	//! Selects instructions (used by tests and benchmarks),
+	//! unsupported instructions are replaced by the best supported ones
+	static void set_instructions(Instructions instructions);
+
+	//! Converts to IEEE 754 half-precision floats, rounds to nearest even
+	static void pack_half(uint16_t *dest, const Color *src, int count);
+	static void unpack_half(Color *dest, const uint16_t *src, int count);
+
+	//! Converts to 8-bit channels with premultiplied alpha,
+	//! values are clamped to [0, 1], transparent pixels become Color(0, 0, 0, 0)
+	static void pack_premulted8(uint8_t *dest, const Color *src, int count);
+	static void unpack_premulted8(Color *dest, const uint8_t *src, int count);
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
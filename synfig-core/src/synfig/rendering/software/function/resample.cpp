@@ -32,6 +32,7 @@
 #include <synfig/debug/debugsurface.h>
 
 #include "resample.h"
+#include "mipmap.h"
 #include "../../primitive/transformationaffine.h"
 
 #endif
@@ -74,10 +75,22 @@ namespace {
 				const void *surface;
 				const RectInt &bounds;
 				Vector pos, pos_dx, pos_dy;
-				Vector aa0, aa0_dx, aa0_dy;
-				Vector aa1, aa1_dx, aa1_dy;
+				Vector aa0, aa0_dx;
+				Vector aa1, aa1_dx;
+				Matrix pos_matrix, aa0_matrix, aa1_matrix;
 				Iterator(const void *surface, const RectInt &bounds):
 					surface(surface), bounds(bounds) { }
+
+				// start of each row calculates directly (without accumulation from the first row),
+				// so the result of row does not depend on the rows drawn before it
+				void set_row(int y)
+					{ pos = pos_matrix.get_transformed( Vector((Real)bounds.minx, (Real)y) ) - Vector(0.5, 0.5); }
+				void set_row_aa(int y) {
+					Vector start((Real)bounds.minx, (Real)y);
+					pos = pos_matrix.get_transformed( start ) - Vector(0.5, 0.5);
+					aa0 = aa0_matrix.get_transformed( start );
+					aa1 = aa1_matrix.get_transformed( start );
+				}
 			};
 
 			template<SamplerCookFunc sampler_func>
@@ -88,15 +101,14 @@ namespace {
 			static inline void fill(pen &p, Iterator &i)
 			{
 				int idx = i.bounds.maxx - i.bounds.minx;
-				int idy = i.bounds.maxy - i.bounds.miny;
-				for(int y = idy; y; --y) {
+				for(int y = i.bounds.miny; y < i.bounds.maxy; ++y) {
+					i.set_row(y);
 					for(int x = idx; x; --x) {
 						p.put_value( sampler_func(i.surface, i.pos[0], i.pos[1]) );
 						p.inc_x();
 						i.pos += i.pos_dx;
 					}
 					p.dec_x(idx); p.inc_y();
-					i.pos += i.pos_dy;
 				}
 			}
 
@@ -105,8 +117,8 @@ namespace {
 			{
 				const Real threshold = 0.5 - 1e-4;
 				int idx = i.bounds.maxx - i.bounds.minx;
-				int idy = i.bounds.maxy - i.bounds.miny;
-				for(int y = idy; y; --y) {
+				for(int y = i.bounds.miny; y < i.bounds.maxy; ++y) {
+					i.set_row_aa(y);
 					for(int x = idx; x; --x) {
 						if ( i.aa0[0] > threshold && i.aa0[1] > threshold
 						&& i.aa1[0] > threshold && i.aa1[1] > threshold )
@@ -117,9 +129,6 @@ namespace {
 						p.inc_x();
 					}
 					p.dec_x(idx); p.inc_y();
-					i.pos += i.pos_dy;
-					i.aa0 += i.aa0_dy;
-					i.aa1 += i.aa1_dy;
 				}
 			}
 
@@ -127,8 +136,8 @@ namespace {
 			static inline void fill_aa(pen &p, Iterator &i)
 			{
 				int idx = i.bounds.maxx - i.bounds.minx;
-				int idy = i.bounds.maxy - i.bounds.miny;
-				for(int y = idy; y; --y) {
+				for(int y = i.bounds.miny; y < i.bounds.maxy; ++y) {
+					i.set_row_aa(y);
 					for(int x = idx; x; --x) {
 						if ( i.aa0[0] > 1 && i.aa0[1] > 1
 						&& i.aa1[0] > 1 && i.aa1[1] > 1 )
@@ -152,9 +161,6 @@ namespace {
 						p.inc_x();
 					}
 					p.dec_x(idx); p.inc_y();
-					i.pos += i.pos_dy;
-					i.aa0 += i.aa0_dy;
-					i.aa1 += i.aa1_dy;
 				}
 			}
 
@@ -196,6 +202,7 @@ namespace {
 			static void resample(
 				synfig::Surface &dest,
 				const RectInt &dest_bounds,
+				const RectInt &dest_clip,
 				const void *src,
 				const RectInt &src_bounds,
 				const Matrix &transformation,
@@ -225,18 +232,24 @@ namespace {
 				rect_set_intersect(bounds, bounds, dest_bounds);
 				rect_set_intersect(bounds, bounds, RectInt(0, 0, dest.get_w(), dest.get_h()));
 
+				// all calculations below depends on the whole bounds,
+				// clip just selects the pixels to draw
+				RectInt draw_bounds;
+				rect_set_intersect(draw_bounds, bounds, dest_clip);
+
 				// texture matrices
 
-				if (bounds.valid()) {
+				if (bounds.valid() && draw_bounds.valid()) {
 					Matrix back_transformation = transformation;
 					back_transformation.invert();
 
-					Iterator i(src, bounds);
+					Iterator i(src, draw_bounds);
 
 					Vector start((Real)bounds.minx, (Real)bounds.miny);
 					Vector dx(1.0, 0.0);
-					Vector dy((Real)(bounds.minx - bounds.maxx), 1.0);
+					Vector dy((Real)(draw_bounds.minx - draw_bounds.maxx), 1.0);
 
+					i.pos_matrix = back_transformation;
 					i.pos    = back_transformation.get_transformed( start ) - Vector(0.5, 0.5);
 					i.pos_dx = back_transformation.get_transformed( dx, false );
 					i.pos_dy = back_transformation.get_transformed( dy, false );
@@ -271,23 +284,21 @@ namespace {
 						Matrix aa0_matrix = Matrix( axis_x,  axis_y, corners[0] - (axis_x + axis_y)*0.5).get_inverted();
 						Matrix aa1_matrix = Matrix(-axis_x, -axis_y, corners[3] + (axis_x + axis_y)*0.5).get_inverted();
 
-						i.aa0    = aa0_matrix.get_transformed( start );
+						i.aa0_matrix = aa0_matrix;
 						i.aa0_dx = aa0_matrix.get_transformed( dx, false );
-						i.aa0_dy = aa0_matrix.get_transformed( dy, false );
 
-						i.aa1    = aa1_matrix.get_transformed( start );
+						i.aa1_matrix = aa1_matrix;
 						i.aa1_dx = aa1_matrix.get_transformed( dx, false );
-						i.aa1_dy = aa1_matrix.get_transformed( dy, false );
 					}
 
 					if (blend) {
 						if (approximate_equal_lp(blend_amount, ColorReal(0))) return;
-						synfig::Surface::alpha_pen p(dest.get_pen(bounds.minx, bounds.miny));
+						synfig::Surface::alpha_pen p(dest.get_pen(draw_bounds.minx, draw_bounds.miny));
 						p.set_blend_method(blend_method);
 						p.set_alpha(blend_amount);
 						fill(interpolation, cut, p, i);
 					} else {
-						synfig::Surface::pen p(dest.get_pen(bounds.minx, bounds.miny));
+						synfig::Surface::pen p(dest.get_pen(draw_bounds.minx, draw_bounds.miny));
 						fill(interpolation, cut, p, i);
 					}
 				}
@@ -426,9 +437,29 @@ namespace {
 							*col = ColorPrep::uncook_static( (*col)*k );
 			}
 
+			static void calc_downscale_size(
+				const RectInt &src_bounds,
+				const Matrix &transformation,
+				int &w,
+				int &h )
+			{
+				const Real threshold = 1.2;
+
+				synfig::rendering::Transformation::Bounds bounds =
+					TransformationAffine( transformation.get_inverted() )
+						.transform_bounds( Rect(0.0, 0.0, 1.0, 1.0), Vector(1.0, 1.0) );
+				bounds.resolution *= threshold;
+
+				int sw = src_bounds.get_width();
+				int sh = src_bounds.get_height();
+				w = std::min( sw, std::max(1, (int)ceil((Real)sw * bounds.resolution[0])) );
+				h = std::min( sh, std::max(1, (int)ceil((Real)sh * bounds.resolution[1])) );
+			}
+
 			static void resample_with_downscale(
 				synfig::Surface &dest,
 				const RectInt &dest_bounds,
+				const RectInt &dest_clip,
 				const void *src,
 				const RectInt &src_bounds,
 				const Matrix &transformation,
@@ -437,19 +468,11 @@ namespace {
 				ColorReal blend_amount,
 				Color::BlendMethod blend_method )
 			{
+				int sw = src_bounds.get_width();
+				int sh = src_bounds.get_height();
+				int w = sw, h = sh;
 				if (interpolation != Color::INTERPOLATION_NEAREST) {
-					const Real threshold = 1.2;
-
-					synfig::rendering::Transformation::Bounds bounds =
-						TransformationAffine( transformation.get_inverted() )
-							.transform_bounds( Rect(0.0, 0.0, 1.0, 1.0), Vector(1.0, 1.0) );
-					bounds.resolution *= threshold;
-
-					int sw = src_bounds.get_width();
-					int sh = src_bounds.get_height();
-					int w = std::min( sw, std::max(1, (int)ceil((Real)sw * bounds.resolution[0])) );
-					int h = std::min( sh, std::max(1, (int)ceil((Real)sh * bounds.resolution[1])) );
-
+					calc_downscale_size(src_bounds, transformation, w, h);
 					if (w < sw || h < sh) {
 						synfig::Surface new_src(w, h);
 						downscale(new_src, RectInt(0, 0, w, h), src, src_bounds, true);
@@ -460,6 +483,7 @@ namespace {
 						Helper::Generic<synfig::Surface::reader, synfig::Surface::reader>::resample(
 							dest,
 							dest_bounds,
+							dest_clip,
 							&new_src,
 							RectInt(0, 0, w, h),
 							new_transformation,
@@ -474,6 +498,7 @@ namespace {
 				resample(
 					dest,
 					dest_bounds,
+					dest_clip,
 					src,
 					src_bounds,
 					transformation,
@@ -512,17 +537,83 @@ software::Resample::downscale(
 	bool keep_cooked )
 {
 	typedef software::PackedSurface::Reader Reader;
+	software::PackedSurface::Reader src_reader(src);
 	Helper::Generic<Reader::reader, Reader::reader_cook>::downscale(
 		dest, dest_bounds,
-		&src, src_bounds,
+		&src_reader, src_bounds,
 		keep_cooked );
 }
 
 
+bool
+software::Resample::is_downscale_required(
+	const RectInt &src_bounds,
+	const Matrix &transformation,
+	Color::Interpolation interpolation )
+{
+	if (interpolation == Color::INTERPOLATION_NEAREST)
+		return false;
+	int w = 0, h = 0;
+	Helper::Generic<synfig::Surface::reader, synfig::Surface::reader_cook>::calc_downscale_size(
+		src_bounds, transformation, w, h );
+	return w < src_bounds.get_width() || h < src_bounds.get_height();
+}
+
+void
+software::Resample::resample(
+	synfig::Surface &dest,
+	const RectInt &dest_bounds,
+	const synfig::Surface &src,
+	const RectInt &src_bounds,
+	const Matrix &transformation,
+	Color::Interpolation interpolation,
+	bool blend,
+	ColorReal blend_amount,
+	Color::BlendMethod blend_method )
+{
+	resample(
+		dest,
+		dest_bounds,
+		dest_bounds,
+		src,
+		src_bounds,
+		transformation,
+		interpolation,
+		blend,
+		blend_amount,
+		blend_method );
+}
+
+void
+software::Resample::resample(
+	synfig::Surface &dest,
+	const RectInt &dest_bounds,
+	const software::PackedSurface &src,
+	const RectInt &src_bounds,
+	const Matrix &transformation,
+	Color::Interpolation interpolation,
+	bool blend,
+	ColorReal blend_amount,
+	Color::BlendMethod blend_method )
+{
+	resample(
+		dest,
+		dest_bounds,
+		dest_bounds,
+		src,
+		src_bounds,
+		transformation,
+		interpolation,
+		blend,
+		blend_amount,
+		blend_method );
+}
+
 void
 software::Resample::resample(
 	synfig::Surface &dest,
 	const RectInt &dest_bounds,
+	const RectInt &dest_clip,
 	const synfig::Surface &src,
 	const RectInt &src_bounds,
 	const Matrix &transformation,
@@ -535,6 +626,7 @@ software::Resample::resample(
 	Helper::Generic<Surface::reader, Surface::reader_cook>::resample_with_downscale(
 		dest,
 		dest_bounds,
+		dest_clip,
 		&src,
 		src_bounds,
 		transformation,
@@ -548,6 +640,7 @@ void
 software::Resample::resample(
 	synfig::Surface &dest,
 	const RectInt &dest_bounds,
+	const RectInt &dest_clip,
 	const software::PackedSurface &src,
 	const RectInt &src_bounds,
 	const Matrix &transformation,
@@ -561,6 +654,7 @@ software::Resample::resample(
 	Helper::Generic<Reader::reader, Reader::reader_cook>::resample_with_downscale(
 		dest,
 		dest_bounds,
+		dest_clip,
 		&src_reader,
 		src_bounds,
 		transformation,
@@ -570,5 +664,68 @@ software::Resample::resample(
 		blend_method );
 }
 
+void
+software::Resample::resample(
+	synfig::Surface &dest,
+	const RectInt &dest_bounds,
+	const RectInt &dest_clip,
+	const SurfaceSWPacked::Handle &src,
+	const RectInt &src_bounds,
+	const Matrix &transformation,
+	Color::Interpolation interpolation,
+	bool blend,
+	ColorReal blend_amount,
+	Color::BlendMethod blend_method )
+{
+	typedef synfig::Surface Surface;
+	const software::PackedSurface &packed = src->get_surface();
+
+	if ( interpolation != Color::INTERPOLATION_NEAREST
+	  && src_bounds == RectInt(0, 0, packed.get_width(), packed.get_height()) )
+	{
+		int sw = src_bounds.get_width();
+		int sh = src_bounds.get_height();
+		int w = sw, h = sh;
+		Helper::Generic<Surface::reader, Surface::reader_cook>::calc_downscale_size(
+			src_bounds, transformation, w, h );
+
+		Mipmap::Level level;
+		if (w < sw || h < sh)
+			level = Mipmap::get_level(src, w, h);
+		if (level) {
+			// level is already cooked, so read it as is,
+			// and downscale it to the exact size if necessary
+			int lw = level->get_w();
+			int lh = level->get_h();
+			Matrix level_transformation = transformation
+										* Matrix().set_scale((Real)sw/(Real)lw, (Real)sh/(Real)lh);
+			Helper::Generic<Surface::reader, Surface::reader>::resample_with_downscale(
+				dest,
+				dest_bounds,
+				dest_clip,
+				level.get(),
+				RectInt(0, 0, lw, lh),
+				level_transformation,
+				interpolation,
+				blend,
+				blend_amount,
+				blend_method );
+			return;
+		}
+	}
+
+	resample(
+		dest,
+		dest_bounds,
+		dest_clip,
+		packed,
+		src_bounds,
+		transformation,
+		interpolation,
+		blend,
+		blend_amount,
+		blend_method );
+}
+
 
 /* === E N T R Y P O I N T ================================================= */
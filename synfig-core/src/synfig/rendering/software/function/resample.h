@@ -62,6 +62,12 @@ public:
 		const RectInt &src_bounds,
 		bool keep_cooked = false );
 
+	//! Returns true if the source will be downscaled before resampling
+	static bool is_downscale_required(
+		const RectInt &src_bounds,
+		const Matrix &transformation,
+		Color::Interpolation interpolation );
+
 	static void resample(
 		synfig::Surface &dest,
 		const RectInt &dest_bounds,
@@ -83,6 +89,46 @@ public:
 		bool blend,
 		ColorReal blend_amount,
 		Color::BlendMethod blend_method );
+
+	//! Draws only the pixels inside dest_clip, other calculations use dest_bounds,
+	//! so the pixels are the same as if whole dest_bounds was resampled
+	static void resample(
+		synfig::Surface &dest,
+		const RectInt &dest_bounds,
+		const RectInt &dest_clip,
+		const synfig::Surface &src,
+		const RectInt &src_bounds,
+		const Matrix &transformation,
+		Color::Interpolation interpolation,
+		bool blend,
+		ColorReal blend_amount,
+		Color::BlendMethod blend_method );
+
+	static void resample(
+		synfig::Surface &dest,
+		const RectInt &dest_bounds,
+		const RectInt &dest_clip,
+		const software::PackedSurface &src,
+		const RectInt &src_bounds,
+		const Matrix &transformation,
+		Color::Interpolation interpolation,
+		bool blend,
+		ColorReal blend_amount,
+		Color::BlendMethod blend_method );
+
+	//! Same as previous, but takes downscaled copy of the source from Mipmap cache
+	//! when whole source should be downscaled
+	static void resample(
+		synfig::Surface &dest,
+		const RectInt &dest_bounds,
+		const RectInt &dest_clip,
+		const SurfaceSWPacked::Handle &src,
+		const RectInt &src_bounds,
+		const Matrix &transformation,
+		Color::Interpolation interpolation,
+		bool blend,
+		ColorReal blend_amount,
+		Color::BlendMethod blend_method );
 };
 
 } /* end namespace software */
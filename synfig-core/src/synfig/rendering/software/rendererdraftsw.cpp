@@ -32,12 +32,14 @@
 #include <synfig/localization.h>
 
 #include "rendererdraftsw.h"
+#include "renderersw.h"
 
 #include "task/tasksw.h"
 
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercontour.h"
 #include "../common/optimizer/optimizerdraft.h"
 #include "../common/optimizer/optimizerlist.h"
 #include "../common/optimizer/optimizersplit.h"
@@ -89,6 +91,7 @@ RendererDraftSW::RendererDraftSW()
 	register_optimizer(new OptimizerDraftLayerSkip("text"));
 	register_optimizer(new OptimizerDraftLayerSkip("xor_pattern"));
 
+	register_optimizer(new OptimizerContourRasterizer(TaskContour::RASTERIZER_BUCKETED));
 	register_optimizer(new OptimizerTransformation());
 	register_optimizer(new OptimizerDraftTransformation());
 
@@ -98,7 +101,9 @@ RendererDraftSW::RendererDraftSW()
 	register_optimizer(new OptimizerBlendToTarget());
 	register_optimizer(new OptimizerList());
 	register_optimizer(new OptimizerBlendAssociative());
-	//register_optimizer(new OptimizerSplit());
+	register_optimizer(new OptimizerSplit(get_max_simultaneous_threads()));
+	if (Optimizer::Handle optimizer = RendererSW::create_surface_format_optimizer())
+		register_optimizer(optimizer);
 }
 
 String RendererDraftSW::get_name() const
@@ -38,6 +38,7 @@
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercontour.h"
 #include "../common/optimizer/optimizerdraft.h"
 #include "../common/optimizer/optimizerlist.h"
 #include "../common/optimizer/optimizersplit.h"
@@ -64,6 +65,7 @@ RendererLowResSW::RendererLowResSW(int level):
 
 	// register optimizers
 	register_optimizer(new OptimizerDraftLowRes(level));
+	register_optimizer(new OptimizerContourRasterizer(TaskContour::RASTERIZER_BUCKETED));
 	register_optimizer(new OptimizerTransformation());
 	register_optimizer(new OptimizerDraftTransformation());
 
@@ -73,7 +75,7 @@ RendererLowResSW::RendererLowResSW(int level):
 	register_optimizer(new OptimizerBlendToTarget());
 	register_optimizer(new OptimizerList());
 	register_optimizer(new OptimizerBlendAssociative());
-	//register_optimizer(new OptimizerSplit());
+	register_optimizer(new OptimizerSplit(get_max_simultaneous_threads()));
 }
 
 String RendererLowResSW::get_name() const
@@ -32,12 +32,14 @@
 #include <synfig/localization.h>
 
 #include "rendererpreviewsw.h"
+#include "renderersw.h"
 
 #include  "task/tasksw.h"
 
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercontour.h"
 #include "../common/optimizer/optimizerlist.h"
 #include "../common/optimizer/optimizersplit.h"
 #include "../common/optimizer/optimizertransformation.h"
@@ -64,6 +66,7 @@ RendererPreviewSW::RendererPreviewSW()
 	register_mode(TaskSW::mode_token.handle());
 
 	// register optimizers
+	register_optimizer(new OptimizerContourRasterizer(TaskContour::RASTERIZER_BUCKETED));
 	register_optimizer(new OptimizerTransformation());
 	register_optimizer(new OptimizerDraftTransformation());
 	register_optimizer(new OptimizerPass(false));
@@ -72,7 +75,9 @@ RendererPreviewSW::RendererPreviewSW()
 	register_optimizer(new OptimizerList());
 	register_optimizer(new OptimizerBlendToTarget());
 	register_optimizer(new OptimizerBlendAssociative());
-	//register_optimizer(new OptimizerSplit());
+	register_optimizer(new OptimizerSplit(get_max_simultaneous_threads()));
+	if (Optimizer::Handle optimizer = RendererSW::create_surface_format_optimizer())
+		register_optimizer(optimizer);
 }
 
 String RendererPreviewSW::get_name() const
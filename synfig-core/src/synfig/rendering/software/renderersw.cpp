@@ -29,6 +29,9 @@
 #	include <config.h>
 #endif
 
+#include <cstdlib>
+
+#include <synfig/general.h>
 #include <synfig/localization.h>
 
 #include "renderersw.h"
@@ -38,13 +41,18 @@
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercontour.h"
 #include "../common/optimizer/optimizerlist.h"
 #include "../common/optimizer/optimizersplit.h"
+#include "../common/optimizer/optimizersurfaceformat.h"
 #include "../common/optimizer/optimizertransformation.h"
 #include "../common/optimizer/optimizerpass.h"
 
 #include "function/fft.h"
 
+#include "surfaceswhalf.h"
+#include "surfaceswpremulted8.h"
+
 #endif
 
 using namespace synfig;
@@ -63,6 +71,7 @@ RendererSW::RendererSW()
 	register_mode(TaskSW::mode_token.handle());
 
 	// register optimizers
+	register_optimizer(new OptimizerContourRasterizer(TaskContour::RASTERIZER_BUCKETED));
 	register_optimizer(new OptimizerTransformation());
 
 	register_optimizer(new OptimizerPass(false));
@@ -71,13 +80,33 @@ RendererSW::RendererSW()
 	register_optimizer(new OptimizerList());
 	register_optimizer(new OptimizerBlendToTarget());
 	register_optimizer(new OptimizerBlendAssociative());
-	//register_optimizer(new OptimizerSplit());
+	register_optimizer(new OptimizerSplit(get_max_simultaneous_threads()));
+
+	if (Optimizer::Handle optimizer = create_surface_format_optimizer())
+		register_optimizer(optimizer);
 }
 
 RendererSW::~RendererSW() { }
 
 String RendererSW::get_name() const { return _("Cobra (software)"); }
 
+Optimizer::Handle RendererSW::create_surface_format_optimizer()
+{
+	// intermediate surfaces are stored as floats unless lower precision is allowed:
+	// "half" - RGBA16F, "byte" - also premultiplied RGBA8 for composited surfaces,
+	// RGBA8 clamps colors to [0, 1], so it is never used by default
+	if (const char *s = getenv("SYNFIG_RENDERING_SURFACE_FORMAT")) {
+		String format(s);
+		if (format == "half")
+			return new OptimizerSurfaceFormat(SurfaceSWHalf::token.handle(), Surface::Token::Handle());
+		if (format == "byte")
+			return new OptimizerSurfaceFormat(SurfaceSWHalf::token.handle(), SurfaceSWPremulted8::token.handle());
+		if (format != "float")
+			synfig::warning("SYNFIG_RENDERING_SURFACE_FORMAT: unknown format '%s'", s);
+	}
+	return Optimizer::Handle();
+}
+
 void RendererSW::initialize()
 {
 	software::FFT::initialize();
@@ -50,6 +50,10 @@ public:
 
 	virtual String get_name() const;
 
+	//! Returns optimizer selected by SYNFIG_RENDERING_SURFACE_FORMAT,
+	//! or null when intermediate surfaces should stay in float format
+	static Optimizer::Handle create_surface_format_optimizer();
+
 	static void initialize();
 	static void deinitialize();
 };
@@ -29,6 +29,11 @@
 #	include <config.h>
 #endif
 
+#include <cstring>
+#include <vector>
+
+#include <synfig/debug/profiler.h>
+
 #include "surfacesw.h"
 
 #endif
@@ -60,7 +65,6 @@ SurfaceSW::SurfaceSW(synfig::Surface &surface, bool own_surface):
 {
 	assert(this->surface);
 	set_desc(this->surface->get_w(), this->surface->get_h(), false);
-	assert((int)this->surface->get_pitch() == (int)sizeof(Color)*get_width());
 }
 
 SurfaceSW::~SurfaceSW()
@@ -77,6 +81,7 @@ SurfaceSW::create_vfunc(int width, int height)
 	assert(surface);
 	surface->set_wh(width, height);
 	surface->clear();
+	debug::Profiler::add_allocated((long long)width*height*sizeof(Color));
 	return true;
 }
 
@@ -84,7 +89,24 @@ bool
 SurfaceSW::assign_vfunc(const rendering::Surface &surface)
 {
 	assert(this->surface);
+
+	// keep the rows of external buffer (see Target_Scanline), set_wh() would detach them
+	if (this->surface->get_w() == surface.get_width() && this->surface->get_h() == surface.get_height() && !get_pixels_pointer()) {
+		std::vector<Color> data;
+		const Color *pixels = surface.get_pixels_pointer();
+		if (!pixels) {
+			data.resize(surface.get_pixels_count());
+			if (!surface.get_pixels(&data.front()))
+				return false;
+			pixels = &data.front();
+		}
+		for(int y = 0; y < surface.get_height(); ++y, pixels += surface.get_width())
+			memcpy((*this->surface)[y], pixels, surface.get_width()*sizeof(Color));
+		return true;
+	}
+
 	this->surface->set_wh(surface.get_width(), surface.get_height());
+	debug::Profiler::add_allocated((long long)surface.get_pixels_count()*sizeof(Color));
 	if (surface.get_pixels(&(*this->surface)[0][0]))
 		return true;
 	this->surface->set_wh(0, 0);
@@ -112,10 +134,23 @@ const Color*
 SurfaceSW::get_pixels_pointer_vfunc() const
 {
 	assert(surface);
-	assert((int)surface->get_pitch() == (int)sizeof(Color)*get_width());
+	// surface may wrap the rows of external buffer (see Target_Scanline)
+	if ((int)surface->get_pitch() != (int)sizeof(Color)*get_width())
+		return NULL;
 	return &(*this->surface)[0][0];
 }
 
+bool
+SurfaceSW::get_pixels_vfunc(Color *dest) const
+{
+	assert(surface);
+	if (const Color *src = get_pixels_pointer())
+		{ memcpy(dest, src, get_buffer_size()); return true; }
+	for(int y = 0; y < get_height(); ++y, dest += get_width())
+		memcpy(dest, (*surface)[y], get_width()*sizeof(Color));
+	return true;
+}
+
 void
 SurfaceSW::set_surface(synfig::Surface &surface, bool own_surface)
 {
@@ -132,7 +167,6 @@ SurfaceSW::set_surface(synfig::Surface &surface, bool own_surface)
 	this->surface = &surface;
 	assert(this->surface);
 	set_desc(surface.get_w(), surface.get_h(), false);
-	assert((int)this->surface->get_pitch() == (int)sizeof(Color)*get_width());
 }
 
 void
@@ -61,6 +61,7 @@ protected:
 	virtual bool clear_vfunc();
 	virtual bool reset_vfunc();
 	virtual const Color* get_pixels_pointer_vfunc() const;
+	virtual bool get_pixels_vfunc(Color *dest) const;
 
 public:
 	SurfaceSW();
@@ -0,0 +1,106 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswhalf.cpp
+**	\brief SurfaceSWHalf
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+
+#include <synfig/debug/profiler.h>
+
+#include "surfaceswhalf.h"
+
+#include "function/pixelpack.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+rendering::Surface::Token SurfaceSWHalf::token(
+	Desc<SurfaceSWHalf>("SurfaceSWHalf") );
+
+
+bool
+SurfaceSWHalf::create_vfunc(int width, int height)
+{
+	data.assign(4*(size_t)width*height, 0);
+	debug::Profiler::add_allocated(data.size()*sizeof(uint16_t));
+	return true;
+}
+
+bool
+SurfaceSWHalf::assign_vfunc(const rendering::Surface &surface)
+{
+	int count = surface.get_pixels_count();
+	data.resize(4*(size_t)count);
+	debug::Profiler::add_allocated(data.size()*sizeof(uint16_t));
+	if (const Color *pixels = surface.get_pixels_pointer()) {
+		software::PixelPack::pack_half(&data.front(), pixels, count);
+		return true;
+	}
+	std::vector<Color> pixels(count);
+	if (!surface.get_pixels(&pixels.front()))
+		return false;
+	software::PixelPack::pack_half(&data.front(), &pixels.front(), count);
+	return true;
+}
+
+bool
+SurfaceSWHalf::clear_vfunc()
+{
+	std::fill(data.begin(), data.end(), 0);
+	return true;
+}
+
+bool
+SurfaceSWHalf::reset_vfunc()
+{
+	std::vector<uint16_t>().swap(data);
+	return true;
+}
+
+bool
+SurfaceSWHalf::get_pixels_vfunc(Color *buffer) const
+{
+	if (data.empty())
+		return false;
+	software::PixelPack::unpack_half(buffer, &data.front(), (int)(data.size()/4));
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,79 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswhalf.h
+**	\brief SurfaceSWHalf Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SURFACESWHALF_H
+#define __SYNFIG_RENDERING_SURFACESWHALF_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "../surface.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Stores pixels as four half-precision floats (RGBA16F), 8 bytes per pixel.
+//! Keeps range of Color, precision is about 3 decimal digits,
+//! used to keep intermediate results (see OptimizerSurfaceFormat).
+class SurfaceSWHalf: public Surface
+{
+public:
+	typedef etl::handle<SurfaceSWHalf> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const
+		{ return token.handle(); }
+
+protected:
+	virtual bool create_vfunc(int width, int height);
+	virtual bool assign_vfunc(const Surface &surface);
+	virtual bool clear_vfunc();
+	virtual bool reset_vfunc();
+	virtual bool get_pixels_vfunc(Color *buffer) const;
+
+private:
+	//! four channels per pixel
+	std::vector<uint16_t> data;
+
+public:
+	const uint16_t* get_data() const
+		{ return data.empty() ? NULL : &data.front(); }
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
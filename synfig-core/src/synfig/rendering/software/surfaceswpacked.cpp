@@ -30,6 +30,7 @@
 #endif
 
 #include "surfaceswpacked.h"
+#include "function/mipmap.h"
 
 #endif
 
@@ -60,6 +61,7 @@ SurfaceSWPacked::assign_vfunc(const rendering::Surface &surface)
 			return false;
 		pixels = &data.front();
 	}
+	software::Mipmap::forget(this);
 	this->surface.set_pixels(pixels, surface.get_width(), surface.get_height());
 	return true;
 }
@@ -67,6 +69,7 @@ SurfaceSWPacked::assign_vfunc(const rendering::Surface &surface)
 bool
 SurfaceSWPacked::reset_vfunc()
 {
+	software::Mipmap::forget(this);
 	surface.clear();
 	return true;
 }
@@ -0,0 +1,79 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswpremulted8.h
+**	\brief SurfaceSWPremulted8 Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SURFACESWPREMULTED8_H
+#define __SYNFIG_RENDERING_SURFACESWPREMULTED8_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "../surface.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Stores pixels as four 8-bit channels with premultiplied alpha, 4 bytes per pixel.
+//! Colors are clamped to [0, 1], so it fits only for results which
+//! will be composited into 8-bit output (see OptimizerSurfaceFormat).
+class SurfaceSWPremulted8: public Surface
+{
+public:
+	typedef etl::handle<SurfaceSWPremulted8> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const
+		{ return token.handle(); }
+
+protected:
+	virtual bool create_vfunc(int width, int height);
+	virtual bool assign_vfunc(const Surface &surface);
+	virtual bool clear_vfunc();
+	virtual bool reset_vfunc();
+	virtual bool get_pixels_vfunc(Color *buffer) const;
+
+private:
+	//! four channels per pixel
+	std::vector<uint8_t> data;
+
+public:
+	const uint8_t* get_data() const
+		{ return data.empty() ? NULL : &data.front(); }
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -32,6 +32,7 @@
 #include <synfig/debug/debugsurface.h>
 
 #include "../../common/task/taskblend.h"
+#include "../function/blend.h"
 #include "tasksw.h"
 
 #endif
@@ -121,22 +122,14 @@ public:
 				{
 					LockRead lb(sub_task_b());
 					if (!lb) return false;
-					synfig::Surface &b = lb.cast_handle()->get_surface(); // TODO: make blit_to constant
+					const synfig::Surface &b = lb->get_surface();
 
 					assert( 0 <= rb.minx && rb.minx < rb.maxx && rb.maxx <= c.get_w()
 						 && 0 <= rb.miny && rb.miny < rb.maxy && rb.miny <= c.get_h() );
 					assert( 0 <= rb.minx + ob[0] && rb.maxx + ob[0] <= b.get_w()
 						 && 0 <= rb.miny + ob[1] && rb.maxy + ob[1] <= b.get_h() );
 
-					synfig::Surface::alpha_pen ap(c.get_pen(rb.minx, rb.miny));
-					ap.set_blend_method(blend_method);
-					ap.set_alpha(amount);
-					b.blit_to(
-						ap,
-						rb.minx + ob[0],
-						rb.miny + ob[1],
-						rb.maxx - rb.minx,
-						rb.maxy - rb.miny );
+					software::Blend::blend(c, rb, b, rb.get_min() + ob, blend_method, amount);
 
 					if (ra.is_valid())
 					{
@@ -161,13 +154,7 @@ public:
 					assert( 0 <= fill[i].minx && fill[i].minx < fill[i].maxx && fill[i].maxx <= c.get_w()
 						 && 0 <= fill[i].miny && fill[i].miny < fill[i].maxy && fill[i].miny <= c.get_h() );
 
-					synfig::Surface::alpha_pen ap(
-						c.get_pen(fill[i].minx, fill[i].miny) );
-					ap.set_blend_method(blend_method);
-					ap.set_alpha(amount);
-					c.fill( Color(0, 0, 0, 0), ap,
-							fill[i].maxx - fill[i].minx,
-							fill[i].maxy - fill[i].miny );
+					software::Blend::fill(c, fill[i], Color(0, 0, 0, 0), blend_method, amount);
 				}
 			}
 		}
@@ -49,7 +49,9 @@ using namespace rendering;
 
 namespace {
 
-class TaskBlurSW: public TaskBlur, public TaskSW, public TaskInterfaceBlendToTarget
+class TaskBlurSW: public TaskBlur, public TaskSW,
+	public TaskInterfaceBlendToTarget,
+	public TaskInterfaceSplit
 {
 public:
 	typedef etl::handle<TaskBlurSW> Handle;
@@ -61,6 +63,12 @@ public:
 	virtual Color::BlendMethodFlags get_supported_blend_methods() const
 		{ return Color::BLEND_METHODS_ALL & ~Color::BLEND_METHODS_STRAIGHT; }
 
+	// other blur algorithms accumulate values along the whole rect
+	virtual bool is_splittable() const {
+		Vector s = blur.size.multiply_coords(get_whole_pixels_per_unit());
+		return software::Blur::is_pattern_used(blur.type, software::Blur::get_extra_size(blur.type, s));
+	}
+
 	virtual bool run(RunParams&) const {
 		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
 			return true;
@@ -70,7 +78,7 @@ public:
 		if (!la || !lb)
 			return false;
 
-		Vector ppu = get_pixels_per_unit();
+		Vector ppu = get_whole_pixels_per_unit();
 		Vector s = blur.size.multiply_coords(ppu);
 
 		VectorInt offset = TaskList::calc_target_offset(*this, *sub_task());
@@ -76,26 +76,62 @@ public:
 	virtual Color::BlendMethodFlags get_supported_blend_methods() const
 		{ return Color::BLEND_METHODS_ALL & ~Color::BLEND_METHODS_STRAIGHT; }
 
+	// inverted contour fills the rows without marks,
+	// so the part may differ from the same rows of the whole contour,
+	// bucketed rasterizer renders each row independently, so it has no such problem
+	virtual bool is_splittable() const
+		{ return contour && (!contour->invert || rasterizer == RASTERIZER_BUCKETED); }
+
 	virtual bool run(RunParams&) const {
 		if (!is_valid())
 			return true;
 		if (!contour)
 			return false;
 
-		Vector ppu = get_pixels_per_unit();
+		// build polyspan for the whole task and take only own rows,
+		// so parts of the split task give exactly the same pixels
+		const Rect &whole_source_rect = get_whole_source_rect();
+		const RectInt &whole_target_rect = get_whole_target_rect();
+		Vector ppu = get_whole_pixels_per_unit();
 
 		Matrix bounds_transfromation;
 		bounds_transfromation.m00 = ppu[0];
 		bounds_transfromation.m11 = ppu[1];
-		bounds_transfromation.m20 = target_rect.minx - ppu[0]*source_rect.minx;
-		bounds_transfromation.m21 = target_rect.miny - ppu[1]*source_rect.miny;
+		bounds_transfromation.m20 = whole_target_rect.minx - ppu[0]*whole_source_rect.minx;
+		bounds_transfromation.m21 = whole_target_rect.miny - ppu[1]*whole_source_rect.miny;
 
 		Matrix matrix = bounds_transfromation * transformation->matrix;
 
 		Polyspan polyspan;
-		polyspan.init(target_rect);
+		polyspan.init(whole_target_rect);
 		software::Contour::build_polyspan(contour->get_chunks(), matrix, polyspan, detail);
 		polyspan.close();
+
+		if (rasterizer == RASTERIZER_BUCKETED) {
+			polyspan.flush_marks();
+
+			LockWrite la(this);
+			if (!la)
+				return false;
+
+			software::Contour::render_polyspan_bucketed(
+				la->get_surface(),
+				polyspan,
+				target_rect.miny,
+				target_rect.maxy,
+				contour->invert,
+				allow_antialias && contour->antialias,
+				contour->winding_style,
+				contour->color,
+				blend ? amount : 1.0,
+				blend ? blend_method : Color::BLEND_COMPOSITE );
+
+			return true;
+		}
+
+		// drop marks of other parts before sorting, sort is the most expensive step
+		if (is_split_part())
+			polyspan.crop_rows(target_rect.miny, target_rect.maxy);
 		polyspan.sort_marks();
 
 		LockWrite la(this);
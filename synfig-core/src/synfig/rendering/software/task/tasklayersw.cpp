@@ -29,6 +29,10 @@
 #	include <config.h>
 #endif
 
+#include <cstring>
+
+#include <algorithm>
+
 #include <synfig/guid.h>
 #include <synfig/canvas.h>
 #include <synfig/context.h>
@@ -53,29 +57,40 @@ using namespace rendering;
 
 namespace {
 
-class TaskLayerSW: public TaskLayer, public TaskSW
+class TaskLayerSW: public TaskLayer, public TaskSW,
+	public TaskInterfaceSplit
 {
 public:
 	typedef etl::handle<TaskLayerSW> Handle;
 	static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
 
+	virtual bool is_splittable() const
+		{ return layer && layer->is_render_thread_safe(); }
+
 	virtual bool run(RunParams&) const {
 		if (!is_valid() || !layer)
 			return false;
 
-		Vector upp = get_units_per_pixel();
-		Vector lt = source_rect.get_min();
-		Vector rb = source_rect.get_max();
-		lt[0] -= target_rect.minx*upp[0];
-		lt[1] -= target_rect.miny*upp[1];
-		rb[0] += (target_surface->get_width() - target_rect.maxx)*upp[0];
-		rb[1] += (target_surface->get_height() - target_rect.maxy)*upp[1];
-
 		RendDesc desc;
-		desc.set_tl(lt);
-		desc.set_br(rb);
-		desc.set_wh(target_surface->get_width(), target_surface->get_height());
+		if (is_split_part()) {
+			// render only own band, other bands are rendered by parallel tasks
+			desc.set_tl(source_rect.get_min());
+			desc.set_br(source_rect.get_max());
+			desc.set_wh(target_rect.get_width(), target_rect.get_height());
+		} else {
+			Vector upp = get_units_per_pixel();
+			Vector lt = source_rect.get_min();
+			Vector rb = source_rect.get_max();
+			lt[0] -= target_rect.minx*upp[0];
+			lt[1] -= target_rect.miny*upp[1];
+			rb[0] += (target_surface->get_width() - target_rect.maxx)*upp[0];
+			rb[1] += (target_surface->get_height() - target_rect.maxy)*upp[1];
+
+			desc.set_tl(lt);
+			desc.set_br(rb);
+			desc.set_wh(target_surface->get_width(), target_surface->get_height());
+		}
 		desc.set_antialias(1);
 
 		etl::handle<Layer_RenderingTask> sub_layer(new Layer_RenderingTask());
@@ -88,6 +103,24 @@ public:
 
 		Context context(fake_canvas_base.begin(), ContextParams());
 
+		if (is_split_part()) {
+			// render without lock, target surface is locked only to copy the band
+			synfig::Surface surface;
+			if (!context.accelerated_render(&surface, 4, desc, NULL))
+				return false;
+
+			LockWrite ldst(this);
+			if (!ldst)
+				return false;
+
+			synfig::Surface &dst = ldst->get_surface();
+			int w = std::min(surface.get_w(), target_rect.get_width());
+			int h = std::min(surface.get_h(), target_rect.get_height());
+			for(int y = 0; y < h; ++y)
+				memcpy(&dst[target_rect.miny + y][target_rect.minx], surface[y], w*sizeof(Color));
+			return true;
+		}
+
 		LockWrite ldst(this);
 		if (!ldst)
 			return false;
@@ -96,7 +129,6 @@ public:
 	}
 };
 
-
 Task::Token TaskLayerSW::token(
 	DescReal<TaskLayerSW, TaskLayer>("LayerSW") );
 
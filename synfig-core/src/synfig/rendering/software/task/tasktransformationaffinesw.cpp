@@ -57,7 +57,8 @@ using namespace rendering;
 namespace {
 
 class TaskTransformationAffineSW: public TaskTransformationAffine, public TaskSW,
-	public TaskInterfaceBlendToTarget
+	public TaskInterfaceBlendToTarget,
+	public TaskInterfaceSplit
 {
 private:
 	class Helper;
@@ -71,17 +72,9 @@ public:
 	virtual Color::BlendMethodFlags get_supported_blend_methods() const
 		{ return Color::BLEND_METHODS_ALL; }
 
-	virtual bool run(RunParams&) const
+	// transformation matrix from pixels of sub-task to pixels of the whole task
+	Matrix calc_matrix() const
 	{
-		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
-			return true;
-
-		LockWrite ldst(this);
-		if (!ldst)
-			return false;
-
-		// transformation matrix
-
 		Vector src_upp = sub_task()->get_units_per_pixel();
 		Matrix src_pixels_to_units;
 		src_pixels_to_units.m00 = src_upp[0];
@@ -89,14 +82,43 @@ public:
 		src_pixels_to_units.m20 = sub_task()->source_rect.minx - src_upp[0]*sub_task()->target_rect.minx;
 		src_pixels_to_units.m21 = sub_task()->source_rect.miny - src_upp[1]*sub_task()->target_rect.miny;
 
-		Vector dst_ppu = get_pixels_per_unit();
+		const Rect &whole_source_rect = get_whole_source_rect();
+		const RectInt &whole_target_rect = get_whole_target_rect();
+		Vector dst_ppu = get_whole_pixels_per_unit();
 		Matrix dst_units_to_pixels;
 		dst_units_to_pixels.m00 = dst_ppu[0];
 		dst_units_to_pixels.m11 = dst_ppu[1];
-		dst_units_to_pixels.m20 = target_rect.minx - dst_ppu[0]*source_rect.minx;
-		dst_units_to_pixels.m21 = target_rect.miny - dst_ppu[1]*source_rect.miny;
+		dst_units_to_pixels.m20 = whole_target_rect.minx - dst_ppu[0]*whole_source_rect.minx;
+		dst_units_to_pixels.m21 = whole_target_rect.miny - dst_ppu[1]*whole_source_rect.miny;
 
-		Matrix matrix = dst_units_to_pixels * transformation->matrix * src_pixels_to_units;
+		return dst_units_to_pixels * transformation->matrix * src_pixels_to_units;
+	}
+
+	// each part downscales the whole source, it's too expensive
+	virtual bool is_splittable() const
+	{
+		return sub_task()
+			&& sub_task()->is_valid_coords()
+			&& !software::Resample::is_downscale_required(
+				sub_task()->target_rect, calc_matrix(), interpolation );
+	}
+
+	virtual bool run(RunParams&) const
+	{
+		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
+			return true;
+
+		LockWrite ldst(this);
+		if (!ldst)
+			return false;
+
+		// transformation matrix
+		// source pixels are mapped to the whole target rect,
+		// and only own target rect is drawn, so parts of the split task
+		// give the same pixels as the whole task
+
+		Matrix matrix = calc_matrix();
+		const RectInt &whole_target_rect = get_whole_target_rect();
 
 		// resample
 		LockReadBase lsrc(sub_task());
@@ -105,8 +127,9 @@ public:
 			if (!src) return false;
 			software::Resample::resample(
 				ldst->get_surface(),
+				whole_target_rect,
 				target_rect,
-				src->get_surface(),
+				src,
 				sub_task()->target_rect,
 				matrix,
 				interpolation,
@@ -119,6 +142,7 @@ public:
 			if (!src) return false;
 			software::Resample::resample(
 				ldst->get_surface(),
+				whole_target_rect,
 				target_rect,
 				src->get_surface(),
 				sub_task()->target_rect,
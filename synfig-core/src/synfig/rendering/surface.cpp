@@ -49,7 +49,7 @@ using namespace rendering;
 /* === M E T H O D S ======================================================= */
 
 synfig::Token Surface::token;
-int SurfaceResource::last_id = 0;
+std::atomic<SurfaceResource::Id> SurfaceResource::last_id(0);
 
 Surface::Surface():
 	blank(true),
@@ -211,12 +211,15 @@ Surface::touch()
 
 SurfaceResource::SurfaceResource():
 	id(++last_id),
+	revision(),
 	width(),
 	height(),
 	blank(true)
 { }
 
 SurfaceResource::SurfaceResource(Surface::Handle surface):
+	id(++last_id),
+	revision(),
 	width(),
 	height(),
 	blank(true)
@@ -287,6 +290,7 @@ SurfaceResource::get_surface(
 			{ surfaces.clear(); surfaces[token] = surface; }
 		surface->touch();
 		blank = false;
+		++revision;
 	}
 	return surface;
 }
@@ -305,6 +309,7 @@ SurfaceResource::create(int width, int height)
 	}
 	blank = true;
 	surfaces.clear();
+	++revision;
 }
 
 void
@@ -321,6 +326,7 @@ SurfaceResource::assign(Surface::Handle surface)
 	height = 0;
 	blank = true;
 	surfaces.clear();
+	++revision;
 	if (!surface->is_exists())
 		return;
 
@@ -337,6 +343,7 @@ SurfaceResource::clear()
 	std::lock_guard<std::mutex> short_lock(mutex);
 	blank = true;
 	surfaces.clear();
+	++revision;
 }
 
 void
@@ -348,6 +355,7 @@ SurfaceResource::reset()
 	height = 0;
 	blank = true;
 	surfaces.clear();
+	++revision;
 }
 
 /* === E N T R Y P O I N T ================================================= */
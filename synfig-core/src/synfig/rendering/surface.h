@@ -30,6 +30,7 @@
 #include <map>
 #include <vector>
 
+#include <atomic>
 #include <mutex>
 #include <glibmm/threads.h>
 
@@ -324,10 +325,14 @@ public:
 			{ assert(get()); return *get(); }
 	};
 
+	//! 64-bit, so ids never repeat, TaskCache identifies surfaces by them
+	typedef unsigned long long Id;
+
 private:
-	static int last_id;
+	static std::atomic<Id> last_id;
 
-	int id;
+	Id id;
+	int revision;
 	int width;
 	int height;
 	bool blank;
@@ -357,8 +362,11 @@ public:
 	void create(const VectorInt &x)
 		{ create(x[0], x[1]); }
 
-	int get_id() const //!< helps to debug of renderer optimizers
+	Id get_id() const //!< unique for every resource, see TaskSurface::hash_params()
 		{ return id; }
+	//! increments every time when content of surface may be changed (see TaskCache)
+	int get_revision() const
+		{ std::lock_guard<std::mutex> lock(mutex); return revision; }
 	int get_width() const
 		{ std::lock_guard<std::mutex> lock(mutex); return width; }
 	int get_height() const
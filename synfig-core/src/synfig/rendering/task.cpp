@@ -57,6 +57,8 @@ SYNFIG_EXPORT Task::Token TaskSurface::token(
 	DescSpecial<TaskSurface>("Surface") );
 Task::Token TaskLockSurface::token(
 	DescSpecial<TaskLockSurface>("LoskSurface") );
+Task::Token TaskSurfaceConvert::token(
+	DescSpecial<TaskSurfaceConvert>("SurfaceConvert") );
 Task::Token TaskList::token(
 	DescSpecial<TaskList>("List") );
 SYNFIG_EXPORT Task::Token TaskEvent::token(
@@ -106,6 +108,7 @@ void
 Task::assign(const Task &other) {
 	assign_target(other);
 	sub_tasks = other.sub_tasks;
+	source_layer = other.source_layer;
 	renderer_data = other.renderer_data; // TODO: remove renderer_data from task
 }
 
@@ -179,6 +182,16 @@ Task::clone_recursive() const
 	return task;
 }
 
+void
+Task::set_source_layer(const String &layer)
+{
+	// tasks of layers below are already marked, so only new tasks will be visited
+	if (!source_layer.empty()) return;
+	source_layer = layer;
+	for(List::const_iterator i = sub_tasks.begin(); i != sub_tasks.end(); ++i)
+		if (*i) (*i)->set_source_layer(layer);
+}
+
 Vector
 Task::get_pixels_per_unit() const
 {
@@ -315,11 +328,94 @@ Task::set_coords_sub_tasks()
 		if (*i) (*i)->set_coords(source_rect, target_rect.get_size());
 }
 
+bool
+Task::calc_hash(TaskHash::Value &out_hash, HashMap *sub_hashes) const
+{
+	TaskHash hash;
+
+	// content of target surface is a part of result,
+	// so only surfaces of TaskSurface (which are hashed by identity) are allowed to be not blank
+	bool valid = !target_surface
+	          || target_surface->is_blank()
+	          || dynamic_cast<const TaskSurface*>(this);
+	if (valid) {
+		hash.add(get_token()->name);
+		hash.add(source_rect);
+		hash.add(target_rect);
+		valid = hash_params(hash);
+	}
+	if (!valid && !sub_hashes)
+		return false;
+
+	// sub-tasks are processed even when this task is not hashable,
+	// to collect hashes of all hashable sub-trees
+	hash.add((int)sub_tasks.size());
+	for(List::const_iterator i = sub_tasks.begin(); i != sub_tasks.end(); ++i) {
+		TaskHash::Value sub_hash = 0;
+		if (*i && !(*i)->calc_hash(sub_hash, sub_hashes)) {
+			if (!sub_hashes) return false;
+			valid = false;
+		}
+		hash.add((bool)*i);
+		hash.add(&sub_hash, sizeof(sub_hash));
+	}
+
+	if (!valid)
+		return false;
+	out_hash = hash.get();
+	if (sub_hashes)
+		(*sub_hashes)[this] = out_hash;
+	return true;
+}
+
 bool
 Task::run(RunParams & /* params */) const
 	{ return false; }
 
 
+// TaskInterfaceSplit
+
+void
+TaskInterfaceSplit::remember_whole_coords()
+{
+	if (is_split_part()) return;
+	const Task *task = dynamic_cast<const Task*>(this);
+	assert(task);
+	whole_source_rect = task->source_rect;
+	whole_target_rect = task->target_rect;
+}
+
+const Rect&
+TaskInterfaceSplit::get_whole_source_rect() const
+{
+	if (is_split_part()) return whole_source_rect;
+	const Task *task = dynamic_cast<const Task*>(this);
+	assert(task);
+	return task->source_rect;
+}
+
+const RectInt&
+TaskInterfaceSplit::get_whole_target_rect() const
+{
+	if (is_split_part()) return whole_target_rect;
+	const Task *task = dynamic_cast<const Task*>(this);
+	assert(task);
+	return task->target_rect;
+}
+
+Vector
+TaskInterfaceSplit::get_whole_pixels_per_unit() const
+{
+	const Rect &sr = get_whole_source_rect();
+	const RectInt &tr = get_whole_target_rect();
+	if (sr.is_nan_or_inf() || !sr.is_valid() || !tr.is_valid())
+		return Vector();
+	return Vector(
+		(Real)tr.get_width()/sr.get_width(),
+		(Real)tr.get_height()/sr.get_height() );
+}
+
+
 // TaskList
 
 VectorInt
@@ -336,6 +432,22 @@ TaskList::calc_target_offset(const Task &a, const Task &b)
 }
 
 
+// TaskSurface
+
+bool
+TaskSurface::hash_params(TaskHash &hash) const
+{
+	bool exists = target_surface && !target_surface->is_blank();
+	hash.add(exists);
+	if (exists) {
+		SurfaceResource::Id id = target_surface->get_id();
+		hash.add(&id, sizeof(id));
+		hash.add(target_surface->get_revision());
+	}
+	return true;
+}
+
+
 // TaskLockSurface
 
 void
@@ -375,6 +487,18 @@ TaskLockSurface::unlock() {
 }
 
 
+// TaskSurfaceConvert
+
+bool
+TaskSurfaceConvert::run(RunParams&) const
+{
+	if (!format || !is_valid())
+		return true;
+	SurfaceResource::LockWriteBase lock(target_surface);
+	return lock.convert(format);
+}
+
+
 // TaskEvent
 
 TaskEvent&
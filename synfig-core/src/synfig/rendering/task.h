@@ -91,6 +91,38 @@ public:
 };
 
 
+//! 64-bit FNV-1a hash of task parameters, see Task::calc_hash()
+class TaskHash
+{
+public:
+	typedef unsigned long long Value;
+
+private:
+	Value value;
+
+public:
+	TaskHash(): value(14695981039346656037ull) { }
+
+	void add(const void *data, size_t size) {
+		const unsigned char *c = (const unsigned char*)data;
+		for(const unsigned char *end = c + size; c < end; ++c)
+			value = (value ^ *c)*1099511628211ull;
+	}
+
+	void add(bool x)            { add(&x, sizeof(x)); }
+	void add(int x)             { add(&x, sizeof(x)); }
+	void add(float x)           { add(&x, sizeof(x)); }
+	void add(double x)          { add(&x, sizeof(x)); }
+	void add(const String &x)   { add((int)x.size()); add(x.c_str(), x.size()); }
+	void add(const Vector &x)   { add(x[0]); add(x[1]); }
+	void add(const Rect &x)     { add(x.minx); add(x.miny); add(x.maxx); add(x.maxy); }
+	void add(const RectInt &x)  { add(x.minx); add(x.miny); add(x.maxx); add(x.maxy); }
+
+	Value get() const
+		{ return value; }
+};
+
+
 // Mode
 
 
@@ -133,6 +165,7 @@ public:
 	typedef etl::handle<Task> Handle;
 	typedef std::vector<Handle> List;
 	typedef std::set<Handle> Set;
+	typedef std::map<const Task*, TaskHash::Value> HashMap;
 
 	typedef Task* (*Fabric)();
 	typedef Task* (*CloneFabric)(const Task&);
@@ -274,6 +307,15 @@ public:
 
 	struct RendererData
 	{
+		enum State {
+			STATE_WAITING,   //!< task enqueued and waits for dependencies
+			STATE_PREPARING, //!< all dependencies are done, task moves to ready queue
+			STATE_READY,     //!< task is in ready queue
+			STATE_RUNNING,
+			STATE_DONE,
+			STATE_CANCELLED
+		};
+
 		int batch_index;
 		int index;
 		Set deps;
@@ -285,7 +327,34 @@ public:
 		RunParams params;
 		bool success;
 
-		RendererData(): batch_index(), index(), success() { }
+		//! count of not finished dependencies, task is ready to run when it reaches zero
+		std::atomic<int> deps_count;
+		//! count of not cancelled dependent tasks, task is orphan when it reaches zero
+		std::atomic<int> back_deps_count;
+		std::atomic<int> state;
+
+		RendererData():
+			batch_index(), index(), success(),
+			deps_count(), back_deps_count(), state(STATE_WAITING) { }
+		RendererData(const RendererData &other):
+			batch_index(), index(), success(),
+			deps_count(), back_deps_count(), state(STATE_WAITING)
+			{ *this = other; }
+
+		RendererData& operator=(const RendererData &other) {
+			batch_index = other.batch_index;
+			index = other.index;
+			deps = other.deps;
+			back_deps = other.back_deps;
+			tmp_deps = other.tmp_deps;
+			tmp_back_deps = other.tmp_back_deps;
+			params = other.params;
+			success = other.success;
+			deps_count = other.deps_count.load();
+			back_deps_count = other.back_deps_count.load();
+			state = other.state.load();
+			return *this;
+		}
 	};
 
 	class LockReadBase: public SurfaceResource::LockReadBase
@@ -361,6 +430,8 @@ public:
 	RectInt target_rect;
 	SurfaceResource::Handle target_surface;
 	List sub_tasks;
+	//! description of the layer which has built this task, filled only while profiling
+	String source_layer;
 
 	mutable RendererData renderer_data;
 
@@ -412,6 +483,9 @@ public:
 	Task::Handle clone() const;
 	Task::Handle clone_recursive() const;
 
+	//! Sets source layer for this task and for sub-tasks which have no source layer yet
+	void set_source_layer(const String &layer);
+
 	virtual Rect calc_bounds() const;
 	void reset_bounds()
 		{ bounds_calculated = false; }
@@ -448,6 +522,16 @@ public:
 	virtual int get_pass_subtask_index() const
 		{ return PASSTO_THIS_TASK; }
 
+	//! Adds parameters of task (except coordinates and sub-tasks) to the hash.
+	//! Returns false when result of task depends on something what cannot be hashed,
+	//! such tasks will never be cached (see TaskCache)
+	virtual bool hash_params(TaskHash & /* hash */) const
+		{ return false; }
+	//! Calculates hash of whole sub-tree including coordinates.
+	//! Returns false if any task in the sub-tree cannot be hashed.
+	//! When sub_hashes is set, hashes of all hashable tasks of sub-tree are stored there
+	bool calc_hash(TaskHash::Value &out_hash, HashMap *sub_hashes = NULL) const;
+
 	void touch_coords();
 	void set_coords(const Rect &source_rect, const VectorInt &target_size);
 	void set_coords_zero();
@@ -471,9 +555,25 @@ public:
 class TaskInterfaceSplit
 {
 public:
+	//! Coordinates of the task before it was split into parts (see OptimizerSplit).
+	//! Parts calculate their transformations from these coordinates,
+	//! so the parts together give the same pixels as the whole task.
+	Rect whole_source_rect;
+	RectInt whole_target_rect;
+
 	virtual bool is_splittable() const
 		{ return true; }
 	virtual ~TaskInterfaceSplit() { }
+
+	bool is_split_part() const
+		{ return whole_target_rect.is_valid(); }
+
+	//! remember current coordinates of task as whole coordinates (if not remembered yet)
+	void remember_whole_coords();
+
+	const Rect& get_whole_source_rect() const;
+	const RectInt& get_whole_target_rect() const;
+	Vector get_whole_pixels_per_unit() const;
 };
 
 
@@ -510,6 +610,7 @@ public:
 	typedef etl::handle<TaskSurface> Handle;
 	SYNFIG_EXPORT static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
+	virtual bool hash_params(TaskHash &hash) const;
 };
 
 
@@ -540,6 +641,22 @@ public:
 };
 
 
+//! Converts target surface into another format, all other formats are dropped.
+//! Renderer adds this task to keep intermediate results in compact formats
+//! until they will be used (see OptimizerSurfaceFormat).
+class TaskSurfaceConvert: public Task
+{
+public:
+	typedef etl::handle<TaskSurfaceConvert> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Surface::Token::Handle format;
+
+	virtual bool run(RunParams&) const;
+};
+
+
 //! Tasks in TaskList executes sequentially and all of them draws at TaskList target surface.
 //! So all tasks inside TaskList should to have the same target surface
 //! which should be same as TaskList target surface.
@@ -551,6 +668,8 @@ public:
 	virtual Token::Handle get_token() const { return token.handle(); }
 	virtual bool run(RunParams&) const
 		{ return true; }
+	virtual bool hash_params(TaskHash&) const
+		{ return true; }
 	static VectorInt calc_target_offset(const Task &a, const Task &b);
 };
 
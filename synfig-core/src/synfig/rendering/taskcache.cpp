@@ -0,0 +1,168 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/taskcache.cpp
+**	\brief TaskCache
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "taskcache.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+// cache is disabled by default, it keeps full frame surfaces of sub-trees,
+// set budget in megabytes by SYNFIG_RENDERING_CACHE_SIZE to enable it
+#define DEFAULT_MAX_SIZE size_t(0)
+
+// how many keys to remember while waiting for the second touch
+#define MAX_SEEN_COUNT 4096
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+Task::Token TaskCacheStore::token(
+	DescSpecial<TaskCacheStore>("CacheStore") );
+
+
+TaskCache::TaskCache():
+	max_size(DEFAULT_MAX_SIZE),
+	size()
+{ }
+
+size_t
+TaskCache::get_max_size() const
+	{ std::lock_guard<std::mutex> lock(mutex); return max_size; }
+
+void
+TaskCache::set_max_size(size_t max_size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->max_size = max_size;
+	shrink(max_size);
+}
+
+size_t
+TaskCache::get_size() const
+	{ std::lock_guard<std::mutex> lock(mutex); return size; }
+
+void
+TaskCache::erase(EntryMap::iterator i)
+{
+	size -= i->second->size;
+	entries.erase(i->second);
+	entries_map.erase(i);
+}
+
+void
+TaskCache::shrink(size_t max_size)
+{
+	while(size > max_size && !entries.empty())
+		erase(entries_map.find(entries.back().key));
+}
+
+SurfaceResource::Handle
+TaskCache::find(Key key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	EntryMap::iterator i = entries_map.find(key);
+	if (i == entries_map.end())
+		return SurfaceResource::Handle();
+
+	// somebody wrote into the cached surface, it cannot be used anymore
+	if (i->second->surface->get_revision() != i->second->revision)
+		{ erase(i); return SurfaceResource::Handle(); }
+
+	entries.splice(entries.begin(), entries, i->second);
+	return i->second->surface;
+}
+
+bool
+TaskCache::touch(Key key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (seen.erase(key))
+		return true;
+	if (seen.size() >= MAX_SEEN_COUNT)
+		seen.clear();
+	seen.insert(key);
+	return false;
+}
+
+void
+TaskCache::store(Key key, const SurfaceResource::Handle &surface)
+{
+	if (!surface || !surface->is_exists())
+		return;
+
+	Entry entry;
+	entry.key = key;
+	entry.surface = surface;
+	entry.revision = surface->get_revision();
+	entry.size = (size_t)surface->get_width()*(size_t)surface->get_height()*sizeof(Color);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (entry.size > max_size)
+		return;
+
+	EntryMap::iterator i = entries_map.find(key);
+	if (i != entries_map.end())
+		erase(i);
+
+	shrink(max_size - entry.size);
+	entries.push_front(entry);
+	entries_map[key] = entries.begin();
+	size += entry.size;
+}
+
+void
+TaskCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries_map.clear();
+	entries.clear();
+	seen.clear();
+	size = 0;
+}
+
+
+bool
+TaskCacheStore::run(RunParams & /* params */) const
+{
+	if (cache && is_valid())
+		cache->store(key, target_surface);
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,123 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/taskcache.h
+**	\brief TaskCache Header
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_TASKCACHE_H
+#define __SYNFIG_RENDERING_TASKCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include "task.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Keeps rendered surfaces of task sub-trees between frames.
+//! Surfaces are identified by hash of sub-tree (see Task::calc_hash()),
+//! least recently used surfaces are removed when total size exceeds the budget.
+//! Budget is zero (cache disabled) unless SYNFIG_RENDERING_CACHE_SIZE is set.
+//! Renderer::optimize() replaces cached sub-trees by blending of TaskSurface
+//! into own target of sub-tree, cached surfaces are never written by tasks.
+class TaskCache: public etl::shared_object
+{
+public:
+	typedef etl::handle<TaskCache> Handle;
+	typedef TaskHash::Value Key;
+
+private:
+	struct Entry {
+		Key key;
+		SurfaceResource::Handle surface;
+		int revision;
+		size_t size;
+		Entry(): key(), revision(), size() { }
+	};
+
+	typedef std::list<Entry> EntryList;
+	typedef std::map<Key, EntryList::iterator> EntryMap;
+
+	mutable std::mutex mutex;
+	size_t max_size;
+	size_t size;
+	EntryList entries; //!< recently used entries are in front
+	EntryMap entries_map;
+	std::set<Key> seen;
+
+	void erase(EntryMap::iterator i);
+	void shrink(size_t max_size);
+
+public:
+	TaskCache();
+
+	size_t get_max_size() const;
+	void set_max_size(size_t max_size);
+	size_t get_size() const;
+	bool is_enabled() const
+		{ return get_max_size() > 0; }
+
+	//! returns surface stored for the key, if surface was not changed since storing
+	SurfaceResource::Handle find(Key key);
+	//! returns true when the key was touched before, so result of sub-tree worth to be stored
+	bool touch(Key key);
+	void store(Key key, const SurfaceResource::Handle &surface);
+	void clear();
+};
+
+
+//! Stores target surface of the task to TaskCache.
+//! Renderer adds this task after sub-tree whose result should be cached,
+//! sub_task(0) is TaskSurface with the same target to make dependency from the sub-tree.
+class TaskCacheStore: public Task
+{
+public:
+	typedef etl::handle<TaskCacheStore> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	TaskCache::Handle cache;
+	TaskCache::Key key;
+
+	TaskCacheStore(): key() { }
+
+	virtual bool run(RunParams &params) const;
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -93,6 +93,10 @@ public:
 	Surface(const size_type &s):
 		etl::surface<Color, ColorAccumulator,ColorPrep>(s) { }
 
+	//! Wraps external memory, data will not be deleted by surface
+	Surface(Color *data, int w, int h, int pitch):
+		etl::surface<Color, ColorAccumulator,ColorPrep>(data, w, h, pitch, false) { }
+
 	template <typename _pen>
 	Surface(const _pen &_begin, const _pen &_end):
 		etl::surface<Color, ColorAccumulator,ColorPrep>(_begin,_end) { }
@@ -31,6 +31,11 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <deque>
+
 #include "target_scanline.h"
 
 #include "general.h"
@@ -56,22 +61,65 @@ using namespace rendering;
 
 /* === M A C R O S ========================================================= */
 
-#define PIXEL_RENDERING_LIMIT 1500000
+#define STRIP_MEMORY_LIMIT_MB 24
 
-#define USE_PIXELRENDERING_LIMIT 1
+// disabled by default: every frame ahead holds the whole frame in memory,
+// see SYNFIG_TARGET_FRAMES_AHEAD
+#define FRAMES_AHEAD 0
+#define FRAMES_AHEAD_MEMORY_LIMIT_MB 512
 
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
 
+//! Writes pixels to target according to alpha mode, dest and src may be the same row
+static void
+convert_row(Color *dest, const Color *src, int count, TargetAlphaMode alpha_mode, const Color &bg_color)
+{
+	switch(alpha_mode)
+	{
+		case TARGET_ALPHA_MODE_FILL:
+			for(int i = 0; i < count; i++)
+				dest[i] = Color::blend(src[i], bg_color, 1.0f);
+			break;
+		case TARGET_ALPHA_MODE_EXTRACT:
+			for(int i = 0; i < count; i++)
+			{
+				float a = src[i].get_a();
+				dest[i] = Color(a,a,a,a);
+			}
+			break;
+		case TARGET_ALPHA_MODE_REDUCE:
+			for(int i = 0; i < count; i++)
+				dest[i] = Color(src[i].get_r(), src[i].get_g(), src[i].get_b(), 1.0f);
+			break;
+		case TARGET_ALPHA_MODE_KEEP:
+			if (dest != src)
+				memcpy(dest, src, count*sizeof(Color));
+			break;
+	}
+}
+
 /* === M E T H O D S ======================================================= */
 
 Target_Scanline::Target_Scanline():
-	threads_(2)
+	threads_(2),
+	frames_ahead_(FRAMES_AHEAD),
+	frames_ahead_memory_limit_((size_t)FRAMES_AHEAD_MEMORY_LIMIT_MB*1024*1024),
+	reuse_static_frames_(true),
+	strip_memory_limit_((size_t)STRIP_MEMORY_LIMIT_MB*1024*1024)
 {
 	curr_frame_=0;
 	if (const char *s = getenv("SYNFIG_TARGET_DEFAULT_ENGINE"))
 		set_engine(s);
+	if (const char *s = getenv("SYNFIG_TARGET_FRAMES_AHEAD"))
+		set_frames_ahead(std::max(0, atoi(s)));
+	if (const char *s = getenv("SYNFIG_TARGET_FRAMES_AHEAD_MEMORY"))
+		set_frames_ahead_memory_limit((size_t)std::max(0, atoi(s))*1024*1024);
+	if (const char *s = getenv("SYNFIG_TARGET_REUSE_STATIC_FRAMES"))
+		set_reuse_static_frames(atoi(s) != 0);
+	if (const char *s = getenv("SYNFIG_TARGET_STRIP_MEMORY"))
+		set_strip_memory_limit((size_t)std::max(0, atoi(s))*1024*1024);
 }
 
 int
@@ -80,22 +128,31 @@ Target_Scanline::next_frame(Time& time)
 	return Target::next_frame(time);
 }
 
+Color *
+Target_Scanline::start_scanlines(int /* scanline */, int /* count */, int &pitch)
+{
+	pitch = 0;
+	return NULL;
+}
+
 bool
-synfig::Target_Scanline::call_renderer(
+Target_Scanline::end_scanlines()
+	{ return true; }
+
+rendering::Task::Handle
+synfig::Target_Scanline::build_task(
 	const etl::handle<rendering::SurfaceResource> &surface,
 	Canvas &canvas,
 	const ContextParams &context_params,
 	const RendDesc &renddesc )
 {
-	surface->create(renddesc.get_w(), renddesc.get_h());
+	// surface may be already assigned to the rows of target (see render_strips())
+	if (surface->get_size() != VectorInt(renddesc.get_w(), renddesc.get_h()))
+		surface->create(renddesc.get_w(), renddesc.get_h());
 	rendering::Task::Handle task = canvas.build_rendering_task(context_params);
 
 	if (task)
 	{
-		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
-		if (!renderer)
-			throw "Renderer '" + get_engine() + "' not found";
-
 		Vector p0 = renddesc.get_tl();
 		Vector p1 = renddesc.get_br();
 		if (p0[0] > p1[0] || p0[1] > p1[1]) {
@@ -111,6 +168,24 @@ synfig::Target_Scanline::call_renderer(
 		task->target_surface = surface;
 		task->target_rect = RectInt( VectorInt(), surface->get_size() );
 		task->source_rect = Rect(p0, p1);
+	}
+	return task;
+}
+
+bool
+synfig::Target_Scanline::call_renderer(
+	const etl::handle<rendering::SurfaceResource> &surface,
+	Canvas &canvas,
+	const ContextParams &context_params,
+	const RendDesc &renddesc )
+{
+	rendering::Task::Handle task = build_task(surface, canvas, context_params, renddesc);
+
+	if (task)
+	{
+		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
+		if (!renderer)
+			throw "Renderer '" + get_engine() + "' not found";
 
 		rendering::Task::List list;
 		list.push_back(task);
@@ -119,6 +194,289 @@ synfig::Target_Scanline::call_renderer(
 	return true;
 }
 
+int
+synfig::Target_Scanline::calc_frames_ahead(int total_frames) const
+{
+	if (total_frames <= 1 || get_frames_ahead() <= 0)
+		return 0;
+
+	int frames_ahead = std::min(get_frames_ahead(), total_frames - 1);
+
+	// current frame and all frames ahead should fit into the memory limit,
+	// otherwise use the regular rendering (it may split frame to the strips)
+	if (get_frames_ahead_memory_limit()) {
+		size_t frame_size = (size_t)desc.get_w()*(size_t)desc.get_h()*sizeof(Color);
+		if (!frame_size)
+			return 0;
+		size_t frames = get_frames_ahead_memory_limit()/frame_size;
+		if (frames < 2)
+			return 0;
+		frames_ahead = std::min(frames_ahead, (int)std::min(frames - 1, (size_t)INT_MAX));
+	}
+
+	return frames_ahead;
+}
+
+int
+synfig::Target_Scanline::calc_strip_height() const
+{
+	int w = desc.get_w(), h = desc.get_h();
+	if (w <= 0 || h <= 0 || !get_strip_memory_limit())
+		return h;
+	size_t rowheight = get_strip_memory_limit()/((size_t)w*sizeof(Color));
+	return rowheight < (size_t)h ? std::max(1, (int)rowheight) : h; // TODO: render partial lines to stay within the limit?
+}
+
+bool
+synfig::Target_Scanline::render_strips(
+	ProgressCallback *cb,
+	const ContextParams &context_params,
+	int rowheight,
+	bool report_progress,
+	const etl::handle<rendering::SurfaceResource> &frame_surface )
+{
+	const int w = desc.get_w();
+	const int h = desc.get_h();
+	const int rows = (h + rowheight - 1)/rowheight;
+
+	// strips are collected into the whole frame only when it will be written again
+	synfig::Surface *frame = NULL;
+	if (frame_surface)
+	{
+		frame = new synfig::Surface(w, h);
+		frame_surface->assign(new SurfaceSW(*frame, true));
+	}
+
+	synfig::info("Render split to %d block%s %d pixels tall, and a final block %d pixels tall",
+				 rows-1, rows==2?"":"s", rowheight, h - (rows-1)*rowheight);
+
+	if(!start_frame(cb))
+	{
+		if(cb)cb->error(_("add_frame(): target panic on start_frame()"));
+		return false;
+	}
+
+	SurfaceResource::Handle surface = new SurfaceResource();
+	int direct_rows = 0;
+
+	for(int y = 0; y < h; y += rowheight)
+	{
+		const int height = std::min(rowheight, h - y);
+		RendDesc blockrd = desc;
+		blockrd.set_subwindow(0, y, w, height);
+
+		// if target owns the memory for these rows, then render directly into it
+		int pitch = 0;
+		if (Color *data = start_scanlines(y, height, pitch))
+		{
+			// synfig::Surface does not own the external data,
+			// so SurfaceSW may delete the wrapper safely
+			synfig::Surface *rows_surface = new synfig::Surface(data, w, height, pitch);
+			rows_surface->clear();
+			surface->assign(new SurfaceSW(*rows_surface, true));
+
+			bool success = call_renderer(surface, *canvas, context_params, blockrd);
+			if (success)
+			{
+				// renderer may replace the wrapper by the surface of another type,
+				// then copy the result into the rows
+				SurfaceResource::LockRead<SurfaceSW> lock(surface);
+				if (!lock)
+					success = false;
+				else
+				if (&lock->get_surface() != rows_surface)
+					for(int i = 0; i < height; ++i)
+						memcpy((char*)data + i*pitch, lock->get_surface()[i], w*sizeof(Color));
+			}
+			surface->reset();
+			if (!success)
+			{
+				if(cb)cb->error(_("Accelerated Renderer Failure"));
+				return false;
+			}
+
+			if (frame)
+				for(int i = 0; i < height; ++i)
+					memcpy((*frame)[y + i], (char*)data + i*pitch, w*sizeof(Color));
+
+			if (get_alpha_mode() != TARGET_ALPHA_MODE_KEEP)
+				for(int i = 0; i < height; ++i)
+				{
+					Color *row = (Color*)((char*)data + i*pitch);
+					convert_row(row, row, w, get_alpha_mode(), desc.get_bg_color());
+				}
+
+			if(!end_scanlines())
+			{
+				if(cb)cb->error(_("add_frame(): target panic on end_scanline()"));
+				return false;
+			}
+			direct_rows += height;
+		}
+		else
+		{
+			surface->reset();
+			if (!call_renderer(surface, *canvas, context_params, blockrd))
+			{
+				if(cb)cb->error(_("Accelerated Renderer Failure"));
+				return false;
+			}
+
+			SurfaceResource::LockRead<SurfaceSW> lock(surface);
+			if (!lock)
+			{
+				if(cb)cb->error(_("Accelerated Renderer Failure: cannot read surface"));
+				return false;
+			}
+
+			const synfig::Surface &s = lock->get_surface();
+			if (frame)
+				for(int i = 0; i < height; ++i)
+					memcpy((*frame)[y + i], s[i], w*sizeof(Color));
+
+			for(int i = 0; i < height; ++i)
+			{
+				Color *colordata = start_scanline(y + i);
+				if(!colordata)
+				{
+					if(cb)cb->error(_("add_frame(): call to start_scanline(y) returned NULL"));
+					return false;
+				}
+
+				convert_row(colordata, s[i], w, get_alpha_mode(), desc.get_bg_color());
+
+				if(!end_scanline())
+				{
+					if(cb)cb->error(_("add_frame(): target panic on end_scanline()"));
+					return false;
+				}
+			}
+		}
+
+		//I'm done with this part
+		if (report_progress && cb) cb->amount_complete(y + height, h);
+	}
+	surface->reset();
+
+	if (direct_rows)
+		synfig::info("%d row%s rendered directly into target", direct_rows, direct_rows == 1 ? "" : "s");
+
+	end_frame();
+	return true;
+}
+
+bool
+synfig::Target_Scanline::render_frames_ahead(ProgressCallback *cb, int frames_ahead, int total_frames)
+{
+	struct Frame {
+		int index;
+		SurfaceResource::Handle surface;
+		TaskEvent::Handle event;
+	};
+
+	rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
+	if (!renderer)
+		throw "Renderer '" + get_engine() + "' not found";
+
+	synfig::info("Render with %d frame%s ahead", frames_ahead, frames_ahead == 1 ? "" : "s");
+
+	ContextParams context_params(desc.get_render_excluded_contexts());
+	std::deque<Frame> queue;
+	Time t = 0;
+	int frames = total_frames;
+	int written_frames = 0;
+
+	// last really rendered frame, it will be written again while canvas is static
+	Frame rendered;
+	Time rendered_time;
+	int reused_frames = 0;
+
+	while(frames || !queue.empty())
+	{
+		// enqueue next frames while the oldest one is rendering
+		while(frames && (int)queue.size() <= frames_ahead)
+		{
+			// Grab the time
+			frames = next_frame(t);
+
+			if ( rendered.surface
+			  && get_reuse_static_frames()
+			  && !canvas->get_time_dependency(rendered_time, t) )
+			{
+				Frame frame = rendered;
+				frame.index = curr_frame_;
+				queue.push_back(frame);
+				++reused_frames;
+				continue;
+			}
+
+			// Set the time that we wish to render
+			if(!get_avoid_time_sync() || canvas->get_time()!=t) {
+				canvas->set_time(t);
+				canvas->load_resources(t);
+			}
+			canvas->set_outline_grow(desc.get_outline_grow());
+
+			// task tree holds copies of layers, so canvas time may be changed
+			// before rendering of this frame will finished
+			Frame frame;
+			frame.index = curr_frame_;
+			frame.surface = new SurfaceResource();
+			frame.event = new TaskEvent();
+			rendering::Task::Handle task = build_task(frame.surface, *canvas, context_params, desc);
+			if (task)
+				renderer->enqueue(task, frame.event);
+			else
+				frame.event->finish(true);
+			queue.push_back(frame);
+			rendered = frame;
+			rendered_time = t;
+		}
+
+		// write frames in order
+		Frame frame = queue.front();
+		queue.pop_front();
+		frame.event->wait();
+
+		bool success = frame.event->is_done();
+		if (success) {
+			// some targets check curr_frame_ to detect the last frame
+			int index = curr_frame_;
+			curr_frame_ = frame.index;
+
+			SurfaceResource::LockRead<SurfaceSW> lock(frame.surface);
+			if (!lock) {
+				if(cb)cb->error(_("Bad surface"));
+				success = false;
+			} else
+			if (!add_frame(&lock->get_surface(), cb)) {
+				if(cb)cb->error(_("Unable to put surface on target"));
+				success = false;
+			}
+
+			curr_frame_ = index;
+		} else {
+			if(cb)cb->error(_("Accelerated Renderer Failure"));
+		}
+
+		// If we have a callback, and it returns
+		// false, go ahead and bail. (it may be a user cancel)
+		if (success && cb && !cb->amount_complete(++written_frames, total_frames))
+			success = false;
+
+		if (!success) {
+			for(std::deque<Frame>::const_iterator i = queue.begin(); i != queue.end(); ++i)
+				rendering::Renderer::cancel(i->event);
+			return false;
+		}
+	}
+
+	if (reused_frames)
+		synfig::info("%d static frame%s written without rendering", reused_frames, reused_frames == 1 ? "" : "s");
+
+	return true;
+}
+
 bool
 synfig::Target_Scanline::render(ProgressCallback *cb)
 {
@@ -152,8 +510,19 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 
 	//synfig::info("1time_set_to %s",t.get_string().c_str());
 
+	if(int frames_ahead = calc_frames_ahead(total_frames))
+	{
+		if (!render_frames_ahead(cb, frames_ahead, total_frames))
+			return false;
+	}
+	else
 	if(total_frames>=1)
 	{
+		// last rendered frame, it will be written again while canvas is static
+		SurfaceResource::Handle rendered_surface;
+		Time rendered_time;
+		int reused_frames = 0;
+
 		do{
 			// Grab the time
 			frames=next_frame(t);
@@ -163,6 +532,25 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 			if(cb && !cb->amount_complete(total_frames-frames,total_frames))
 				return false;
 
+			if ( rendered_surface
+			  && get_reuse_static_frames()
+			  && !canvas->get_time_dependency(rendered_time, t) )
+			{
+				SurfaceResource::LockRead<SurfaceSW> lock(rendered_surface);
+				if(!lock)
+				{
+					if(cb)cb->error(_("Bad surface"));
+					return false;
+				}
+				if(!add_frame(&lock->get_surface(), cb))
+				{
+					if(cb)cb->error(_("Unable to put surface on target"));
+					return false;
+				}
+				++reused_frames;
+				continue;
+			}
+
 			// Set the time that we wish to render
 			if(!get_avoid_time_sync() || canvas->get_time()!=t) {
 				canvas->set_time(t);
@@ -172,118 +560,24 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 
 			// If quality is set otherwise, then we use the accelerated renderer
 			{
-				#if USE_PIXELRENDERING_LIMIT
-				if(desc.get_w()*desc.get_h() > PIXEL_RENDERING_LIMIT)
+				int rowheight = calc_strip_height();
+				if(rowheight < desc.get_h())
 				{
-					SurfaceResource::Handle surface = new SurfaceResource();
-
-					int rowheight = PIXEL_RENDERING_LIMIT/desc.get_w();
-					if (!rowheight) rowheight = 1; // TODO: render partial lines to stay within the limit?
-					int rows = desc.get_h()/rowheight;
-					int lastrowheight = desc.get_h() - rows*rowheight;
-
-					rows++;
-
-					synfig::info("Render split to %d block%s %d pixels tall, and a final block %d pixels tall",
-								 rows-1, rows==2?"":"s", rowheight, lastrowheight);
-
-					// loop through all the full rows
-					if(!start_frame())
-					{
-//						throw(string("add_frame(): target panic on start_frame()"));
-						if(cb)
-							cb->error(_("add_frame(): target panic on start_frame()"));
+					// strips don't give the whole frame, so check in advance whether
+					// the next frames will be the same, and collect the strips only then
+					SurfaceResource::Handle frame_surface;
+					if ( frames
+					  && get_reuse_static_frames()
+					  && !canvas->get_time_dependency(t, desc.get_time_end()) )
+						frame_surface = new SurfaceResource();
+
+					if (!render_strips(cb, context_params, rowheight, false, frame_surface))
 						return false;
-					}
-
-					for(int i=0; i < rows; ++i)
-					{
-						surface->reset();
-						RendDesc blockrd = desc;
-
-						//render the strip at the normal size unless it's the last one...
-						if(i == rows-1)
-						{
-							if(!lastrowheight) break;
-							blockrd.set_subwindow(0,i*rowheight,desc.get_w(),lastrowheight);
-						}
-						else
-						{
-							blockrd.set_subwindow(0,i*rowheight,desc.get_w(),rowheight);
-						}
-
-						//synfig::info( " -- block %d/%d left, top, width, height: %d, %d, %d, %d",
-						//	i+1, rows, 0, i*rowheight, blockrd.get_w(), blockrd.get_h() );
-
-						if (!call_renderer(surface, *canvas, context_params, blockrd))
-						{
-							if(cb)cb->error(_("Accelerated Renderer Failure"));
-							return false;
-						} else {
-							SurfaceResource::LockRead<SurfaceSW> lock(surface);
-							if (!lock) {
-								if(cb)cb->error(_("Accelerated Renderer Failure: cannot read surface"));
-								return false;
-							}
-
-							const synfig::Surface &s = lock->get_surface();
-
-							int y;
-							int rowspan=sizeof(Color)*s.get_w();
-							Surface::const_pen pen = s.begin();
-
-							int yoff = i*rowheight;
-
-							for(y = 0; y < blockrd.get_h(); y++, pen.inc_y())
-							{
-								Color *colordata= start_scanline(y + yoff);
-								if(!colordata)
-								{
-//									throw(string("add_frame(): call to start_scanline(y) returned NULL"));
-									if(cb)
-										cb->error(_("add_frame(): call to start_scanline(y) returned NULL"));
-									return false;
-								}
-
-								switch(get_alpha_mode())
-								{
-									case TARGET_ALPHA_MODE_FILL:
-										for(int i = 0; i < s.get_w(); i++)
-											colordata[i] = Color::blend(s[y][i], desc.get_bg_color(), 1.0f);
-										break;
-									case TARGET_ALPHA_MODE_EXTRACT:
-										for(int i = 0; i < s.get_w(); i++)
-										{
-											float a=s[y][i].get_a();
-											colordata[i] = Color(a,a,a,a);
-										}
-										break;
-									case TARGET_ALPHA_MODE_REDUCE:
-										for(int i = 0; i < s.get_w(); i++)
-											colordata[i] = Color(s[y][i].get_r(), s[y][i].get_g(), s[y][i].get_b(), 1.f);
-										break;
-									case TARGET_ALPHA_MODE_KEEP:
-										memcpy(colordata, s[y], rowspan);
-										break;
-								}
-
-								if(!end_scanline())
-								{
-//									throw(string("add_frame(): target panic on end_scanline()"));
-									if(cb)
-										cb->error(_("add_frame(): target panic on end_scanline()"));
-									return false;
-								}
-							}
-						}
-					}
-					surface->reset();
-
-					end_frame();
 
+					rendered_surface = frame_surface;
+					rendered_time = t;
 				}else //use normal rendering...
 				{
-				#endif
 					SurfaceResource::Handle surface = new SurfaceResource();
 
 					if (!call_renderer(surface, *canvas, context_params, desc))
@@ -307,11 +601,15 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 						if(cb)cb->error(_("Unable to put surface on target"));
 						return false;
 					}
-				#if USE_PIXELRENDERING_LIMIT
+
+					rendered_surface = surface;
+					rendered_time = t;
 				}
-				#endif
 			}
 		}while(frames);
+
+		if (reused_frames)
+			synfig::info("%d static frame%s written without rendering", reused_frames, reused_frames == 1 ? "" : "s");
 	}
     else
     {
@@ -324,124 +622,13 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 
 		// If quality is set otherwise, then we use the accelerated renderer
 		{
-			#if USE_PIXELRENDERING_LIMIT
-			if(desc.get_w()*desc.get_h() > PIXEL_RENDERING_LIMIT)
+			int rowheight = calc_strip_height();
+			if(rowheight < desc.get_h())
 			{
-				SurfaceResource::Handle surface(new SurfaceResource());
-
-				int totalheight = desc.get_h();
-				int rowheight = PIXEL_RENDERING_LIMIT/desc.get_w();
-				if (!rowheight) rowheight = 1; // TODO: render partial lines to stay within the limit?
-				int rows = desc.get_h()/rowheight;
-				int lastrowheight = desc.get_h() - rows*rowheight;
-
-				rows++;
-
-				synfig::info("Render split to %d block%s %d pixels tall, and a final block %d pixels tall",
-							 rows-1, rows==2?"":"s", rowheight, lastrowheight);
-
-				// loop through all the full rows
-				if(!start_frame())
-				{
-//					throw(string("add_frame(): target panic on start_frame()"));
-					if(cb)
-						cb->error(_("add_frame(): target panic on start_frame()"));
+				if (!render_strips(cb, context_params, rowheight, true))
 					return false;
-				}
-
-				for(int i=0; i < rows; ++i)
-				{
-					surface->reset();
-					RendDesc blockrd = desc;
-
-					//render the strip at the normal size unless it's the last one...
-					if(i == rows-1)
-					{
-						if(!lastrowheight) break;
-						blockrd.set_subwindow(0,i*rowheight,desc.get_w(),lastrowheight);
-					}
-					else
-					{
-						blockrd.set_subwindow(0,i*rowheight,desc.get_w(),rowheight);
-					}
-
-					//synfig::info( " -- block %d/%d left, top, width, height: %d, %d, %d, %d",
-					//	i+1, rows, 0, i*rowheight, blockrd.get_w(), blockrd.get_h() );
-
-					if (!call_renderer(surface, *canvas, context_params, blockrd))
-					{
-						if(cb)cb->error(_("Accelerated Renderer Failure"));
-						return false;
-					}
-
-					SurfaceResource::LockRead<SurfaceSW> lock(surface);
-
-					if(!lock)
-					{
-						if(cb)cb->error(_("Bad surface"));
-						return false;
-					}
-
-					const synfig::Surface &s = lock->get_surface();
-
-					int y;
-					int rowspan=sizeof(Color)*s.get_w();
-					Surface::const_pen pen = s.begin();
-
-					int yoff = i*rowheight;
-
-					for(y = 0; y < blockrd.get_h(); y++, pen.inc_y())
-					{
-						Color *colordata= start_scanline(y + yoff);
-						if(!colordata)
-						{
-//							throw(string("add_frame(): call to start_scanline(y) returned NULL"));
-							if(cb)
-								cb->error(_("add_frame(): call to start_scanline(y) returned NULL"));
-							return false;
-						}
-
-						switch(get_alpha_mode())
-						{
-							case TARGET_ALPHA_MODE_FILL:
-								for(int i = 0; i < s.get_w(); i++)
-									colordata[i] = Color::blend(s[y][i], desc.get_bg_color(), 1.0f);
-								break;
-							case TARGET_ALPHA_MODE_EXTRACT:
-								for(int i = 0; i < s.get_w(); i++)
-								{
-									float a=s[y][i].get_a();
-									colordata[i] = Color(a,a,a,a);
-								}
-								break;
-							case TARGET_ALPHA_MODE_REDUCE:
-								for(int i = 0; i < s.get_w(); i++)
-									colordata[i] = Color(s[y][i].get_r(), s[y][i].get_g(), s[y][i].get_b(), 1.0f);
-								break;
-							case TARGET_ALPHA_MODE_KEEP:
-								memcpy(colordata,s[y], rowspan);
-								break;
-						}
-
-						if(!end_scanline())
-						{
-//							throw(string("add_frame(): target panic on end_scanline()"));
-							if(cb)
-								cb->error(_("add_frame(): target panic on end_scanline()"));
-							return false;
-						}
-					}
-
-					//I'm done with this part
-					if (cb) cb->amount_complete((i+1)*rowheight, totalheight);
-				}
-				surface->reset();
-
-				end_frame();
-
 			}else
 			{
-			#endif
 				SurfaceResource::Handle surface = new SurfaceResource();
 
 				if (!call_renderer(surface, *canvas, context_params, desc))
@@ -465,9 +652,7 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 					if(cb)cb->error(_("Unable to put surface on target"));
 					return false;
 				}
-			#if USE_PIXELRENDERING_LIMIT
 			}
-			#endif
 		}
 	}
 
@@ -497,8 +682,6 @@ Target_Scanline::add_frame(const synfig::Surface *surface, ProgressCallback *cb)
 
 
 	int y;
-	int rowspan=sizeof(Color)*surface->get_w();
-	Surface::const_pen pen=surface->begin();
 
 	if(!start_frame(cb))
 	{
@@ -508,7 +691,25 @@ Target_Scanline::add_frame(const synfig::Surface *surface, ProgressCallback *cb)
 		return false;
 	}
 
-	for(y=0;y<surface->get_h();y++,pen.inc_y())
+	// copy the whole frame at once when target gives its rows
+	int pitch = 0;
+	if (Color *data = start_scanlines(0, surface->get_h(), pitch))
+	{
+		for(y=0;y<surface->get_h();y++)
+			convert_row((Color*)((char*)data + y*pitch), (*surface)[y], surface->get_w(), get_alpha_mode(), desc.get_bg_color());
+
+		if(!end_scanlines())
+		{
+			if (cb)
+				cb->error(_("add_frame(): target panic on end_scanline()"));
+			return false;
+		}
+
+		end_frame();
+		return true;
+	}
+
+	for(y=0;y<surface->get_h();y++)
 	{
 		Color *colordata= start_scanline(y);
 		if(!colordata)
@@ -519,27 +720,7 @@ Target_Scanline::add_frame(const synfig::Surface *surface, ProgressCallback *cb)
 			return false;
 		}
 
-		switch(get_alpha_mode())
-		{
-			case TARGET_ALPHA_MODE_FILL:
-				for(int i=0;i<surface->get_w();i++)
-					colordata[i]=Color::blend((*surface)[y][i],desc.get_bg_color(),1.0f);
-				break;
-			case TARGET_ALPHA_MODE_EXTRACT:
-				for(int i=0;i<surface->get_w();i++)
-				{
-					float a=(*surface)[y][i].get_a();
-					colordata[i] = Color(a,a,a,a);
-				}
-				break;
-			case TARGET_ALPHA_MODE_REDUCE:
-				for(int i = 0; i < surface->get_w(); i++)
-					colordata[i] = Color((*surface)[y][i].get_r(),(*surface)[y][i].get_g(),(*surface)[y][i].get_b(),1.0f);
-				break;
-			case TARGET_ALPHA_MODE_KEEP:
-				memcpy(colordata,(*surface)[y],rowspan);
-				break;
-		}
+		convert_row(colordata, (*surface)[y], surface->get_w(), get_alpha_mode(), desc.get_bg_color());
 
 		if(!end_scanline())
 		{
@@ -38,7 +38,7 @@
 
 namespace synfig {
 
-namespace rendering { class SurfaceResource; }
+namespace rendering { class SurfaceResource; class Task; }
 
 /*!	\class Target_Scanline
 **	\brief This is a Target class that implements the render function
@@ -51,12 +51,48 @@ class Target_Scanline : public Target
 
 	String engine_;
 
+	//! Number of frames which may be rendered while the current one is written
+	int frames_ahead_;
+
+	//! Memory limit in bytes for the surfaces of frames rendered ahead (0 - unlimited)
+	size_t frames_ahead_memory_limit_;
+
+	//! Write previous frame again instead of rendering when canvas has no changes
+	bool reuse_static_frames_;
+
+	//! Memory limit in bytes for the surface of one strip, larger frames are rendered by strips (0 - unlimited)
+	size_t strip_memory_limit_;
+
+	etl::handle<rendering::Task> build_task(
+		const etl::handle<rendering::SurfaceResource> &surface,
+		Canvas &canvas,
+		const ContextParams &context_params,
+		const RendDesc &renddesc );
+
 	bool call_renderer(
 		const etl::handle<rendering::SurfaceResource> &surface,
 		Canvas &canvas,
 		const ContextParams &context_params,
 		const RendDesc &renddesc );
 
+	//! Returns count of frames to render ahead, or zero if pipeline should not be used
+	int calc_frames_ahead(int total_frames) const;
+
+	//! Renders frames in pipeline, the next frames are rendering while current frame is written
+	bool render_frames_ahead(ProgressCallback *cb, int frames_ahead, int total_frames);
+
+	//! Returns height of strip which fits into the strip memory limit
+	int calc_strip_height() const;
+
+	//! Renders current frame by strips, directly into the rows of target when it provides them,
+	//! also collects the whole frame into \a frame_surface when it is set
+	bool render_strips(
+		ProgressCallback *cb,
+		const ContextParams &context_params,
+		int rowheight,
+		bool report_progress,
+		const etl::handle<rendering::SurfaceResource> &frame_surface = etl::handle<rendering::SurfaceResource>() );
+
 public:
 	typedef etl::handle<Target_Scanline> Handle;
 	typedef etl::loose_handle<Target_Scanline> LooseHandle;
@@ -97,6 +133,26 @@ public:
 	**	\see start_scanline()
 	*/
 	virtual bool end_scanline()=0;
+
+	//! Marks the start of several scanlines which are stored in memory of target
+	/*!	Allows to render the strip of frame directly into the target buffer,
+	**	without intermediate surface and copying.
+	**	\param scanline The first scanline of the strip
+	**	\param count Count of scanlines in the strip
+	**	\param pitch Returns the distance between scanlines in bytes
+	**	\return The address of the first scanline or NULL if target
+	**		has no such buffer (default), then start_scanline() is used.
+	**	\warning Must be called after start_frame()
+	**	\see end_scanlines()
+	*/
+	virtual Color * start_scanlines(int scanline, int count, int &pitch);
+
+	//! Marks the end of scanlines returned by start_scanlines()
+	/*!	\return \c true on success, \c false on failure.
+	**	\see start_scanlines()
+	*/
+	virtual bool end_scanlines();
+
 	//! Sets the number of threads
 
 	void set_threads(int x) { threads_=x; }
@@ -106,6 +162,22 @@ public:
 	const String& get_engine()const { return engine_; }
 	//! Sets engine
 	void set_engine(const String &x) { engine_=x; }
+	//! Sets count of frames which may be rendered ahead of the frame being written (0 - disabled, default)
+	void set_frames_ahead(int x) { frames_ahead_=x; }
+	//! Gets count of frames which may be rendered ahead of the frame being written
+	int get_frames_ahead()const { return frames_ahead_; }
+	//! Sets memory limit in bytes for the frames rendered ahead (0 - unlimited)
+	void set_frames_ahead_memory_limit(size_t x) { frames_ahead_memory_limit_=x; }
+	//! Gets memory limit in bytes for the frames rendered ahead
+	size_t get_frames_ahead_memory_limit()const { return frames_ahead_memory_limit_; }
+	//! Enables reusing of the previous frame when canvas is not changed in time
+	void set_reuse_static_frames(bool x) { reuse_static_frames_=x; }
+	//! Returns true if frames without changes are not rendered again
+	bool get_reuse_static_frames()const { return reuse_static_frames_; }
+	//! Sets memory limit in bytes for the surface of one strip (0 - unlimited)
+	void set_strip_memory_limit(size_t x) { strip_memory_limit_=x; }
+	//! Gets memory limit in bytes for the surface of one strip
+	size_t get_strip_memory_limit()const { return strip_memory_limit_; }
 
 	//! Puts the rendered surface onto the target.
 	bool add_frame(const synfig::Surface *surface, ProgressCallback* cb);
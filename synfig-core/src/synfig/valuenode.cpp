@@ -671,6 +671,18 @@ void LinkableValueNode::get_times_vfunc(Node::time_set &set) const
 	}
 }
 
+bool
+LinkableValueNode::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	for(int i = 0; i < link_count(); ++i)
+	{
+		ValueNode::LooseHandle h = get_link(i);
+		if (h && h->get_time_dependency(a, b))
+			return true;
+	}
+	return false;
+}
+
 String
 LinkableValueNode::get_description(int index, bool show_exported_name)const
 {
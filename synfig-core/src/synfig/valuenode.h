@@ -455,6 +455,9 @@ protected:
 	//! Returns the cached times values for all the children (linked Value Nodes)
 	virtual void get_times_vfunc(Node::time_set &set) const;
 
+	//! Returns true if any of linked Value Nodes depends on time
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
+
 	//! Pure Virtual member to get the children vocabulary
 	virtual Vocab get_children_vocab_vfunc()const=0;
 
@@ -115,3 +115,7 @@ void
 ValueNode_Animated::get_times_vfunc(Node::time_set &set) const
 	{ ValueNode_AnimatedInterface::get_times_vfunc(set); }
 
+bool
+ValueNode_Animated::get_time_dependency_vfunc(const Time &a, const Time &b) const
+	{ return ValueNode_AnimatedInterface::get_time_dependency_vfunc(a, b); }
+
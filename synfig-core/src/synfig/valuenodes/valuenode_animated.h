@@ -75,6 +75,7 @@ protected:
 
 	virtual void on_changed();
 	virtual void get_times_vfunc(Node::time_set &set) const;
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
 };
 
 }; // END of namespace synfig
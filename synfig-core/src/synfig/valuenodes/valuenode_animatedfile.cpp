@@ -519,3 +519,12 @@ ValueNode_AnimatedFile::get_values_vfunc(std::map<Time, ValueBase> &x) const
 				ValueNode::add_value_to_map(x, j->first, j->second);
 	}
 }
+
+bool
+ValueNode_AnimatedFile::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	if (LinkableValueNode::get_time_dependency_vfunc(a, b))
+		return true;
+	(*this)(a); // load file
+	return ValueNode_AnimatedInterfaceConst::get_time_dependency_vfunc(a, b);
+}
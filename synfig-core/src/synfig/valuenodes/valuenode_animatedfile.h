@@ -74,6 +74,7 @@ public:
 
 	virtual ValueBase operator()(Time t) const;
 	virtual void get_values_vfunc(std::map<Time, ValueBase> &x) const;
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
 
 	String get_file_field(Time t, const String &field_name) const;
 
@@ -33,6 +33,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <atomic>
 #include <typeinfo>
 #include <vector>
 #include <list>
@@ -117,6 +118,45 @@ struct is_angle_type<Angle>
 	{ bool operator()()const { return true; } };
 #endif //ANGLES_USE_LINEAR_INTERPOLATION
 
+//! Types which are interpolated as cubic polynomials in power basis,
+//! integers and gradients are interpolated by etl::hermite as before
+template <class T>
+struct is_polynomial_type { enum { value = false }; };
+template <> struct is_polynomial_type<Real>   { enum { value = true }; };
+template <> struct is_polynomial_type<Time>   { enum { value = true }; };
+template <> struct is_polynomial_type<Angle>  { enum { value = true }; };
+template <> struct is_polynomial_type<Vector> { enum { value = true }; };
+template <> struct is_polynomial_type<Color>  { enum { value = true }; };
+
+//! Cubic bezier curve over [0, 1] converted to power basis,
+//! so it costs 3 multiplications and 3 additions per evaluation
+template <class T, bool enabled = is_polynomial_type<T>::value>
+struct PowerBasis
+{
+	bool valid() const { return false; }
+	void build(const T&, const T&, const T&, const T&) { }
+	T operator()(Real) const { return T(); }
+};
+
+template <class T>
+struct PowerBasis<T, true>
+{
+	T coeff[4];
+
+	bool valid() const { return true; }
+
+	void build(const T &a, const T &b, const T &c, const T &d)
+	{
+		coeff[0] = a;
+		coeff[1] = (b - a)*3;
+		coeff[2] = (c - b*2 + a)*3;
+		coeff[3] = d - a + (b - c)*3;
+	}
+
+	T operator()(Real x) const
+		{ return coeff[0] + (coeff[1] + (coeff[2] + coeff[3]*x)*x)*x; }
+};
+
 template<class T>
 T
 clamped_tangent(T p1, T p2, T p3, Time t1, Time t2, Time t3)
@@ -243,6 +283,14 @@ public:
 	virtual void on_changed() = 0;
 	virtual ValueBase operator()(Time t) const = 0;
 
+	virtual void evaluate(const std::vector<Time> &times, std::vector<ValueBase> &out_values) const
+	{
+		out_values.clear();
+		out_values.reserve(times.size());
+		for(std::vector<Time>::const_iterator i = times.begin(); i != times.end(); ++i)
+			out_values.push_back((*this)(*i));
+	}
+
 	virtual void get_values_vfunc(std::map<Time, ValueBase> &x) const
 	{
 		// TODO: special case for discrete interpolation mode
@@ -312,6 +360,24 @@ public:
 			WaypointList::iterator start;
 			WaypointList::iterator end;
 
+			//! Time curve maps [r, s] to parameter of value curve, both are normalized to [0, 1].
+			//! Value curve is used only when both waypoints are static.
+			PowerBasis<Real> time_curve;
+			PowerBasis<value_type> value_curve;
+			Real time_k; //!< 1/(s - r)
+
+			void build_power_basis()
+			{
+				Time r = first.get_r();
+				time_k = 1.0/(Real)first.get_dt();
+				time_curve.build(
+					(Real)(first[0] - r)*time_k,
+					(Real)(first[1] - r)*time_k,
+					(Real)(first[2] - r)*time_k,
+					(Real)(first[3] - r)*time_k );
+				value_curve.build(second[0], second[1], second[2], second[3]);
+			}
+
 			value_type resolve(const Time &t)const
 			{
 				bool start_static(start->is_static());
@@ -333,6 +399,11 @@ public:
 
 					second.sync();
 				}
+				else
+				if (value_curve.valid())
+				{
+					return demult(value_curve(time_curve((Real)(t - first.get_r())*time_k)));
+				}
 
 				return demult(second(first(t)));
 			}
@@ -344,8 +415,43 @@ public:
 		// Bounds of this curve
 		Time r,s;
 
+		//! Index of last used segment, rendering and editing usually
+		//! ask for the same or the next segment
+		mutable std::atomic<int> last_segment;
+
+		static bool segment_less(const Time &t, const PathSegment &segment)
+			{ return t < segment.first.get_s(); }
+
+		//! Finds first segment which ends after \a t, starting from \a hint
+		int find_segment(const Time &t, int hint) const
+		{
+			const int count = (int)curve_list.size();
+			for(int i = hint; i >= 0 && i < count && i <= hint + 1; ++i)
+				if ( t < curve_list[i].first.get_s()
+				  && (i == 0 || !(t < curve_list[i-1].first.get_s())) )
+					return i;
+			return (int)(std::upper_bound(curve_list.begin(), curve_list.end(), t, segment_less) - curve_list.begin());
+		}
+
+		ValueBase get_value(const Time &t, int &hint) const
+		{
+			if(animated.waypoint_list_.empty())
+				return value_type();	//! \todo Perhaps we should throw something here?
+			if(animated.waypoint_list_.size()==1)
+				return animated.waypoint_list_.front().get_value(t);
+			if(t<=r)
+				return animated.waypoint_list_.front().get_value(t);
+			if(t>=s)
+				return animated.waypoint_list_.back().get_value(t);
+
+			hint = find_segment(t, hint);
+			if(hint >= (int)curve_list.size())
+				return animated.waypoint_list_.back().get_value(t);
+			return curve_list[hint].resolve(t);
+		}
+
 	public:
-		Hermite(ValueNode_AnimatedInterfaceConst &node): Interpolator(node) { }
+		Hermite(ValueNode_AnimatedInterfaceConst &node): Interpolator(node), last_segment(0) { }
 
 		virtual Interpolator* create(ValueNode_AnimatedInterfaceConst &node) const
 			{ return new Hermite(node); }
@@ -644,28 +750,28 @@ public:
 
 				curve_list.push_back(curve);
 			}
+
+			// tangents of previous curve may be changed by the next one,
+			// so coefficients are calculated when all curves are ready
+			for(typename curve_list_type::iterator i = curve_list.begin(); i != curve_list.end(); ++i)
+				i->build_power_basis();
 		}
 
 		virtual ValueBase operator()(Time t)const
 		{
-			if(animated.waypoint_list_.empty())
-				return value_type();	//! \todo Perhaps we should throw something here?
-			if(animated.waypoint_list_.size()==1)
-				return animated.waypoint_list_.front().get_value(t);
-			if(t<=r)
-				return animated.waypoint_list_.front().get_value(t);
-			if(t>=s)
-				return animated.waypoint_list_.back().get_value(t);
-
-			typename curve_list_type::const_iterator iter;
+			int hint = last_segment.load(std::memory_order_relaxed);
+			ValueBase value = get_value(t, hint);
+			last_segment.store(hint, std::memory_order_relaxed);
+			return value;
+		}
 
-			// This next line will set iter to the
-			// correct iterator for the given time.
-			for(iter=curve_list.begin();iter<curve_list.end() && t>=iter->first.get_s();++iter)
-				continue;
-			if(iter==curve_list.end())
-				return animated.waypoint_list_.back().get_value(t);
-			return iter->resolve(t);
+		virtual void evaluate(const std::vector<Time> &times, std::vector<ValueBase> &out_values) const
+		{
+			out_values.clear();
+			out_values.reserve(times.size());
+			int hint = 0;
+			for(std::vector<Time>::const_iterator i = times.begin(); i != times.end(); ++i)
+				out_values.push_back(get_value(*i, hint));
 		}
 	}; // END of class Hermite
 
@@ -682,6 +788,9 @@ public:
 
 		using Interpolator::animated;
 
+		static bool waypoint_less(const Time &t, const Waypoint &waypoint)
+			{ return t < waypoint.get_time(); }
+
 	public:
 		Constant(ValueNode_AnimatedInterfaceConst &node): Interpolator(node) { }
 
@@ -748,13 +857,10 @@ public:
 			if(t>=s)
 				return animated.waypoint_list_.back().get_value(t);
 
-			WaypointList::const_iterator iter;
-			WaypointList::const_iterator next;
-
-			// This next line will set iter to the
-			// correct iterator for the given time.
-			for(next=animated.waypoint_list_.begin(),iter=next++;next!=animated.waypoint_list_.end() && t>=next->get_time();iter=next++)
-				continue;
+			// last waypoint which is not later than t
+			WaypointList::const_iterator iter = std::upper_bound(
+				animated.waypoint_list_.begin(), animated.waypoint_list_.end(), t, waypoint_less );
+			--iter;
 
 			return iter->get_value(t);
 		}
@@ -959,6 +1065,10 @@ ValueBase
 ValueNode_AnimatedInterfaceConst::operator()(Time t) const
 	{ return (*interpolator_)(t); }
 
+void
+ValueNode_AnimatedInterfaceConst::evaluate(const std::vector<Time> &times, std::vector<ValueBase> &out_values) const
+	{ interpolator_->evaluate(times, out_values); }
+
 void
 ValueNode_AnimatedInterfaceConst::get_values_vfunc(std::map<Time, ValueBase> &x) const
 	{ interpolator_->get_values_vfunc(x); }
@@ -1292,3 +1402,41 @@ ValueNode_AnimatedInterfaceConst::get_times_vfunc(Node::time_set &set) const
 		set.insert(t);
 	}
 }
+
+bool
+ValueNode_AnimatedInterfaceConst::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	if (waypoint_list().empty())
+		return false;
+
+	// find waypoints which affect the range [a, b]
+	WaypointList::const_iterator first = waypoint_list().begin();
+	WaypointList::const_iterator last = waypoint_list().end() - 1;
+	for(WaypointList::const_iterator i = waypoint_list().begin(); i != waypoint_list().end(); ++i)
+	{
+		if (i->get_time() <= a)
+			first = i;
+		if (i->get_time() >= b)
+			{ last = i; break; }
+	}
+
+	// value is static if all of these waypoints are static and have the same value,
+	// and curves between them have no overshoot
+	const ValueBase value = (*first->get_value_node())(a);
+	for(WaypointList::const_iterator i = first; i <= last; ++i)
+	{
+		if (i->get_value_node()->get_time_dependency(a, b))
+			return true;
+		if (i == first)
+			continue;
+
+		Interpolation after = (i - 1)->get_after();
+		Interpolation before = i->get_before();
+		if ( (after != INTERPOLATION_CONSTANT && after != INTERPOLATION_LINEAR && after != INTERPOLATION_HALT)
+		  || (before != INTERPOLATION_CONSTANT && before != INTERPOLATION_LINEAR && before != INTERPOLATION_HALT) )
+			return true;
+		if ((*i->get_value_node())(a) != value)
+			return true;
+	}
+	return false;
+}
@@ -29,6 +29,7 @@
 /* === H E A D E R S ======================================================= */
 
 #include <list>
+#include <vector>
 
 #include <synfig/valuenode.h>
 #include <synfig/uniqueid.h>
@@ -120,6 +121,7 @@ protected:
 	void on_changed();
 	ValueBase operator()(Time t) const;
 	void get_times_vfunc(Node::time_set &set) const;
+	bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
 	void get_values_vfunc(std::map<Time, ValueBase> &x) const;
 
 	void assign(const ValueNode_AnimatedInterfaceConst &animated, const synfig::GUID& deriv_guid);
@@ -130,6 +132,9 @@ protected:
 
 public:
 	const WaypointList &waypoint_list()const { return waypoint_list_; }
+	//! Calculates values at many times at once.
+	//! It's faster than separate calls when times are sorted, like samples of curve
+	void evaluate(const std::vector<Time> &times, std::vector<ValueBase> &out_values) const;
 	bool waypoint_is_only_use_of_valuenode(Waypoint &waypoint) const;
 	//! Returns a new waypoint at a given time but it is not inserted in the Waypoint List.
 	/*! \note this does not add any waypoint to the ValueNode! */
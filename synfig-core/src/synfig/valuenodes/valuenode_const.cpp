@@ -178,6 +178,11 @@ void ValueNode_Const::get_times_vfunc(Node::time_set &/*set*/) const
 {
 }
 
+bool ValueNode_Const::get_time_dependency_vfunc(const Time &/*a*/, const Time &/*b*/) const
+{
+	return false;
+}
+
 void ValueNode_Const::get_values_vfunc(std::map<Time, ValueBase> &x) const
 {
 	add_value_to_map(x, 0, value);
@@ -198,3 +198,10 @@ ValueNode_DIList::set_bline(ValueNode::Handle b)
 	bline_=b;
 }
 
+bool
+ValueNode_DIList::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	return ValueNode_DynamicList::get_time_dependency_vfunc(a, b)
+	    || (bline_ && bline_->get_time_dependency(a, b));
+}
+
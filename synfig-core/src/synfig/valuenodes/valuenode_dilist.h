@@ -82,6 +82,7 @@ public:
 protected:
 
 	LinkableValueNode* create_new()const;
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
 
 public:
 
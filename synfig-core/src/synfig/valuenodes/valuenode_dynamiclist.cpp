@@ -863,6 +863,23 @@ void ValueNode_DynamicList::get_times_vfunc(Node::time_set &set) const
 	}
 }
 
+bool ValueNode_DynamicList::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	for(std::vector<ListEntry>::const_iterator i = list.begin(); i != list.end(); ++i)
+	{
+		if (i->value_node && i->value_node->get_time_dependency(a, b))
+			return true;
+
+		// activepoints may turn entry on or off
+		for(ListEntry::ActivepointList::const_iterator j = i->timing_info.begin(); j != i->timing_info.end(); ++j)
+			if (j->get_time() >= a && j->get_time() <= b)
+				return true;
+		if (i->amount_at_time(a) != i->amount_at_time(b))
+			return true;
+	}
+	return false;
+}
+
 
 //new find functions that don't throw
 struct timecmp
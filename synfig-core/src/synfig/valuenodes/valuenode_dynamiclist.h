@@ -230,6 +230,7 @@ protected:
 	LinkableValueNode* create_new()const;
 
 	virtual void get_times_vfunc(Node::time_set &set) const;
+	virtual bool get_time_dependency_vfunc(const Time &a, const Time &b) const;
 
 public:
 	/*! \note The construction parameter (\a id) is the type that the list
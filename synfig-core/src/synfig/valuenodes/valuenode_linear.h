@@ -61,6 +61,8 @@ public:
 
 protected:
 	LinkableValueNode* create_new()const;
+	//! Value depends on time itself
+	virtual bool get_time_dependency_vfunc(const Time &/*a*/, const Time &/*b*/)const { return true; }
 	virtual bool set_link_vfunc(int i,ValueNode::Handle x);
 
 public:
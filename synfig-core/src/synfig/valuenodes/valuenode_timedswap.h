@@ -70,6 +70,8 @@ public:
 protected:
 
 	virtual LinkableValueNode* create_new()const;
+	//! Value depends on time itself
+	virtual bool get_time_dependency_vfunc(const Time &/*a*/, const Time &/*b*/)const { return true; }
 
 public:
 	using synfig::LinkableValueNode::get_link_vfunc;
@@ -444,3 +444,10 @@ ValueNode_WPList::set_bline(ValueNode::Handle b)
 	bline_=b;
 }
 
+bool
+ValueNode_WPList::get_time_dependency_vfunc(const Time &a, const Time &b) const
+{
+	return ValueNode_DynamicList::get_time_dependency_vfunc(a, b)
+	    || (bline_ && bline_->get_time_dependency(a, b));
+}
+
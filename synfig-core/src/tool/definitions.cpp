@@ -103,3 +103,13 @@ void SynfigToolGeneralOptions::set_should_print_benchmarks(bool print_benchmarks
 {
 	_should_print_benchmarks = print_benchmarks;
 }
+
+std::string SynfigToolGeneralOptions::get_profile_trace_filename() const
+{
+	return _profile_trace_filename;
+}
+
+void SynfigToolGeneralOptions::set_profile_trace_filename(const std::string &filename)
+{
+	_profile_trace_filename = filename;
+}
@@ -101,10 +101,16 @@ public:
 
 	void set_should_print_benchmarks(bool print_benchmarks);
 
+	//! file for rendering profile, empty when profiling is disabled
+	std::string get_profile_trace_filename() const;
+
+	void set_profile_trace_filename(const std::string &filename);
+
 private:
 	SynfigToolGeneralOptions(const char* argv0);
 
 	std::string _binary_path;
+	std::string _profile_trace_filename;
 	int _verbosity;
 	size_t _threads;
 	bool _should_be_quiet,
@@ -0,0 +1,232 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tool/framelist.cpp
+**	\brief Frame shards and checksum manifest of the render jobs
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+
+#include <ETL/stringf>
+#include <synfig/general.h>
+
+#include "definitions.h"
+#include "synfigtoolexception.h"
+#include "framelist.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#endif
+
+namespace {
+
+bool parse_int(const std::string& str, int& value)
+{
+	if (str.empty())
+		return false;
+	char *end = nullptr;
+	long x = strtol(str.c_str(), &end, 10);
+	if (*end || x < 0 || x > 10000000)
+		return false;
+	value = (int)x;
+	return true;
+}
+
+void parse_frame_item(const std::string& item, std::vector<int>& frames, std::set<int>& known)
+{
+	std::string range = item;
+	int step = 1;
+
+	std::size_t colon = item.find(':');
+	if (colon != std::string::npos)
+	{
+		range = item.substr(0, colon);
+		if (!parse_int(item.substr(colon + 1), step) || step <= 0)
+			throw SynfigToolException(SYNFIGTOOL_UNKNOWNARGUMENT,
+				etl::strprintf(_("Invalid frame step in \"%s\"."), item.c_str()));
+	}
+
+	int first = 0, last = 0;
+	std::size_t dash = range.find('-');
+	bool valid = dash == std::string::npos
+			   ? parse_int(range, first) && parse_int(range, last)
+			   : parse_int(range.substr(0, dash), first) && parse_int(range.substr(dash + 1), last);
+	if (!valid || last < first)
+		throw SynfigToolException(SYNFIGTOOL_UNKNOWNARGUMENT,
+			etl::strprintf(_("Invalid frame range \"%s\"."), item.c_str()));
+
+	for(int frame = first; frame <= last; frame += step)
+		if (known.insert(frame).second)
+			frames.push_back(frame);
+}
+
+}
+
+void parse_frame_list(const std::string& spec, std::vector<int>& frames)
+{
+	std::set<int> known(frames.begin(), frames.end());
+
+	std::string item;
+	for(std::string::const_iterator i = spec.begin(); ; ++i)
+	{
+		if (i == spec.end() || *i == ',' || isspace((unsigned char)*i))
+		{
+			if (!item.empty())
+				parse_frame_item(item, frames, known);
+			item.clear();
+			if (i == spec.end())
+				break;
+		}
+		else
+			item += *i;
+	}
+}
+
+void read_frame_list_file(const std::string& filename, std::vector<int>& frames)
+{
+	FILE *file = g_fopen(filename.c_str(), "r");
+	if (!file)
+		throw SynfigToolException(SYNFIGTOOL_FILENOTFOUND,
+			etl::strprintf(_("Unable to open frames file '%s'."), filename.c_str()));
+
+	char buffer[1024];
+	while(fgets(buffer, sizeof(buffer), file))
+	{
+		std::string line(buffer);
+		std::size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+		try
+		{
+			parse_frame_list(line, frames);
+		}
+		catch(...)
+		{
+			fclose(file);
+			throw;
+		}
+	}
+	fclose(file);
+}
+
+std::string frame_filename(const std::string& filename, const std::string& sequence_separator, int frame)
+{
+	return etl::filename_sans_extension(filename)
+		 + sequence_separator
+		 + etl::strprintf("%04d", frame)
+		 + etl::filename_extension(filename);
+}
+
+std::string file_checksum(const std::string& filename)
+{
+	FILE *file = g_fopen(filename.c_str(), "rb");
+	if (!file)
+		return std::string();
+
+	unsigned long long hash = 14695981039346656037ull;
+	unsigned char buffer[65536];
+	while(std::size_t size = fread(buffer, 1, sizeof(buffer), file))
+		for(std::size_t i = 0; i < size; ++i)
+			hash = (hash ^ buffer[i])*1099511628211ull;
+
+	bool failed = ferror(file);
+	fclose(file);
+	return failed ? std::string() : etl::strprintf("%016llx", hash);
+}
+
+FrameManifest::FrameManifest(const std::string& filename, const std::string& source_checksum):
+	filename_(filename),
+	source_checksum_(source_checksum)
+{ }
+
+void FrameManifest::load()
+{
+	checksums_.clear();
+
+	FILE *file = g_fopen(filename_.c_str(), "r");
+	if (!file)
+		return;
+
+	char buffer[4096];
+	bool valid = false;
+	if (fgets(buffer, sizeof(buffer), file))
+	{
+		char source[256] = {};
+		valid = sscanf(buffer, "source %255s", source) == 1
+			 && source_checksum_ == source;
+	}
+
+	if (valid)
+	{
+		while(fgets(buffer, sizeof(buffer), file))
+		{
+			int frame = 0;
+			char checksum[64] = {};
+			if (sscanf(buffer, "%d %63s", &frame, checksum) == 2)
+				checksums_[frame] = checksum;
+		}
+	}
+	else
+	{
+		synfig::warning(_("Manifest '%s' belongs to another version of the document, all frames will be rendered"), filename_.c_str());
+	}
+	fclose(file);
+
+	// start new manifest if the old one can't be used
+	if (!valid)
+		g_remove(filename_.c_str());
+}
+
+bool FrameManifest::is_done(int frame, const std::string& filename) const
+{
+	std::map<int, std::string>::const_iterator i = checksums_.find(frame);
+	return i != checksums_.end()
+		&& !i->second.empty()
+		&& i->second == file_checksum(filename);
+}
+
+bool FrameManifest::add(int frame, const std::string& filename)
+{
+	std::string checksum = file_checksum(filename);
+	if (checksum.empty())
+		return false;
+
+	bool exists = g_file_test(filename_.c_str(), G_FILE_TEST_EXISTS);
+	FILE *file = g_fopen(filename_.c_str(), "a");
+	if (!file)
+		return false;
+	if (!exists)
+		fprintf(file, "source %s\n", source_checksum_.c_str());
+	fprintf(file, "%d %s %s\n", frame, checksum.c_str(), filename.c_str());
+	bool failed = fflush(file) != 0;
+	fclose(file);
+
+	checksums_[frame] = checksum;
+	return !failed;
+}
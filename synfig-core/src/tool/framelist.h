@@ -0,0 +1,72 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tool/framelist.h
+**	\brief Frame shards and checksum manifest of the render jobs
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#ifndef __SYNFIG_FRAMELIST_H
+#define __SYNFIG_FRAMELIST_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+/// Parses list of frames like "1-100:4,120,130-140"
+/// Ranges are inclusive, step is optional. Duplicates are removed, order is kept.
+/// Throws SynfigToolException on syntax error
+void parse_frame_list(const std::string& spec, std::vector<int>& frames);
+
+/// Reads frame lists from job file, one or more lists per line,
+/// everything after '#' is a comment
+void read_frame_list_file(const std::string& filename, std::vector<int>& frames);
+
+/// Returns the name of the file for the frame, same as image sequence targets do
+std::string frame_filename(const std::string& filename, const std::string& sequence_separator, int frame);
+
+/// 64-bit FNV-1a hash of file contents as hex string, empty if file can't be read
+std::string file_checksum(const std::string& filename);
+
+/// List of the already rendered frames, stored as "<outfile>.manifest" text file
+/// First line holds the checksum of the source document, the manifest is
+/// discarded when the document was changed since previous run.
+/// Each following line is "<frame> <checksum> <filename>".
+class FrameManifest
+{
+public:
+	FrameManifest(const std::string& filename, const std::string& source_checksum);
+
+	/// Loads entries written by previous run
+	void load();
+
+	/// Returns true when the frame is listed and its file still has the same checksum
+	bool is_done(int frame, const std::string& filename) const;
+
+	/// Appends frame to manifest, file is flushed immediately,
+	/// so the rendering can be resumed after interruption
+	bool add(int frame, const std::string& filename);
+
+	const std::string& get_filename() const { return filename_; }
+
+private:
+	std::string filename_;
+	std::string source_checksum_;
+	std::map<int, std::string> checksums_;
+};
+
+#endif // __SYNFIG_FRAMELIST_H
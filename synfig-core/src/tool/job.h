@@ -24,6 +24,7 @@
 
 #ifndef __SYNFIG_JOB_H
 #define __SYNFIG_JOB_H
+#include <vector>
 #include "synfig/target.h"
 
 struct Job
@@ -39,6 +40,9 @@ struct Job
 	synfig::Canvas::Handle canvas;
 	synfig::Target::Handle target;
 
+	//! frames to render one by one (render-farm shard), whole animation when empty
+	std::vector<int> frames;
+
 	int quality;
 	bool sifout;
 	bool list_canvases;
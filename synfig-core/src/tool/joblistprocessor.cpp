@@ -37,16 +37,19 @@
 #include <chrono>
 
 #include <autorevision.h>
+#include <ETL/stringf>
 #include <synfig/general.h>
 #include <synfig/localization.h>
 #include <synfig/target.h>
 #include <synfig/target_scanline.h>
 #include <synfig/savecanvas.h>
 #include <synfig/filesystemnative.h>
+#include <synfig/debug/profiler.h>
 
 #include "definitions.h"
 #include "synfigtoolexception.h"
 #include "renderprogress.h"
+#include "framelist.h"
 #include "joblistprocessor.h"
 
 #include <giomm/file.h>
@@ -68,9 +71,33 @@ void process_job_list(std::list<Job>& job_list, const TargetParam& target_params
 
 	for(; !job_list.empty(); job_list.pop_front())
 	{
+		if (!job_list.front().frames.empty())
+			process_job_frames(job_list.front(), target_params);
+		else
 		if (setup_job(job_list.front(), target_params))
 			process_job(job_list.front());
 	}
+
+	std::string profile_filename = SynfigToolGeneralOptions::instance()->get_profile_trace_filename();
+	if (!profile_filename.empty())
+		write_profile(profile_filename);
+}
+
+void write_profile(const std::string &filename)
+{
+	std::vector<synfig::debug::Profiler::LayerTotal> totals = synfig::debug::Profiler::get_layer_totals();
+
+	std::cout << _("Rendering time by layers (seconds, tasks, allocated MiB, layer):") << std::endl;
+	for(std::vector<synfig::debug::Profiler::LayerTotal>::const_iterator i = totals.begin(); i != totals.end(); ++i)
+		std::cout << etl::strprintf("%10.3f %8d %10.1f  %s",
+			(double)i->time*1e-6,
+			i->tasks,
+			(double)i->bytes/(1024.0*1024.0),
+			i->layer.empty() ? _("(no layer)") : i->layer.c_str() ) << std::endl;
+
+	if (!synfig::debug::Profiler::write_trace(filename))
+		throw (SynfigToolException(SYNFIGTOOL_INVALIDOUTPUT, _("Unable to write profile trace.")));
+	VERBOSE_OUT(1) << _("Profile trace written to ") << filename << std::endl;
 }
 
 std::string get_extension(const std::string &filename)
@@ -283,3 +310,75 @@ void process_job (Job& job)
 	VERBOSE_OUT(1) << _("Done.") << std::endl;
 }
 
+
+void process_job_frames(Job& job, const TargetParam& target_parameters)
+{
+	// resolve the target and the output filename
+	if (!setup_job(job, target_parameters))
+		return;
+	if (job.sifout)
+		throw (SynfigToolException(SYNFIGTOOL_INVALIDTARGET, _("Frame list can't be used with sif target.")));
+	job.target = nullptr;
+
+	// manifest is valid only for the same document and the same output settings
+	std::string source_checksum = file_checksum(job.filename);
+	if (source_checksum.empty())
+		source_checksum = "unknown";
+	source_checksum += etl::strprintf("-%s-%dx%d-a%d-q%d-m%d",
+		job.target_name.c_str(), job.desc.get_w(), job.desc.get_h(),
+		job.desc.get_antialias(), job.quality, (int)job.alpha_mode);
+
+	FrameManifest manifest(job.outfilename + ".manifest", source_checksum);
+	manifest.load();
+
+	VERBOSE_OUT(1) << _("Rendering frames...") << std::endl;
+	std::chrono::system_clock::time_point start_timepoint =
+		std::chrono::system_clock::now();
+
+	int rendered = 0, skipped = 0;
+	for(std::vector<int>::const_iterator i = job.frames.begin(); i != job.frames.end(); ++i)
+	{
+		Job frame_job = job;
+		frame_job.frames.clear();
+		frame_job.outfilename = frame_filename(job.outfilename, target_parameters.sequence_separator, *i);
+
+		if (manifest.is_done(*i, frame_job.outfilename))
+		{
+			std::cout << etl::strprintf(_("Frame %d: %s is up to date, skipped"), *i, frame_job.outfilename.c_str()) << std::endl;
+			++skipped;
+			continue;
+		}
+
+		// target takes the rend desc from the canvas
+		frame_job.desc.set_frame(*i);
+		frame_job.canvas->rend_desc() = frame_job.desc;
+		if (!setup_job(frame_job, target_parameters))
+			throw (SynfigToolException(SYNFIGTOOL_INVALIDOUTPUT,
+				etl::strprintf(_("Unable to create output for frame %d."), *i)));
+
+		std::chrono::system_clock::time_point frame_timepoint =
+			std::chrono::system_clock::now();
+
+		RenderProgress p;
+		p.task(frame_job.outfilename);
+		if (!frame_job.target->render(&p))
+			throw (SynfigToolException(SYNFIGTOOL_RENDERFAILURE,
+				etl::strprintf(_("Render Failure at frame %d."), *i)));
+		// release the target to close the file before the checksum is taken
+		frame_job.target = nullptr;
+
+		std::chrono::duration<double> duration =
+			std::chrono::system_clock::now() - frame_timepoint;
+		std::cout << etl::strprintf(_("Frame %d: %s rendered in %.3f seconds"), *i, frame_job.outfilename.c_str(), duration.count()) << std::endl;
+		++rendered;
+
+		if (!manifest.add(*i, frame_job.outfilename))
+			synfig::warning(_("Unable to add frame %d to manifest '%s'"), *i, manifest.get_filename().c_str());
+	}
+
+	job.canvas->rend_desc() = job.desc;
+
+	std::chrono::duration<double> duration =
+		std::chrono::system_clock::now() - start_timepoint;
+	std::cout << etl::strprintf(_("%d frames rendered, %d skipped in %.3f seconds"), rendered, skipped, duration.count()) << std::endl;
+}
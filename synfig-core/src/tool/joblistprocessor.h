@@ -40,6 +40,13 @@ bool setup_job(Job& job, const synfig::TargetParam& target_parameters);
 /// Process an individual job
 void process_job(Job& job);
 
+/// Render frames of the job one by one to separate files,
+/// frames listed in the manifest of previous run are skipped
+void process_job_frames(Job& job, const synfig::TargetParam& target_parameters);
+
+/// Print rendering time per layer and write trace of rendering tasks
+void write_profile(const std::string& filename);
+
 std::string get_absolute_path(std::string relative_path);
 
 #endif // __SYNFIG_JOBLISTPROCESSOR_H
@@ -30,6 +30,7 @@
 #endif
 
 #include <iostream>
+#include <chrono>
 
 #include <autorevision.h>
 #include <synfig/general.h>
@@ -42,11 +43,13 @@
 #include <synfig/importer.h>
 #include <synfig/loadcanvas.h>
 #include <synfig/valuenode_registry.h>
+#include <synfig/debug/profiler.h>
 
 #include "definitions.h"
 #include "job.h"
 #include "synfigtoolexception.h"
 #include "printing_functions.h"
+#include "framelist.h"
 #include "optionsprocessor.h"
 #include <glibmm/init.h>
 #endif
@@ -101,6 +104,8 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	set_begin_time(),
 	set_start_time(),
 	set_end_time(),
+	set_frames(),
+	set_frames_file(),
 	set_dpi(),
 	set_dpi_x(),
 	set_dpi_y(),
@@ -110,6 +115,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	sw_quiet(),
 	sw_print_benchmarks(),
 	sw_extract_alpha(),
+	sw_profile_trace(),
 
 	// Misc group
 	misc_append_filename(),
@@ -159,6 +165,8 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option(og_set, "begin-time",  ' ', set_begin_time, 	_("Set the starting time"), "seconds");
 	add_option(og_set, "start-time",  ' ', set_start_time,	_("Set the starting time"), "seconds");
 	add_option(og_set, "end-time",    ' ', set_end_time, 	_("Set the ending time"), "seconds");
+	add_option(og_set, "frames",      ' ', set_frames, 		_("Render only the listed frames as separate images, skipping the ones already rendered (e.g. 1-100:4,120)"), "list");
+	add_option_filename(og_set, "frames-file", ' ', set_frames_file, _("Same as --frames, but read the frame lists from <filename>"), _("filename"));
 	add_option(og_set, "dpi",         ' ', set_dpi, 		_("Set the physical resolution (Dots-per-inch)"), "NUM");
 	add_option(og_set, "dpi-x",       ' ', set_dpi_x, 		_("Set the physical X resolution (Dots-per-inch)"), "NUM");
 	add_option(og_set, "dpi-y",       ' ', set_dpi_y, 		_("Set the physical Y resolution (Dots-per-inch)"), "NUM");
@@ -169,6 +177,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option(og_switch, "quiet",         'q', sw_quiet, 				_("Quiet mode (No progress/time-remaining display)"), "");
 	add_option(og_switch, "benchmarks",    'b', sw_print_benchmarks,	_("Print benchmarks"), "");
 	add_option(og_switch, "extract-alpha", 'x', sw_extract_alpha, 		_("Extract alpha"), "");
+	add_option_filename(og_switch, "profile-trace", ' ', sw_profile_trace, _("Write timings of rendering tasks to <filename> in Chrome trace format and print totals per layer"), _("filename"));
 
 	//SynfigOptionGroup og_misc("misc", _("Misc options"), "Show Misc options help");
 	add_option_filename(og_misc, "append", ' ', misc_append_filename, 	_("Append layers in <filename> to composition"), _("filename"));
@@ -227,6 +236,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	_allowed_video_codecs.push_back(VideoCodec("msmpeg4", "MPEG-4 part 2 Microsoft variant version 3."));
 	_allowed_video_codecs.push_back(VideoCodec("msmpeg4v1", "MPEG-4 part 2 Microsoft variant version 1."));
 	_allowed_video_codecs.push_back(VideoCodec("msmpeg4v2", "MPEG-4 part 2 Microsoft variant version 2."));
+	_allowed_video_codecs.push_back(VideoCodec("prores-4444", "Apple ProRes 4444 with alpha (MOV)."));
 	_allowed_video_codecs.push_back(VideoCodec("wmv1", "Windows Media Video 7."));
 	_allowed_video_codecs.push_back(VideoCodec("wmv2", "Windows Media Video 8."));
 
@@ -342,6 +352,12 @@ void SynfigCommandLineParser::process_settings_options() const
 		SynfigToolGeneralOptions::instance()->set_should_print_benchmarks(true);
 	}
 
+	if (!sw_profile_trace.empty())
+	{
+		SynfigToolGeneralOptions::instance()->set_profile_trace_filename(sw_profile_trace);
+		synfig::debug::Profiler::set_enabled(true);
+	}
+
 	if (sw_quiet)
 	{
 		SynfigToolGeneralOptions::instance()->set_should_be_quiet(true);
@@ -648,7 +664,21 @@ Job SynfigCommandLineParser::extract_job()
 			if (FileSystem::Handle file_system = CanvasFileNaming::make_filesystem(job.filename))
 			{
 				FileSystem::Identifier identifier = file_system->get_identifier(CanvasFileNaming::project_file(job.filename));
+				std::chrono::steady_clock::time_point start_timepoint =
+					std::chrono::steady_clock::now();
+
 				job.root = open_canvas_as(identifier, job.filename, errors, warnings);
+
+				if (job.root && SynfigToolGeneralOptions::instance()->should_print_benchmarks())
+				{
+					std::chrono::duration<double> duration =
+						std::chrono::steady_clock::now() - start_timepoint;
+
+					std::cout << job.filename.c_str()
+					          << _(": Loaded in ")
+					          << duration.count()
+					          << _(" seconds.") << std::endl;
+				}
 			}
 			else
 			{
@@ -695,6 +725,13 @@ Job SynfigCommandLineParser::extract_job()
 		job.extract_alpha = true;
 	}
 
+	if (!set_frames.empty())
+		parse_frame_list(set_frames, job.frames);
+	if (!set_frames_file.empty())
+		read_frame_list_file(set_frames_file, job.frames);
+	if (!job.frames.empty())
+		VERBOSE_OUT(1) << etl::strprintf(_("%d frames to render"), (int)job.frames.size()) << std::endl;
+
 	if (set_quality > 0)
 		job.quality = set_quality;
 	else
@@ -110,6 +110,8 @@ private:
 	Glib::ustring	set_begin_time;
 	Glib::ustring	set_start_time;
 	Glib::ustring	set_end_time;
+	Glib::ustring	set_frames;
+	std::string		set_frames_file;
 	double			set_dpi;
 	double			set_dpi_x;
 	double			set_dpi_y;
@@ -119,6 +121,7 @@ private:
 	bool			sw_quiet;
 	bool			sw_print_benchmarks;
 	bool			sw_extract_alpha;
+	std::string		sw_profile_trace;
 
 	// Misc group
 	std::string		misc_append_filename;
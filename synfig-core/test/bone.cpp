@@ -29,8 +29,16 @@
 #	include <config.h>
 #endif
 
+#include <cmath>
 #include <iostream>
+#include <vector>
+
 #include <synfig/bone.h>
+#include <synfig/general.h>
+#include <synfig/threadpool.h>
+#include <synfig/type.h>
+#include <synfig/value.h>
+#include <synfig/layers/layer_skeletondeformation.h>
 
 #endif
 
@@ -41,17 +49,234 @@ using namespace synfig;
 
 /* === M A C R O S ========================================================= */
 
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return 1; \
+	} \
+}
+
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
 
-int bone_test1()
+//! Gives access to the mesh and to the reference distance function
+class SkeletonDeformationTest: public Layer_SkeletonDeformation
+{
+public:
+	using Layer_SkeletonDeformation::distance_to_line;
+	rendering::Mesh::Handle get_mesh() const { return mesh; }
+};
+
+static Real random_real(unsigned int &seed, Real min, Real max)
+{
+	seed = seed*1103515245u + 12345u;
+	return min + (max - min)*Real((seed >> 8) & 0xffff)/Real(0xffff);
+}
+
+static Bone create_bone(const Point &origin, Real angle, Real length, Real scalelx, Real width, Real tipwidth, Real depth)
+{
+	Bone bone;
+	bone.set_length(length);
+	bone.set_scalelx(scalelx);
+	bone.set_width(width);
+	bone.set_tipwidth(tipwidth);
+	bone.set_depth(depth);
+	Real c = cos(angle), s = sin(angle);
+	bone.set_animated_matrix(Matrix(
+		 c, s, 0.0,
+		-s, c, 0.0,
+		origin[0], origin[1], 1.0 ));
+	return bone;
+}
+
+static Bone create_random_bone(unsigned int &seed)
+{
+	Point origin(random_real(seed, -4.5, 4.5), random_real(seed, -4.5, 4.5));
+	return create_bone(
+		origin,
+		random_real(seed, -PI, PI),
+		random_real(seed, 0.1, 3.0),
+		random_real(seed, -1.5, 1.5),
+		random_real(seed, 0.0, 1.5),
+		random_real(seed, 0.0, 1.5),
+		random_real(seed, -2.0, 2.0) );
+}
+
+static std::vector<Layer_SkeletonDeformation::BonePair> create_bones(unsigned int seed)
+{
+	std::vector<Layer_SkeletonDeformation::BonePair> bones;
+	for(int i = 0; i < 12; ++i) {
+		Bone rest = create_random_bone(seed);
+		Bone pose = create_random_bone(seed);
+		bones.push_back(Layer_SkeletonDeformation::BonePair(rest, pose));
+	}
+
+	Bone pose = create_random_bone(seed);
+	// zero length
+	bones.push_back(Layer_SkeletonDeformation::BonePair(
+		create_bone(Point(0.3, -0.2), 0.5, 1.0, 0.0, 0.7, 0.4, 1.0), pose ));
+	// tip circle covers the origin circle, shape has no side lines
+	bones.push_back(Layer_SkeletonDeformation::BonePair(
+		create_bone(Point(-1.1, 0.9), 2.0, 0.2, 1.0, 0.1, 1.2, 0.0), pose ));
+	// no width
+	bones.push_back(Layer_SkeletonDeformation::BonePair(
+		create_bone(Point(1.7, 1.3), -1.0, 2.0, 1.0, 0.0, 0.0, -1.0), pose ));
+	// out of the grid
+	bones.push_back(Layer_SkeletonDeformation::BonePair(
+		create_bone(Point(50.0, -70.0), 0.0, 1.0, 1.0, 0.5, 0.5, 0.0), pose ));
+	// axis aligned, along the grid lines
+	bones.push_back(Layer_SkeletonDeformation::BonePair(
+		create_bone(Point(-2.0, -2.0), 0.0, 4.0, 1.0, 0.3, 0.3, 0.5), pose ));
+	return bones;
+}
+
+static bool is_same(Real a, Real b)
+	{ return std::isnan(a) ? std::isnan(b) : a == b; }
+
+//! Same weights as Layer_SkeletonDeformation::prepare_mesh() calculated for each pair of grid point and bone
+static Vector reference_position(
+	const std::vector<Layer_SkeletonDeformation::BonePair> &bones,
+	const Vector &x, Real expand, bool &used )
+{
+	static const Real precision = 1e-10;
+
+	Vector summary_position;
+	Real summary_weight = 0.0;
+	used = false;
+	for(std::vector<Layer_SkeletonDeformation::BonePair>::const_iterator i = bones.begin(); i != bones.end(); ++i) {
+		Bone::Shape shape0 = i->first.get_shape();
+		Bone::Shape shape1 = i->second.get_shape();
+		Bone::Shape expanded_shape0 = shape0;
+		expanded_shape0.r0 += expand;
+		expanded_shape0.r1 += expand;
+
+		Matrix into_bone(
+			shape0.p1[0] - shape0.p0[0], shape0.p1[1] - shape0.p0[1], 0.0,
+			shape0.p0[1] - shape0.p1[1], shape0.p1[0] - shape0.p0[0], 0.0,
+			shape0.p0[0], shape0.p0[1], 1.0 );
+		into_bone.invert();
+		Matrix from_bone(
+			shape1.p1[0] - shape1.p0[0], shape1.p1[1] - shape1.p0[1], 0.0,
+			shape1.p0[1] - shape1.p1[1], shape1.p1[0] - shape1.p0[0], 0.0,
+			shape1.p0[0], shape1.p0[1], 1.0 );
+		Matrix matrix = from_bone * into_bone;
+
+		Real percent = Bone::distance_to_shape_center_percent(expanded_shape0, x);
+		if (percent > precision) {
+			Real distance = SkeletonDeformationTest::distance_to_line(shape0.p0, shape0.p1, x);
+			if (distance < precision) distance = precision;
+			Real weight = percent/(distance*distance);
+			summary_position += matrix.get_transformed(x) * weight;
+			summary_weight += weight;
+			used = true;
+		}
+	}
+	return summary_weight > precision ? summary_position/summary_weight : x;
+}
+
+static int check_mesh(const Point &p0, const Point &p1, int x_subdivisions, int y_subdivisions, unsigned int seed)
 {
+	std::vector<Layer_SkeletonDeformation::BonePair> bones = create_bones(seed);
+	ValueBase bones_value;
+	bones_value.set_list_of(bones);
+
+	etl::handle<SkeletonDeformationTest> layer(new SkeletonDeformationTest());
+	layer->set_param("point1", ValueBase(p0));
+	layer->set_param("point2", ValueBase(p1));
+	layer->set_param("x_subdivisions", ValueBase(x_subdivisions));
+	layer->set_param("y_subdivisions", ValueBase(y_subdivisions));
+	layer->set_param("bones", bones_value);
+
+	rendering::Mesh::Handle mesh = layer->get_mesh();
+	ASSERT(mesh);
+
+	const int count_x = x_subdivisions + 1;
+	const int count_y = y_subdivisions + 1;
+	ASSERT((int)mesh->vertices.size() == count_x*count_y);
+
+	const Real step_x = (p1[0] - p0[0])/x_subdivisions;
+	const Real step_y = (p1[1] - p0[1])/y_subdivisions;
+	const Real expand = 2.0*sqrt(step_x*step_x + step_y*step_y);
+
+	std::vector<bool> used(count_x*count_y);
+	for(int j = 0; j < count_y; ++j) {
+		for(int i = 0; i < count_x; ++i) {
+			const int index = j*count_x + i;
+			Vector x(p0[0] + i*step_x, p0[1] + j*step_y);
+			bool u = false;
+			Vector expected = reference_position(bones, x, expand, u);
+			used[index] = u;
+
+			const Vector &actual = mesh->vertices[index].position;
+			if (!is_same(expected[0], actual[0]) || !is_same(expected[1], actual[1])) {
+				error( "seed %u, grid %dx%d, point (%d, %d): expected (%.17g, %.17g), got (%.17g, %.17g)",
+					seed, count_x, count_y, i, j, expected[0], expected[1], actual[0], actual[1] );
+				return 1;
+			}
+		}
+	}
+
+	// cells where all corners are affected by bones
+	int triangles = 0;
+	for(int j = 1; j < count_y; ++j)
+		for(int i = 1; i < count_x; ++i)
+			if ( used[(j-1)*count_x + i-1] && used[(j-1)*count_x + i]
+			  && used[j*count_x + i-1] && used[j*count_x + i] )
+				triangles += 2;
+	ASSERT((int)mesh->triangles.size() == triangles);
+
 	return 0;
 }
 
-int bone_test2()
+//! Compares mesh of the layer with weights of bones calculated for every grid point separately
+int bone_test_skinning()
 {
+	int failures = 0;
+	for(unsigned int seed = 1; seed <= 3; ++seed) {
+		// small grid is processed in a single pass
+		failures += check_mesh(Point(-4, 4), Point(4, -4), 16, 12, seed);
+		// big grid is split into bands for threads
+		failures += check_mesh(Point(-4, 4), Point(4, -4), 160, 120, seed);
+		// reversed axes
+		failures += check_mesh(Point(5, -3), Point(-3, 5), 90, 70, seed);
+	}
+	// degenerate grid
+	failures += check_mesh(Point(1, 1), Point(1, 1), 4, 4, 1);
+	return failures;
+}
+
+//! Layer should not rebuild the mesh when bones and grid are not changed
+int bone_test_mesh_state()
+{
+	std::vector<Layer_SkeletonDeformation::BonePair> bones = create_bones(7);
+	ValueBase bones_value;
+	bones_value.set_list_of(bones);
+
+	etl::handle<SkeletonDeformationTest> layer(new SkeletonDeformationTest());
+	layer->set_param("bones", bones_value);
+	rendering::Mesh::Handle mesh = layer->get_mesh();
+	ASSERT(mesh);
+
+	// the same pose, even set by a new value
+	ValueBase same_value;
+	same_value.set_list_of(bones);
+	layer->set_param("bones", same_value);
+	ASSERT(layer->get_mesh() == mesh);
+	layer->set_param("x_subdivisions", ValueBase(32));
+	ASSERT(layer->get_mesh() == mesh);
+
+	// changed pose
+	bones[3].second.set_width(bones[3].second.get_width() + 0.1);
+	bones_value.set_list_of(bones);
+	layer->set_param("bones", bones_value);
+	ASSERT(layer->get_mesh() != mesh);
+	mesh = layer->get_mesh();
+
+	// changed grid
+	layer->set_param("point2", ValueBase(Point(4, -3)));
+	ASSERT(layer->get_mesh() != mesh);
+
 	return 0;
 }
 
@@ -61,8 +286,20 @@ int main()
 {
 	int failures = 0;
 
-	failures += bone_test1();
-	failures += bone_test2();
+	Type::subsys_init();
+	// big meshes are built by threads
+	ThreadPool::subsys_init();
+
+	failures += bone_test_skinning();
+	failures += bone_test_mesh_state();
+
+	ThreadPool::subsys_stop();
+	Type::subsys_stop();
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
 
 	return failures;
 }
@@ -0,0 +1,348 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file canvascache.cpp
+**	\brief Test writing and reading of CanvasCache files
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <ETL/stringf>
+
+#include <synfig/canvascache.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/general.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return true; \
+	} \
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+/* === C L A S S E S ======================================================= */
+
+//! Records events as strings, so they may be compared with the written ones
+class Recorder: public CanvasCache::Handler
+{
+public:
+	std::vector<String> events;
+
+	virtual void start_element(const String &name, const CanvasCache::AttributeList &attributes, int line)
+	{
+		String event = strprintf("start %s line %d", name.c_str(), line);
+		for(CanvasCache::AttributeList::const_iterator i = attributes.begin(); i != attributes.end(); ++i)
+			event += " " + i->name + "=\"" + i->value + "\"";
+		events.push_back(event);
+	}
+	virtual void end_element()
+		{ events.push_back("end"); }
+	virtual void characters(const String &text)
+		{ events.push_back("text " + text); }
+};
+
+/* === P R O C E D U R E S ================================================= */
+
+static CanvasCache::Source create_source()
+{
+	CanvasCache::Source source;
+	source.path = "/path/to/file.sifz#";
+	source.size = 123456;
+	source.mtime = 1600000000123456789ll;
+	return source;
+}
+
+//! Writes the same events into the writer and into the expected list
+static void write_events(CanvasCache::Writer &writer, std::vector<String> &expected)
+{
+	writer.start_element("canvas", 2, 2);
+	writer.attribute("version", "1.2");
+	writer.attribute("width", "480");
+	expected.push_back("start canvas line 2 version=\"1.2\" width=\"480\"");
+
+	for(int i = 0; i < 3; ++i) {
+		// names are written once and then referenced by index
+		writer.start_element("layer", 3 + i*4, 2);
+		writer.attribute("type", "circle");
+		writer.attribute("desc", strprintf("layer %d", i));
+		expected.push_back(strprintf("start layer line %d type=\"circle\" desc=\"layer %d\"", 3 + i*4, i));
+
+		writer.start_element("param", 4 + i*4, 1);
+		writer.attribute("name", "amount");
+		expected.push_back(strprintf("start param line %d name=\"amount\"", 4 + i*4));
+
+		writer.characters(String("text\0with zero", 14));
+		expected.push_back("text " + String("text\0with zero", 14));
+
+		writer.end_element();
+		expected.push_back("end");
+		writer.end_element();
+		expected.push_back("end");
+	}
+
+	// empty element and empty text, unknown line
+	writer.start_element("desc", -1, 0);
+	expected.push_back("start desc line 0");
+	writer.characters("");
+	expected.push_back("text ");
+	writer.end_element();
+	expected.push_back("end");
+
+	writer.end_element();
+	expected.push_back("end");
+}
+
+static bool read_file(const String &filename, std::string &out_data)
+{
+	FILE *f = g_fopen(filename.c_str(), "rb");
+	if (!f) return false;
+	char buffer[4096];
+	while(size_t size = fread(buffer, 1, sizeof(buffer), f))
+		out_data.append(buffer, size);
+	fclose(f);
+	return true;
+}
+
+static bool write_file(const String &filename, const std::string &data)
+{
+	FILE *f = g_fopen(filename.c_str(), "wb");
+	if (!f) return false;
+	bool success = fwrite(data.data(), 1, data.size(), f) == data.size();
+	return fclose(f) == 0 && success;
+}
+
+//! Cache file with the given content should be rejected without any call of handler
+static bool is_rejected(const CanvasCache::Source &source, const std::string &data)
+{
+	if (!write_file(CanvasCache::get_cache_filename(source.path), data))
+		return false;
+	Recorder recorder;
+	return !CanvasCache::load(source, recorder) && recorder.events.empty();
+}
+
+bool test_round_trip()
+{
+	CanvasCache::Source source = create_source();
+	CanvasCache::Writer writer;
+	std::vector<String> expected;
+	write_events(writer, expected);
+	ASSERT(writer.save(source));
+
+	Recorder recorder;
+	ASSERT(CanvasCache::load(source, recorder));
+	ASSERT(recorder.events == expected);
+
+	// cache of another file, or of the same file after change
+	CanvasCache::Source other = source;
+	other.path = "/path/to/other.sifz#";
+	ASSERT(!CanvasCache::load(other, recorder));
+	other = source;
+	other.size += 1;
+	ASSERT(!CanvasCache::load(other, recorder));
+	other = source;
+	other.mtime += 1; // saved in the same second
+	ASSERT(!CanvasCache::load(other, recorder));
+	ASSERT(recorder.events == expected);
+
+	return false;
+}
+
+bool test_broken_files()
+{
+	CanvasCache::Source source = create_source();
+	CanvasCache::Writer writer;
+	std::vector<String> expected;
+	write_events(writer, expected);
+	ASSERT(writer.save(source));
+
+	std::string data;
+	ASSERT(read_file(CanvasCache::get_cache_filename(source.path), data));
+	ASSERT(!data.empty() && data[data.size() - 1] == 'Z');
+
+	// truncated at any position
+	for(size_t size = 0; size < data.size(); ++size)
+		ASSERT(is_rejected(source, data.substr(0, size)));
+
+	// garbage after the end
+	ASSERT(is_rejected(source, data + "Z"));
+	ASSERT(is_rejected(source, data + "E"));
+
+	// broken magic
+	std::string broken = data;
+	broken[0] = 'X';
+	ASSERT(is_rejected(source, broken));
+
+	// unknown event instead of the end mark
+	broken = data;
+	broken[broken.size() - 1] = 'Q';
+	ASSERT(is_rejected(source, broken));
+
+	// unbalanced elements
+	CanvasCache::Writer unbalanced;
+	unbalanced.start_element("canvas", 1, 0);
+	unbalanced.end_element();
+	unbalanced.end_element();
+	ASSERT(unbalanced.save(source));
+	Recorder recorder;
+	ASSERT(!CanvasCache::load(source, recorder) && recorder.events.empty());
+
+	unbalanced = CanvasCache::Writer();
+	unbalanced.start_element("canvas", 1, 0);
+	ASSERT(unbalanced.save(source));
+	ASSERT(!CanvasCache::load(source, recorder) && recorder.events.empty());
+
+	// file without events is the header and the end mark
+	ASSERT(CanvasCache::Writer().save(source));
+	std::string header;
+	ASSERT(read_file(CanvasCache::get_cache_filename(source.path), header));
+	ASSERT(CanvasCache::load(source, recorder) && recorder.events.empty());
+	header.erase(header.size() - 1);
+
+	// reference to the name which was never written
+	std::string events = "S";
+	events += '\x01'; // name index
+	events += '\x01'; // line
+	events += '\x00'; // attributes count
+	events += "EZ";
+	ASSERT(is_rejected(source, header + events));
+
+	// length of string out of the file
+	events = "S";
+	events += '\x00'; // new name
+	events += '\x7f'; // length
+	events += "canvas";
+	ASSERT(is_rejected(source, header + events));
+
+	// endless varint
+	events = "S";
+	events += std::string(12, '\xff');
+	ASSERT(is_rejected(source, header + events));
+
+	// valid file still loads after all the broken ones
+	ASSERT(writer.save(source));
+	ASSERT(CanvasCache::load(source, recorder));
+	ASSERT(recorder.events == expected);
+
+	return false;
+}
+
+//! Source is identified by size and modification time with nanoseconds
+bool test_source()
+{
+	String filename = CanvasCache::get_directory() + ETL_DIRECTORY_SEPARATOR + "file.sif";
+	FileSystem::Identifier identifier = FileSystemNative::instance()->get_identifier(filename);
+	CanvasCache::Source source;
+
+	ASSERT(write_file(filename, std::string(1000, ' ')));
+	ASSERT(!CanvasCache::get_source(identifier, filename, source));
+
+	ASSERT(write_file(filename, std::string(CanvasCache::min_source_size, ' ')));
+	ASSERT(CanvasCache::get_source(identifier, filename, source));
+	ASSERT(source.path == filename);
+	ASSERT(source.size == CanvasCache::min_source_size);
+
+#ifndef _WIN32
+	// file saved twice in the same second
+	struct timespec times[2];
+	times[0].tv_sec = times[1].tv_sec = 1600000000;
+	times[0].tv_nsec = times[1].tv_nsec = 100000000;
+	ASSERT(utimensat(AT_FDCWD, filename.c_str(), times, 0) == 0);
+	ASSERT(CanvasCache::get_source(identifier, filename, source));
+	ASSERT(CanvasCache::Writer().save(source));
+
+	times[0].tv_nsec = times[1].tv_nsec = 200000000;
+	ASSERT(utimensat(AT_FDCWD, filename.c_str(), times, 0) == 0);
+	CanvasCache::Source changed;
+	ASSERT(CanvasCache::get_source(identifier, filename, changed));
+	ASSERT(changed.size == source.size);
+	ASSERT(changed.mtime != source.mtime);
+
+	Recorder recorder;
+	ASSERT(CanvasCache::load(source, recorder));
+	ASSERT(!CanvasCache::load(changed, recorder));
+#endif
+
+	return false;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	int failures = 0;
+	bool fail;
+
+	gchar *directory = g_dir_make_tmp("synfig-canvascache-XXXXXX", NULL);
+	if (!directory) {
+		error("Cannot create temporary directory");
+		return 1;
+	}
+	CanvasCache::set_directory(directory);
+
+	TEST_FUNCTION(test_round_trip)
+	TEST_FUNCTION(test_broken_files)
+	TEST_FUNCTION(test_source)
+
+	// remove_recursive() leaves the empty directory
+	FileSystemNative::instance()->remove_recursive(directory);
+	g_rmdir(directory);
+	g_free(directory);
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_blend.cpp
+**	\brief Test vectorized blend functions against Color::blend()
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <ETL/stringf>
+
+#include <synfig/general.h>
+
+#include <synfig/rendering/software/function/blend.h>
+
+#include "rendering_common.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === M A C R O S ========================================================= */
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return true; \
+	} \
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+// odd count to check tails of packs
+#define ROW_SIZE 37
+
+/* === P R O C E D U R E S ================================================= */
+
+static const ColorReal amounts[] = { 1.0, 0.5, -0.7, 0.3 };
+static const int amounts_count = sizeof(amounts)/sizeof(amounts[0]);
+
+static bool compare_rows(
+	const std::vector<Color> &expected,
+	const std::vector<Color> &actual,
+	const char *function,
+	int method,
+	ColorReal amount )
+{
+	for(int i = 0; i < (int)expected.size(); ++i) {
+		if (!is_equal(expected[i], actual[i])) {
+			error( "%s: method %d, amount %f, instructions %d, pixel %d: expected (%f, %f, %f, %f), got (%f, %f, %f, %f)",
+				function, method, amount, (int)Blend::get_instructions(), i,
+				expected[i].get_r(), expected[i].get_g(), expected[i].get_b(), expected[i].get_a(),
+				actual[i].get_r(), actual[i].get_g(), actual[i].get_b(), actual[i].get_a() );
+			return false;
+		}
+	}
+	return true;
+}
+
+bool test_blend()
+{
+	std::vector<Color> src(ROW_SIZE), dest(ROW_SIZE), expected, actual;
+	fill_random(src, 1);
+	fill_random(dest, 2);
+
+	for(int instructions = Blend::INSTRUCTIONS_VECTOR4; instructions <= Blend::get_supported_instructions(); ++instructions)
+	for(int method = 0; method < Color::BLEND_END; ++method)
+	for(int i = 0; i < amounts_count; ++i) {
+		Blend::set_instructions(Blend::INSTRUCTIONS_SCALAR);
+		expected = dest;
+		Blend::blend(&expected.front(), &src.front(), ROW_SIZE, (Color::BlendMethod)method, amounts[i]);
+
+		Blend::set_instructions((Blend::Instructions)instructions);
+		actual = dest;
+		Blend::blend(&actual.front(), &src.front(), ROW_SIZE, (Color::BlendMethod)method, amounts[i]);
+		ASSERT(compare_rows(expected, actual, "blend", method, amounts[i]));
+	}
+
+	Blend::set_instructions(Blend::get_supported_instructions());
+	return false;
+}
+
+bool test_fill()
+{
+	std::vector<Color> colors(4), dest(ROW_SIZE), expected, actual;
+	fill_random(colors, 3);
+	fill_random(dest, 4);
+	colors[0].set_a(1);
+	colors[1].set_a(0);
+
+	for(int instructions = Blend::INSTRUCTIONS_VECTOR4; instructions <= Blend::get_supported_instructions(); ++instructions)
+	for(int method = 0; method < Color::BLEND_END; ++method)
+	for(int i = 0; i < amounts_count; ++i)
+	for(int j = 0; j < (int)colors.size(); ++j) {
+		Blend::set_instructions(Blend::INSTRUCTIONS_SCALAR);
+		expected = dest;
+		Blend::fill(&expected.front(), colors[j], ROW_SIZE, (Color::BlendMethod)method, amounts[i]);
+
+		Blend::set_instructions((Blend::Instructions)instructions);
+		actual = dest;
+		Blend::fill(&actual.front(), colors[j], ROW_SIZE, (Color::BlendMethod)method, amounts[i]);
+		ASSERT(compare_rows(expected, actual, "fill", method, amounts[i]));
+	}
+
+	Blend::set_instructions(Blend::get_supported_instructions());
+	return false;
+}
+
+bool test_surface()
+{
+	synfig::Surface src(20, 10), dest(30, 20);
+	for(int y = 0; y < src.get_h(); ++y)
+		for(int x = 0; x < src.get_w(); ++x)
+			src[y][x] = Color(0.1*x, 0.05*y, 0.5, 0.75);
+	dest.fill(Color(0.25, 0.5, 0.75, 0.5));
+
+	RectInt rect(5, 3, 22, 10);
+	const VectorInt offset(2, 1);
+	Blend::blend(dest, rect, src, offset, Color::BLEND_COMPOSITE, 0.5);
+
+	for(int y = 0; y < dest.get_h(); ++y) {
+		for(int x = 0; x < dest.get_w(); ++x) {
+			Color expected(0.25, 0.5, 0.75, 0.5);
+			if (rect.is_inside(PointInt(x, y)))
+				expected = Color::blend(
+					src[y - rect.miny + offset[1]][x - rect.minx + offset[0]],
+					expected, 0.5, Color::BLEND_COMPOSITE );
+			ASSERT(is_equal(expected, dest[y][x]));
+		}
+	}
+
+	Blend::fill(dest, rect, Color(0, 0, 0, 0), Color::BLEND_STRAIGHT, 1.0);
+	ASSERT(dest[rect.miny][rect.minx] == Color(0, 0, 0, 0));
+	ASSERT(dest[rect.maxy - 1][rect.maxx - 1] == Color(0, 0, 0, 0));
+	ASSERT(dest[rect.maxy][rect.maxx] == Color(0.25, 0.5, 0.75, 0.5));
+
+	return false;
+}
+
+//! prints time of blending for every method and instructions set,
+//! run as: rendering_blend benchmark
+void benchmark()
+{
+	const int width = 1920, height = 64, repeats = 10;
+	std::vector<Color> src(width*height), dest(width*height), row;
+	fill_random(src, 5);
+	fill_random(dest, 6);
+
+	for(int method = 0; method < Color::BLEND_END; ++method) {
+		String line = strprintf("method %2d:", method);
+		for(int instructions = Blend::INSTRUCTIONS_SCALAR; instructions <= Blend::get_supported_instructions(); ++instructions) {
+			Blend::set_instructions((Blend::Instructions)instructions);
+			row = dest;
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			for(int i = 0; i < repeats; ++i)
+				Blend::blend(&row.front(), &src.front(), (int)row.size(), (Color::BlendMethod)method, 0.75);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count()/repeats;
+			line += strprintf("  x%d %8.3fms", instructions == Blend::INSTRUCTIONS_SCALAR ? 1 : instructions == Blend::INSTRUCTIONS_VECTOR4 ? 4 : 8, ms);
+		}
+		info("%s", line.c_str());
+	}
+
+	Blend::set_instructions(Blend::get_supported_instructions());
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && !strcmp(argv[1], "benchmark"))
+		{ benchmark(); return 0; }
+
+	int failures = 0;
+	bool fail;
+
+	TEST_FUNCTION(test_blend)
+	TEST_FUNCTION(test_fill)
+	TEST_FUNCTION(test_surface)
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,426 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_cache.cpp
+**	\brief Test hashes of rendering tasks, TaskCache and Mipmap
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <synfig/general.h>
+#include <synfig/token.h>
+
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/taskcache.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/taskcontour.h>
+#include <synfig/rendering/common/task/taskmesh.h>
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/software/surfaceswpacked.h>
+#include <synfig/rendering/software/function/mipmap.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return true; \
+	} \
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+static Task::Handle make_contour_task(const Color &color)
+{
+	rendering::Contour::Handle contour(new rendering::Contour());
+	contour->move_to(Vector(-1.0, -1.0));
+	contour->line_to(Vector(1.0, -0.5));
+	contour->line_to(Vector(0.0, 1.0));
+	contour->close();
+	contour->color = color;
+
+	TaskContour::Handle task(new TaskContour());
+	task->contour = contour;
+	task->source_rect = Rect(-2.0, -2.0, 2.0, 2.0);
+	task->target_rect = RectInt(0, 0, 100, 100);
+	return task;
+}
+
+static Task::Handle make_blend_task(const Task::Handle &a, const Task::Handle &b)
+{
+	TaskBlend::Handle task(new TaskBlend());
+	task->sub_task_a() = a;
+	task->sub_task_b() = b;
+	task->source_rect = Rect(-2.0, -2.0, 2.0, 2.0);
+	task->target_rect = RectInt(0, 0, 100, 100);
+	return task;
+}
+
+static SurfaceResource::Handle make_surface(int width, int height)
+{
+	SurfaceResource::Handle surface(new SurfaceResource());
+	surface->create(width, height);
+	return surface;
+}
+
+static void write_surface(const SurfaceResource::Handle &surface)
+{
+	SurfaceResource::LockWrite<SurfaceSW> lock(surface);
+	lock->get_surface().fill(Color::red());
+}
+
+bool test_hash()
+{
+	TaskHash::Value a = 0, b = 0, c = 0;
+
+	ASSERT(make_contour_task(Color::red())->calc_hash(a));
+	ASSERT(make_contour_task(Color::red())->calc_hash(b));
+	ASSERT(make_contour_task(Color::blue())->calc_hash(c));
+	ASSERT(a == b);
+	ASSERT(a != c);
+
+	Task::Handle moved = make_contour_task(Color::red());
+	moved->target_rect = RectInt(10, 0, 110, 100);
+	ASSERT(moved->calc_hash(c));
+	ASSERT(a != c);
+
+	// tasks without hash_params() implementation are not hashable,
+	// but hashes of their hashable sub-trees are still collected
+	TaskMesh::Handle mesh(new TaskMesh());
+	Task::Handle contour = make_contour_task(Color::red());
+	Task::Handle blend = make_blend_task(contour, mesh);
+	Task::HashMap hashes;
+	ASSERT(!blend->calc_hash(c));
+	ASSERT(!blend->calc_hash(c, &hashes));
+	ASSERT(hashes.count(contour.get()));
+	ASSERT(hashes[contour.get()] == a);
+	ASSERT(!hashes.count(blend.get()));
+	ASSERT(!hashes.count(mesh.get()));
+
+	// prerendered surfaces are hashed by identity and revision
+	SurfaceResource::Handle surface = make_surface(16, 16);
+	TaskSurface::Handle task_surface(new TaskSurface());
+	task_surface->target_surface = surface;
+	task_surface->target_rect = RectInt(0, 0, 16, 16);
+	task_surface->source_rect = Rect(0.0, 0.0, 1.0, 1.0);
+	write_surface(surface);
+	ASSERT(task_surface->calc_hash(a));
+	ASSERT(task_surface->calc_hash(b));
+	ASSERT(a == b);
+	write_surface(surface);
+	ASSERT(task_surface->calc_hash(b));
+	ASSERT(a != b);
+
+	return false;
+}
+
+bool test_surface_id()
+{
+	// TaskSurface is hashed by id of its surface, so ids should be unique
+	// even when surfaces are created by several rendering threads at once
+	const int threads_count = 4, surfaces_count = 10000;
+	std::vector<SurfaceResource::Id> ids(threads_count*surfaces_count);
+	std::vector<std::thread> threads;
+	for(int i = 0; i < threads_count; ++i)
+		threads.push_back(std::thread([&ids, i]() {
+			for(int j = 0; j < surfaces_count; ++j)
+				ids[i*surfaces_count + j] = SurfaceResource::Handle(new SurfaceResource())->get_id();
+		}));
+	for(int i = 0; i < threads_count; ++i)
+		threads[i].join();
+
+	std::sort(ids.begin(), ids.end());
+	ASSERT(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+
+	return false;
+}
+
+bool test_cache()
+{
+	const size_t surface_size = 100*100*sizeof(Color);
+
+	TaskCache::Handle cache(new TaskCache());
+	// disabled by default
+	ASSERT(!cache->is_enabled());
+	cache->set_max_size(2*surface_size);
+
+	// result is stored only for keys which were met before
+	ASSERT(!cache->touch(1));
+	ASSERT(cache->touch(1));
+	ASSERT(!cache->touch(1));
+
+	SurfaceResource::Handle s1 = make_surface(100, 100);
+	SurfaceResource::Handle s2 = make_surface(100, 100);
+	SurfaceResource::Handle s3 = make_surface(100, 100);
+
+	cache->store(1, s1);
+	cache->store(2, s2);
+	ASSERT(cache->get_size() == 2*surface_size);
+	ASSERT(cache->find(1) == s1);
+	ASSERT(cache->find(2) == s2);
+
+	// least recently used entry should be removed
+	ASSERT(cache->find(1) == s1);
+	cache->store(3, s3);
+	ASSERT(cache->get_size() == 2*surface_size);
+	ASSERT(cache->find(1) == s1);
+	ASSERT(!cache->find(2));
+	ASSERT(cache->find(3) == s3);
+
+	// changed surfaces are removed from cache
+	write_surface(s1);
+	ASSERT(!cache->find(1));
+	ASSERT(cache->get_size() == surface_size);
+
+	// surfaces larger than budget are not stored
+	cache->store(4, make_surface(200, 200));
+	ASSERT(!cache->find(4));
+	ASSERT(cache->find(3) == s3);
+
+	cache->set_max_size(0);
+	ASSERT(!cache->is_enabled());
+	ASSERT(!cache->find(3));
+	ASSERT(cache->get_size() == 0);
+
+	return false;
+}
+
+static Task::Handle make_large_contour_task(const Color &color)
+{
+	// bounds of contour cover the whole target, so it is large enough to be cached
+	rendering::Contour::Handle contour(new rendering::Contour());
+	contour->move_to(Vector(-2.0, -2.0));
+	contour->line_to(Vector(2.0, -1.0));
+	contour->line_to(Vector(0.0, 2.0));
+	contour->close();
+	contour->color = color;
+
+	TaskContour::Handle task(new TaskContour());
+	task->contour = contour;
+	task->source_rect = Rect(-2.0, -2.0, 2.0, 2.0);
+	task->target_rect = RectInt(0, 0, 100, 100);
+	return task;
+}
+
+static Task::Handle make_frame_task(const SurfaceResource::Handle &target, int frame)
+{
+	// sub-trees are the same in every frame, so they are taken from cache,
+	// amount of root is changed every frame, so root blends onto cached surfaces
+
+	// two identical contours
+	Task::Handle both = make_blend_task(make_large_contour_task(Color::red()), make_large_contour_task(Color::red()));
+
+	// blending onto another contour
+	Task::Handle onto = make_blend_task(make_large_contour_task(Color::red()), make_large_contour_task(Color::blue()));
+
+	TaskBlend::Handle task = TaskBlend::Handle::cast_dynamic(make_blend_task(both, onto));
+	task->amount = 0.9 - 0.1*frame;
+	task->target_surface = target;
+	return task;
+}
+
+static bool render_frame(synfig::Surface &out, int frame)
+{
+	SurfaceResource::Handle target = make_surface(100, 100);
+	if (!Renderer::get_renderer("software")->run(make_frame_task(target, frame)))
+		return false;
+	SurfaceResource::LockRead<SurfaceSW> lock(target);
+	if (!lock) return false;
+	out = lock->get_surface();
+	return true;
+}
+
+static bool is_same_pixels(const synfig::Surface &a, const synfig::Surface &b)
+{
+	if (a.get_w() != b.get_w() || a.get_h() != b.get_h())
+		return false;
+	for(int y = 0; y < a.get_h(); ++y)
+		for(int x = 0; x < a.get_w(); ++x)
+			if (!approximate_equal_lp(a[y][x].get_r(), b[y][x].get_r())
+			 || !approximate_equal_lp(a[y][x].get_g(), b[y][x].get_g())
+			 || !approximate_equal_lp(a[y][x].get_b(), b[y][x].get_b())
+			 || !approximate_equal_lp(a[y][x].get_a(), b[y][x].get_a()))
+				return false;
+	return true;
+}
+
+bool test_render()
+{
+	const int frames = 4;
+	const size_t surface_size = 100*100*sizeof(Color);
+	const TaskCache::Handle &cache = Renderer::get_cache();
+	ASSERT(cache);
+
+	synfig::Surface expected[frames];
+	cache->set_max_size(0);
+	for(int frame = 0; frame < frames; ++frame) {
+		ASSERT(render_frame(expected[frame], frame));
+		// center of target is covered by contours
+		ASSERT(expected[frame][50][50].get_a() > 0.5);
+	}
+
+	cache->set_max_size(16*surface_size);
+	for(int frame = 0; frame < frames; ++frame) {
+		synfig::Surface result;
+		ASSERT(render_frame(result, frame));
+		ASSERT(is_same_pixels(expected[frame], result));
+
+		// both sub-trees are cached, surfaces are not written by tasks
+		// which use them, otherwise they would be dropped by revision check
+		if (frame > 0)
+			ASSERT(cache->get_size() == 2*surface_size);
+	}
+
+	cache->clear();
+	return false;
+}
+
+static SurfaceSWPacked::Handle make_packed_surface(int width, int height, const Color &color)
+{
+	SurfaceSW surface;
+	surface.create(width, height);
+	surface.get_surface().fill(color);
+	surface.touch();
+	return new SurfaceSWPacked(surface);
+}
+
+static bool is_filled(const synfig::Surface &surface, const Color &color)
+{
+	for(int y = 0; y < surface.get_h(); ++y)
+		for(int x = 0; x < surface.get_w(); ++x)
+			if (!approximate_equal_lp(surface[y][x].get_r(), color.get_r())
+			 || !approximate_equal_lp(surface[y][x].get_a(), color.get_a()))
+				return false;
+	return true;
+}
+
+bool test_mipmap()
+{
+	using software::Mipmap;
+	const Color color(0.5, 0.25, 1.0, 1.0);
+
+	Mipmap::clear();
+	Mipmap::Statistics stats = Mipmap::get_statistics();
+
+	SurfaceSWPacked::Handle a = make_packed_surface(64, 48, color);
+
+	// source is used when it's not larger than twice of requested size
+	ASSERT(!Mipmap::get_level(a, 64, 48));
+	ASSERT(!Mipmap::get_level(a, 40, 10));
+
+	Mipmap::Level level = Mipmap::get_level(a, 20, 20);
+	ASSERT(level);
+	ASSERT(level->get_w() == 32 && level->get_h() == 24);
+	ASSERT(is_filled(*level, color));
+	ASSERT(Mipmap::get_level(a, 30, 13) == level);
+
+	level = Mipmap::get_level(a, 16, 12);
+	ASSERT(level);
+	ASSERT(level->get_w() == 16 && level->get_h() == 12);
+
+	// odd sizes are rounded up
+	level = Mipmap::get_level(a, 1, 1);
+	ASSERT(level);
+	ASSERT(level->get_w() == 1 && level->get_h() == 1);
+	ASSERT(is_filled(*level, color));
+
+	Mipmap::Statistics s = Mipmap::get_statistics();
+	ASSERT(s.hits == stats.hits + 1);
+	ASSERT(s.misses == stats.misses + 3);
+	ASSERT(s.sources == 1);
+	ASSERT(s.size == (32*24 + 16*12 + 1*1)*sizeof(Color));
+
+	// changed source loses its levels
+	a->assign(*make_packed_surface(8, 8, color));
+	ASSERT(Mipmap::get_statistics().sources == 0);
+	ASSERT(Mipmap::get_statistics().size == 0);
+
+	// sources which are not used anymore are dropped
+	a = make_packed_surface(64, 48, color);
+	ASSERT(Mipmap::get_level(a, 16, 16));
+	a.reset();
+	SurfaceSWPacked::Handle b = make_packed_surface(64, 48, color);
+	ASSERT(Mipmap::get_level(b, 16, 16));
+	ASSERT(Mipmap::get_statistics().sources == 1);
+
+	// least recently used sources are dropped when cache is full
+	SurfaceSWPacked::Handle c = make_packed_surface(64, 48, color);
+	Mipmap::set_max_size(32*24*sizeof(Color));
+	ASSERT(Mipmap::get_level(c, 16, 16));
+	ASSERT(Mipmap::get_statistics().sources == 1);
+	ASSERT(Mipmap::get_level(c, 16, 16));
+	ASSERT(Mipmap::get_statistics().hits == s.hits + 1);
+
+	Mipmap::clear();
+	ASSERT(Mipmap::get_statistics().size == 0);
+
+	return false;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	int failures = 0;
+	bool fail;
+
+	TEST_FUNCTION(test_hash)
+	TEST_FUNCTION(test_surface_id)
+	TEST_FUNCTION(test_cache)
+	TEST_FUNCTION(test_mipmap)
+
+	// software tasks are bound to abstract ones when tokens are built
+	Token::rebuild();
+	Renderer::initialize();
+	TEST_FUNCTION(test_render)
+	Renderer::deinitialize();
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
+
+	return failures ? 1 : 0;
+}
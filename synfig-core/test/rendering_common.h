@@ -0,0 +1,96 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_common.h
+**	\brief Helpers to generate and compare pixels in rendering tests
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_TEST_RENDERING_COMMON_H
+#define __SYNFIG_TEST_RENDERING_COMMON_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <synfig/color.h>
+
+/* === P R O C E D U R E S ================================================= */
+
+//! Linear congruential generator, gives the same numbers on every platform
+inline synfig::ColorReal random_real(unsigned int &seed, synfig::ColorReal min, synfig::ColorReal max)
+{
+	seed = seed*1103515245u + 12345u;
+	return min + (max - min)*synfig::ColorReal((seed >> 8) & 0xffff)/synfig::ColorReal(0xffff);
+}
+
+//! Fills row by colors out of [0, 1] range, alpha is clamped
+inline void fill_random(std::vector<synfig::Color> &row, unsigned int seed)
+{
+	for(std::vector<synfig::Color>::iterator i = row.begin(); i != row.end(); ++i) {
+		i->set_r(random_real(seed, -0.2, 1.5));
+		i->set_g(random_real(seed, -0.2, 1.5));
+		i->set_b(random_real(seed, -0.2, 1.5));
+		// keep some pixels fully transparent and fully opaque
+		synfig::ColorReal a = random_real(seed, -0.3, 1.3);
+		i->set_a(a < 0 ? 0 : a > 1 ? 1 : a);
+	}
+}
+
+//! Relative comparison, NaN and infinity are equal only to themselves
+inline bool is_equal(synfig::ColorReal a, synfig::ColorReal b)
+{
+	if (std::isnan(a) || std::isnan(b))
+		return std::isnan(a) && std::isnan(b);
+	if (std::isinf(a) || std::isinf(b))
+		return a == b;
+	return std::fabs(a - b) <= 1e-4*std::max(synfig::ColorReal(1), std::fabs(a));
+}
+
+inline bool is_equal(const synfig::Color &a, const synfig::Color &b)
+{
+	return is_equal(a.get_r(), b.get_r())
+		&& is_equal(a.get_g(), b.get_g())
+		&& is_equal(a.get_b(), b.get_b())
+		&& is_equal(a.get_a(), b.get_a());
+}
+
+//! Largest difference of channels divided by scale
+inline synfig::ColorReal max_difference(const synfig::Color &a, const synfig::Color &b, synfig::ColorReal scale = 1)
+{
+	synfig::Color d = a - b;
+	return std::max( std::max(std::fabs(d.get_r()), std::fabs(d.get_g())),
+	                 std::max(std::fabs(d.get_b()), std::fabs(d.get_a())) )/scale;
+}
+
+//! Largest difference of premultiplied channels, color of transparent pixel doesn't matter
+inline synfig::ColorReal max_premulted_difference(const synfig::Color &a, const synfig::Color &b)
+{
+	return std::max(
+		std::max( std::fabs(a.get_r()*a.get_a() - b.get_r()*b.get_a()),
+		          std::fabs(a.get_g()*a.get_a() - b.get_g()*b.get_a()) ),
+		std::max( std::fabs(a.get_b()*a.get_a() - b.get_b()*b.get_a()),
+		          std::fabs(a.get_a() - b.get_a()) ));
+}
+
+/* === E N D =============================================================== */
+
+#endif
@@ -0,0 +1,234 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_gradient.cpp
+**	\brief Test gradient lookup table and vectorized gradient fill
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <ETL/stringf>
+
+#include <synfig/general.h>
+#include <synfig/gradient.h>
+
+#include <synfig/rendering/software/function/blend.h>
+#include <synfig/rendering/software/function/gradientfill.h>
+
+#include "rendering_common.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === M A C R O S ========================================================= */
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return true; \
+	} \
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+static std::vector<Gradient> create_gradients()
+{
+	std::vector<Gradient> gradients;
+	gradients.push_back(Gradient(Color::black(), Color::white()));
+
+	// duplicated position and transparent stops
+	Gradient g;
+	g.push_back(GradientCPoint(0.0, Color(1, 0, 0, 1)));
+	g.push_back(GradientCPoint(0.3, Color(0, 1, 0, 0.5)));
+	g.push_back(GradientCPoint(0.3, Color(0, 0, 1, 1)));
+	g.push_back(GradientCPoint(0.8, Color(1, 1, 0, 0)));
+	g.push_back(GradientCPoint(1.0, Color(1, 1, 1, 1)));
+	gradients.push_back(g);
+
+	// enough stops to use lookup table instead of comparison with each stop
+	g = Gradient();
+	for(int i = 0; i <= 20; ++i)
+		g.push_back(GradientCPoint(0.05*i*i/20.0, Color(0.05*i, 1 - 0.05*i, (i%3)*0.5, i%4 ? 1 : 0.25)));
+	gradients.push_back(g);
+
+	return gradients;
+}
+
+bool test_find()
+{
+	std::vector<Gradient> gradients = create_gradients();
+	const Real special[] = { 0.0, -0.0, 0.3, 0.8, 1.0, 1e-9, 1 - 1e-9, INFINITY, -INFINITY };
+
+	for(int i = 0; i < (int)gradients.size(); ++i)
+	for(int zigzag = 0; zigzag < 2; ++zigzag) {
+		CompiledGradient gradient(gradients[i], false, zigzag);
+		const CompiledGradient::List &list = gradient.get_list();
+
+		std::vector<Real> positions(special, special + sizeof(special)/sizeof(special[0]));
+		for(int j = -2000; j <= 3000; ++j)
+			positions.push_back(j/1000.0);
+		for(int j = 0; j < (int)list.size(); ++j)
+			{ positions.push_back(list[j].prev_pos); positions.push_back(list[j].next_pos); }
+
+		for(std::vector<Real>::const_iterator x = positions.begin(); x != positions.end(); ++x)
+			ASSERT(gradient.find(*x) == std::lower_bound(list.begin(), list.end() - 1, *x));
+	}
+
+	return false;
+}
+
+bool test_fill()
+{
+	const int width = 67, height = 23;
+	std::vector<Gradient> gradients = create_gradients();
+	synfig::Surface expected(width, height), actual(width, height);
+
+	for(int shape = GradientFill::SHAPE_LINEAR; shape <= GradientFill::SHAPE_SPIRAL; ++shape)
+	for(int i = 0; i < (int)gradients.size(); ++i)
+	for(int repeat = 0; repeat < 2; ++repeat)
+	for(int scale = 0; scale < 3; ++scale) {
+		CompiledGradient gradient(gradients[i], repeat, false);
+
+		GradientFill::Params params;
+		params.shape = (GradientFill::Shape)shape;
+		params.angle = 0.1;
+		params.clockwise = repeat;
+		const Real s = scale == 0 ? 0.05 : scale == 1 ? 0.005 : 0.2;
+		params.matrix = Matrix().set_translate(-1.3, 0.7)
+		              * Matrix().set_scale(s, -1.1*s)
+		              * Matrix().set_rotate(Angle::deg(20*scale));
+
+		for(int blend = 0; blend < 2; ++blend) {
+			Color::BlendMethod method = blend ? Color::BLEND_COMPOSITE : Color::BLEND_STRAIGHT;
+			ColorReal amount = blend ? 0.5 : 1.0;
+
+			Blend::set_instructions(Blend::INSTRUCTIONS_SCALAR);
+			expected.fill(Color(0.25, 0.5, 0.75, 0.5));
+			GradientFill::fill(expected, RectInt(2, 1, width - 3, height), gradient, params, method, amount);
+
+			// scalar path gives exactly the colors of the gradient layers
+			if (!blend) {
+				if (shape == GradientFill::SHAPE_LINEAR) {
+					Real t = params.matrix.get_transformed(Vector(2, 1))[0];
+					Real size = 0.5*params.matrix.axis_x().mag();
+					ASSERT(max_premulted_difference(expected[1][2], gradient.average(t - size, t + size)) < 1e-6);
+				}
+				ASSERT(expected[0][0] == Color(0.25, 0.5, 0.75, 0.5));
+				ASSERT(expected[height - 1][width - 1] == Color(0.25, 0.5, 0.75, 0.5));
+			}
+
+			for(int instructions = Blend::INSTRUCTIONS_VECTOR4; instructions <= Blend::get_supported_instructions(); ++instructions) {
+				Blend::set_instructions((Blend::Instructions)instructions);
+				actual.fill(Color(0.25, 0.5, 0.75, 0.5));
+				GradientFill::fill(actual, RectInt(2, 1, width - 3, height), gradient, params, method, amount);
+
+				for(int y = 0; y < height; ++y)
+					for(int x = 0; x < width; ++x)
+						if (max_premulted_difference(expected[y][x], actual[y][x]) > 1e-3) {
+							error( "shape %d, gradient %d, repeat %d, scale %d, blend %d, instructions %d, pixel (%d, %d): expected (%f, %f, %f, %f), got (%f, %f, %f, %f)",
+								shape, i, repeat, scale, blend, instructions, x, y,
+								expected[y][x].get_r(), expected[y][x].get_g(), expected[y][x].get_b(), expected[y][x].get_a(),
+								actual[y][x].get_r(), actual[y][x].get_g(), actual[y][x].get_b(), actual[y][x].get_a() );
+							Blend::set_instructions(Blend::get_supported_instructions());
+							return true;
+						}
+			}
+		}
+	}
+
+	Blend::set_instructions(Blend::get_supported_instructions());
+	return false;
+}
+
+//! prints time of gradient fill for every shape and instructions set,
+//! run as: rendering_gradient benchmark
+void benchmark()
+{
+	const int width = 1920, height = 1080, repeats = 5;
+	CompiledGradient gradient(create_gradients()[1], true);
+	synfig::Surface surface(width, height);
+
+	const char *names[] = { "linear", "radial", "conical", "spiral" };
+	for(int shape = GradientFill::SHAPE_LINEAR; shape <= GradientFill::SHAPE_SPIRAL; ++shape) {
+		GradientFill::Params params;
+		params.shape = (GradientFill::Shape)shape;
+		params.matrix = Matrix().set_translate(-4.0, 2.25)
+		              * Matrix().set_scale(8.0/width, -4.5/height);
+
+		String line = strprintf("%8s:", names[shape]);
+		for(int instructions = Blend::INSTRUCTIONS_SCALAR; instructions <= Blend::get_supported_instructions(); ++instructions) {
+			Blend::set_instructions((Blend::Instructions)instructions);
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			for(int i = 0; i < repeats; ++i)
+				GradientFill::fill(surface, RectInt(0, 0, width, height), gradient, params, Color::BLEND_STRAIGHT, 1.0);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count()/repeats;
+			line += strprintf("  x%d %8.3fms", instructions == Blend::INSTRUCTIONS_SCALAR ? 1 : instructions == Blend::INSTRUCTIONS_VECTOR4 ? 4 : 8, ms);
+		}
+		info("%s", line.c_str());
+	}
+
+	Blend::set_instructions(Blend::get_supported_instructions());
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && !strcmp(argv[1], "benchmark"))
+		{ benchmark(); return 0; }
+
+	int failures = 0;
+	bool fail;
+
+	TEST_FUNCTION(test_find)
+	TEST_FUNCTION(test_fill)
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,399 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_noise.cpp
+**	\brief Test batched noise generation and software noise task
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <ETL/stringf>
+
+#include <synfig/canvasbase.h>
+#include <synfig/context.h>
+#include <synfig/general.h>
+#include <synfig/gradient.h>
+#include <synfig/renddesc.h>
+#include <synfig/surface.h>
+#include <synfig/token.h>
+#include <synfig/type.h>
+
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/software/task/tasksw.h>
+#include <synfig/rendering/software/function/blend.h>
+
+#include <modules/mod_noise/distort.h>
+#include <modules/mod_noise/noise.h>
+#include <modules/mod_noise/random_noise.h>
+
+#include "rendering_common.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === M A C R O S ========================================================= */
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return true; \
+	} \
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+bool test_generate()
+{
+	// odd count to get the scalar tail after the vectorized part
+	const int count = 67;
+	const float times[] = { 0.f, 0.3f, 1.75f, -2.5f, 7.2f };
+	const int loops[] = { 0, 3 };
+	const int subseeds[] = { 0, 13 };
+
+	std::vector<float> x(count), y(count), dest(count);
+	for(int i = 0; i < count; ++i) {
+		x[i] = -9.7f + 0.37f*i;
+		y[i] = 4.1f - 0.23f*i*(i%3);
+	}
+	// integer coordinates are the nodes of interpolation
+	x[5] = 2.f; y[5] = -3.f;
+
+	for(int seed = 0; seed < 3; ++seed)
+	for(int smooth = RandomNoise::SMOOTH_DEFAULT; smooth <= RandomNoise::SMOOTH_FAST_SPLINE; ++smooth)
+	for(int t = 0; t < (int)(sizeof(times)/sizeof(times[0])); ++t)
+	for(int l = 0; l < (int)(sizeof(loops)/sizeof(loops[0])); ++l)
+	for(int s = 0; s < (int)(sizeof(subseeds)/sizeof(subseeds[0])); ++s) {
+		RandomNoise random;
+		random.set_seed(seed*7919 - 5);
+
+		for(int instructions = Blend::INSTRUCTIONS_SCALAR; instructions <= Blend::get_supported_instructions(); ++instructions) {
+			Blend::set_instructions((Blend::Instructions)instructions);
+			std::fill(dest.begin(), dest.end(), NAN);
+			random.generate(RandomNoise::SmoothType(smooth), subseeds[s], &x.front(), &y.front(), &dest.front(), count, times[t], loops[l]);
+
+			for(int i = 0; i < count; ++i) {
+				float expected = random(RandomNoise::SmoothType(smooth), subseeds[s], x[i], y[i], times[t], loops[l]);
+				if (dest[i] != expected) {
+					error( "seed %d, smooth %d, time %f, loop %d, subseed %d, instructions %d, point %d (%f, %f): expected %f, got %f",
+						seed, smooth, times[t], loops[l], subseeds[s], instructions, i, x[i], y[i], expected, dest[i] );
+					Blend::set_instructions(Blend::get_supported_instructions());
+					return true;
+				}
+			}
+		}
+	}
+
+	Blend::set_instructions(Blend::get_supported_instructions());
+	return false;
+}
+
+static etl::handle<Noise> create_noise_layer(int smooth, bool turbulent, bool do_alpha, bool super_sample, Real speed)
+{
+	Gradient gradient;
+	gradient.push_back(GradientCPoint(0.0, Color(1, 0, 0, 1)));
+	gradient.push_back(GradientCPoint(0.4, Color(0, 1, 0, 0.5)));
+	gradient.push_back(GradientCPoint(1.0, Color(0, 0, 1, 1)));
+
+	etl::handle<Noise> layer(new Noise());
+	layer->set_param("gradient", ValueBase(gradient));
+	layer->set_param("size", ValueBase(Vector(0.3, 0.2)));
+	layer->set_param("seed", ValueBase(int(1234)));
+	layer->set_param("smooth", ValueBase(smooth));
+	layer->set_param("detail", ValueBase(int(4)));
+	layer->set_param("speed", ValueBase(speed));
+	layer->set_param("turbulent", ValueBase(turbulent));
+	layer->set_param("do_alpha", ValueBase(do_alpha));
+	layer->set_param("super_sample", ValueBase(super_sample));
+	layer->set_param("amount", ValueBase(Real(1.0)));
+	layer->set_blend_method(Color::BLEND_STRAIGHT);
+	layer->set_time_mark(Time(1.3));
+	return layer;
+}
+
+static bool render_task(Task::Handle task, const RendDesc &desc, synfig::Surface &out)
+{
+	SurfaceResource::Handle target(new SurfaceResource());
+	target->create(desc.get_w(), desc.get_h());
+
+	// flip the axes like Target_Scanline::build_task() does
+	Vector p0 = desc.get_tl();
+	Vector p1 = desc.get_br();
+	if (p0[0] > p1[0] || p0[1] > p1[1]) {
+		Matrix m;
+		if (p0[0] > p1[0]) { m.m00 = -1.0; m.m20 = p0[0] + p1[0]; std::swap(p0[0], p1[0]); }
+		if (p0[1] > p1[1]) { m.m11 = -1.0; m.m21 = p0[1] + p1[1]; std::swap(p0[1], p1[1]); }
+		TaskTransformationAffine::Handle t(new TaskTransformationAffine());
+		t->transformation->matrix = m;
+		t->sub_task() = task;
+		task = t;
+	}
+
+	task->target_surface = target;
+	task->target_rect = RectInt(0, 0, desc.get_w(), desc.get_h());
+	task->source_rect = Rect(p0, p1);
+
+	Task::List list;
+	list.push_back(task);
+	if (!Renderer::get_renderer("software")->run(list))
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(target);
+	if (!lock) return false;
+	out = lock->get_surface();
+	return true;
+}
+
+bool test_task()
+{
+	const int width = 67, height = 23;
+
+	RendDesc desc;
+	desc.set_wh(width, height);
+	desc.set_tl(Point(-1.31, 0.73));
+	desc.set_br(Point(1.13, -0.41));
+
+	for(int smooth = RandomNoise::SMOOTH_DEFAULT; smooth <= RandomNoise::SMOOTH_CUBIC; ++smooth)
+	for(int flags = 0; flags < 8; ++flags)
+	for(int speed = 0; speed < 2; ++speed)
+	for(int quality = 4; quality <= 8; quality += 4) {
+		const bool turbulent = flags & 1, do_alpha = flags & 2, super_sample = flags & 4;
+		etl::handle<Noise> layer = create_noise_layer(smooth, turbulent, do_alpha, super_sample, speed*0.7);
+
+		// straight blend with amount 1 doesn't read the context
+		synfig::Surface expected, actual;
+		ASSERT(layer->accelerated_render(Context(), &expected, quality, desc, NULL));
+
+		// tasks have no quality, they always use supersampling when it's enabled
+		if (quality >= 8 && super_sample)
+			continue;
+
+		ASSERT(render_task(layer->build_composite_task_vfunc(ContextParams()), desc, actual));
+		ASSERT(expected.get_w() == actual.get_w() && expected.get_h() == actual.get_h());
+
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				if (max_premulted_difference(expected[y][x], actual[y][x]) > 1e-5) {
+					error( "smooth %d, turbulent %d, do_alpha %d, super_sample %d, speed %d, quality %d, pixel (%d, %d): expected (%f, %f, %f, %f), got (%f, %f, %f, %f)",
+						smooth, turbulent, do_alpha, super_sample, speed, quality, x, y,
+						expected[y][x].get_r(), expected[y][x].get_g(), expected[y][x].get_b(), expected[y][x].get_a(),
+						actual[y][x].get_r(), actual[y][x].get_g(), actual[y][x].get_b(), actual[y][x].get_a() );
+					return true;
+				}
+	}
+
+	return false;
+}
+
+//! Color changes linearly, so linear sampling of the rendered context gives exact values
+static Color linear_color(const Point &p)
+	{ return Color(0.5 + 0.3*p[0], 0.4 - 0.2*p[1], 0.5 + 0.1*p[0] + 0.2*p[1], 1.0); }
+
+//! Context of the distortion for the renderer
+class TaskLinear: public Task
+{
+public:
+	typedef etl::handle<TaskLinear> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+};
+
+class TaskLinearSW: public TaskLinear, public TaskSW
+{
+public:
+	typedef etl::handle<TaskLinearSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid())
+			return true;
+
+		LockWrite la(this);
+		if (!la)
+			return false;
+
+		synfig::Surface &dest = la->get_surface();
+		const Vector upp = get_units_per_pixel();
+		for(int y = target_rect.miny; y < target_rect.maxy; ++y)
+			for(int x = target_rect.minx; x < target_rect.maxx; ++x)
+				dest[y][x] = linear_color(Vector(
+					source_rect.minx + (x - target_rect.minx + 0.5)*upp[0],
+					source_rect.miny + (y - target_rect.miny + 0.5)*upp[1] ));
+		return true;
+	}
+};
+
+Task::Token TaskLinear::token(
+	DescAbstract<TaskLinear>("TestLinear") );
+Task::Token TaskLinearSW::token(
+	DescReal<TaskLinearSW, TaskLinear>("TestLinearSW") );
+
+//! Context of the distortion for the legacy get_color()
+class LayerLinear: public Layer
+{
+public:
+	virtual Color get_color(Context /* context */, const Point &pos) const
+		{ return linear_color(pos); }
+protected:
+	virtual Task::Handle build_rendering_task_vfunc(Context /* context */) const
+		{ return new TaskLinear(); }
+};
+
+bool test_distort()
+{
+	const int width = 67, height = 23;
+
+	// axes are not flipped, affine transformation of the task would resample the result
+	RendDesc desc;
+	desc.set_wh(width, height);
+	desc.set_tl(Point(-1.31, -0.41));
+	desc.set_br(Point(1.13, 0.73));
+	const Vector upp(
+		(desc.get_br()[0] - desc.get_tl()[0])/width,
+		(desc.get_br()[1] - desc.get_tl()[1])/height );
+
+	CanvasBase layers;
+	etl::handle<NoiseDistort> layer(new NoiseDistort());
+	layers.push_back(layer);
+	layers.push_back(new LayerLinear());
+	layers.push_back(Layer::Handle());
+	Context context(layers.begin(), ContextParams());
+
+	for(int smooth = RandomNoise::SMOOTH_DEFAULT; smooth <= RandomNoise::SMOOTH_CUBIC; ++smooth)
+	for(int turbulent = 0; turbulent < 2; ++turbulent)
+	for(int speed = 0; speed < 2; ++speed) {
+		layer->set_param("displacement", ValueBase(Vector(0.25, -0.15)));
+		layer->set_param("size", ValueBase(Vector(0.3, 0.2)));
+		layer->set_param("seed", ValueBase(int(1234)));
+		layer->set_param("smooth", ValueBase(smooth));
+		layer->set_param("detail", ValueBase(int(4)));
+		layer->set_param("speed", ValueBase(Real(speed*0.7)));
+		layer->set_param("turbulent", ValueBase(bool(turbulent)));
+		layer->set_time_mark(Time(1.3));
+
+		synfig::Surface actual;
+		ASSERT(render_task(context.build_rendering_task(), desc, actual));
+		ASSERT(actual.get_w() == width && actual.get_h() == height);
+
+		// tasks sample the context at the centers of pixels
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x) {
+				Point p( desc.get_tl()[0] + (x + 0.5)*upp[0],
+				         desc.get_tl()[1] + (y + 0.5)*upp[1] );
+				Color expected = layer->get_color(context.get_next(), p);
+				if (max_premulted_difference(expected, actual[y][x]) > 1e-4) {
+					error( "smooth %d, turbulent %d, speed %d, pixel (%d, %d): expected (%f, %f, %f, %f), got (%f, %f, %f, %f)",
+						smooth, turbulent, speed, x, y,
+						expected.get_r(), expected.get_g(), expected.get_b(), expected.get_a(),
+						actual[y][x].get_r(), actual[y][x].get_g(), actual[y][x].get_b(), actual[y][x].get_a() );
+					return true;
+				}
+			}
+	}
+
+	return false;
+}
+
+//! prints time of noise generation for every smooth type and instructions set,
+//! run as: rendering_noise benchmark
+void benchmark()
+{
+	const int width = 1920, height = 1080;
+	RandomNoise random;
+	random.set_seed(1234);
+
+	std::vector<float> x(width), y(width), dest(width);
+	for(int i = 0; i < width; ++i)
+		x[i] = i*0.05f;
+
+	const char *names[] = { "nearest", "linear", "cosine", "spline", "cubic", "fspline" };
+	for(int smooth = RandomNoise::SMOOTH_DEFAULT; smooth <= RandomNoise::SMOOTH_FAST_SPLINE; ++smooth) {
+		String line = strprintf("%8s:", names[smooth]);
+		for(int instructions = Blend::INSTRUCTIONS_SCALAR; instructions <= Blend::get_supported_instructions(); ++instructions) {
+			Blend::set_instructions((Blend::Instructions)instructions);
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			for(int row = 0; row < height; ++row) {
+				std::fill(y.begin(), y.end(), row*0.05f);
+				random.generate(RandomNoise::SmoothType(smooth), 5, &x.front(), &y.front(), &dest.front(), width, 0.5f);
+			}
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+			line += strprintf("  x%d %8.3fms", instructions == Blend::INSTRUCTIONS_SCALAR ? 1 : instructions == Blend::INSTRUCTIONS_VECTOR4 ? 4 : 8, ms);
+		}
+		info("%s", line.c_str());
+	}
+
+	Blend::set_instructions(Blend::get_supported_instructions());
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && !strcmp(argv[1], "benchmark"))
+		{ benchmark(); return 0; }
+
+	int failures = 0;
+	bool fail;
+
+	TEST_FUNCTION(test_generate)
+
+	// tasks of the noise module are linked into the test, bind them to the renderer
+	Type::subsys_init();
+	Token::rebuild();
+	Renderer::initialize();
+	TEST_FUNCTION(test_task)
+	TEST_FUNCTION(test_distort)
+	Renderer::deinitialize();
+	Type::subsys_stop();
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
+
+	return failures ? 1 : 0;
+}
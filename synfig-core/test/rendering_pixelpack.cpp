@@ -0,0 +1,207 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_pixelpack.cpp
+**	\brief Test conversion of pixels to compact formats of intermediate surfaces
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <synfig/general.h>
+
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/software/surfaceswhalf.h>
+#include <synfig/rendering/software/surfaceswpremulted8.h>
+#include <synfig/rendering/software/function/pixelpack.h>
+
+#include "rendering_common.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === M A C R O S ========================================================= */
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return true; \
+	} \
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+// odd count to check tails of packs
+#define ROW_SIZE 37
+
+/* === P R O C E D U R E S ================================================= */
+
+static bool compare_rows(
+	const std::vector<Color> &expected,
+	const std::vector<Color> &actual,
+	const char *function )
+{
+	for(int i = 0; i < (int)expected.size(); ++i) {
+		if (!is_equal(expected[i], actual[i])) {
+			error( "%s: instructions %d, pixel %d: expected (%f, %f, %f, %f), got (%f, %f, %f, %f)",
+				function, (int)PixelPack::get_instructions(), i,
+				expected[i].get_r(), expected[i].get_g(), expected[i].get_b(), expected[i].get_a(),
+				actual[i].get_r(), actual[i].get_g(), actual[i].get_b(), actual[i].get_a() );
+			return false;
+		}
+	}
+	return true;
+}
+
+bool test_pack_half()
+{
+	std::vector<Color> src(ROW_SIZE), expected(ROW_SIZE), actual(ROW_SIZE);
+	std::vector<uint16_t> expected_packed(4*ROW_SIZE), packed(4*ROW_SIZE);
+	fill_random(src, 7);
+	src[0] = Color(65504.0, -65504.0, 1e-7, 0.0); // max, min and subnormal
+	src[1] = Color(1e6, -1e6, -0.0, 1.0);         // overflow
+
+	PixelPack::set_instructions(PixelPack::INSTRUCTIONS_SCALAR);
+	PixelPack::pack_half(&expected_packed.front(), &src.front(), ROW_SIZE);
+	PixelPack::unpack_half(&expected.front(), &expected_packed.front(), ROW_SIZE);
+
+	ASSERT(expected[0] == Color(65504.0, -65504.0, expected[0].get_b(), 0.0));
+	ASSERT(expected[0].get_b() > 0 && expected[0].get_b() < 2e-7);
+	ASSERT(std::isinf(expected[1].get_r()) && std::isinf(expected[1].get_g()));
+	for(int i = 2; i < ROW_SIZE; ++i)
+		ASSERT(max_difference(expected[i], src[i], 2) <= 1e-3);
+
+	for(int instructions = PixelPack::INSTRUCTIONS_VECTOR; instructions <= PixelPack::get_supported_instructions(); ++instructions) {
+		PixelPack::set_instructions((PixelPack::Instructions)instructions);
+		PixelPack::pack_half(&packed.front(), &src.front(), ROW_SIZE);
+		ASSERT(packed == expected_packed);
+		PixelPack::unpack_half(&actual.front(), &packed.front(), ROW_SIZE);
+		ASSERT(compare_rows(expected, actual, "unpack_half"));
+	}
+
+	PixelPack::set_instructions(PixelPack::get_supported_instructions());
+	return false;
+}
+
+bool test_pack_premulted8()
+{
+	std::vector<Color> src(ROW_SIZE), expected(ROW_SIZE), actual(ROW_SIZE);
+	std::vector<uint8_t> expected_packed(4*ROW_SIZE), packed(4*ROW_SIZE);
+	fill_random(src, 8);
+	src[0] = Color(0.5, 0.25, 1.0, 0.0);
+
+	PixelPack::set_instructions(PixelPack::INSTRUCTIONS_SCALAR);
+	PixelPack::pack_premulted8(&expected_packed.front(), &src.front(), ROW_SIZE);
+	PixelPack::unpack_premulted8(&expected.front(), &expected_packed.front(), ROW_SIZE);
+	ASSERT(expected[0] == Color(0, 0, 0, 0));
+
+	// premultiplied components are exact up to 1/510
+	for(int i = 1; i < ROW_SIZE; ++i) {
+		ColorReal a = std::max(ColorReal(0), std::min(ColorReal(1), src[i].get_a()));
+		ColorReal r = std::max(ColorReal(0), std::min(ColorReal(1), src[i].get_r()*a));
+		ASSERT(std::fabs(expected[i].get_a() - a) <= 1.0/510 + 1e-6);
+		ASSERT(std::fabs(expected[i].get_r()*expected[i].get_a() - r) <= 1.0/510 + 1e-6);
+	}
+
+	for(int instructions = PixelPack::INSTRUCTIONS_VECTOR; instructions <= PixelPack::get_supported_instructions(); ++instructions) {
+		PixelPack::set_instructions((PixelPack::Instructions)instructions);
+		PixelPack::pack_premulted8(&packed.front(), &src.front(), ROW_SIZE);
+		ASSERT(packed == expected_packed);
+		PixelPack::unpack_premulted8(&actual.front(), &packed.front(), ROW_SIZE);
+		ASSERT(compare_rows(expected, actual, "unpack_premulted8"));
+	}
+
+	PixelPack::set_instructions(PixelPack::get_supported_instructions());
+	return false;
+}
+
+bool test_surface_formats()
+{
+	synfig::Surface src(17, 5);
+	for(int y = 0; y < src.get_h(); ++y)
+		for(int x = 0; x < src.get_w(); ++x)
+			src[y][x] = Color(0.05*x, 0.2*y, 0.5, 0.75);
+
+	rendering::Surface::Token::Handle formats[] = { SurfaceSWHalf::token.handle(), SurfaceSWPremulted8::token.handle() };
+	for(int i = 0; i < 2; ++i) {
+		SurfaceResource::Handle resource = new SurfaceResource(new SurfaceSW(*new synfig::Surface(src), true));
+		{
+			SurfaceResource::LockWriteBase lock(resource);
+			ASSERT(lock.convert(formats[i]));
+		}
+		{
+			// float surface must be dropped after conversion
+			SurfaceResource::LockReadBase lock(resource);
+			ASSERT(lock.convert(formats[i], false));
+			ASSERT(!lock.convert(SurfaceSW::token.handle(), false));
+		}
+
+		SurfaceResource::LockRead<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		const synfig::Surface &dest = lock->get_surface();
+		ASSERT(dest.get_w() == src.get_w() && dest.get_h() == src.get_h());
+		for(int y = 0; y < src.get_h(); ++y)
+			for(int x = 0; x < src.get_w(); ++x)
+				ASSERT(max_difference(dest[y][x], src[y][x]) < 0.01);
+	}
+
+	return false;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	int failures = 0;
+	bool fail;
+
+	TEST_FUNCTION(test_pack_half)
+	TEST_FUNCTION(test_pack_premulted8)
+	TEST_FUNCTION(test_surface_formats)
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,405 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering_split.cpp
+**	\brief Test that split rendering tasks give the same pixels as whole tasks
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <synfig/angle.h>
+#include <synfig/general.h>
+#include <synfig/matrix.h>
+#include <synfig/surface.h>
+
+#include <synfig/rendering/common/optimizer/optimizersplit.h>
+#include <synfig/rendering/primitive/contour.h>
+#include <synfig/rendering/primitive/polyspan.h>
+#include <synfig/rendering/software/function/blur.h>
+#include <synfig/rendering/software/function/contour.h>
+#include <synfig/rendering/software/function/resample.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return true; \
+	} \
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+/* === P R O C E D U R E S ================================================= */
+
+// bands like OptimizerSplit makes
+static std::vector<RectInt> make_bands(const RectInt &rect, int count)
+{
+	std::vector<RectInt> bands;
+	int h = rect.get_height();
+	for(int j = 0; j < count; ++j)
+		bands.push_back(RectInt(
+			rect.minx, rect.miny + h*j/count,
+			rect.maxx, rect.miny + h*(j + 1)/count ));
+	return bands;
+}
+
+static bool is_same_pixels(const synfig::Surface &a, const synfig::Surface &b)
+{
+	if (a.get_w() != b.get_w() || a.get_h() != b.get_h())
+		return false;
+	for(int y = 0; y < a.get_h(); ++y)
+		if (memcmp(&a[y][0], &b[y][0], a.get_w()*sizeof(Color)))
+			return false;
+	return true;
+}
+
+static bool is_similar_pixels(const synfig::Surface &a, const synfig::Surface &b)
+{
+	if (a.get_w() != b.get_w() || a.get_h() != b.get_h())
+		return false;
+	for(int y = 0; y < a.get_h(); ++y)
+		for(int x = 0; x < a.get_w(); ++x) {
+			const Color &ca = a[y][x], &cb = b[y][x];
+			if ( std::fabs(ca.get_r() - cb.get_r()) > 1e-4
+			  || std::fabs(ca.get_g() - cb.get_g()) > 1e-4
+			  || std::fabs(ca.get_b() - cb.get_b()) > 1e-4
+			  || std::fabs(ca.get_a() - cb.get_a()) > 1e-4 )
+			{
+				error("pixel %d, %d differs", x, y);
+				return false;
+			}
+		}
+	return true;
+}
+
+static rendering::Contour::Handle make_contour()
+{
+	rendering::Contour::Handle contour(new rendering::Contour());
+	contour->move_to(Vector(10.3, 5.7));
+	contour->cubic_to(Vector(190.1, 40.2), Vector(120.0, -30.0), Vector(250.0, 10.0));
+	contour->line_to(Vector(150.7, 150.2));
+	contour->conic_to(Vector(3.3, 120.8), Vector(80.0, 200.0));
+	contour->close();
+	// self-intersecting star to check winding styles
+	contour->move_to(Vector(100.2, 20.1));
+	contour->line_to(Vector(140.6, 130.3));
+	contour->line_to(Vector(40.4, 60.7));
+	contour->line_to(Vector(160.9, 60.2));
+	contour->line_to(Vector(60.1, 130.8));
+	contour->close();
+	return contour;
+}
+
+static void fill_noise(synfig::Surface &surface)
+{
+	unsigned int seed = 12345;
+	for(int y = 0; y < surface.get_h(); ++y)
+		for(int x = 0; x < surface.get_w(); ++x) {
+			Color::value_type c[4];
+			for(int i = 0; i < 4; ++i) {
+				seed = seed*1103515245u + 12345u;
+				c[i] = (Color::value_type)((seed >> 16) & 0xff)/255.f;
+			}
+			surface[y][x] = Color(c[0], c[1], c[2], c[3]);
+		}
+}
+
+bool test_parts_count()
+{
+	OptimizerSplit single(1);
+	ASSERT(single.calc_parts_count(RectInt(0, 0, 1920, 1080)) == 1);
+
+	OptimizerSplit split(8);
+	ASSERT(split.calc_parts_count(RectInt(0, 0, 16, 16)) == 1);
+	ASSERT(split.calc_parts_count(RectInt(0, 0, 1920, 1080)) >= 8);
+	ASSERT(split.calc_parts_count(RectInt(0, 0, 1920, 1080)) <= 1080/16);
+	ASSERT(split.calc_parts_count(RectInt(0, 0, 4096, 20)) == 1);
+	return false;
+}
+
+bool test_contour()
+{
+	const RectInt whole(0, 0, 203, 157);
+
+	rendering::Contour::Handle contour(new rendering::Contour());
+	contour->move_to(Vector(10.3, 5.7));
+	contour->cubic_to(Vector(190.1, 40.2), Vector(120.0, -30.0), Vector(250.0, 10.0));
+	contour->line_to(Vector(150.7, 150.2));
+	contour->conic_to(Vector(3.3, 120.8), Vector(80.0, 200.0));
+	contour->close();
+
+	for(int antialias = 0; antialias < 2; ++antialias)
+	{
+		synfig::Surface a(whole.get_width(), whole.get_height());
+		synfig::Surface b(whole.get_width(), whole.get_height());
+		a.clear();
+		b.clear();
+
+		Polyspan polyspan;
+		polyspan.init(whole);
+		software::Contour::build_polyspan(contour->get_chunks(), Matrix(), polyspan);
+		polyspan.close();
+		polyspan.sort_marks();
+		software::Contour::render_polyspan(
+			a, polyspan, false, antialias, rendering::Contour::WINDING_NON_ZERO,
+			Color(0.2, 0.4, 0.8, 0.7), 0.9, Color::BLEND_COMPOSITE );
+
+		std::vector<RectInt> bands = make_bands(whole, 7);
+		for(std::vector<RectInt>::const_iterator i = bands.begin(); i != bands.end(); ++i)
+		{
+			Polyspan part;
+			part.init(whole);
+			software::Contour::build_polyspan(contour->get_chunks(), Matrix(), part);
+			part.close();
+			part.sort_marks();
+			part.crop_rows(i->miny, i->maxy);
+			software::Contour::render_polyspan(
+				b, part, false, antialias, rendering::Contour::WINDING_NON_ZERO,
+				Color(0.2, 0.4, 0.8, 0.7), 0.9, Color::BLEND_COMPOSITE );
+		}
+
+		ASSERT(is_same_pixels(a, b));
+	}
+	return false;
+}
+
+bool test_contour_bucketed()
+{
+	const RectInt whole(0, 0, 203, 157);
+	const rendering::Contour::Handle contour = make_contour();
+
+	for(int invert = 0; invert < 2; ++invert)
+	for(int antialias = 0; antialias < 2; ++antialias)
+	for(int winding = 0; winding < 2; ++winding)
+	{
+		const rendering::Contour::WindingStyle winding_style = winding
+			? rendering::Contour::WINDING_EVEN_ODD : rendering::Contour::WINDING_NON_ZERO;
+
+		synfig::Surface a(whole.get_width(), whole.get_height());
+		synfig::Surface b(whole.get_width(), whole.get_height());
+		synfig::Surface c(whole.get_width(), whole.get_height());
+		fill_noise(a);
+		fill_noise(b);
+		fill_noise(c);
+
+		// sorted rasterizer
+		Polyspan polyspan;
+		polyspan.init(whole);
+		software::Contour::build_polyspan(contour->get_chunks(), Matrix(), polyspan);
+		polyspan.close();
+		polyspan.sort_marks();
+		software::Contour::render_polyspan(
+			a, polyspan, invert, antialias, winding_style,
+			Color(0.2, 0.4, 0.8, 0.7), 0.9, Color::BLEND_COMPOSITE );
+
+		// bucketed rasterizer
+		Polyspan bucketed;
+		bucketed.init(whole);
+		software::Contour::build_polyspan(contour->get_chunks(), Matrix(), bucketed);
+		bucketed.close();
+		bucketed.flush_marks();
+		software::Contour::render_polyspan_bucketed(
+			b, bucketed, whole.miny, whole.maxy, invert, antialias, winding_style,
+			Color(0.2, 0.4, 0.8, 0.7), 0.9, Color::BLEND_COMPOSITE );
+
+		ASSERT(is_similar_pixels(a, b));
+
+		// bucketed rasterizer by bands, inverted contours are supported too
+		std::vector<RectInt> bands = make_bands(whole, 7);
+		for(std::vector<RectInt>::const_iterator i = bands.begin(); i != bands.end(); ++i)
+			software::Contour::render_polyspan_bucketed(
+				c, bucketed, i->miny, i->maxy, invert, antialias, winding_style,
+				Color(0.2, 0.4, 0.8, 0.7), 0.9, Color::BLEND_COMPOSITE );
+
+		ASSERT(is_same_pixels(b, c));
+	}
+	return false;
+}
+
+bool test_external_rows()
+{
+	// strip rendered directly into the rows of target buffer, see Target_Scanline
+	const RectInt whole(0, 0, 203, 157);
+	const int pitch_w = 256;
+	const rendering::Contour::Handle contour = make_contour();
+
+	std::vector<Color> buffer(pitch_w*whole.get_height(), Color(1, 1, 1, 1));
+	synfig::Surface *rows = new synfig::Surface(
+		&buffer.front(), whole.get_width(), whole.get_height(), pitch_w*sizeof(Color) );
+	rows->clear();
+	synfig::Surface a(whole.get_width(), whole.get_height());
+
+	Polyspan polyspan;
+	polyspan.init(whole);
+	software::Contour::build_polyspan(contour->get_chunks(), Matrix(), polyspan);
+	polyspan.close();
+	polyspan.sort_marks();
+	software::Contour::render_polyspan(
+		a, polyspan, false, true, rendering::Contour::WINDING_NON_ZERO,
+		Color(0.2, 0.4, 0.8, 0.7), 0.9, Color::BLEND_COMPOSITE );
+	software::Contour::render_polyspan(
+		*rows, polyspan, false, true, rendering::Contour::WINDING_NON_ZERO,
+		Color(0.2, 0.4, 0.8, 0.7), 0.9, Color::BLEND_COMPOSITE );
+
+	// data outside of the rows should stay untouched
+	ASSERT(is_same_pixels(a, *rows));
+	ASSERT(buffer[whole.get_width()] == Color(1, 1, 1, 1));
+	ASSERT(buffer.back() == Color(1, 1, 1, 1));
+
+	// surface owns the wrapper only, not the rows
+	SurfaceResource::Handle resource(new SurfaceResource());
+	resource->assign(new SurfaceSW(*rows, true));
+	{
+		SurfaceResource::LockRead<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		ASSERT(!lock->get_pixels_pointer());
+		synfig::Surface b(whole.get_width(), whole.get_height());
+		ASSERT(lock->get_pixels(&b[0][0]));
+		ASSERT(is_same_pixels(a, b));
+	}
+
+	// assigning to the wrapper writes into the rows instead of detached memory
+	{
+		synfig::Surface *c = new synfig::Surface(whole.get_width(), whole.get_height());
+		c->fill(Color(0.5, 0.25, 0.125, 1));
+		SurfaceSW other(*c, true);
+		SurfaceSW wrapper(*rows, false);
+		ASSERT(wrapper.assign(other));
+		ASSERT(&wrapper.get_surface()[0][0] == &buffer.front());
+		ASSERT(is_same_pixels(*c, *rows));
+		ASSERT(buffer[whole.get_width()] == Color(1, 1, 1, 1));
+		ASSERT(buffer.back() == Color(1, 1, 1, 1));
+	}
+	resource->reset();
+	ASSERT(buffer.back() == Color(1, 1, 1, 1));
+
+	return false;
+}
+
+bool test_blur()
+{
+	const RectInt whole(0, 0, 97, 89);
+	const Vector size(3.5, 2.5);
+	const rendering::Blur::Type type = rendering::Blur::GAUSSIAN;
+
+	VectorInt extra = software::Blur::get_extra_size(type, size);
+	ASSERT(software::Blur::is_pattern_used(type, extra));
+
+	synfig::Surface src(whole.get_width() + 2*extra[0], whole.get_height() + 2*extra[1]);
+	fill_noise(src);
+
+	synfig::Surface a(whole.get_width(), whole.get_height());
+	synfig::Surface b(whole.get_width(), whole.get_height());
+	a.clear();
+	b.clear();
+
+	software::Blur::blur(software::Blur::Params(
+		a, whole, src, extra, type, size, false, Color::BLEND_COMPOSITE, 1.0 ));
+
+	std::vector<RectInt> bands = make_bands(whole, 5);
+	for(std::vector<RectInt>::const_iterator i = bands.begin(); i != bands.end(); ++i)
+		software::Blur::blur(software::Blur::Params(
+			b, *i, src, extra + i->get_min(), type, size, false, Color::BLEND_COMPOSITE, 1.0 ));
+
+	ASSERT(is_same_pixels(a, b));
+	return false;
+}
+
+bool test_resample()
+{
+	const RectInt whole(0, 0, 131, 117);
+	const RectInt src_bounds(0, 0, 64, 48);
+
+	synfig::Surface src(src_bounds.get_width(), src_bounds.get_height());
+	fill_noise(src);
+
+	Matrix matrix = Matrix().set_translate(60.5, 20.25)
+	              * Matrix().set_rotate(Angle::deg(27.0))
+	              * Matrix().set_scale(1.3, 1.1);
+	ASSERT(!software::Resample::is_downscale_required(src_bounds, matrix, Color::INTERPOLATION_CUBIC));
+
+	for(int interpolation = Color::INTERPOLATION_NEAREST; interpolation <= Color::INTERPOLATION_CUBIC; ++interpolation)
+	{
+		synfig::Surface a(whole.get_width(), whole.get_height());
+		synfig::Surface b(whole.get_width(), whole.get_height());
+		a.clear();
+		b.clear();
+
+		software::Resample::resample(
+			a, whole, src, src_bounds, matrix,
+			(Color::Interpolation)interpolation, false, 1.0, Color::BLEND_COMPOSITE );
+
+		std::vector<RectInt> bands = make_bands(whole, 6);
+		for(std::vector<RectInt>::const_iterator i = bands.begin(); i != bands.end(); ++i)
+			software::Resample::resample(
+				b, whole, *i, src, src_bounds, matrix,
+				(Color::Interpolation)interpolation, false, 1.0, Color::BLEND_COMPOSITE );
+
+		ASSERT(is_same_pixels(a, b));
+	}
+	return false;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	int failures = 0;
+	bool fail;
+
+	TEST_FUNCTION(test_parts_count)
+	TEST_FUNCTION(test_contour)
+	TEST_FUNCTION(test_contour_bucketed)
+	TEST_FUNCTION(test_external_rows)
+	TEST_FUNCTION(test_blur)
+	TEST_FUNCTION(test_resample)
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
+
+	return failures ? 1 : 0;
+}
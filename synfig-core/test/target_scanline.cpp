@@ -0,0 +1,211 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file target_scanline.cpp
+**	\brief Test rendering of frame sequences by Target_Scanline
+**
+**	$Id$
+**
+**	\legal
+**	Copyright (c) 2020 Synfig contributors
+**
+**	This package is free software; you can redistribute it and/or
+**	modify it under the terms of the GNU General Public License as
+**	published by the Free Software Foundation; either version 2 of
+**	the License, or (at your option) any later version.
+**
+**	This package is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+**	General Public License for more details.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <vector>
+
+#include <synfig/canvas.h>
+#include <synfig/general.h>
+#include <synfig/renddesc.h>
+#include <synfig/surface.h>
+#include <synfig/target_scanline.h>
+#include <synfig/token.h>
+#include <synfig/type.h>
+#include <synfig/layers/layer_solidcolor.h>
+
+#include <synfig/rendering/renderer.h>
+
+#include "rendering_common.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		error("%s:%d - assertion failed: %s", __FUNCTION__, __LINE__, #condition); \
+		return true; \
+	} \
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+/* === C L A S S E S ======================================================= */
+
+//! Keeps all written frames, may give the rows of frame to render strips directly into them
+class TestTarget: public Target_Scanline
+{
+public:
+	bool own_rows;
+	int strips; //!< calls of start_scanlines(), one per rendered strip and one per frame written by add_frame()
+	synfig::Surface buffer;
+	std::vector<synfig::Surface> frames;
+
+	TestTarget(): own_rows(false), strips(0) { }
+
+	virtual bool start_frame(ProgressCallback * /* cb */)
+		{ buffer.set_wh(desc.get_w(), desc.get_h()); buffer.clear(); return true; }
+	virtual void end_frame()
+		{ frames.push_back(buffer); }
+	virtual Color* start_scanline(int scanline)
+		{ return buffer[scanline]; }
+	virtual bool end_scanline()
+		{ return true; }
+	virtual Color* start_scanlines(int scanline, int /* count */, int &pitch)
+	{
+		++strips;
+		if (!own_rows) return NULL;
+		pitch = buffer.get_pitch();
+		return buffer[scanline];
+	}
+};
+
+/* === P R O C E D U R E S ================================================= */
+
+static const int width = 32, height = 40, frame_count = 6, strip_rows = 8;
+
+static Canvas::Handle create_static_canvas(const Color &color)
+{
+	Canvas::Handle canvas = Canvas::create();
+	RendDesc &desc = canvas->rend_desc();
+	desc.set_wh(width, height);
+	desc.set_tl(Point(-2.0, 2.5));
+	desc.set_br(Point(2.0, -2.5));
+	desc.set_frame_rate(24);
+	desc.set_time_start(0);
+	desc.set_time_end(Time(frame_count - 1)/24);
+
+	Layer::Handle layer = new Layer_SolidColor();
+	layer->set_param("color", ValueBase(color));
+	canvas->push_back(layer);
+	return canvas;
+}
+
+//! Renders the canvas by strips or with frames ahead,
+//! returns count of start_scanlines() calls or -1 on failure
+static int render_frames(const Canvas::Handle &canvas, const Color &color, bool own_rows, bool reuse, int frames_ahead)
+{
+	etl::handle<TestTarget> target(new TestTarget());
+	target->own_rows = own_rows;
+	target->set_frames_ahead(frames_ahead);
+	target->set_frames_ahead_memory_limit(0);
+	target->set_reuse_static_frames(reuse);
+	target->set_strip_memory_limit(strip_rows*width*sizeof(Color));
+	target->set_canvas(canvas);
+	RendDesc desc = canvas->rend_desc();
+	target->set_rend_desc(&desc);
+
+	if (!target->render())
+		return -1;
+
+	if ((int)target->frames.size() != frame_count) {
+		error("own rows %d, reuse %d: expected %d frames, got %d", own_rows, reuse, frame_count, (int)target->frames.size());
+		return -1;
+	}
+	for(int i = 0; i < frame_count; ++i) {
+		const synfig::Surface &frame = target->frames[i];
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				if (max_difference(frame[y][x], color) > 1e-6) {
+					error( "own rows %d, reuse %d, frame %d, pixel (%d, %d): expected (%f, %f, %f, %f), got (%f, %f, %f, %f)",
+						own_rows, reuse, i, x, y,
+						color.get_r(), color.get_g(), color.get_b(), color.get_a(),
+						frame[y][x].get_r(), frame[y][x].get_g(), frame[y][x].get_b(), frame[y][x].get_a() );
+					return -1;
+				}
+	}
+	return target->strips;
+}
+
+//! Static canvas above the strip limit is rendered once and written to every frame
+bool test_static_strips()
+{
+	const Color color(0.25, 0.5, 0.75, 1.0);
+	Canvas::Handle canvas = create_static_canvas(color);
+	const int strips_per_frame = (height + strip_rows - 1)/strip_rows;
+
+	for(int own_rows = 0; own_rows < 2; ++own_rows) {
+		// next frames are copied from the first one
+		ASSERT(render_frames(canvas, color, own_rows, true, 0) == strips_per_frame + frame_count - 1);
+		ASSERT(render_frames(canvas, color, own_rows, false, 0) == strips_per_frame*frame_count);
+	}
+
+	return false;
+}
+
+//! Frames rendered ahead are written into the rows of target at once, when target gives them
+bool test_frames_ahead()
+{
+	const Color color(0.75, 0.25, 0.5, 0.5);
+	Canvas::Handle canvas = create_static_canvas(color);
+
+	for(int own_rows = 0; own_rows < 2; ++own_rows)
+		for(int frames_ahead = 1; frames_ahead <= frame_count; ++frames_ahead)
+			ASSERT(render_frames(canvas, color, own_rows, false, frames_ahead) == frame_count);
+
+	return false;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main()
+{
+	int failures = 0;
+	bool fail;
+
+	Type::subsys_init();
+	Token::rebuild();
+	Renderer::initialize();
+
+	TEST_FUNCTION(test_static_strips)
+	TEST_FUNCTION(test_frames_ahead)
+
+	Renderer::deinitialize();
+	Type::subsys_stop();
+
+	if (failures)
+		error("Test finished with %i errors", failures);
+	else
+		info("Success");
+
+	return failures ? 1 : 0;
+}
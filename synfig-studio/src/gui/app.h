@@ -230,6 +230,8 @@ public:
 	static synfig::String navigator_renderer;
 	static synfig::String workarea_renderer;
 	static int number_of_threads;
+	//! memory limit for rendered tiles of each work area, in megabytes
+	static int render_cache_size;
 	static bool enable_mainwin_menubar;
 	static bool enable_mainwin_toolbar;
 	static synfig::String ui_language;
@@ -68,6 +68,7 @@
 #include <gui/widgets/widget_canvastimeslider.h>
 #include <gui/widgets/widget_enum.h>
 #include <gui/workarea.h>
+#include <gui/workarearenderer/renderer_canvas.h>
 
 #include <pangomm.h>
 #include <sstream>
@@ -513,6 +514,7 @@ CanvasView::CanvasView(etl::loose_handle<Instance> instance,etl::handle<CanvasIn
 	time_model_              (new TimeModel()),
 	statusbar                (manage(new class Gtk::Statusbar())),
 	progressbar              (manage(new class Gtk::ProgressBar())),
+	render_cache_label       (manage(new class Gtk::Label())),
 	jackbutton               (NULL),
 	offset_widget            (NULL),
 	toggleducksdial          (Gtk::IconSize::from_name("synfig-small_icon_16x16")),
@@ -634,6 +636,7 @@ CanvasView::CanvasView(etl::loose_handle<Instance> instance,etl::handle<CanvasIn
 	work_area->signal_layer_selected().connect(sigc::mem_fun(*this,&CanvasView::workarea_layer_selected));
 	work_area->signal_input_device_changed().connect(sigc::mem_fun(*this,&CanvasView::on_input_device_changed));
 	work_area->signal_meta_data_changed().connect(sigc::mem_fun(*this,&CanvasView::on_meta_data_changed));
+	work_area->signal_rendering().connect(sigc::mem_fun(*this,&CanvasView::on_rendering));
 
 	canvas_interface()->signal_canvas_added().connect(
 		sigc::hide( sigc::mem_fun(*instance,&Instance::refresh_canvas_tree)));
@@ -1044,6 +1047,7 @@ CanvasView::create_time_bar()
 		controls->attach(*jackdial, left_pos++, 0, 1, 1);
 		controls->attach(*statusbar, left_pos++, 0, 1, 1);
 		controls->attach(*progressbar, left_pos++, 0, 1, 1);
+		controls->attach(*render_cache_label, left_pos++, 0, 1, 1);
 		controls->attach(*widget_interpolation, left_pos++, 0, 1, 1);
 		controls->attach(*keyframedial, left_pos++, 0, 1, 1);
 		controls->attach(*animatebutton, left_pos++, 0, 1, 1);
@@ -1057,6 +1061,11 @@ CanvasView::create_time_bar()
 		statusbar->set_hexpand(true);
 		statusbar->set_halign(Gtk::Align::ALIGN_FILL);
 
+		render_cache_label->set_margin_start(4);
+		render_cache_label->set_margin_end(4);
+		render_cache_label->set_tooltip_text(_("Memory used by the rendered frames of the work area. The limit can be changed in Preferences."));
+		render_cache_label->show();
+
 		controls->show();
 	}
 
@@ -2791,6 +2800,15 @@ CanvasView::toggle_background_rendering()
 	toggling_background_rendering=false;
 }
 
+void
+CanvasView::on_rendering()
+{
+	long long used = 0, limit = 0;
+	work_area->get_renderer_canvas()->get_cache_usage(used, limit);
+	const double megabyte = 1024.0*1024.0;
+	render_cache_label->set_text(etl::strprintf(_("Cache %.0f/%.0f MB"), used/megabyte, limit/megabyte));
+}
+
 void
 CanvasView::on_dirty_preview()
 {
@@ -43,6 +43,7 @@
 
 #include <gtkmm/button.h>
 #include <gtkmm/grid.h>
+#include <gtkmm/label.h>
 #include <gtkmm/menu.h>
 #include <gtkmm/progressbar.h>
 #include <gtkmm/radiobuttongroup.h>
@@ -274,6 +275,7 @@ private:
 
 	Gtk::Statusbar *statusbar;
 	Gtk::ProgressBar *progressbar;
+	Gtk::Label *render_cache_label;
 
 	Gtk::Button *closebutton;
 	Gtk::Button *stopbutton;
@@ -666,6 +668,7 @@ protected:
 	bool on_button_press_event(GdkEventButton *event);
 	bool on_keyframe_tree_event(GdkEvent *event);
 	void on_dirty_preview();
+	void on_rendering();
 	bool on_children_user_click(int, Gtk::TreeRow, ChildrenTree::ColumnID);
 	bool on_layer_user_click(int, Gtk::TreeRow, LayerTree::ColumnID);
 	void on_mode_changed(synfigapp::CanvasInterface::Mode mode);
@@ -56,7 +56,7 @@ const char* allowed_video_codecs[] =
 {
 	"flv", "h263p", "huffyuv", "libtheora", "libx264", "libx264-lossless",
 	"mjpeg", "mpeg1video", "mpeg2video", "mpeg4", "msmpeg4",
-	"msmpeg4v1", "msmpeg4v2", "wmv1", "wmv2", CUSTOM_VCODEC, NULL
+	"msmpeg4v1", "msmpeg4v2", "prores-4444", "wmv1", "wmv2", CUSTOM_VCODEC, NULL
 };
 
 //! Allowed video codecs description.
@@ -78,6 +78,7 @@ const char* allowed_video_codecs_description[] =
 	_("MPEG-4 part 2 Microsoft variant version 3"),
 	_("MPEG-4 part 2 Microsoft variant version 1"),
 	_("MPEG-4 part 2 Microsoft variant version 2"),
+	_("Apple ProRes 4444 with alpha (MOV)"),
 	_("Windows Media Video 7"),
 	_("Windows Media Video 8"),
 	CUSTOM_VCODEC_DESCRIPTION,
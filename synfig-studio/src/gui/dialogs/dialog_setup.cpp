@@ -86,6 +86,7 @@ Dialog_Setup::Dialog_Setup(Gtk::Window& parent):
 	adj_pref_y_size(Gtk::Adjustment::create(270,1,10000,1,10,0)),
 	adj_pref_fps(Gtk::Adjustment::create(24.0,1.0,100,0.1,1,0)),
 	adj_number_of_threads(Gtk::Adjustment::create(App::number_of_threads,2,std::thread::hardware_concurrency(),1,10,0)),
+	adj_render_cache_size(Gtk::Adjustment::create(App::render_cache_size,64,65536,64,512,0)),
 	pref_modification_flag(false),
 	refreshing(false)
 {
@@ -668,7 +669,9 @@ Dialog_Setup::create_render_page(PageInfo pi)
 {
 	/*---------Render------------------*\
 	 *
-	 *  sequence separator _________
+	 *   number of threads  [ 4 ]
+	 *   render cache  [ 512 ]
+	 *   sequence separator _________
 	 *   workarea  [ Legacy ]
 	 *   play sound on render done  [x| ]
 	 *
@@ -681,6 +684,12 @@ Dialog_Setup::create_render_page(PageInfo pi)
 	pi.grid->attach(*number_of_threads_select, 1, row, 1, 1);
 	number_of_threads_select->signal_changed().connect(sigc::mem_fun(*this, &Dialog_Setup::on_number_of_thread_changed) );
 	number_of_threads_select->set_hexpand(true);
+	// Render - Memory for rendered tiles of WorkArea
+	attach_label(pi.grid, _("WorkArea render cache (MB)"), ++row);
+	Gtk::SpinButton *render_cache_size_select = Gtk::manage(new Gtk::SpinButton(adj_render_cache_size,0,0));
+	render_cache_size_select->set_tooltip_text(_("Memory used to keep rendered frames of each opened file. Increase it to cache more frames for playback and onion skin."));
+	render_cache_size_select->set_hexpand(true);
+	pi.grid->attach(*render_cache_size_select, 1, row, 1, 1);
 	// Render - Image sequence separator
 	attach_label(pi.grid, _("Image Sequence Separator String"), ++row);
 	pi.grid->attach(image_sequence_separator, 1, row, 1, 1);
@@ -854,6 +863,7 @@ Dialog_Setup::on_restore_pressed()
 		adj_pref_fps->set_value(24.0);
 		image_sequence_separator.set_text(".");
 		adj_number_of_threads->set_value(std::thread::hardware_concurrency());
+		adj_render_cache_size->set_value(512);
 
 		workarea_renderer_combo.set_active_id("");
 		def_background_none.set_active();
@@ -1004,6 +1014,9 @@ Dialog_Setup::on_apply_pressed()
 	// Set the number of threads
 	App::number_of_threads = int(adj_number_of_threads->get_value());
 
+	// Set the memory limit for rendered tiles
+	App::render_cache_size = int(adj_render_cache_size->get_value());
+
 	// Set the workarea render and navigator render flag
 	App::navigator_renderer = App::workarea_renderer  = workarea_renderer_combo.get_active_id();
 
@@ -1305,6 +1318,9 @@ Dialog_Setup::refresh()
 	// Refresh the number of threads
 	number_of_threads_select->set_value(App::number_of_threads);
 
+	// Refresh the memory limit for rendered tiles
+	adj_render_cache_size->set_value(App::render_cache_size);
+
 	// Refresh the status of the workarea_renderer
 	workarea_renderer_combo.set_active_id(App::workarea_renderer);
 
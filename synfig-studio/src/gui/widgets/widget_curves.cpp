@@ -184,6 +184,33 @@ struct Widget_Curves::CurveStruct: sigc::trackable
 		return channels[channel].values[time];
 	}
 
+	//! Calculates values which are not cached yet for many sorted times at once
+	void fill_values(const std::vector<Time> &times, Real tolerance) {
+		if (channels.empty())
+			return;
+
+		std::vector<Time> missing_times;
+		std::map<Real, Real> &cached = channels[0].values;
+		for(std::vector<Time>::const_iterator t = times.begin(); t != times.end(); ++t) {
+			Real time = *t;
+			std::map<Real, Real>::iterator i = cached.lower_bound(time);
+			if (i == cached.end() || i->first - time > tolerance)
+				missing_times.push_back(*t);
+		}
+		if (missing_times.empty())
+			return;
+
+		std::vector<ValueBase> values;
+		value_desc.get_values(missing_times, values);
+		std::vector<Real> channel_values;
+		for(size_t i = 0; i < values.size(); ++i) {
+			if (!get_value_base_channel_values(values[i], channel_values))
+				continue;
+			for (size_t c = 0; c < channel_values.size() && c < channels.size(); c++)
+				channels[c].values[Real(missing_times[i])] = channel_values[c];
+		}
+	}
+
 	static bool get_value_base_channel_values(const ValueBase &value_base, std::vector<Real>& channels) {
 		channels.clear();
 		Type &type(value_base.get_type());
@@ -718,7 +745,14 @@ Widget_Curves::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
 			points[c].reserve(w);
 		}
 
+		std::vector<Time> times;
+		times.reserve(w);
 		Time t = time_plot_data->lower;
+		for(int j = 0; j < w; ++j, t += time_plot_data->dt)
+			times.push_back(t);
+		curve_it->fill_values(times, time_plot_data->dt);
+
+		t = time_plot_data->lower;
 		for(int j = 0; j < w; ++j, t += time_plot_data->dt) {
 			for(size_t c = 0; c < channels; ++c) {
 				Real y = curve_it->get_value(c, t, time_plot_data->dt);
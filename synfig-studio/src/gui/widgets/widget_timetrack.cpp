@@ -778,11 +778,18 @@ void Widget_Timetrack::draw_static_intervals_for_row(const Cairo::RefPtr<Cairo::
 	Gdk::RGBA color = get_style_context()->get_color();
 	cr->set_source_rgba(color.get_red(), color.get_green(), color.get_blue(), 0.7);
 
-	for (const auto& pair : waypoints) {
-		const synfig::Time &t = pair.second;
+	std::vector<synfig::Time> times;
+	times.reserve(waypoints.size());
+	for (const auto& pair : waypoints)
+		times.push_back(pair.second);
+	std::vector<synfig::ValueBase> values;
+	row_info.get_value_desc().get_values(times, values);
+
+	for (size_t i = 0; i < waypoints.size(); ++i) {
+		const synfig::Time &t = waypoints[i].second;
 		int px = time_plot_data->get_pixel_t_coord(t);
 
-		synfig::ValueBase value(row_info.get_value_desc().get_value(t));
+		const synfig::ValueBase &value = values[i];
 		if (value == previous_value) {
 			int previous_px = time_plot_data->get_pixel_t_coord(previous_time);
 			cr->rectangle(previous_px, py + waypoint_edge_length/2 - static_line_thickness/2, px - previous_px, static_line_thickness);
@@ -34,6 +34,8 @@
 #	include <config.h>
 #endif
 
+#include <cmath>
+
 #include <gui/workarea.h>
 
 #include <gtkmm/arrow.h>
@@ -150,6 +152,8 @@ WorkArea::WorkArea(etl::loose_handle<synfigapp::CanvasInterface> canvas_interfac
 	low_res_pixel_size(2),
 	dirty_trap_count(0),
 	dirty_trap_queued(0),
+	changed_rect_set(false),
+	changed_rect_full(false),
 	onion_skin(false),
 	onion_skin_keyframes(true),
 	background_rendering(false),
@@ -278,6 +282,7 @@ WorkArea::WorkArea(etl::loose_handle<synfigapp::CanvasInterface> canvas_interfac
 
 	canvas_interface->signal_rend_desc_changed().connect(sigc::mem_fun(*this, &WorkArea::refresh_dimension_info));
 	canvas_interface->signal_time_changed().connect(sigc::mem_fun(*this, &WorkArea::queue_draw));
+	canvas_interface->signal_layer_region_changed().connect(sigc::mem_fun(*this, &WorkArea::on_layer_region_changed));
 	// When either of the scrolling adjustments change, then redraw.
 	get_scrollx_adjustment()->signal_value_changed().connect(sigc::mem_fun(*this, &WorkArea::queue_scroll));
 	get_scrolly_adjustment()->signal_value_changed().connect(sigc::mem_fun(*this, &WorkArea::queue_scroll));
@@ -2131,7 +2136,7 @@ void
 WorkArea::sync_render(bool refresh)
 {
 	dirty_trap_queued = 0;
-	if (refresh) renderer_canvas->clear_render();
+	if (refresh) clear_changed_render();
 	renderer_canvas->enqueue_render();
 	renderer_canvas->wait_render();
 
@@ -2160,7 +2165,7 @@ studio::WorkArea::queue_render(bool refresh)
 	// avoiding dead-lock : github#1071
 	Glib::signal_idle().connect_once([=] () {
 		if (refresh) {
-			renderer_canvas->clear_render();
+			clear_changed_render();
 			Glib::signal_idle().connect_once(
 						sigc::mem_fun(*renderer_canvas, &Renderer_Canvas::enqueue_render),
 						Glib::PRIORITY_DEFAULT );
@@ -2170,6 +2175,39 @@ studio::WorkArea::queue_render(bool refresh)
 	});
 }
 
+void
+WorkArea::on_layer_region_changed(Layer::Handle, Rect old_rect, Rect new_rect)
+{
+	Rect rect = old_rect;
+	rect |= new_rect;
+	Time time = canvas_interface->get_time();
+
+	bool finite = std::isfinite(rect.minx) && std::isfinite(rect.miny)
+			   && std::isfinite(rect.maxx) && std::isfinite(rect.maxy);
+	if (!finite || (changed_rect_set && !changed_time.is_equal(time)))
+		changed_rect_full = true;
+	else
+	if (changed_rect_set)
+		changed_rect |= rect;
+	else
+		changed_rect = rect;
+
+	changed_rect_set = true;
+	changed_time = time;
+}
+
+void
+WorkArea::clear_changed_render()
+{
+	// refresh without reported changes (refresh button, rend desc changes, etc.) clears everything
+	if (changed_rect_set && !changed_rect_full)
+		renderer_canvas->clear_render(changed_time, changed_rect);
+	else
+		renderer_canvas->clear_render();
+	changed_rect_set = false;
+	changed_rect_full = false;
+}
+
 void
 studio::WorkArea::set_cursor(const Glib::RefPtr<Gdk::Cursor> &x)
 {
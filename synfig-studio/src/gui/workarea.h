@@ -46,6 +46,7 @@
 #include <set>
 
 #include <synfig/canvas.h>
+#include <synfig/rect.h>
 #include <synfig/time.h>
 #include <synfig/vector.h>
 
@@ -206,6 +207,14 @@ private:
 	int dirty_trap_count;
 	int dirty_trap_queued;
 
+	//! Area of the canvas changed since the last clearing of rendered tiles
+	//! (in canvas units), collected by on_layer_region_changed()
+	synfig::Rect changed_rect;
+	synfig::Time changed_time;
+	bool changed_rect_set;
+	//! some change affects the unknown area, all tiles should be cleared
+	bool changed_rect_full;
+
 	// This flag is set if onion skin is visible
 	bool onion_skin;
 	//! stores the future [1] and past [0] onion skins based on keyframes
@@ -466,6 +475,10 @@ private:
 	bool on_key_press_event(GdkEventKey* event);
 	bool on_key_release_event(GdkEventKey* event);
 	bool on_drawing_area_event(GdkEvent* event);
+	void on_layer_region_changed(synfig::Layer::Handle layer, synfig::Rect old_rect, synfig::Rect new_rect);
+
+	//! Clears tiles of the changed area only, when it's known
+	void clear_changed_render();
 	bool on_hruler_event(GdkEvent* event);
 	bool on_vruler_event(GdkEvent* event);
 	void on_duck_selection_single(const etl::handle<Duck>& duck_guid);
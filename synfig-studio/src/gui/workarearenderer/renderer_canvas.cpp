@@ -32,6 +32,7 @@
 #	include <config.h>
 #endif
 
+#include <cmath>
 #include <cstring>
 #include <valarray>
 
@@ -41,6 +42,7 @@
 #include <synfig/rendering/renderer.h>
 #include <synfig/rendering/common/task/tasktransformation.h>
 
+#include <gui/app.h>
 #include <gui/canvasview.h>
 #include <gui/localization.h>
 #include <gui/timemodel.h>
@@ -77,11 +79,17 @@ static long long
 image_rect_size(const RectInt &rect)
 	{ return 4ll*rect.get_width()*rect.get_height(); }
 
+//! tile keeps float surface (16 bytes per pixel) only while rendering,
+//! it's released after conversion to Cairo surface (4 bytes per pixel)
+static long long
+tile_size(const Renderer_Canvas::Tile &tile)
+	{ return image_rect_size(tile.rect)*(tile.event ? 5 : 1); }
+
 /* === M E T H O D S ======================================================= */
 
 Renderer_Canvas::Renderer_Canvas():
-	max_tiles_size_soft(512*1024*1024),
-	max_tiles_size_hard(max_tiles_size_soft + 128*1024*1024),
+	max_tiles_size_soft(),
+	max_tiles_size_hard(),
 	weight_future      (   1.0), // high priority
 	weight_past        (   2.0), // low priority
 	weight_future_extra(  16.0),
@@ -237,9 +245,11 @@ Renderer_Canvas::on_tile_finished(bool success, const Tile::Handle &tile)
 	if (!tile->event && !tile->surface && !tile->cairo_surface)
 		return; // tile is already removed
 
+	tiles_size -= tile_size(*tile);
 	tile->event.reset();
 	tile->cairo_surface = cairo_surface;
 	tile->surface.reset();
+	tiles_size += tile_size(*tile);
 
 	// don't create handle if ref-count is zero
 	// it means that object was nether had a handles and will removed with handle
@@ -283,7 +293,7 @@ Renderer_Canvas::insert_tile(TileList &list, const Tile::Handle &tile)
 	// this method may be called from other threads
 	// mutex must be already locked
 	list.push_back(tile);
-	tiles_size += image_rect_size(tile->rect);
+	tiles_size += tile_size(*tile);
 }
 
 Renderer_Canvas::TileList::iterator
@@ -292,7 +302,7 @@ Renderer_Canvas::erase_tile(TileList &list, TileList::iterator i, rendering::Tas
 	// this method may be called from other threads
 	// mutex must be already locked
 	if ((*i)->event) events.push_back((*i)->event);
-	tiles_size -= image_rect_size((*i)->rect);
+	tiles_size -= tile_size(**i);
 	(*i)->event.reset();
 	(*i)->surface.reset();
 	(*i)->cairo_surface = Cairo::RefPtr<Cairo::ImageSurface>();
@@ -578,6 +588,7 @@ Renderer_Canvas::enqueue_render()
 	assert(get_work_area());
 
 	rendering::Task::List events;
+	bool enqueued_any = false;
 
 	{
 		std::lock_guard<std::mutex> lock(mutex);
@@ -593,6 +604,9 @@ Renderer_Canvas::enqueue_render()
 
 		build_onion_frames();
 
+		max_tiles_size_soft = std::max(64ll, (long long)App::render_cache_size)*1024*1024;
+		max_tiles_size_hard = max_tiles_size_soft + max_tiles_size_soft/4;
+
 		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(renderer_name);
 		
 		int max_tasks = max_enqueued_tasks;
@@ -687,12 +701,16 @@ Renderer_Canvas::enqueue_render()
 					canvas->set_time(orig_time);
 
 				if(enqueued)
-					get_work_area()->signal_rendering()();
+					enqueued_any = true;
 			}
 		}
 	}
 
 	rendering::Renderer::cancel(events);
+
+	// emit signal when mutex is unlocked, handlers may ask for cache usage
+	if (enqueued_any)
+		get_work_area()->signal_rendering()();
 }
 
 void
@@ -734,6 +752,75 @@ Renderer_Canvas::clear_render()
 		get_work_area()->signal_rendering()();
 }
 
+void
+Renderer_Canvas::clear_render(const Time &time, const Rect &rect)
+{
+	Canvas::Handle canvas = get_work_area() ? get_work_area()->get_canvas() : Canvas::Handle();
+	if (!canvas)
+		{ clear_render(); return; }
+
+	// changed area in pixels is calculated for each frame size separately,
+	// tiles have the same tl and br as canvas, see enqueue_render_frame()
+	const Vector tl = canvas->rend_desc().get_tl();
+	const Vector br = canvas->rend_desc().get_br();
+	const bool empty = !(rect.area() > 0.0)
+					|| approximate_equal(tl[0], br[0])
+					|| approximate_equal(tl[1], br[1]);
+
+	rendering::Task::List events;
+	bool cleared = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(TileMap::iterator i = tiles.begin(); i != tiles.end(); ++i) {
+			if (!i->first.time.is_equal(time)) {
+				// the change may affect other frames in other places
+				cleared = cleared || !i->second.empty();
+				while(!i->second.empty()) {
+					TileList::iterator j = i->second.end(); --j;
+					erase_tile(i->second, j, events);
+				}
+				continue;
+			}
+			if (empty) continue;
+
+			// expand by one pixel to cover antialiasing
+			const Real kx = i->first.width/(br[0] - tl[0]);
+			const Real ky = i->first.height/(br[1] - tl[1]);
+			const Real x0 = (rect.minx - tl[0])*kx, x1 = (rect.maxx - tl[0])*kx;
+			const Real y0 = (rect.miny - tl[1])*ky, y1 = (rect.maxy - tl[1])*ky;
+			const Real max_x = i->first.width + 1.0, max_y = i->first.height + 1.0;
+			RectInt changed(
+				(int)floor(clamp(std::min(x0, x1), -1.0, max_x)) - 1,
+				(int)floor(clamp(std::min(y0, y1), -1.0, max_y)) - 1,
+				(int)ceil (clamp(std::max(x0, x1), -1.0, max_x)) + 1,
+				(int)ceil (clamp(std::max(y0, y1), -1.0, max_y)) + 1 );
+
+			for(TileList::iterator j = i->second.begin(); j != i->second.end(); )
+				if (*j && ((*j)->rect && changed))
+					{ j = erase_tile(i->second, j, events); cleared = true; }
+				else
+					++j;
+		}
+
+		// remove empty entries from tiles map
+		for(TileMap::iterator i = tiles.begin(); i != tiles.end(); )
+			if (i->second.empty()) tiles.erase(i++); else ++i;
+
+		rendering_error_msg_map.clear();
+	}
+	rendering::Renderer::cancel(events);
+	if (cleared)
+		get_work_area()->signal_rendering()();
+}
+
+void
+Renderer_Canvas::get_cache_usage(long long &used, long long &limit)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	used = tiles_size;
+	limit = max_tiles_size_soft ? max_tiles_size_soft : (long long)App::render_cache_size*1024*1024;
+}
+
 Renderer_Canvas::FrameStatus
 Renderer_Canvas::merge_status(FrameStatus a, FrameStatus b) {
 	static const FrameStatus map[FS_Count][FS_Count] = {
@@ -134,8 +134,8 @@ public:
 
 private:
 	// cache options
-	const long long max_tiles_size_soft; //!< threshold for creation of new tiles
-	const long long max_tiles_size_hard; //!< threshold for removing already created tiles
+	long long max_tiles_size_soft;       //!< threshold for creation of new tiles, see App::render_cache_size
+	long long max_tiles_size_hard;       //!< threshold for removing already created tiles
 	const synfig::Real weight_future;    //!< will multiply to frames count
 	const synfig::Real weight_past;
 	const synfig::Real weight_future_extra;
@@ -159,7 +159,7 @@ private:
 	FrameId current_frame;
 	synfig::Time frame_duration;
 
-	//! increment of this field makes all tiles outdated
+	//! memory used by tiles, includes float surfaces of tiles which are rendering now
 	long long tiles_size;
 
 	synfig::PixelFormat pixel_format;
@@ -224,9 +224,15 @@ public:
 	void enqueue_render();
 	void wait_render();
 	void clear_render();
+	//! removes tiles at given time which intersect the changed area (in canvas units)
+	//! and all tiles of other times, so only the changed area of current frame will be rendered again
+	void clear_render(const synfig::Time &time, const synfig::Rect &rect);
 
 	void get_render_status(StatusMap &out_map);
 
+	//! memory used by rendered tiles and its limit, in bytes
+	void get_cache_usage(long long &used, long long &limit);
+
 	void get_rendering_error_messages(std::vector<std::string>& messages);
 	void get_rendering_error_messages_for_time(const synfig::Time& time, std::set<std::string>& message_set);
 
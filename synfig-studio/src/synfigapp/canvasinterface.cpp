@@ -32,6 +32,10 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include <synfig/general.h>
 
 #include <synfig/canvasfilenaming.h>
@@ -45,8 +49,11 @@
 #include <synfig/waypoint.h>
 #include <synfig/valuenode_registry.h>
 #include <synfig/surface.h>
+#include <synfig/transform.h>
 #include <synfig/rendering/software/surfacesw.h>
 
+#include <synfig/layers/layer_composite_fork.h>
+#include <synfig/layers/layer_filtergroup.h>
 #include <synfig/layers/layer_pastecanvas.h>
 #include <synfig/layers/layer_bitmap.h>
 
@@ -91,6 +98,96 @@ using namespace synfigapp;
 
 /* === P R O C E D U R E S ================================================= */
 
+static Rect
+get_layer_region(const Layer::Handle &layer, const Time &time)
+{
+	// parameters linked to value nodes are updated by set_time(),
+	// Layer::on_changed() clears the time mark, so only the changed layer will be updated
+	if (!layer->get_time_mark().is_equal(time)) {
+		if (!layer->get_canvas())
+			return Rect::full_plane();
+		IndependentContext context = layer->get_canvas()->get_independent_context();
+		while(*context && *context != layer) ++context;
+		if (!*context)
+			return Rect::full_plane();
+		context.set_time(time);
+	}
+
+	if (etl::handle<Layer_PasteCanvas> paste = etl::handle<Layer_PasteCanvas>::cast_dynamic(layer))
+		return paste->get_bounding_rect_context_dependent(ContextParams(true));
+	return layer->get_bounding_rect();
+}
+
+static bool
+is_finite_rect(const Rect &rect)
+{
+	return std::isfinite(rect.minx) && std::isfinite(rect.miny)
+		&& std::isfinite(rect.maxx) && std::isfinite(rect.maxy);
+}
+
+//! Checks that transform acts as invertible affine transformation inside of rect,
+//! so Transform::perform() of rect gives the bounds of the transformed area
+static bool
+is_affine_in_rect(const Transform &transform, const Rect &rect)
+{
+	const Vector a(rect.minx, rect.miny), b(rect.maxx, rect.miny), c(rect.minx, rect.maxy), d(rect.maxx, rect.maxy);
+	const Vector pa = transform.perform(a), pb = transform.perform(b), pc = transform.perform(c);
+	const Vector dx = pb - pa, dy = pc - pa;
+	const Real size = dx.mag() + dy.mag();
+	const Real precision = 1e-6*size + 1e-9;
+	if (!std::isfinite(size) || std::fabs(dx[0]*dy[1] - dx[1]*dy[0]) <= precision*precision)
+		return false;
+
+	const Real k[][2] = { {1.0, 1.0}, {0.5, 0.5}, {0.5, 0.0}, {0.0, 0.5}, {1.0, 0.5}, {0.5, 1.0} };
+	for(int i = 0; i < (int)(sizeof(k)/sizeof(k[0])); ++i) {
+		Vector p = a + (b - a)*k[i][0] + (c - a)*k[i][1];
+		Vector pp = transform.perform(p);
+		if ( (pp - (pa + dx*k[i][0] + dy*k[i][1])).mag() > precision
+		  || (transform.unperform(pp) - p).mag() > 1e-6*(d - a).mag() + 1e-9 )
+			return false;
+	}
+	return true;
+}
+
+//! Maps the area changed by the layer of the canvas through the layers above it:
+//! they may move or spread the pixels of the layer, see Layer::get_full_bounding_rect().
+//! Returns full plane when some layer above is not local.
+static Rect
+get_visible_region(const Canvas::Handle &canvas, const Layer::Handle &layer, Rect rect)
+{
+	if (!rect.is_valid())
+		return rect;
+	if (!is_finite_rect(rect))
+		return Rect::full_plane();
+
+	// when the position of the layer is unknown (removed or moved layer)
+	// all layers of the canvas may be above it, and only local ones are allowed
+	Canvas::iterator position = std::find(canvas->begin(), canvas->end(), layer);
+	const bool known = position != canvas->end();
+	std::vector<Layer::Handle> above(canvas->begin(), position);
+
+	for(std::vector<Layer::Handle>::reverse_iterator i = above.rbegin(); i != above.rend(); ++i) {
+		const Layer *x = i->get();
+		if (!x->active())
+			continue;
+
+		// blends own pixels with pixels of context at the same position
+		if ( dynamic_cast<const Layer_Composite*>(x)
+		  && !dynamic_cast<const Layer_CompositeFork*>(x)
+		  && !dynamic_cast<const Layer_FilterGroup*>(x) )
+			continue;
+
+		etl::handle<Transform> transform = x->get_transform();
+		if (!known || !transform || !is_affine_in_rect(*transform, rect))
+			return Rect::full_plane();
+		rect = transform->perform(rect);
+		if (!is_finite_rect(rect))
+			return Rect::full_plane();
+	}
+
+	return rect;
+}
+
 /* === M E T H O D S ======================================================= */
 
 CanvasInterface::CanvasInterface(etl::loose_handle<Instance> instance,etl::handle<synfig::Canvas> canvas):
@@ -102,6 +199,17 @@ CanvasInterface::CanvasInterface(etl::loose_handle<Instance> instance,etl::handl
 {
 	set_selection_manager(get_instance()->get_selection_manager());
 	set_ui_interface(get_instance()->get_ui_interface());
+
+	get_canvas()->signal_child_changed().connect(
+		sigc::mem_fun(*this, &CanvasInterface::on_child_changed) );
+	signal_layer_inserted().connect(
+		sigc::hide(sigc::mem_fun(*this, &CanvasInterface::on_layer_inserted)) );
+	signal_layer_removed().connect(
+		sigc::mem_fun(*this, &CanvasInterface::on_layer_removed) );
+	signal_layer_moved().connect(
+		sigc::hide(sigc::hide(sigc::mem_fun(*this, &CanvasInterface::on_layer_moved))) );
+
+	update_layer_rects();
 }
 
 CanvasInterface::~CanvasInterface()
@@ -123,6 +231,7 @@ CanvasInterface::set_time(synfig::Time x)
 	if(cur_time_.is_equal(x))
 		return;
 	get_canvas()->set_time(cur_time_=x);
+	update_layer_rects();
 
 	// update the time in all the child canvases
 	Canvas::Children children = get_canvas()->get_root()->children();
@@ -140,10 +249,93 @@ CanvasInterface::get_time()const
 	return cur_time_;
 }
 
+void
+CanvasInterface::update_layer_rects()
+{
+	// the first change after the time change needs the rect of the layer before the change
+	layer_rects_.clear();
+	for(Canvas::iterator i = get_canvas()->begin(); i != get_canvas()->end(); ++i)
+		layer_rects_[*i] = get_layer_region(*i, get_time());
+}
+
+void
+CanvasInterface::emit_layer_region_changed(Layer::Handle layer, const Rect &old_rect, const Rect &new_rect)
+{
+	signal_layer_region_changed()(
+		layer,
+		get_visible_region(get_canvas(), layer, old_rect),
+		get_visible_region(get_canvas(), layer, new_rect) );
+}
+
+void
+CanvasInterface::on_child_changed(const Node *node)
+{
+	// only the layers of this canvas, changes inside of the group layers
+	// come here as the change of the group layer
+	const Layer *x = dynamic_cast<const Layer*>(node);
+	if (!x || !x->count() || x->get_canvas() != get_canvas())
+		return;
+
+	Layer::Handle layer(const_cast<Layer*>(x));
+	Rect new_rect = get_layer_region(layer, get_time());
+	std::map<Layer::Handle, Rect>::iterator i = layer_rects_.find(layer);
+	Rect old_rect = i == layer_rects_.end() ? Rect::full_plane() : i->second;
+	layer_rects_[layer] = new_rect;
+	emit_layer_region_changed(layer, old_rect, new_rect);
+}
+
+void
+CanvasInterface::on_layer_inserted(Layer::Handle layer)
+{
+	if (!layer || layer->get_canvas() != get_canvas())
+		return;
+	Rect rect = get_layer_region(layer, get_time());
+	layer_rects_[layer] = rect;
+	emit_layer_region_changed(layer, Rect::zero(), rect);
+}
+
+void
+CanvasInterface::on_layer_removed(Layer::Handle layer)
+{
+	if ( !layer
+	  || ( layer->get_canvas() == get_canvas()
+		&& std::find(get_canvas()->begin(), get_canvas()->end(), layer) != get_canvas()->end() ))
+		return;
+
+	// old position of the layer is unknown, so layers above it are unknown too
+	std::map<Layer::Handle, Rect>::iterator i = layer_rects_.find(layer);
+	if (i != layer_rects_.end()) {
+		Rect old_rect = get_visible_region(get_canvas(), Layer::Handle(), i->second);
+		layer_rects_.erase(i);
+		signal_layer_region_changed()(layer, old_rect, Rect::zero());
+	} else
+	if (layer->get_canvas() == get_canvas()) {
+		signal_layer_region_changed()(layer, Rect::full_plane(), Rect::zero());
+	}
+}
+
+void
+CanvasInterface::on_layer_moved(Layer::Handle layer)
+{
+	if (!layer || layer->get_canvas() != get_canvas()) {
+		on_layer_removed(layer);
+		return;
+	}
+
+	// layers above the old position are unknown, new position is handled by on_child_changed()
+	std::map<Layer::Handle, Rect>::iterator i = layer_rects_.find(layer);
+	Rect rect = i == layer_rects_.end() ? Rect::full_plane() : i->second;
+	signal_layer_region_changed()(
+		layer,
+		get_visible_region(get_canvas(), Layer::Handle(), rect),
+		get_visible_region(get_canvas(), layer, rect) );
+}
+
 void
 CanvasInterface::refresh_current_values()
 {
 	get_canvas()->set_time(cur_time_);
+	update_layer_rects();
 	signal_time_changed()();
 	signal_dirty_preview()();
 }
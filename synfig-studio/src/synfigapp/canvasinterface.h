@@ -30,11 +30,13 @@
 
 #include <set>
 #include <list>
+#include <map>
 
 #include <sigc++/sigc++.h>
 
 //#include <synfig/canvas.h>
 #include <synfig/value.h>
+#include <synfig/rect.h>
 
 #include "selectionmanager.h"
 #include "uimanager.h"
@@ -115,6 +117,20 @@ private:
 
 	sigc::signal<void,synfig::Layer::Handle,synfig::String> signal_layer_param_changed_;
 
+	sigc::signal<void,synfig::Layer::Handle,synfig::Rect,synfig::Rect> signal_layer_region_changed_;
+
+	//! Bounding rects of the layers of the canvas at current time, taken at their last change
+	std::map<synfig::Layer::Handle, synfig::Rect> layer_rects_;
+
+	void update_layer_rects();
+	//! Maps rects of the layer through the layers above it and emits signal_layer_region_changed()
+	void emit_layer_region_changed(synfig::Layer::Handle layer, const synfig::Rect &old_rect, const synfig::Rect &new_rect);
+
+	void on_child_changed(const synfig::Node *node);
+	void on_layer_inserted(synfig::Layer::Handle layer);
+	void on_layer_removed(synfig::Layer::Handle layer);
+	void on_layer_moved(synfig::Layer::Handle layer);
+
 public:	// Signal Interface
 
 	sigc::signal<void,synfig::Layer::Handle,int,synfig::Canvas::Handle>& signal_layer_moved() { return signal_layer_moved_; }
@@ -151,6 +167,15 @@ public:	// Signal Interface
 	//! Signal called when a layer's parameter has been changed
 	sigc::signal<void,synfig::Layer::Handle,synfig::String>& signal_layer_param_changed() { return signal_layer_param_changed_; }
 
+	//! Signal called when a layer of the canvas has been changed.
+	/*!	Passes the layer and the areas of the canvas covered by it at current time
+	**	before and after the change. The bounding rects of the layer are mapped through
+	**	the layers above it, rects are infinite when the affected area is unknown
+	**	(e.g. some layer above blurs or distorts the layer).
+	**	Emitted synchronously together with signal_dirty_preview() for the same change,
+	**	but not necessarily before it (changes inside of the group layers come later). */
+	sigc::signal<void,synfig::Layer::Handle,synfig::Rect,synfig::Rect>& signal_layer_region_changed() { return signal_layer_region_changed_; }
+
 	//! Signal called when the canvas's preview needs to be updated
 	//sigc::signal<void>& signal_dirty_preview() { return signal_dirty_preview_; }
 	sigc::signal<void>& signal_dirty_preview() { return get_canvas()->signal_dirty(); }
@@ -60,6 +60,19 @@ void ValueDesc::on_id_changed()
 	}
 }
 
+void
+ValueDesc::get_values(const std::vector<Time> &times, std::vector<ValueBase> &out_values)const
+{
+	if(!parent_is_value_node_const() && is_value_node() && (!parent_is_canvas() || !name.empty()))
+		if(ValueNode_Animated::Handle animated = ValueNode_Animated::Handle::cast_dynamic(get_value_node()))
+			{ animated->evaluate(times, out_values); return; }
+
+	out_values.clear();
+	out_values.reserve(times.size());
+	for(std::vector<Time>::const_iterator i = times.begin(); i != times.end(); ++i)
+		out_values.push_back(get_value(*i));
+}
+
 String
 ValueDesc::get_description(bool show_exported_name)const
 {
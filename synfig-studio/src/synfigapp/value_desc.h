@@ -380,6 +380,11 @@ public:
 		return synfig::ValueBase();
 	}
 
+	//! Same as get_value() for many times at once,
+	//! animated value nodes are evaluated in one pass
+	void
+	get_values(const std::vector<synfig::Time> &times, std::vector<synfig::ValueBase> &out_values)const;
+
 	synfig::Type&
 	get_value_type()const
 	{